@@ -0,0 +1,409 @@
+// P9-ML benchmark: times the membrane passes on synthetic transformer-shaped namespaces
+//
+// The namespace has a root membrane with one membrane per layer ("blk.N"), each with an "attn" and an "ffn"
+// child holding n_obj n_embd x n_embd objects. Every repetition builds a fresh namespace, so the passes that
+// skip unmodified objects do the full work, and runs in order:
+//
+//   create   membranes and objects (the object data is filled afterwards, untimed)
+//   mixed    ggml_p9ml_mixed_precision_quantize
+//   tiled    ggml_p9ml_forward_tiled_qat
+//   qat      ggml_p9ml_apply_data_free_qat
+//   evolve   one step of a transform rule on the first object of every leaf membrane
+//   compute  ggml_p9ml_namespace_compute of a residual chain of matrix products over all the objects
+//
+// The bandwidth of a stage counts the bytes it has to read and write (see bench_stage_bytes), "-" for create.
+//
+// usage: bench-p9ml [-l n_layer] [-d n_embd] [-n n_obj] [-p n_tokens] [-q type] [-t threads,...] [-r reps] [-o md|csv|json]
+
+#include "ggml-p9ml.h"
+#include "ggml.h"
+#include "ggml-cpu.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_THREADS 16
+
+enum bench_stage {
+    BENCH_CREATE,
+    BENCH_MIXED,
+    BENCH_TILED,
+    BENCH_QAT,
+    BENCH_EVOLVE,
+    BENCH_COMPUTE,
+    BENCH_STAGE_COUNT,
+};
+
+static const char * bench_stage_names[BENCH_STAGE_COUNT] = {
+    "create", "mixed", "tiled", "qat", "evolve", "compute",
+};
+
+enum bench_output {
+    BENCH_OUTPUT_MD,
+    BENCH_OUTPUT_CSV,
+    BENCH_OUTPUT_JSON,
+};
+
+struct bench_params {
+    int n_layer;
+    int64_t n_embd;
+    int n_obj;
+    int64_t n_tokens;
+    enum ggml_type type;
+    int n_threads[BENCH_MAX_THREADS];
+    int n_thread_counts;
+    int reps;
+    enum bench_output output;
+};
+
+struct bench_result {
+    int64_t min_us;
+    int64_t max_us;
+    int64_t sum_us;
+};
+
+static void print_usage(const char * argv0, const struct bench_params * params) {
+    fprintf(stderr, "usage: %s [options]\n\n", argv0);
+    fprintf(stderr, "  -l N         layers (default: %d)\n", params->n_layer);
+    fprintf(stderr, "  -d N         hidden size (default: %" PRId64 ")\n", params->n_embd);
+    fprintf(stderr, "  -n N         objects per attn/ffn membrane (default: %d)\n", params->n_obj);
+    fprintf(stderr, "  -p N         tokens of the compute graph (default: %" PRId64 ")\n", params->n_tokens);
+    fprintf(stderr, "  -q TYPE      QAT target type (default: %s)\n", ggml_type_name(params->type));
+    fprintf(stderr, "  -t N,N,...   thread counts (default: 1,4)\n");
+    fprintf(stderr, "  -r N         repetitions (default: %d)\n", params->reps);
+    fprintf(stderr, "  -o FORMAT    md, csv or json (default: md)\n");
+}
+
+static int parse_threads(const char * arg, struct bench_params * params) {
+    params->n_thread_counts = 0;
+    while (*arg) {
+        char * end;
+        const long n = strtol(arg, &end, 10);
+        if (end == arg || n <= 0 || params->n_thread_counts == BENCH_MAX_THREADS) {
+            return -1;
+        }
+        params->n_threads[params->n_thread_counts++] = (int) n;
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return params->n_thread_counts > 0 ? 0 : -1;
+}
+
+static int parse_type(const char * arg, enum ggml_type * type) {
+    for (int t = 0; t < GGML_TYPE_COUNT; t++) {
+        const char * name = ggml_type_name((enum ggml_type) t);
+        if (name && strcmp(name, arg) == 0 && ggml_get_type_traits((enum ggml_type) t)->blck_size > 0) {
+            *type = (enum ggml_type) t;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int parse_args(int argc, char ** argv, struct bench_params * params) {
+    for (int i = 1; i < argc; i++) {
+        const char * arg = argv[i];
+        if (i + 1 >= argc || arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0') {
+            return -1;
+        }
+        const char * value = argv[++i];
+        int ok = 1;
+        switch (arg[1]) {
+            case 'l': params->n_layer  = atoi(value); ok = params->n_layer  > 0; break;
+            case 'd': params->n_embd   = atoll(value); ok = params->n_embd  > 0; break;
+            case 'n': params->n_obj    = atoi(value); ok = params->n_obj    > 0; break;
+            case 'p': params->n_tokens = atoll(value); ok = params->n_tokens > 0; break;
+            case 'r': params->reps     = atoi(value); ok = params->reps     > 0; break;
+            case 'q': ok = parse_type(value, &params->type) == 0; break;
+            case 't': ok = parse_threads(value, params) == 0; break;
+            case 'o':
+                if (strcmp(value, "md") == 0) {
+                    params->output = BENCH_OUTPUT_MD;
+                } else if (strcmp(value, "csv") == 0) {
+                    params->output = BENCH_OUTPUT_CSV;
+                } else if (strcmp(value, "json") == 0) {
+                    params->output = BENCH_OUTPUT_JSON;
+                } else {
+                    ok = 0;
+                }
+                break;
+            default: ok = 0; break;
+        }
+        if (!ok) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static struct ggml_tensor * bench_transform(
+    struct ggml_context * ctx,
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_tensor * object,
+    void * userdata) {
+    (void) membrane;
+    (void) userdata;
+    return ggml_scale(ctx, object, 0.5f);
+}
+
+// Bytes a stage reads and writes at least, 0 if it moves no object data
+static uint64_t bench_stage_bytes(const struct bench_params * params, enum bench_stage stage) {
+    const uint64_t n_objects = 2*(uint64_t) params->n_layer*params->n_obj;
+    const uint64_t object_size = ggml_row_size(GGML_TYPE_F32, params->n_embd)*params->n_embd;
+    const uint64_t act_size = ggml_row_size(GGML_TYPE_F32, params->n_embd)*params->n_tokens;
+
+    switch (stage) {
+        case BENCH_MIXED:   return n_objects*object_size;                 // the candidate types share the rows read
+        case BENCH_TILED:   return n_objects*object_size;                 // the objects are not modified
+        case BENCH_QAT:     return 2*n_objects*object_size;               // read and written back
+        case BENCH_EVOLVE:  return 2*2*(uint64_t) params->n_layer*object_size; // the first object of every leaf
+        case BENCH_COMPUTE: return n_objects*(object_size + 2*act_size) + 2*(uint64_t) params->n_layer*3*act_size;
+        default:            return 0;
+    }
+}
+
+// One repetition at the current thread count, adds the time of each stage to results
+static int bench_run(const struct bench_params * params, ggml_backend_t backend, struct bench_result * results) {
+    const int n_objects = 2*params->n_layer*params->n_obj;
+    const size_t object_size = ggml_row_size(GGML_TYPE_F32, params->n_embd)*params->n_embd;
+
+    struct ggml_init_params data_params = {
+        .mem_size = (n_objects + 1)*(ggml_tensor_overhead() + object_size) + ggml_row_size(GGML_TYPE_F32, params->n_embd)*params->n_tokens,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(data_params);
+    if (!ctx) {
+        return -1;
+    }
+
+    int64_t t_stage[BENCH_STAGE_COUNT];
+    int result = 0;
+
+    // create
+    int64_t t0 = ggml_time_us();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("bench", backend);
+    struct ggml_p9ml_membrane ** leaves = malloc(2*params->n_layer*sizeof(struct ggml_p9ml_membrane *));
+    struct ggml_p9ml_membrane * root = ns ? ggml_p9ml_namespace_membrane_new(ns, "model", 0, ctx) : NULL;
+    if (!ns || !leaves || !root || ggml_p9ml_namespace_set_root(ns, root) != 0) {
+        result = -1;
+    }
+    for (int il = 0; il < params->n_layer && result == 0; il++) {
+        char name[GGML_MAX_NAME];
+        snprintf(name, sizeof(name), "blk.%d", il);
+        struct ggml_p9ml_membrane * blk  = ggml_p9ml_namespace_membrane_new(ns, name, 1, ctx);
+        struct ggml_p9ml_membrane * attn = ggml_p9ml_namespace_membrane_new(ns, "attn", 2, ctx);
+        struct ggml_p9ml_membrane * ffn  = ggml_p9ml_namespace_membrane_new(ns, "ffn", 2, ctx);
+        if (!blk || !attn || !ffn ||
+            ggml_p9ml_membrane_add_child(root, blk) != 0 ||
+            ggml_p9ml_membrane_add_child(blk, attn) != 0 ||
+            ggml_p9ml_membrane_add_child(blk, ffn) != 0) {
+            result = -1;
+            break;
+        }
+        leaves[2*il + 0] = attn;
+        leaves[2*il + 1] = ffn;
+        for (int m = 0; m < 2 && result == 0; m++) {
+            for (int i = 0; i < params->n_obj && result == 0; i++) {
+                struct ggml_tensor * w = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, params->n_embd, params->n_embd);
+                ggml_format_name(w, "w.%d", i);
+                result = ggml_p9ml_membrane_add_object(leaves[2*il + m], w);
+            }
+        }
+    }
+    t_stage[BENCH_CREATE] = ggml_time_us() - t0;
+
+    if (result == 0) {
+        for (int l = 0; l < 2*params->n_layer; l++) {
+            for (int i = 0; i < params->n_obj; i++) {
+                struct ggml_tensor * w = leaves[l]->objects[i];
+                ggml_p9ml_noise_fill((float *) w->data, ggml_nelements(w), 0, GGML_P9ML_DEFAULT_SEED,
+                    (uint64_t) l*params->n_obj + i, GGML_P9ML_NOISE_GAUSSIAN, 0.02f);
+            }
+        }
+    }
+
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(params->type, 0.0f);
+    if (!config) {
+        result = -1;
+    }
+
+    // mixed, tiled, qat
+    t0 = ggml_time_us();
+    if (result == 0) {
+        result = ggml_p9ml_mixed_precision_quantize(root, 0.01f);
+    }
+    t_stage[BENCH_MIXED] = ggml_time_us() - t0;
+
+    t0 = ggml_time_us();
+    if (result == 0) {
+        result = ggml_p9ml_forward_tiled_qat(root, config, NULL);
+    }
+    t_stage[BENCH_TILED] = ggml_time_us() - t0;
+
+    t0 = ggml_time_us();
+    if (result == 0) {
+        result = ggml_p9ml_apply_data_free_qat(root, config);
+    }
+    t_stage[BENCH_QAT] = ggml_time_us() - t0;
+
+    // evolve
+    for (int l = 0; l < 2*params->n_layer && result == 0; l++) {
+        result = ggml_p9ml_membrane_add_rule(leaves[l], ggml_p9ml_rule_transform(0, bench_transform, NULL));
+    }
+    t0 = ggml_time_us();
+    if (result == 0) {
+        result = ggml_p9ml_membrane_evolve(root);
+    }
+    t_stage[BENCH_EVOLVE] = ggml_time_us() - t0;
+
+    // compute
+    const size_t graph_size = 2*(size_t) n_objects + 4*(size_t) params->n_layer + 16;
+    struct ggml_init_params graph_params = {
+        .mem_size = graph_size*ggml_tensor_overhead() + ggml_graph_overhead_custom(graph_size, false),
+        .mem_buffer = NULL,
+        .no_alloc = true,
+    };
+    struct ggml_context * gctx = result == 0 ? ggml_init(graph_params) : NULL;
+    if (result == 0 && !gctx) {
+        result = -1;
+    }
+    if (result == 0) {
+        struct ggml_tensor * x = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, params->n_embd, params->n_tokens);
+        ggml_p9ml_noise_fill((float *) x->data, ggml_nelements(x), 0, GGML_P9ML_DEFAULT_SEED, (uint64_t) -1,
+            GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+        struct ggml_tensor * cur = x;
+        for (int l = 0; l < 2*params->n_layer; l++) {
+            struct ggml_tensor * h = cur;
+            for (int i = 0; i < params->n_obj; i++) {
+                h = ggml_mul_mat(gctx, leaves[l]->objects[i], h);
+            }
+            cur = ggml_add(gctx, cur, h);
+        }
+        struct ggml_cgraph * graph = ggml_new_graph_custom(gctx, graph_size, false);
+        ggml_build_forward_expand(graph, cur);
+
+        t0 = ggml_time_us();
+        result = ggml_p9ml_namespace_compute(ns, graph);
+        t_stage[BENCH_COMPUTE] = ggml_time_us() - t0;
+    }
+
+    if (result == 0) {
+        for (int s = 0; s < BENCH_STAGE_COUNT; s++) {
+            struct bench_result * r = &results[s];
+            r->min_us = t_stage[s] < r->min_us ? t_stage[s] : r->min_us;
+            r->max_us = t_stage[s] > r->max_us ? t_stage[s] : r->max_us;
+            r->sum_us += t_stage[s];
+        }
+    }
+
+    if (gctx) {
+        ggml_free(gctx);
+    }
+    if (config) {
+        ggml_p9ml_qat_config_free(config);
+    }
+    free(leaves);
+    if (ns) {
+        ggml_p9ml_namespace_free(ns);
+    }
+    ggml_free(ctx);
+
+    return result;
+}
+
+int main(int argc, char ** argv) {
+    struct bench_params params = {
+        .n_layer = 4,
+        .n_embd = 512,
+        .n_obj = 4,
+        .n_tokens = 32,
+        .type = GGML_TYPE_Q4_0,
+        .n_threads = { 1, 4 },
+        .n_thread_counts = 2,
+        .reps = 3,
+        .output = BENCH_OUTPUT_MD,
+    };
+    if (parse_args(argc, argv, &params) != 0) {
+        print_usage(argv[0], &params);
+        return 1;
+    }
+
+    ggml_time_init();
+
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    if (!backend) {
+        fprintf(stderr, "failed to initialize the CPU backend\n");
+        return 1;
+    }
+
+    if (params.output == BENCH_OUTPUT_MD) {
+        printf("| n_layer | n_embd | n_obj | type | threads | stage | avg ms | min ms | max ms | GB/s |\n");
+        printf("| ---: | ---: | ---: | --- | ---: | --- | ---: | ---: | ---: | ---: |\n");
+    } else if (params.output == BENCH_OUTPUT_CSV) {
+        printf("n_layer,n_embd,n_obj,n_tokens,type,n_threads,stage,reps,avg_us,min_us,max_us,bytes\n");
+    } else {
+        printf("[");
+    }
+
+    int result = 0;
+    int n_printed = 0;
+    for (int t = 0; t < params.n_thread_counts && result == 0; t++) {
+        ggml_backend_cpu_set_n_threads(backend, params.n_threads[t]);
+
+        struct bench_result results[BENCH_STAGE_COUNT];
+        for (int s = 0; s < BENCH_STAGE_COUNT; s++) {
+            results[s].min_us = INT64_MAX;
+            results[s].max_us = 0;
+            results[s].sum_us = 0;
+        }
+        for (int r = 0; r < params.reps && result == 0; r++) {
+            result = bench_run(&params, backend, results);
+        }
+        if (result != 0) {
+            fprintf(stderr, "benchmark failed with %d threads\n", params.n_threads[t]);
+            break;
+        }
+
+        for (int s = 0; s < BENCH_STAGE_COUNT; s++) {
+            const struct bench_result * r = &results[s];
+            const double avg_us = (double) r->sum_us/params.reps;
+            const uint64_t bytes = bench_stage_bytes(&params, (enum bench_stage) s);
+            char gbps[32] = "-";
+            char nbytes[32] = "";
+            if (bytes > 0) {
+                snprintf(gbps, sizeof(gbps), "%.2f", avg_us > 0 ? bytes/avg_us/1e3 : 0.0);
+                snprintf(nbytes, sizeof(nbytes), "%" PRIu64, bytes);
+            }
+            switch (params.output) {
+                case BENCH_OUTPUT_MD:
+                    printf("| %d | %" PRId64 " | %d | %s | %d | %s | %.3f | %.3f | %.3f | %s |\n",
+                        params.n_layer, params.n_embd, params.n_obj, ggml_type_name(params.type), params.n_threads[t],
+                        bench_stage_names[s], avg_us/1e3, r->min_us/1e3, r->max_us/1e3, gbps);
+                    break;
+                case BENCH_OUTPUT_CSV:
+                    printf("%d,%" PRId64 ",%d,%" PRId64 ",%s,%d,%s,%d,%.1f,%" PRId64 ",%" PRId64 ",%s\n",
+                        params.n_layer, params.n_embd, params.n_obj, params.n_tokens, ggml_type_name(params.type),
+                        params.n_threads[t], bench_stage_names[s], params.reps, avg_us, r->min_us, r->max_us, nbytes);
+                    break;
+                case BENCH_OUTPUT_JSON:
+                    printf("%s\n  {\"n_layer\": %d, \"n_embd\": %" PRId64 ", \"n_obj\": %d, \"n_tokens\": %" PRId64 ", "
+                        "\"type\": \"%s\", \"n_threads\": %d, \"stage\": \"%s\", \"reps\": %d, "
+                        "\"avg_us\": %.1f, \"min_us\": %" PRId64 ", \"max_us\": %" PRId64 ", \"bytes\": %s}",
+                        n_printed > 0 ? "," : "", params.n_layer, params.n_embd, params.n_obj, params.n_tokens,
+                        ggml_type_name(params.type), params.n_threads[t], bench_stage_names[s], params.reps,
+                        avg_us, r->min_us, r->max_us, bytes > 0 ? nbytes : "null");
+                    break;
+            }
+            n_printed++;
+        }
+    }
+
+    if (params.output == BENCH_OUTPUT_JSON) {
+        printf("\n]\n");
+    }
+
+    ggml_backend_free(backend);
+
+    return result == 0 ? 0 : 1;
+}
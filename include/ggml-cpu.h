@@ -19,6 +19,9 @@ extern "C" {
         // abort ggml_graph_compute when true
         ggml_abort_callback abort_callback;
         void *              abort_callback_data;
+
+        // skip the barrier between nodes that do not depend on each other (enabled by `ggml_graph_plan()`)
+        bool use_dag;
     };
 
     // numa strategies
@@ -33,6 +36,8 @@ extern "C" {
 
     GGML_BACKEND_API void    ggml_numa_init(enum ggml_numa_strategy numa); // call once for better performance on NUMA systems
     GGML_BACKEND_API bool    ggml_is_numa(void); // true if init detected that system has >1 NUMA node
+    GGML_BACKEND_API int     ggml_numa_n_nodes(void); // NUMA nodes found by init (0 if not initialized)
+    GGML_BACKEND_API int     ggml_numa_thread_node(int ith); // node compute thread ith is bound to by the strategy (-1: none)
 
     GGML_BACKEND_API struct ggml_tensor * ggml_new_i32(struct ggml_context * ctx, int32_t value);
     GGML_BACKEND_API struct ggml_tensor * ggml_new_f32(struct ggml_context * ctx, float value);
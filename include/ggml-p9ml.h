@@ -9,6 +9,7 @@
 //
 
 #include "ggml.h"
+#include "ggml-alloc.h"
 #include "ggml-backend.h"
 
 #ifdef __cplusplus
@@ -19,6 +20,112 @@ extern "C" {
 typedef struct ggml_p9ml_membrane ggml_p9ml_membrane;
 typedef struct ggml_p9ml_namespace ggml_p9ml_namespace;
 typedef struct ggml_p9ml_qat_config ggml_p9ml_qat_config;
+typedef struct ggml_p9ml_arena ggml_p9ml_arena;
+typedef struct ggml_p9ml_shard ggml_p9ml_shard;
+typedef struct ggml_p9ml_mapping ggml_p9ml_mapping;
+typedef struct ggml_p9ml_index ggml_p9ml_index;
+typedef struct ggml_p9ml_cow ggml_p9ml_cow;
+typedef struct ggml_p9ml_stats ggml_p9ml_stats;
+typedef struct ggml_p9ml_executor ggml_p9ml_executor;
+
+#define GGML_P9ML_DEFAULT_SEED 0x9E3779B97F4A7C15ULL
+#define GGML_P9ML_MAX_BACKENDS 16
+#define GGML_P9ML_NUMA_MAX_NODES 8          // NUMA nodes a membrane can be placed on (as ggml-cpu)
+#define GGML_P9ML_MP_TYPES 9                // candidate types of the mixed-precision search
+#define GGML_P9ML_STATS_PATH_MAX 128        // membrane paths of the stats records (longer ones are replaced by the name)
+
+// Passes that skip unmodified objects (bits of ggml_p9ml_membrane::dirty)
+#define GGML_P9ML_DIRTY_QAT   1u
+#define GGML_P9ML_DIRTY_MIXED 2u
+#define GGML_P9ML_DIRTY_ALL   (GGML_P9ML_DIRTY_QAT | GGML_P9ML_DIRTY_MIXED)
+
+// Noise distributions of the counter-based generator
+enum ggml_p9ml_noise_type {
+    GGML_P9ML_NOISE_UNIFORM,                // uniform in [-scale, scale)
+    GGML_P9ML_NOISE_GAUSSIAN,               // normal with standard deviation scale
+};
+
+// Instrumented operations (ggml_p9ml_stats_record::pass)
+enum ggml_p9ml_pass {
+    GGML_P9ML_PASS_QAT,                     // ggml_p9ml_apply_data_free_qat
+    GGML_P9ML_PASS_TILED_QAT,               // ggml_p9ml_forward_tiled_qat
+    GGML_P9ML_PASS_MIXED_PRECISION,         // ggml_p9ml_mixed_precision_quantize
+    GGML_P9ML_PASS_CALIBRATE,               // ggml_p9ml_calibrate
+    GGML_P9ML_PASS_TRAIN,                   // ggml_p9ml_qat_train (the final QAT pass has its own records)
+    GGML_P9ML_PASS_EVOLVE,                  // ggml_p9ml_membrane_evolve
+    GGML_P9ML_PASS_COMPUTE,                 // ggml_p9ml_namespace_compute
+    GGML_P9ML_PASS_COUNT,
+};
+
+// What ggml_p9ml_namespace_set_stats records
+#define GGML_P9ML_STATS_PASSES 1u           // one record per run, and per membrane for the fake-quantization passes
+#define GGML_P9ML_STATS_NODES  2u           // per-membrane records of ggml_p9ml_namespace_compute, timed node by node
+
+// Evolution rules
+// All the rules of the membranes of a tree are lowered into a single graph per evolution step. Rules read the
+// objects as they were at the start of the step, and their results are written back at the end of it.
+enum ggml_p9ml_rule_type {
+    GGML_P9ML_RULE_TRANSFORM,               // object = transform(object)
+    GGML_P9ML_RULE_COMMUNICATE,             // copy an object into an object of the parent or of a child
+    GGML_P9ML_RULE_DIVIDE,                  // add a copy-on-write clone of the subtree as a sibling (fires once)
+    GGML_P9ML_RULE_DISSOLVE,                // remove the membrane, its objects and children move to the parent
+    GGML_P9ML_RULE_MOVE,                    // move an object to the parent or to a child (fires once, no copy)
+    GGML_P9ML_RULE_SHARE,                   // add a view of an object to the parent or to a child (fires once, no copy)
+};
+
+// Emits the ops computing the new value of an object in ctx (must not modify the object in place)
+typedef struct ggml_tensor * (*ggml_p9ml_transform_t)(
+    struct ggml_context * ctx,
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_tensor * object,
+    void * userdata);
+
+struct ggml_p9ml_rule {
+    enum ggml_p9ml_rule_type type;
+    int object;                             // source object (TRANSFORM, COMMUNICATE, MOVE, SHARE)
+    int target;                             // COMMUNICATE, MOVE, SHARE: child index, -1 for the parent
+    int target_object;                      // COMMUNICATE: object of the target membrane
+    ggml_p9ml_transform_t transform;        // TRANSFORM: ops of the new value
+    void * userdata;                        // TRANSFORM: passed to transform
+};
+
+// Per-tile error map of a membrane object (forward tiled QAT)
+// Tiles cover tile_rows rows and tile_cols columns (whole quantization blocks), the last tile of a row or column may be smaller
+struct ggml_p9ml_tile_map {
+    int64_t tile_cols;                      // columns per tile
+    int64_t tile_rows;                      // rows per tile
+    int64_t n_x;                            // tiles per row
+    int64_t n_y;                            // tiles per column
+    int64_t capacity;                       // allocated tiles
+    float * rmse;                           // n_y x n_x tile RMSE, row-major (NULL if not computed)
+};
+
+// Calibration of a membrane object (ggml_p9ml_calibrate)
+struct ggml_p9ml_calibration {
+    int64_t n_cols;                         // entries of imatrix (ne[0] of the object)
+    int64_t n_rows;                         // rows of scales (0: no scales)
+    int64_t n_row_scales;                   // scales per row: 1 (per channel) or one per quantization block
+    float * imatrix;                        // mean square of the synthetic activations per input column (NULL if not calibrated)
+    float * scales;                         // n_rows x n_row_scales scales applied before quantization
+};
+
+// Modification tracking of a membrane object
+// The version is bumped whenever P9-ML writes the object (QAT, evolution rules) or ggml_p9ml_membrane_touch
+// is called, passes remember the version they saw and skip the object while it does not change
+struct ggml_p9ml_object_state {
+    uint64_t version;                       // bumped on every modification of the object
+    uint64_t id;                            // noise stream of the object (0: not assigned yet, see ggml_p9ml_noise_fill)
+    uint64_t qat_version;                   // version written by the last QAT pass (0: none)
+    uint64_t qat_key;                       // settings of that pass (type, noise, seed)
+    uint64_t mp_version;                    // version the mixed-precision errors were measured at (0: none)
+    double mp_sq_src;                       // sum(w^2)
+    double mp_sq_err[GGML_P9ML_MP_TYPES];   // sum(|w - q(w)|^2) per candidate type (< 0: not a candidate)
+    int * refs;                             // number of membrane slots sharing the data of the object (NULL: not shared), does not keep the data alive
+    bool alias;                             // view added by a share rule (the passes that write objects skip it)
+    struct ggml_p9ml_cow * cow;             // objects of divided membranes reading the same data (NULL: not shared)
+    void * cow_data;                        // private copy of the data made by the first write while shared (or NULL)
+    bool cow_clone;                         // the data is read from another object (not counted by the memory budget)
+};
 
 // Membrane Computing Abstraction
 // Represents a computational membrane with rules and objects
@@ -27,23 +134,38 @@ struct ggml_p9ml_membrane {
     int level;                              // membrane hierarchy level
     struct ggml_context * ctx;              // GGML context for this membrane
     struct ggml_p9ml_namespace * ns;        // associated namespace
+    struct ggml_p9ml_arena * arena;         // owning namespace arena (NULL if heap-allocated)
     struct ggml_p9ml_membrane * parent;     // parent membrane (NULL for root)
     struct ggml_p9ml_membrane ** children;  // child membranes
+    int backend_id;                         // namespace backend of the objects of the subtree (-1: same as the parent)
+    int numa_node;                          // NUMA node of the host objects and pass tasks of the subtree (-1: same as the parent)
     int num_children;                       // number of child membranes
-    int max_children;                       // maximum children capacity
+    int max_children;                       // children capacity (grows on demand)
     
     // Membrane objects (tensors)
     struct ggml_tensor ** objects;          // tensors in this membrane
+    float * object_errors;                  // per-object RMSE of the last QAT pass (-1 if not quantized)
+    enum ggml_type * object_types;          // per-object type chosen by the mixed-precision search
+    struct ggml_p9ml_tile_map * tile_maps;  // per-object tile errors of the last forward tiled QAT
+    struct ggml_p9ml_object_state * object_states; // per-object versions and cached pass results
+    struct ggml_p9ml_calibration * calibrations;   // per-object importance matrix and channel scales
     int num_objects;                        // number of objects
-    int max_objects;                        // maximum objects capacity
+    int max_objects;                        // objects capacity (grows on demand)
     
     // Evolution rules (transformations)
-    void ** rules;                          // function pointers for rules
+    struct ggml_p9ml_rule * rules;          // rules, applied in order
     int num_rules;                          // number of rules
-    int max_rules;                          // maximum rules capacity
+    int max_rules;                          // rules capacity (grows on demand)
     
     // Quantization context
     struct ggml_p9ml_qat_config * qat_config;
+    uint32_t dirty;                         // passes with modified objects in the subtree (GGML_P9ML_DIRTY_*)
+    uint64_t qat_key;                       // settings of the last QAT pass over the subtree
+    
+    // Memory budget
+    size_t nbytes;                          // bytes of the host objects (updated as objects are added and removed)
+    uint64_t last_use;                      // namespace clock of the last pass or graph that used the objects
+    uint64_t spill_id;                      // spill file of the evicted objects (0: resident)
 };
 
 // Distributed Namespace Management
@@ -51,9 +173,31 @@ struct ggml_p9ml_membrane {
 struct ggml_p9ml_namespace {
     char name[64];                          // namespace identifier
     struct ggml_p9ml_membrane * root;       // root membrane
-    struct ggml_backend * backend;          // computation backend
+    struct ggml_backend * backend;          // computation backend (first of backends)
+    ggml_backend_t backends[GGML_P9ML_MAX_BACKENDS]; // scheduler backends in priority order
+    int n_backends;
+    ggml_backend_sched_t sched;             // scheduler of ggml_p9ml_namespace_compute (created on first use)
+    size_t sched_graph_size;                // graph size the scheduler was created for
+    ggml_backend_buffer_type_t sched_bufts[GGML_P9ML_MAX_BACKENDS]; // buffer types allocating from a default buffer type shared with another backend (or NULL)
+    struct ggml_p9ml_shard * shards;        // device copies of the objects placed on backends without host memory
+    int n_shards;
+    int max_shards;
+    struct ggml_threadpool * threadpool;    // threadpool used for membrane passes (CPU backend only)
+    struct ggml_p9ml_arena * arena;         // storage of the membranes created with ggml_p9ml_namespace_membrane_new
+    ggml_gallocr_t galloc;                  // allocator of the evolution graphs (reused across steps)
+    struct ggml_p9ml_mapping * mapping;     // file the objects of a loaded namespace are mapped from (or NULL)
+    struct ggml_p9ml_index * index;         // names and paths of the objects of the tree (built on first lookup, NULL when stale)
+    struct ggml_p9ml_stats * stats;         // records of the instrumented operations (NULL: disabled)
+    
+    // Memory budget
+    size_t memory_budget;                   // bytes of host objects the resident membranes may hold (0: unlimited)
+    char * spill_prefix;                    // evicted membranes are written to <spill_prefix>.<spill_id>.gguf (or NULL)
+    uint64_t n_spills;                      // spill files written
+    int evict_status;                       // result of the eviction that followed the last compute (0: fits or nothing to evict)
+    uint64_t clock;                         // bumped by every pass and graph, orders the membranes by last use
     
     // Global namespace properties
+    uint64_t seed;                          // key of the namespace noise streams
     float noise_scale;                      // for data-free QAT
     int target_bits;                        // target quantization bits
     bool mixed_precision;                   // enable mixed precision
@@ -64,6 +208,26 @@ struct ggml_p9ml_namespace {
     float compression_ratio;                // achieved compression
 };
 
+// Graph of a namespace submitted to an executor
+struct ggml_p9ml_executor_entry {
+    struct ggml_p9ml_namespace * ns;
+    struct ggml_cgraph * graph;
+};
+
+// Batched executor of the graphs of many namespaces
+struct ggml_p9ml_executor {
+    ggml_backend_t backend;                 // CPU backend the batches are computed on
+    struct ggml_threadpool * threadpool;    // threadpool of the backend (or NULL)
+    ggml_gallocr_t * gallocs;               // allocator of each batch of a run (reused across runs)
+    int n_gallocs;
+    int max_nodes;                          // nodes of a batch (a larger graph is computed alone)
+    struct ggml_p9ml_executor_entry * entries; // graphs submitted since the last run, in order
+    int n_entries;
+    int max_entries;
+    int n_batches;                          // graphs computed by the last run: batches and
+    int n_single;                           // graphs of the namespaces that cannot be batched
+};
+
 // Data-Free QAT Configuration
 // Configuration for data-free quantization aware training
 struct ggml_p9ml_qat_config {
@@ -77,8 +241,12 @@ struct ggml_p9ml_qat_config {
     int num_steps;                          // training steps
     float learning_rate;                    // learning rate for QAT
     
+    // Calibration
+    int scale_steps;                        // candidate scales on each side of 1 (0: no scale search)
+    float scale_range;                      // the candidates span [1 - scale_range, 1 + scale_range]
+    
     // Forward tiled QAT
-    int tile_size;                          // tile size for forward QAT
+    int tile_size;                          // elements per tile, rounded to whole quant blocks (0 = cache-sized)
     bool use_reference;                     // use FP reference
 };
 
@@ -90,6 +258,7 @@ GGML_API struct ggml_p9ml_membrane * ggml_p9ml_membrane_new(
     int level,
     struct ggml_context * ctx);
 
+// Free a membrane and its subtree, the membrane is removed from its parent (or from its namespace if it is the root)
 GGML_API void ggml_p9ml_membrane_free(struct ggml_p9ml_membrane * membrane);
 
 GGML_API int ggml_p9ml_membrane_add_child(
@@ -100,17 +269,103 @@ GGML_API int ggml_p9ml_membrane_add_object(
     struct ggml_p9ml_membrane * membrane,
     struct ggml_tensor * tensor);
 
+// Mark an object (all of them if index < 0) as modified outside of P9-ML
+// The next QAT and mixed-precision passes process it again, the membrane and its ancestors become dirty
+GGML_API int ggml_p9ml_membrane_touch(
+    struct ggml_p9ml_membrane * membrane,
+    int index);
+
+// Evolution rules
+GGML_API struct ggml_p9ml_rule ggml_p9ml_rule_transform(int object, ggml_p9ml_transform_t transform, void * userdata);
+GGML_API struct ggml_p9ml_rule ggml_p9ml_rule_communicate(int object, int target, int target_object);
+GGML_API struct ggml_p9ml_rule ggml_p9ml_rule_divide(void);
+GGML_API struct ggml_p9ml_rule ggml_p9ml_rule_dissolve(void);
+GGML_API struct ggml_p9ml_rule ggml_p9ml_rule_move(int object, int target);
+GGML_API struct ggml_p9ml_rule ggml_p9ml_rule_share(int object, int target);
+
+GGML_API int ggml_p9ml_membrane_add_rule(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_rule rule);
+
 // Namespace management
 GGML_API struct ggml_p9ml_namespace * ggml_p9ml_namespace_new(
     const char * name,
     struct ggml_backend * backend);
 
+// Frees the namespace arena, and with it every membrane created with ggml_p9ml_namespace_membrane_new
 GGML_API void ggml_p9ml_namespace_free(struct ggml_p9ml_namespace * ns);
 
+// Create a membrane (and its tables) in the namespace arena
+// The membrane is owned by the namespace: ggml_p9ml_membrane_free is optional and does not release memory
+GGML_API struct ggml_p9ml_membrane * ggml_p9ml_namespace_membrane_new(
+    struct ggml_p9ml_namespace * ns,
+    const char * name,
+    int level,
+    struct ggml_context * ctx);
+
 GGML_API int ggml_p9ml_namespace_set_root(
     struct ggml_p9ml_namespace * ns,
     struct ggml_p9ml_membrane * root);
 
+// Attach a threadpool to the namespace backend (must be a CPU backend)
+// Membrane passes (QAT, ...) are chunked by row across its threads
+GGML_API int ggml_p9ml_namespace_set_threadpool(
+    struct ggml_p9ml_namespace * ns,
+    struct ggml_threadpool * threadpool);
+
+// Object lookup
+// key is an object name ("attn.q_proj") or an object path: the names of the membranes from the root and the name
+// of the object, separated by '/' ("model/attn/q_proj"). The first match in breadth-first order is returned, with
+// its membrane and slot if membrane and slot are not NULL (NULL if there is none).
+// The index is hashed, objects added to the tree are indexed as they are added and structural changes (new
+// children, dissolved membranes) rebuild it on the next lookup. Objects are indexed under the name they had when added.
+GGML_API struct ggml_tensor * ggml_p9ml_namespace_find(
+    struct ggml_p9ml_namespace * ns,
+    const char * key,
+    struct ggml_p9ml_membrane ** membrane,
+    int * slot);
+
+// Add a backend to the namespace scheduler, returns its index (the namespace backend is index 0)
+// Backends are in priority order, the scheduler needs the last one to be a CPU backend
+GGML_API int ggml_p9ml_namespace_add_backend(
+    struct ggml_p9ml_namespace * ns,
+    ggml_backend_t backend);
+
+// Place the objects of a membrane subtree, and the ops that consume them, on a namespace backend
+// (-1: same as the parent, unplaced tensors are assigned by the scheduler)
+GGML_API int ggml_p9ml_membrane_set_backend(
+    struct ggml_p9ml_membrane * membrane,
+    int backend_id);
+
+// Copy the objects of the membranes placed on backends that cannot use host memory (e.g. ggml-rpc) into
+// buffers of those backends, the membranes then refer to the device tensors (owned by the namespace),
+// the host tensors are not modified
+// Tensors larger than the RPC hash threshold are sent by hash to servers started with a cache
+// QAT, tiled QAT and mixed precision process the device objects on their backends, in parallel with each
+// other and with the host objects (backends that do not support GGML_OP_FAKE_QUANT go through a CPU backend)
+GGML_API int ggml_p9ml_namespace_upload(struct ggml_p9ml_namespace * ns);
+
+// Spread the child subtrees of the namespace root over the given backends, balancing the size of their
+// objects (largest subtree first on the least loaded backend), then upload them
+GGML_API int ggml_p9ml_namespace_shard(
+    struct ggml_p9ml_namespace * ns,
+    const int * backend_ids,
+    int n_backend_ids);
+
+// NUMA placement
+// Uses the topology of ggml_numa_init: with GGML_NUMA_STRATEGY_DISTRIBUTE (or ISOLATE) the threads of the CPU backend
+// are bound to the nodes, and the tasks of the passes over the objects of a membrane placed on a node (QAT, tiled QAT,
+// mixed precision) are run by the threads of that node first. Threads out of work take the unplaced tasks, then
+// those of the other nodes. Fails if ggml_numa_init was not called or the node does not exist (-1: same as the parent).
+GGML_API int ggml_p9ml_membrane_set_numa_node(
+    struct ggml_p9ml_membrane * membrane,
+    int node);
+
+// Bind the pages of the host objects of the membranes placed on a node to it (moving the pages already touched)
+// Objects that read the data of another one (views, shared and copy-on-write clones) are left to their owner.
+// The policy stays with the pages: evicted objects are reloaded on their node. Linux only.
+GGML_API int ggml_p9ml_namespace_numa_bind(struct ggml_p9ml_namespace * ns);
+
 // Data-Free QAT Functions
 GGML_API struct ggml_p9ml_qat_config * ggml_p9ml_qat_config_new(
     enum ggml_type target_type,
@@ -118,11 +373,56 @@ GGML_API struct ggml_p9ml_qat_config * ggml_p9ml_qat_config_new(
 
 GGML_API void ggml_p9ml_qat_config_free(struct ggml_p9ml_qat_config * config);
 
+// Fake-quantize every object of the membrane tree to config->target_type
+// (quantize + dequantize round-trip, written back in the original type)
+// The per-object RMSE is stored in membrane->object_errors
+// Objects already fake-quantized with the same settings and not modified since are skipped
+// Calibrated objects are quantized with their importance matrix and channel scales
 GGML_API int ggml_p9ml_apply_data_free_qat(
     struct ggml_p9ml_membrane * membrane,
     struct ggml_p9ml_qat_config * config);
 
-// Generate synthetic data for data-free training
+// Data-free calibration
+// Synthetic Gaussian activations (namespace seed, id of the object, see ggml_p9ml_noise_fill) flow
+// through the 2D objects of each membrane on the namespace CPU backend: an object whose rows match the outputs
+// of the previous object gets them, RMS-normalized, as its input. The mean square of the activations of each
+// input column is the importance matrix of the object, used by the following QAT passes (required by the IQ
+// types that need one). With config->per_channel, scales are searched among 1 + k*scale_range/scale_steps,
+// k = -scale_steps..scale_steps, to minimize the importance-weighted error of target_type: one per quantization
+// block when the blocks of target_type carry their own scale (the search scale folds into it), one per output
+// channel otherwise.
+GGML_API int ggml_p9ml_calibrate(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_qat_config * config);
+
+// Straight-through-estimator QAT
+// The 2D objects quantizable to config->target_type are trained with ggml-opt (AdamW, learning_rate, num_steps
+// steps) on the namespace CPU backend: the forward pass uses ggml_fake_quant_ext(w) with the calibrated scales and
+// importance matrix, whose gradient reaches the FP weights w unchanged, and the loss is the output error against the FP weights before
+// training on fresh synthetic Gaussian inputs (scaled by the calibrated RMS of each column, if any).
+// The trained weights are then fake-quantized as by ggml_p9ml_apply_data_free_qat
+GGML_API int ggml_p9ml_qat_train(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_qat_config * config);
+
+// Counter-based noise (Philox4x32-10)
+// Element i of the stream (seed, id) only depends on (seed, id, i), so the result does not depend
+// on how the work is split: dst[j] = noise(seed, id, offset + j) for j in [0, n)
+// QAT noise uses the namespace seed and the id of the object (ggml_p9ml_object_state::id): a hash of its name, slot
+// and membrane path taken when a pass first needs it, then kept by the object when it moves, its membrane
+// dissolves or divides, so it does not depend on the membrane a pass starts from
+GGML_API void ggml_p9ml_noise_fill(
+    float * dst,
+    int64_t n,
+    int64_t offset,
+    uint64_t seed,
+    uint64_t id,
+    enum ggml_p9ml_noise_type type,
+    float scale);
+
+// Generate synthetic data for data-free training (Gaussian, standard deviation noise_scale)
+// The data is drawn from the stream (GGML_P9ML_DEFAULT_SEED, offset of the tensor in ctx), so it only
+// depends on the contents of ctx
 GGML_API struct ggml_tensor * ggml_p9ml_generate_synthetic_data(
     struct ggml_context * ctx,
     const int64_t * shape,
@@ -130,24 +430,170 @@ GGML_API struct ggml_tensor * ggml_p9ml_generate_synthetic_data(
     float noise_scale);
 
 // Forward tiled QAT
+// Fake-quantizes every object of the membrane tree to config->target_type tile by tile, in parallel, and
+// stores the RMSE of each tile against the FP reference in membrane->tile_maps (the whole-object RMSE in
+// object_errors). With a reference, only the objects of its shape are processed (the others keep an
+// object_errors of -1 and an empty tile map, -1 if there is none); NULL (or !config->use_reference)
+// compares each object against its own values. Only one tile per thread is dequantized at a time and
+// the objects are not modified.
 GGML_API int ggml_p9ml_forward_tiled_qat(
     struct ggml_p9ml_membrane * membrane,
     struct ggml_p9ml_qat_config * config,
     struct ggml_tensor * reference);
 
 // Mixed-precision quantization
+// Measures the quantization error of every candidate type on every object of the membrane tree and
+// picks the types with the smallest total size such that the relative error of the whole tree,
+// sum(|w - q(w)|^2) / sum(|w|^2), stays under quality_threshold
+// The choice is stored in membrane->object_types / object_errors (the tensors are not modified) and
+// in the namespace quantized_params and compression_ratio
+// The errors of the objects not modified since the previous search are reused
 GGML_API int ggml_p9ml_mixed_precision_quantize(
     struct ggml_p9ml_membrane * membrane,
     float quality_threshold);
 
 // Membrane evolution (P-Systems computation)
+// One step of all the rules of the membrane tree, computed as a single graph on the namespace CPU backend
+// (through ggml_p9ml_namespace_compute when the namespace has several backends).
+// Divided membranes are cloned (as by ggml_p9ml_membrane_divide) at the start of the step and added to the parent
+// after it, then moved and shared objects are transferred, then dissolved membranes are removed from the tree and freed. A moved object takes its state (versions, calibration) along and the rules
+// that refer to it are removed, a shared object is aliased by a view in the context of the target membrane (that
+// needs room for the tensor). Neither copies data. The transfers of a step are all checked before the step is
+// computed: an object moved twice, or shared after it moved, fails the step and leaves the tree unchanged.
+// The alias does not own the data of a shared object: the context (or buffer) that holds the object must outlive
+// every membrane that shares it. The slots that share the data are only counted so that the object is not evicted
+// and is copied when its membrane divides, freeing a membrane removes its slots from the count.
 GGML_API int ggml_p9ml_membrane_evolve(struct ggml_p9ml_membrane * membrane);
 
+// Copy-on-write division
+// Clone the subtree of a membrane (objects, rules, calibrations and what the passes know about the objects) and add
+// it to the parent of the membrane, returns the clone or NULL (a root cannot divide). The cloned objects are new
+// tensors in the contexts of the original membranes (that need room for the tensors) that read the data of the
+// originals: the first write of P9-ML to an object that shares its data (QAT, STE training, evolution rules) gives it a
+// private copy, the other objects keep the data. Clones only count the copies they own in the memory budget, and
+// are not evicted while they share data. Objects shared by a share rule are copied when cloned, device objects cannot
+// be cloned. Call ggml_p9ml_membrane_unshare before writing an object outside of P9-ML.
+GGML_API struct ggml_p9ml_membrane * ggml_p9ml_membrane_divide(struct ggml_p9ml_membrane * membrane);
+
+// Give an object (all of them if index < 0) that shares its data with a clone or an original its own copy
+GGML_API int ggml_p9ml_membrane_unshare(
+    struct ggml_p9ml_membrane * membrane,
+    int index);
+
 // Distributed computation across namespace
+// The graph is split by ggml_backend_sched over the namespace backends following the membrane placement,
+// a single non-CPU backend computes the graph directly
+// Objects placed on a backend that cannot use host memory must be allocated in a backend buffer
 GGML_API int ggml_p9ml_namespace_compute(
     struct ggml_p9ml_namespace * ns,
     struct ggml_cgraph * graph);
 
+// Batched execution
+// Graphs of namespaces computed on one CPU backend are merged, in submission order, into batches of up to max_nodes
+// nodes (0: GGML_DEFAULT_GRAPH_SIZE) computed at once on the executor backend (with the threadpool, if any), so that
+// small graphs do not each pay for a graph launch and the synchronization of all the threads. The intermediate
+// tensors are allocated by the executor and valid until the next run: as with ggml_backend_sched, a graph is built
+// for the run it is submitted to. The graphs of the other namespaces
+// (several backends, non-CPU backend) are computed by ggml_p9ml_namespace_compute. Evicted membranes are reloaded
+// and the memory budgets enforced as by ggml_p9ml_namespace_compute. A node shared with a graph of an earlier batch
+// of the run is not computed again.
+// With a threadpool, the executor takes over the backend: it sets the threadpool of the backend and its number of
+// threads to those of the threadpool. ggml_p9ml_executor_free detaches the threadpool, the number of threads stays.
+GGML_API struct ggml_p9ml_executor * ggml_p9ml_executor_new(
+    ggml_backend_t backend,
+    struct ggml_threadpool * threadpool,
+    int max_nodes);
+GGML_API void ggml_p9ml_executor_free(struct ggml_p9ml_executor * exec);
+
+// Queue a graph, returns its index in the run
+GGML_API int ggml_p9ml_executor_add(
+    struct ggml_p9ml_executor * exec,
+    struct ggml_p9ml_namespace * ns,
+    struct ggml_cgraph * graph);
+
+// Compute the queued graphs and clear the queue, stops at the first failure
+GGML_API int ggml_p9ml_executor_run(struct ggml_p9ml_executor * exec);
+
+// Memory budget
+// Each membrane counts the bytes of its host objects, the namespace uses the sum over the resident membranes of
+// its tree. Over budget, ggml_p9ml_namespace_compute and ggml_p9ml_namespace_evict write the least recently used
+// membranes to GGUF spill files and release the pages of their objects (the tensors keep their data pointers).
+// An evicted membrane is mapped back from its spill file when a graph computed with ggml_p9ml_namespace_compute,
+// or a pass, uses its objects. Other code must call ggml_p9ml_membrane_reload before accessing them.
+// Only membranes whose objects are contiguous host tensors (not views) that no other slot of the tree holds or views
+// are evicted. A failed eviction after a compute does not fail the compute, it is reported in ns->evict_status.
+GGML_API int ggml_p9ml_namespace_set_memory_budget(
+    struct ggml_p9ml_namespace * ns,
+    size_t budget,
+    const char * spill_prefix);
+
+// Bytes of the host objects of the resident membranes of the namespace tree
+GGML_API size_t ggml_p9ml_namespace_memory_used(struct ggml_p9ml_namespace * ns);
+
+// Evict the least recently used membranes until the namespace fits its budget
+GGML_API int ggml_p9ml_namespace_evict(struct ggml_p9ml_namespace * ns);
+
+GGML_API int ggml_p9ml_membrane_evict(struct ggml_p9ml_membrane * membrane);
+GGML_API int ggml_p9ml_membrane_reload(struct ggml_p9ml_membrane * membrane);
+
+// Serialization
+// The membrane tree, the QAT configs and the object errors are stored as GGUF metadata and the objects as
+// GGUF tensors, in the type chosen by the mixed-precision search when it differs from their own type
+// Evolution rules are not saved (transforms are function pointers)
+GGML_API int ggml_p9ml_namespace_save(
+    const struct ggml_p9ml_namespace * ns,
+    const char * fname);
+
+// Load a saved namespace, the objects are mapped from the file (copy-on-write) instead of being read
+// The membranes are owned by the namespace, the mapping is released by ggml_p9ml_namespace_free
+GGML_API struct ggml_p9ml_namespace * ggml_p9ml_namespace_load(
+    const char * fname,
+    struct ggml_backend * backend);
+
+// Instrumentation
+// A record covers one membrane in one run of an operation, or the whole run (total). The fake-quantization
+// passes have per-membrane records built from the time of their chunks: a membrane spans its first to last
+// chunk, and busy_us is the thread time spent on it. The total of a run also spans the pass only, busy_us over
+// n_threads times the span is the thread utilization. Without GGML_P9ML_STATS_NODES, a compute only has a total;
+// with it, the scheduler computes the graph node by node (synchronizing the backends, so the graph runs slower)
+// and each node is charged to the membrane of its first source that is an object, or of the node it reads.
+struct ggml_p9ml_stats_record {
+    enum ggml_p9ml_pass pass;
+    uint64_t run;                           // run of the operation, shared by its records (from 1)
+    bool total;                             // record of the whole run, membrane is the one it was called on
+    char membrane[GGML_P9ML_STATS_PATH_MAX]; // path of the membrane ("model/blk.0/attn")
+    int64_t t_start_us;                     // since the stats were enabled or reset
+    int64_t t_end_us;
+    int64_t busy_us;                        // thread time spent on the membrane (on the run for the total)
+    int n_threads;                          // threads of the pass (0: unknown)
+    uint64_t bytes_read;                    // object bytes read (compute: bytes of the sources of the nodes)
+    uint64_t bytes_written;                 // object bytes written (compute: bytes of the nodes)
+    uint64_t n_quantized;                   // elements fake-quantized
+    double sq_err;                          // sum of the squared quantization errors
+    double sq_src;                          // sum of the squared source values
+};
+
+// Start recording (flags: GGML_P9ML_STATS_*), 0 stops and drops the records
+GGML_API int ggml_p9ml_namespace_set_stats(
+    struct ggml_p9ml_namespace * ns,
+    uint32_t flags);
+
+GGML_API void ggml_p9ml_namespace_stats_reset(struct ggml_p9ml_namespace * ns);
+GGML_API int ggml_p9ml_namespace_stats_n_records(const struct ggml_p9ml_namespace * ns);
+GGML_API const struct ggml_p9ml_stats_record * ggml_p9ml_namespace_stats_get(
+    const struct ggml_p9ml_namespace * ns,
+    int i);
+GGML_API const char * ggml_p9ml_pass_name(enum ggml_p9ml_pass pass);
+
+// Write the records as JSON (with the derived rmse and utilization, and the namespace metrics), or in the
+// Chrome trace event format (chrome://tracing, Perfetto): one row per membrane, totals on row 0
+GGML_API int ggml_p9ml_namespace_stats_write_json(
+    const struct ggml_p9ml_namespace * ns,
+    const char * fname);
+GGML_API int ggml_p9ml_namespace_stats_write_trace(
+    const struct ggml_p9ml_namespace * ns,
+    const char * fname);
+
 // Utility functions
 GGML_API void ggml_p9ml_print_membrane_stats(struct ggml_p9ml_membrane * membrane);
 GGML_API void ggml_p9ml_print_namespace_stats(struct ggml_p9ml_namespace * ns);
@@ -518,6 +518,7 @@ extern "C" {
         GGML_OP_CROSS_ENTROPY_LOSS,
         GGML_OP_CROSS_ENTROPY_LOSS_BACK,
         GGML_OP_OPT_STEP_ADAMW,
+        GGML_OP_FAKE_QUANT,
 
         GGML_OP_COUNT,
     };
@@ -2075,6 +2076,25 @@ extern "C" {
             struct ggml_tensor  * v,
             struct ggml_tensor  * adamw_params); // parameters such a the learning rate
 
+    // fake quantization: quantize a to type as ggml_quantize_chunk and dequantize back to F32
+    // (a->ne[0] must be a multiple of the block size)
+    // the gradient is passed through unchanged (straight-through estimator)
+    GGML_API struct ggml_tensor * ggml_fake_quant(
+            struct ggml_context * ctx,
+            struct ggml_tensor  * a,
+            enum ggml_type        type);
+
+    // scales:  optional per-channel scales, F32 [a->ne[1]]: row i01 becomes q(s*x)/s with s = scales[i01]
+    //          or per-block scales, F32 [a->ne[0]/block size, a->ne[1]]: block i00 of row i01 uses scales[i01][i00]
+    // imatrix: optional importance matrix, F32 [a->ne[0]] (required by the types that need one)
+    // scales and imatrix are constants for the backward pass
+    GGML_API struct ggml_tensor * ggml_fake_quant_ext(
+            struct ggml_context * ctx,
+            struct ggml_tensor  * a,
+            struct ggml_tensor  * scales,
+            struct ggml_tensor  * imatrix,
+            enum ggml_type        type);
+
     //
     // automatic differentiation
     //
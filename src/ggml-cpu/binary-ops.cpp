@@ -58,7 +58,6 @@ static void apply_binary_op(const ggml_compute_params * params, ggml_tensor * ds
     GGML_ASSERT( nb0 == sizeof(dst_t));
     GGML_ASSERT(nb00 == sizeof(src0_t));
 
-    const auto [ir0, ir1] = get_thread_range(params, src0);
     const bool is_src1_contiguous = (nb10 == sizeof(src1_t));
 
     if (!is_src1_contiguous) { // broadcast not implemented yet for non-contiguous
@@ -81,7 +80,7 @@ static void apply_binary_op(const ggml_compute_params * params, ggml_tensor * ds
     }
 #endif
 
-    for (int64_t ir = ir0; ir < ir1; ++ir) {
+    for (const int64_t ir : chunked_rows(params, ggml_nrows(src0))) {
         const int64_t i03 = ir/(ne02*ne01);
         const int64_t i02 = (ir - i03*ne02*ne01)/ne01;
         const int64_t i01 = (ir - i03*ne02*ne01 - i02*ne01);
@@ -7,6 +7,8 @@
 
 #ifdef __cplusplus
 
+#include <algorithm>
+#include <cstddef>
 #include <utility>
 
 // convenience functions/macros for use in template calls
@@ -69,4 +71,57 @@ static std::pair<int64_t, int64_t> get_thread_range(const struct ggml_compute_pa
     return {ir0, ir1};
 }
 
+// rows [0, nr) handed out to the threads in work-stealing chunks (see ggml_compute_chunk_next)
+// usage: for (const int64_t ir : chunked_rows(params, nr)) { ... }
+class chunked_rows {
+  public:
+    class iterator {
+      public:
+        iterator(const chunked_rows * rows) : rows(rows) {
+            next_chunk(-1);
+        }
+
+        int64_t operator*() const { return ir; }
+
+        iterator & operator++() {
+            if (++ir == ir1) {
+                next_chunk(chunk);
+            }
+            return *this;
+        }
+
+        bool operator!=(std::nullptr_t) const { return chunk < rows->n_chunks; }
+
+      private:
+        void next_chunk(int cur) {
+            chunk = ggml_compute_chunk_next(rows->params, cur, rows->n_chunks);
+            ir    = rows->dr*chunk;
+            ir1   = std::min(ir + rows->dr, rows->nr);
+            if (ir >= ir1) {
+                // only trailing chunks can be empty, and the chunks of a thread only go up
+                chunk = rows->n_chunks;
+            }
+        }
+
+        const chunked_rows * rows;
+        int     chunk;
+        int64_t ir;
+        int64_t ir1;
+    };
+
+    chunked_rows(const struct ggml_compute_params * params, int64_t nr) :
+        params(params), nr(nr), n_chunks(ggml_compute_chunk_count(params, nr)) {
+        dr = n_chunks > 0 ? (nr + n_chunks - 1)/n_chunks : 0;
+    }
+
+    iterator       begin() const { return iterator(this); }
+    std::nullptr_t end()   const { return nullptr; }
+
+  private:
+    const struct ggml_compute_params * params;
+    int64_t nr;
+    int64_t dr;
+    int     n_chunks;
+};
+
 #endif
@@ -24,6 +24,9 @@ struct ggml_compute_params {
     void * wdata;
 
     struct ggml_threadpool * threadpool;
+
+    // index of the node being computed, selects its chunk counter (see ggml_compute_chunk_next)
+    int node_n;
 };
 
 
@@ -506,6 +509,15 @@ void ggml_barrier(struct ggml_threadpool * tp);
 void ggml_threadpool_chunk_set(struct ggml_threadpool * tp, int value);
 int  ggml_threadpool_chunk_add(struct ggml_threadpool * tp, int value);
 
+// work-stealing chunks for ops that split rows between the threads:
+// every thread starts with chunk ith and then takes the next free chunk from a per-node counter, so the threads
+// that are done first pick up the work of the slower ones instead of waiting for them at the next barrier.
+// the counters are reset before the graph is computed, so no barrier is needed before the first chunk.
+// only one chunked loop per node is supported
+int ggml_compute_chunk_count(const struct ggml_compute_params * params, int64_t nr);
+// pass chunk = -1 to get the first chunk, returns n_chunks when there is nothing left
+int ggml_compute_chunk_next (const struct ggml_compute_params * params, int chunk, int n_chunks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,6 +42,12 @@
 #include <omp.h>
 #endif
 
+#if defined(__gnu_linux__) && !defined(GGML_USE_OPENMP)
+#include <linux/futex.h>
+// threads that wait for too long in a barrier or for new work park on a futex
+#define GGML_CPU_FUTEX
+#endif
+
 #if defined(__ARM_FEATURE_SVE) || defined(__ARM_FEATURE_MATMUL_INT8)
 #undef GGML_USE_LLAMAFILE
 #endif
@@ -441,6 +447,12 @@ struct ggml_threadpool {
     atomic_int GGML_CACHE_ALIGN n_barrier_passed;
     atomic_int GGML_CACHE_ALIGN current_chunk; // currently processing chunk during Mat_Mul, shared between all the threads.
 
+    // futex parking (GGML_CPU_FUTEX)
+    atomic_int GGML_CACHE_ALIGN n_barrier_sleepers; // threads parked on n_barrier_passed
+    atomic_int GGML_CACHE_ALIGN n_wake;             // bumped on new work, pause and stop
+    atomic_int n_wake_sleepers;                     // threads parked on n_wake
+    int        barrier_spin;                        // ggml_thread_cpu_relax rounds before parking in a barrier
+
     // these are atomic as an annotation for thread-sanitizer
     atomic_bool stop;         // Used for stopping the threadpool altogether
     atomic_bool pause;        // Used for pausing the threadpool or individual threads
@@ -454,6 +466,12 @@ struct ggml_threadpool {
     uint32_t     poll;        // Polling level (0 - no polling)
 
     enum ggml_status ec;
+
+    // per node state, sized for the largest graph computed so far (see ggml_threadpool_prepare_nodes)
+    uint8_t    * dag_flags;   // GGML_DAG_BARRIER, GGML_DAG_CLAIM (cplan->use_dag, see ggml_graph_dag_init)
+    atomic_int * dag_claimed; // set by the thread that runs a GGML_DAG_CLAIM node
+    atomic_int * node_chunks; // work-stealing chunk counters, one cache line apart (see ggml_compute_chunk_next)
+    int          n_nodes_max;
 };
 
 // Per-thread state
@@ -481,6 +499,20 @@ static inline void ggml_thread_cpu_relax(void) {
 static inline void ggml_thread_cpu_relax(void) {;}
 #endif
 
+#ifdef GGML_CPU_FUTEX
+static inline void ggml_futex_wait(atomic_int * addr, int val) {
+    // returns right away if *addr != val, spurious wake-ups are handled by the callers
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline void ggml_futex_wake_all(atomic_int * addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+#endif
+
+// how long a thread spins in a barrier before parking, at the default polling level (50)
+#define GGML_BARRIER_SPIN_US 100
+
 //
 // NUMA support
 //
@@ -512,6 +544,7 @@ struct ggml_numa_nodes {
 
 struct ggml_state {
     struct ggml_numa_nodes numa;
+    int cpu_relax_per_us; // ggml_thread_cpu_relax rounds per microsecond, measured by ggml_cpu_init
 };
 
 static struct ggml_state g_state = {0};
@@ -536,11 +569,27 @@ void ggml_barrier(struct ggml_threadpool * tp) {
 
         // exit barrier (fill seq-cst fence)
         atomic_fetch_add_explicit(&tp->n_barrier_passed, 1, memory_order_seq_cst);
+
+#ifdef GGML_CPU_FUTEX
+        // one syscall per generation, and only if someone is parked
+        if (atomic_load_explicit(&tp->n_barrier_sleepers, memory_order_seq_cst) > 0) {
+            ggml_futex_wake_all(&tp->n_barrier_passed);
+        }
+#endif
         return;
     }
 
     // wait for other threads
-    while (atomic_load_explicit(&tp->n_barrier_passed, memory_order_relaxed) == n_passed) {
+    for (int i = 0; atomic_load_explicit(&tp->n_barrier_passed, memory_order_relaxed) == n_passed; i++) {
+#ifdef GGML_CPU_FUTEX
+        if (i >= tp->barrier_spin) {
+            // waited long enough, park until the last thread arrives
+            atomic_fetch_add_explicit(&tp->n_barrier_sleepers, 1, memory_order_seq_cst);
+            ggml_futex_wait(&tp->n_barrier_passed, n_passed);
+            atomic_fetch_sub_explicit(&tp->n_barrier_sleepers, 1, memory_order_relaxed);
+            continue;
+        }
+#endif
         ggml_thread_cpu_relax();
     }
 
@@ -562,6 +611,35 @@ int ggml_threadpool_chunk_add(struct ggml_threadpool * tp, int value) {
     return atomic_fetch_add_explicit(&tp->current_chunk, value, memory_order_relaxed);
 }
 
+#define GGML_CHUNKS_PER_THREAD 4
+#define GGML_CHUNK_STRIDE      (CACHE_LINE_SIZE/sizeof(atomic_int))
+
+int ggml_compute_chunk_count(const struct ggml_compute_params * params, int64_t nr) {
+    if (params->nth == 1 || ggml_is_numa()) {
+        // static split, as with mul_mat chunking by thread was measured to be faster on NUMA systems
+        return params->nth;
+    }
+
+    return (int) MIN(nr, (int64_t) params->nth*GGML_CHUNKS_PER_THREAD);
+}
+
+int ggml_compute_chunk_next(const struct ggml_compute_params * params, int chunk, int n_chunks) {
+    if (chunk < 0) {
+        return MIN(params->ith, n_chunks);
+    }
+
+    if (n_chunks <= params->nth) {
+        // one chunk per thread, nothing to take
+        return n_chunks;
+    }
+
+    atomic_int * counter = params->threadpool->node_chunks + params->node_n*GGML_CHUNK_STRIDE;
+
+    const int next = params->nth + atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+
+    return MIN(next, n_chunks);
+}
+
 #if defined(__gnu_linux__)
 static cpu_set_t ggml_get_numa_affinity(void) {
     cpu_set_t cpuset;
@@ -669,6 +747,26 @@ bool ggml_is_numa(void) {
     return g_state.numa.n_nodes > 1;
 }
 
+int ggml_numa_n_nodes(void) {
+    return (int) g_state.numa.n_nodes;
+}
+
+int ggml_numa_thread_node(int ith) {
+    if (g_state.numa.n_nodes == 0 || ith < 0) {
+        return -1;
+    }
+
+    // mirrors set_numa_thread_affinity
+    switch (g_state.numa.numa_strategy) {
+        case GGML_NUMA_STRATEGY_DISTRIBUTE:
+            return ith % (int) g_state.numa.n_nodes;
+        case GGML_NUMA_STRATEGY_ISOLATE:
+            return (int) g_state.numa.current_node;
+        default:
+            return -1;
+    }
+}
+
 #if defined(__ARM_ARCH)
 
 #if defined(__linux__) && defined(__aarch64__)
@@ -1996,6 +2094,11 @@ static void ggml_compute_forward(struct ggml_compute_params * params, struct ggm
                 ggml_compute_forward_opt_step_adamw(params, tensor);
             }
             break;
+        case GGML_OP_FAKE_QUANT:
+            {
+                ggml_compute_forward_fake_quant(params, tensor);
+            }
+            break;
         case GGML_OP_NONE:
             {
                 // nop
@@ -2281,6 +2384,7 @@ static int ggml_get_n_tasks(struct ggml_tensor * node, int n_threads) {
         case GGML_OP_CROSS_ENTROPY_LOSS:
         case GGML_OP_CROSS_ENTROPY_LOSS_BACK:
         case GGML_OP_OPT_STEP_ADAMW:
+        case GGML_OP_FAKE_QUANT:
             {
                 n_tasks = n_threads;
             } break;
@@ -2529,6 +2633,20 @@ static void ggml_thread_cpumask_next(const bool * global_mask, bool * local_mask
     }
 }
 
+#ifndef GGML_USE_OPENMP
+// wake the threads parked while waiting for work, called after changing n_graph, pause or stop
+static void ggml_threadpool_wake(struct ggml_threadpool * threadpool) {
+#ifdef GGML_CPU_FUTEX
+    atomic_fetch_add_explicit(&threadpool->n_wake, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&threadpool->n_wake_sleepers, memory_order_seq_cst) > 0) {
+        ggml_futex_wake_all(&threadpool->n_wake);
+    }
+#else
+    UNUSED(threadpool);
+#endif
+}
+#endif // GGML_USE_OPENMP
+
 void ggml_threadpool_free(struct ggml_threadpool* threadpool) {
     if (!threadpool) return;
 
@@ -2543,6 +2661,7 @@ void ggml_threadpool_free(struct ggml_threadpool* threadpool) {
     threadpool->pause = false;
 
     ggml_cond_broadcast(&threadpool->cond);
+    ggml_threadpool_wake(threadpool);
     ggml_mutex_unlock(&threadpool->mutex);
 
     for (int j = 1; j < n_threads; j++) {
@@ -2557,6 +2676,11 @@ void ggml_threadpool_free(struct ggml_threadpool* threadpool) {
 
     const size_t workers_size = sizeof(struct ggml_compute_state) * n_threads;
     ggml_aligned_free(threadpool->workers, workers_size);
+    free(threadpool->dag_flags);
+    free(threadpool->dag_claimed);
+    if (threadpool->node_chunks) {
+        ggml_aligned_free(threadpool->node_chunks, threadpool->n_nodes_max*GGML_CHUNK_STRIDE*sizeof(atomic_int));
+    }
     ggml_aligned_free(threadpool, sizeof(struct ggml_threadpool));
 }
 
@@ -2566,6 +2690,7 @@ static void ggml_threadpool_pause_locked(struct ggml_threadpool * threadpool) {
     GGML_PRINT_DEBUG("Pausing threadpool\n");
     threadpool->pause = true;
     ggml_cond_broadcast(&threadpool->cond);
+    ggml_threadpool_wake(threadpool);
 }
 
 static void ggml_threadpool_resume_locked(struct ggml_threadpool * threadpool) {
@@ -2575,6 +2700,10 @@ static void ggml_threadpool_resume_locked(struct ggml_threadpool * threadpool) {
 }
 #endif
 
+int ggml_threadpool_get_n_threads(struct ggml_threadpool * threadpool) {
+    return threadpool->n_threads_max;
+}
+
 void ggml_threadpool_pause(struct ggml_threadpool * threadpool) {
 #ifndef GGML_USE_OPENMP
     ggml_mutex_lock(&threadpool->mutex);
@@ -2763,6 +2892,14 @@ struct ggml_cplan ggml_graph_plan(
                     {
                         cur = ggml_type_size(node->type)*(n_tasks + node->src[0]->ne[0]*n_tasks);
                     } break;
+                case GGML_OP_FAKE_QUANT:
+                    {
+                        const int64_t ne00 = node->src[0]->ne[0];
+                        const enum ggml_type type = (enum ggml_type) ggml_get_op_params_i32(node, 0);
+                        cur = (sizeof(float)*ne00 + ggml_row_size(type, ne00) + CACHE_LINE_SIZE)*n_tasks;
+                        // once per graph, the kernel quantizes the rows without taking the lock of ggml_quantize_init
+                        ggml_quantize_init(type);
+                    } break;
                 case GGML_OP_COUNT:
                     {
                         GGML_ABORT("fatal error");
@@ -2783,10 +2920,199 @@ struct ggml_cplan ggml_graph_plan(
     cplan.n_threads  = MIN(max_tasks, n_threads);
     cplan.work_size  = work_size;
     cplan.work_data  = NULL;
+    cplan.use_dag    = true;
 
     return cplan;
 }
 
+//
+// dependency-driven execution
+//
+// ops are computed by all the threads of the pool together (each thread takes its share of dst via ith/nth),
+// so a node cannot be handed over to a subset of the threads. what we can do is drop the barrier between nodes
+// that do not depend on each other: a thread that is done with its share of a node moves on to the next one
+// while the other threads are still busy. consecutive nodes are merged into a group as long as:
+//  - no node of the group reads or writes memory written by another node of the group (checked on the actual
+//    data ranges, so views, in-place ops and allocator reuse are all covered)
+//  - every op in the group only touches its own share of dst, without internal barriers or shared chunk counters
+//  - at most one node of the group uses the work buffer (per-thread scratch slices depend on the op's shape)
+// small nodes of a group are claimed by the first thread that reaches them and computed by that thread alone,
+// the other threads skip ahead to the next node.
+//
+
+#define GGML_DAG_BARRIER 1 // barrier after this node
+#define GGML_DAG_CLAIM   2 // computed by a single thread
+
+#define GGML_DAG_MAX_GROUP          32
+#define GGML_DAG_CLAIM_MAX_ELEMENTS 4096
+
+static bool ggml_dag_node_is_empty(const struct ggml_tensor * node) {
+    switch (node->op) {
+        case GGML_OP_NONE:
+        case GGML_OP_RESHAPE:
+        case GGML_OP_VIEW:
+        case GGML_OP_PERMUTE:
+        case GGML_OP_TRANSPOSE:
+            return true;
+        default:
+            return ggml_is_empty(node);
+    }
+}
+
+// ops that can be computed without a barrier before and after them
+static bool ggml_dag_node_is_independent(const struct ggml_tensor * node) {
+    for (int i = 0; i < GGML_MAX_SRC; i++) {
+        if (node->src[i] && node->src[i]->extra) {
+            // extra buffer types bring their own kernels
+            return false;
+        }
+    }
+
+    switch (node->op) {
+        case GGML_OP_DUP:
+        case GGML_OP_CPY:
+        case GGML_OP_CONT:
+        case GGML_OP_ADD:
+        case GGML_OP_ADD1:
+        case GGML_OP_SUB:
+        case GGML_OP_MUL:
+        case GGML_OP_DIV:
+        case GGML_OP_SQR:
+        case GGML_OP_SQRT:
+        case GGML_OP_LOG:
+        case GGML_OP_SIN:
+        case GGML_OP_COS:
+        case GGML_OP_SCALE:
+        case GGML_OP_UNARY:
+        case GGML_OP_NORM:
+        case GGML_OP_RMS_NORM:
+        case GGML_OP_GET_ROWS:
+        case GGML_OP_SOFT_MAX:
+        case GGML_OP_ROPE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool ggml_dag_node_uses_wdata(const struct ggml_tensor * node) {
+    switch (node->op) {
+        case GGML_OP_SOFT_MAX:
+        case GGML_OP_ROPE:
+            return true;
+        case GGML_OP_DUP:
+        case GGML_OP_CPY:
+        case GGML_OP_CONT:
+            return node->type != node->src[0]->type;
+        case GGML_OP_ADD:
+        case GGML_OP_ADD1:
+            return ggml_is_quantized(node->src[0]->type);
+        default:
+            return false;
+    }
+}
+
+static bool ggml_dag_overlap(const struct ggml_tensor * a, const struct ggml_tensor * b) {
+    if (a == NULL || b == NULL || a->data == NULL || b->data == NULL) {
+        return false;
+    }
+
+    const char * a0 = (const char *) a->data;
+    const char * b0 = (const char *) b->data;
+
+    return a0 < b0 + ggml_nbytes(b) && b0 < a0 + ggml_nbytes(a);
+}
+
+// true if one of the nodes writes memory that the other one reads or writes
+static bool ggml_dag_conflict(const struct ggml_tensor * a, const struct ggml_tensor * b) {
+    if (ggml_dag_overlap(a, b)) {
+        return true;
+    }
+
+    for (int i = 0; i < GGML_MAX_SRC; i++) {
+        if (ggml_dag_overlap(a, b->src[i]) || ggml_dag_overlap(a->src[i], b)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void ggml_graph_dag_init(struct ggml_threadpool * tp, const struct ggml_cgraph * cgraph) {
+    const int n_nodes = cgraph->n_nodes;
+
+    int  group[GGML_DAG_MAX_GROUP];
+    int  n_group     = 0;
+    bool group_wdata = false;
+    bool open        = false; // a node has been computed since the last barrier
+
+    for (int i = 0; i < n_nodes; i++) {
+        const struct ggml_tensor * node = cgraph->nodes[i];
+
+        tp->dag_flags[i] = 0;
+        atomic_store_explicit(&tp->dag_claimed[i], 0, memory_order_relaxed);
+
+        if (ggml_dag_node_is_empty(node)) {
+            continue;
+        }
+
+        const bool independent = ggml_dag_node_is_independent(node);
+        const bool wdata       = independent && ggml_dag_node_uses_wdata(node);
+
+        bool fence = !independent || n_group == GGML_DAG_MAX_GROUP || (wdata && group_wdata);
+        for (int j = 0; j < n_group && !fence; j++) {
+            fence = ggml_dag_conflict(cgraph->nodes[group[j]], node);
+        }
+
+        if (fence) {
+            if (open) {
+                tp->dag_flags[i - 1] |= GGML_DAG_BARRIER;
+            }
+            n_group     = 0;
+            group_wdata = false;
+        }
+
+        if (independent) {
+            group[n_group++] = i;
+            group_wdata |= wdata;
+            open = true;
+
+            if (!wdata && ggml_nelements(node) <= GGML_DAG_CLAIM_MAX_ELEMENTS) {
+                tp->dag_flags[i] |= GGML_DAG_CLAIM;
+            }
+        } else {
+            tp->dag_flags[i] |= GGML_DAG_BARRIER;
+            open = false;
+        }
+    }
+
+    if (n_nodes > 0) {
+        tp->dag_flags[n_nodes - 1] |= GGML_DAG_BARRIER;
+    }
+}
+
+// called by the main thread before the workers are started
+static void ggml_threadpool_prepare_nodes(struct ggml_threadpool * tp, const struct ggml_cgraph * cgraph) {
+    const int n_nodes = cgraph->n_nodes;
+
+    if (tp->n_nodes_max < n_nodes) {
+        free(tp->dag_flags);
+        free(tp->dag_claimed);
+        if (tp->node_chunks) {
+            ggml_aligned_free(tp->node_chunks, tp->n_nodes_max*GGML_CHUNK_STRIDE*sizeof(atomic_int));
+        }
+        tp->dag_flags   = malloc(n_nodes);
+        tp->dag_claimed = malloc(n_nodes*sizeof(atomic_int));
+        tp->node_chunks = ggml_aligned_malloc(n_nodes*GGML_CHUNK_STRIDE*sizeof(atomic_int));
+        GGML_ASSERT(tp->dag_flags && tp->dag_claimed && tp->node_chunks);
+        tp->n_nodes_max = n_nodes;
+    }
+
+    for (int i = 0; i < n_nodes; i++) {
+        atomic_store_explicit(&tp->node_chunks[i*GGML_CHUNK_STRIDE], 0, memory_order_relaxed);
+    }
+}
+
 static thread_ret_t ggml_graph_compute_thread(void * data) {
     struct ggml_compute_state * state = (struct ggml_compute_state *) data;
     struct ggml_threadpool    * tp    = state->threadpool;
@@ -2802,12 +3128,33 @@ static thread_ret_t ggml_graph_compute_thread(void * data) {
         /*.wsize     =*/ cplan->work_size,
         /*.wdata     =*/ cplan->work_data,
         /*.threadpool=*/ tp,
+        /*.node_n    =*/ 0,
     };
 
+    // claimed nodes are computed as if there was a single thread
+    struct ggml_compute_params params_claim = params;
+    params_claim.ith = 0;
+    params_claim.nth = 1;
+
+    const uint8_t * dag = cplan->use_dag && params.nth > 1 ? tp->dag_flags : NULL;
+
     for (int node_n = 0; node_n < cgraph->n_nodes && atomic_load_explicit(&tp->abort, memory_order_relaxed) != node_n; node_n++) {
         struct ggml_tensor * node = cgraph->nodes[node_n];
 
-        ggml_compute_forward(&params, node);
+        params.node_n = node_n;
+
+        if (dag && (dag[node_n] & GGML_DAG_CLAIM)) {
+            if (atomic_exchange_explicit(&tp->dag_claimed[node_n], 1, memory_order_relaxed) == 0) {
+                ggml_compute_forward(&params_claim, node);
+            }
+        } else {
+            ggml_compute_forward(&params, node);
+        }
+
+        if (dag && !(dag[node_n] & GGML_DAG_BARRIER)) {
+            // the next node does not depend on this one
+            continue;
+        }
 
         if (state->ith == 0 && cplan->abort_callback &&
                 cplan->abort_callback(cplan->abort_callback_data)) {
@@ -2889,6 +3236,21 @@ static inline bool ggml_graph_compute_check_for_work(struct ggml_compute_state *
         return state->pending;
     }
 
+#ifdef GGML_CPU_FUTEX
+    while (true) {
+        // read the wake sequence before checking, a kickoff in between makes the futex wait return right away
+        const int seq = atomic_load_explicit(&threadpool->n_wake, memory_order_seq_cst);
+        if (ggml_graph_compute_thread_ready(state)) {
+            break;
+        }
+        // No new work. Wait for the signal.
+        GGML_PRINT_DEBUG("thread #%d waiting for work (sleeping)\n", state->ith);
+        atomic_fetch_add_explicit(&threadpool->n_wake_sleepers, 1, memory_order_seq_cst);
+        ggml_futex_wait(&threadpool->n_wake, seq);
+        atomic_fetch_sub_explicit(&threadpool->n_wake_sleepers, 1, memory_order_relaxed);
+    }
+    ggml_graph_compute_thread_sync(state);
+#else
     ggml_mutex_lock_shared(&threadpool->mutex);
     while (!ggml_graph_compute_thread_ready(state)) {
         // No new work. Wait for the signal.
@@ -2896,6 +3258,7 @@ static inline bool ggml_graph_compute_check_for_work(struct ggml_compute_state *
         ggml_cond_wait(&threadpool->cond, &threadpool->mutex);
     }
     ggml_mutex_unlock_shared(&threadpool->mutex);
+#endif
 
     return state->pending;
 }
@@ -2965,6 +3328,7 @@ static void ggml_graph_compute_kickoff(struct ggml_threadpool * threadpool, int
        ggml_threadpool_resume_locked(threadpool);
     } else {
        ggml_cond_broadcast(&threadpool->cond);
+       ggml_threadpool_wake(threadpool);
     }
 
     ggml_mutex_unlock(&threadpool->mutex);
@@ -2995,6 +3359,19 @@ static struct ggml_threadpool * ggml_threadpool_new_impl(
         threadpool->poll             = tpp->poll;
         threadpool->prio             = tpp->prio;
         threadpool->ec               = GGML_STATUS_SUCCESS;
+        threadpool->dag_flags        = NULL;
+        threadpool->dag_claimed      = NULL;
+        threadpool->node_chunks      = NULL;
+        threadpool->n_nodes_max      = 0;
+
+        threadpool->n_barrier_sleepers = 0;
+        threadpool->n_wake             = 0;
+        threadpool->n_wake_sleepers    = 0;
+
+        // spin for about GGML_BARRIER_SPIN_US at the default polling level, fall back to a fixed count if
+        // ggml_cpu_init did not calibrate
+        const int64_t relax_per_us = g_state.cpu_relax_per_us > 0 ? g_state.cpu_relax_per_us : 64;
+        threadpool->barrier_spin = (int) MIN(INT_MAX, MAX(1024, relax_per_us*GGML_BARRIER_SPIN_US*tpp->poll/50));
     }
 
     // Allocate and init workers state
@@ -3071,6 +3448,14 @@ enum ggml_status ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cpl
         threadpool->ec               = GGML_STATUS_SUCCESS;
     }
 
+    if (n_threads > 1) {
+        ggml_threadpool_prepare_nodes(threadpool, cgraph);
+
+        if (cplan->use_dag) {
+            ggml_graph_dag_init(threadpool, cgraph);
+        }
+    }
+
 #ifdef GGML_USE_OPENMP
     if (n_threads > 1) {
         #pragma omp parallel num_threads(n_threads)
@@ -3466,6 +3851,27 @@ void ggml_cpu_init(void) {
         ggml_init_arm_arch_features();
 #endif
 
+#ifdef GGML_CPU_FUTEX
+        // measure ggml_thread_cpu_relax so that the barrier spin can be expressed in time
+        {
+            const int64_t t_start = ggml_time_us();
+            int64_t n_relax = 0;
+            int64_t t_elapsed = 0;
+
+            while (t_elapsed < 200) {
+                for (int i = 0; i < 64; i++) {
+                    ggml_thread_cpu_relax();
+                }
+                n_relax  += 64;
+                t_elapsed = ggml_time_us() - t_start;
+            }
+
+            g_state.cpu_relax_per_us = (int) MAX(1, n_relax/t_elapsed);
+
+            GGML_PRINT_DEBUG("%s: %d cpu_relax rounds per us\n", __func__, g_state.cpu_relax_per_us);
+        }
+#endif
+
         is_first_call = false;
     }
 
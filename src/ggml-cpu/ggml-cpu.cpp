@@ -3,6 +3,7 @@
 #include "ggml-cpu.h"
 #include "repack.h"
 #include "traits.h"
+#include "vec.h"
 #include "ggml-impl.h"
 #include "amx/amx.h"
 
@@ -631,6 +632,15 @@ static void * ggml_backend_cpu_get_proc_address(ggml_backend_reg_t reg, const ch
     if (strcmp(name, "ggml_backend_cpu_is_numa") == 0) {
         return (void *)ggml_is_numa;
     }
+    if (strcmp(name, "ggml_backend_cpu_numa_n_nodes") == 0) {
+        return (void *)ggml_numa_n_nodes;
+    }
+    if (strcmp(name, "ggml_backend_cpu_numa_thread_node") == 0) {
+        return (void *)ggml_numa_thread_node;
+    }
+    if (strcmp(name, "ggml_backend_cpu_vec_sq_err_f32") == 0) {
+        return (void *)ggml_vec_sq_err_f32;
+    }
 
     // threadpool - TODO:  move to ggml-base
     if (strcmp(name, "ggml_threadpool_new") == 0) {
@@ -639,6 +649,9 @@ static void * ggml_backend_cpu_get_proc_address(ggml_backend_reg_t reg, const ch
     if (strcmp(name, "ggml_threadpool_free") == 0) {
         return (void *)ggml_threadpool_free;
     }
+    if (strcmp(name, "ggml_threadpool_get_n_threads") == 0) {
+        return (void *)ggml_threadpool_get_n_threads;
+    }
     if (strcmp(name, "ggml_backend_cpu_set_threadpool") == 0) {
         return (void *)ggml_backend_cpu_set_threadpool;
     }
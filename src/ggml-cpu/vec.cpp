@@ -319,3 +319,224 @@ ggml_float ggml_vec_log_soft_max_f32(const int n, float * y, const float * x, fl
     }
     return sum = (ggml_float)logf(sum);
 }
+
+void ggml_vec_sq_err_f32(const int n, ggml_float * sq_err, ggml_float * sq_x, const float * x, const float * y) {
+    int i = 0;
+    ggml_float sum_err = 0;
+    ggml_float sum_x   = 0;
+#if defined(__AVX512F__)
+    __m512 ve = _mm512_setzero_ps();
+    __m512 vx = _mm512_setzero_ps();
+    for (; i + 15 < n; i += 16) {
+        const __m512 a = _mm512_loadu_ps(x + i);
+        const __m512 d = _mm512_sub_ps(a, _mm512_loadu_ps(y + i));
+        ve = _mm512_fmadd_ps(d, d, ve);
+        vx = _mm512_fmadd_ps(a, a, vx);
+    }
+    sum_err = (ggml_float)_mm512_reduce_add_ps(ve);
+    sum_x   = (ggml_float)_mm512_reduce_add_ps(vx);
+#elif defined(__AVX2__)
+    __m256 ve = _mm256_setzero_ps();
+    __m256 vx = _mm256_setzero_ps();
+    for (; i + 7 < n; i += 8) {
+        const __m256 a = _mm256_loadu_ps(x + i);
+        const __m256 d = _mm256_sub_ps(a, _mm256_loadu_ps(y + i));
+        ve = _mm256_add_ps(ve, _mm256_mul_ps(d, d));
+        vx = _mm256_add_ps(vx, _mm256_mul_ps(a, a));
+    }
+    float le[8];
+    float lx[8];
+    _mm256_storeu_ps(le, ve);
+    _mm256_storeu_ps(lx, vx);
+    for (int j = 0; j < 8; ++j) {
+        sum_err += (ggml_float)le[j];
+        sum_x   += (ggml_float)lx[j];
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float32x4_t ve = vdupq_n_f32(0.0f);
+    float32x4_t vx = vdupq_n_f32(0.0f);
+    for (; i + 3 < n; i += 4) {
+        const float32x4_t a = vld1q_f32(x + i);
+        const float32x4_t d = vsubq_f32(a, vld1q_f32(y + i));
+        ve = vfmaq_f32(ve, d, d);
+        vx = vfmaq_f32(vx, a, a);
+    }
+    sum_err = (ggml_float)vaddvq_f32(ve);
+    sum_x   = (ggml_float)vaddvq_f32(vx);
+#endif
+    for (; i < n; ++i) {
+        const float d = x[i] - y[i];
+        sum_err += (ggml_float)(d*d);
+        sum_x   += (ggml_float)(x[i]*x[i]);
+    }
+    *sq_err = sum_err;
+    *sq_x   = sum_x;
+}
+
+// fake quantization of whole blocks of 32 values, y = q(s*x)/s, without packing the quantized blocks
+// same results as quantize_row_q8_0_ref / quantize_row_q4_0_ref of s*x followed by dequantization and the scaling
+// by 1/s, including the FP16 block scale and the rounding of ties away from zero (roundf, the SIMD round
+// instructions round them to even)
+
+#if defined(__AVX2__)
+inline static float ggml_v_hmax(__m256 v) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_movehdup_ps(m));
+    return _mm_cvtss_f32(m);
+}
+
+inline static float ggml_v_hmin(__m256 v) {
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_min_ss(m, _mm_movehdup_ps(m));
+    return _mm_cvtss_f32(m);
+}
+
+// roundf: round to nearest, ties away from zero
+inline static __m256 ggml_v_round(__m256 x) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 t    = _mm256_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256 frac = _mm256_andnot_ps(sign, _mm256_sub_ps(x, t));
+    const __m256 up   = _mm256_cmp_ps(frac, _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+    return _mm256_add_ps(t, _mm256_and_ps(up, _mm256_or_ps(_mm256_and_ps(x, sign), _mm256_set1_ps(1.0f))));
+}
+#endif
+
+void ggml_vec_fake_quant_q8_0_f32(const int n, float * y, const float * x, const float s) {
+    const int qk = 32;
+    assert(n % qk == 0);
+
+    for (int ib = 0; ib < n/qk; ++ib) {
+        const float * xb = x + ib*qk;
+        float       * yb = y + ib*qk;
+#if defined(__AVX2__)
+        const __m256 vs   = _mm256_set1_ps(s);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        __m256 v[4];
+        __m256 vmax = _mm256_setzero_ps();
+        for (int k = 0; k < 4; ++k) {
+            v[k] = _mm256_mul_ps(_mm256_loadu_ps(xb + 8*k), vs);
+            vmax = _mm256_max_ps(vmax, _mm256_andnot_ps(sign, v[k]));
+        }
+        const float d  = ggml_v_hmax(vmax)/127.0f;
+        const float id = d ? 1.0f/d : 0.0f;
+        const __m256 vid = _mm256_set1_ps(id);
+        const __m256 vd  = _mm256_set1_ps(GGML_FP16_TO_FP32(GGML_FP32_TO_FP16(d)));
+        const __m256 vis = _mm256_set1_ps(1.0f/s);
+        for (int k = 0; k < 4; ++k) {
+            const __m256 q = ggml_v_round(_mm256_mul_ps(v[k], vid));
+            _mm256_storeu_ps(yb + 8*k, _mm256_mul_ps(_mm256_mul_ps(q, vd), vis));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const float32x4_t vs = vdupq_n_f32(s);
+        float32x4_t v[8];
+        float32x4_t vmax = vdupq_n_f32(0.0f);
+        for (int k = 0; k < 8; ++k) {
+            v[k] = vmulq_f32(vld1q_f32(xb + 4*k), vs);
+            vmax = vmaxq_f32(vmax, vabsq_f32(v[k]));
+        }
+        const float d  = vmaxvq_f32(vmax)/127.0f;
+        const float id = d ? 1.0f/d : 0.0f;
+        const float32x4_t vid = vdupq_n_f32(id);
+        const float32x4_t vd  = vdupq_n_f32(GGML_FP16_TO_FP32(GGML_FP32_TO_FP16(d)));
+        const float32x4_t vis = vdupq_n_f32(1.0f/s);
+        for (int k = 0; k < 8; ++k) {
+            vst1q_f32(yb + 4*k, vmulq_f32(vmulq_f32(vrndaq_f32(vmulq_f32(v[k], vid)), vd), vis));
+        }
+#else
+        float amax = 0.0f;
+        for (int j = 0; j < qk; ++j) {
+            amax = MAX(amax, fabsf(s*xb[j]));
+        }
+        const float d  = amax/127.0f;
+        const float id = d ? 1.0f/d : 0.0f;
+        const float dh = GGML_FP16_TO_FP32(GGML_FP32_TO_FP16(d));
+        const float is = 1.0f/s;
+        for (int j = 0; j < qk; ++j) {
+            yb[j] = roundf(s*xb[j]*id)*dh*is;
+        }
+#endif
+    }
+}
+
+void ggml_vec_fake_quant_q4_0_f32(const int n, float * y, const float * x, const float s) {
+    const int qk = 32;
+    assert(n % qk == 0);
+
+    for (int ib = 0; ib < n/qk; ++ib) {
+        const float * xb = x + ib*qk;
+        float       * yb = y + ib*qk;
+#if defined(__AVX2__)
+        const __m256 vs = _mm256_set1_ps(s);
+        __m256 v[4];
+        __m256 vmax = _mm256_set1_ps(-INFINITY);
+        __m256 vmin = _mm256_set1_ps( INFINITY);
+        for (int k = 0; k < 4; ++k) {
+            v[k] = _mm256_mul_ps(_mm256_loadu_ps(xb + 8*k), vs);
+            vmax = _mm256_max_ps(vmax, v[k]);
+            vmin = _mm256_min_ps(vmin, v[k]);
+        }
+        const float hi = ggml_v_hmax(vmax);
+        const float lo = ggml_v_hmin(vmin);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const float32x4_t vs = vdupq_n_f32(s);
+        float32x4_t v[8];
+        float32x4_t vmax = vdupq_n_f32(-INFINITY);
+        float32x4_t vmin = vdupq_n_f32( INFINITY);
+        for (int k = 0; k < 8; ++k) {
+            v[k] = vmulq_f32(vld1q_f32(xb + 4*k), vs);
+            vmax = vmaxq_f32(vmax, v[k]);
+            vmin = vminq_f32(vmin, v[k]);
+        }
+        const float hi = vmaxvq_f32(vmax);
+        const float lo = vminvq_f32(vmin);
+#else
+        float hi = -INFINITY;
+        float lo =  INFINITY;
+        for (int j = 0; j < qk; ++j) {
+            hi = MAX(hi, s*xb[j]);
+            lo = MIN(lo, s*xb[j]);
+        }
+#endif
+        // the value of largest magnitude, the first one on ties
+        float max = -lo > hi ? lo : hi;
+        if (-lo == hi) {
+            for (int j = 0; j < qk; ++j) {
+                if (fabsf(s*xb[j]) == hi) {
+                    max = s*xb[j];
+                    break;
+                }
+            }
+        }
+
+        const float d  = max / -8;
+        const float id = d ? 1.0f/d : 0.0f;
+        const float dh = GGML_FP16_TO_FP32(GGML_FP32_TO_FP16(d));
+        const float is = 1.0f/s;
+#if defined(__AVX2__)
+        const __m256 vid = _mm256_set1_ps(id);
+        const __m256 vd  = _mm256_set1_ps(dh);
+        const __m256 vis = _mm256_set1_ps(is);
+        for (int k = 0; k < 4; ++k) {
+            __m256 q = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(v[k], vid), _mm256_set1_ps(8.5f)));
+            q = _mm256_sub_ps(_mm256_min_ps(q, _mm256_set1_ps(15.0f)), _mm256_set1_ps(8.0f));
+            _mm256_storeu_ps(yb + 8*k, _mm256_mul_ps(_mm256_mul_ps(q, vd), vis));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const float32x4_t vid = vdupq_n_f32(id);
+        const float32x4_t vd  = vdupq_n_f32(dh);
+        const float32x4_t vis = vdupq_n_f32(is);
+        for (int k = 0; k < 8; ++k) {
+            float32x4_t q = vrndmq_f32(vaddq_f32(vmulq_f32(v[k], vid), vdupq_n_f32(8.5f)));
+            q = vsubq_f32(vminq_f32(q, vdupq_n_f32(15.0f)), vdupq_n_f32(8.0f));
+            vst1q_f32(yb + 4*k, vmulq_f32(vmulq_f32(q, vd), vis));
+        }
+#else
+        for (int j = 0; j < qk; ++j) {
+            const int q = MIN(15, (int8_t)(s*xb[j]*id + 8.5f));
+            yb[j] = (q - 8)*dh*is;
+        }
+#endif
+    }
+}
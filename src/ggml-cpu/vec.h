@@ -47,6 +47,13 @@ void ggml_vec_silu_f32(const int n, float * y, const float * x);
 ggml_float ggml_vec_soft_max_f32(const int n, float * y, const float * x, float max);
 ggml_float ggml_vec_log_soft_max_f32(const int n, float * y, const float * x, float max);
 
+// sum((x - y)^2) and sum(x^2)
+void ggml_vec_sq_err_f32(const int n, ggml_float * sq_err, ggml_float * sq_x, const float * x, const float * y);
+
+// y = q(s*x)/s for Q8_0 / Q4_0, n a multiple of 32
+void ggml_vec_fake_quant_q8_0_f32(const int n, float * y, const float * x, const float s);
+void ggml_vec_fake_quant_q4_0_f32(const int n, float * y, const float * x, const float s);
+
 inline static void ggml_vec_set_i8(const int n, int8_t * x, const int8_t v) { for (int i = 0; i < n; ++i) x[i] = v; }
 inline static void ggml_vec_set_i16(const int n, int16_t * x, const int16_t v) { for (int i = 0; i < n; ++i) x[i] = v; }
 
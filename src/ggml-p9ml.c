@@ -5,23 +5,286 @@
 
 #include "ggml-p9ml.h"
 #include "ggml-impl.h"
+#include "ggml-backend-impl.h"
 #include "ggml-quants.h"
+#include "ggml-opt.h"
+#include "gguf.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
+#include <inttypes.h>
+#include <limits.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+    #define NOMINMAX
+#endif
+#include <windows.h>
+
+typedef volatile LONG atomic_int;
+
+static LONG atomic_fetch_add(atomic_int * ptr, LONG inc) {
+    return InterlockedExchangeAdd(ptr, inc);
+}
+static void atomic_store(atomic_int * ptr, LONG val) {
+    InterlockedExchange(ptr, val);
+}
+#else
+#include <stdatomic.h>
+#endif
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+    #define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/syscall.h>
+#endif
+
+// ggml-base is built for the baseline instruction set, the x86 kernels that depend on a wider one
+// are compiled with a target attribute and selected at run time
+#if defined(__GNUC__) && defined(__x86_64__)
+#define P9ML_X86_DISPATCH
+#define P9ML_TARGET(t) __attribute__((target(t)))
+#endif
+
+#if defined(P9ML_X86_DISPATCH)
+#include <immintrin.h>
+#endif
 
 // Internal constants
-#define P9ML_DEFAULT_MAX_CHILDREN 16
-#define P9ML_DEFAULT_MAX_OBJECTS 256
-#define P9ML_DEFAULT_MAX_RULES 64
+#define P9ML_INITIAL_MAX_CHILDREN 4
+#define P9ML_INITIAL_MAX_OBJECTS 8
+#define P9ML_INITIAL_MAX_RULES 4
+#define P9ML_ARENA_MIN_BLOCK_SIZE (64*1024)
+#define P9ML_ARENA_MAX_BLOCK_SIZE (64*1024*1024)
 #define P9ML_MEMBRANE_NAME_MAX 64
+#define P9ML_QAT_CHUNK_ELEMENTS 16384 // elements per fake-quantization task (cache-sized tile)
+#define P9ML_RULE_MAX_NODES 64 // graph nodes a transform rule may emit
+#define P9ML_BUFFER_ALIGNMENT 32 // TENSOR_ALIGNMENT of the backend buffers
+#define P9ML_MPOL_BIND 2 // <linux/mempolicy.h>
+#define P9ML_MPOL_MF_MOVE (1 << 1)
+
+// Device copies of the objects of one backend, the membranes point to them instead of the host objects
+struct ggml_p9ml_shard {
+    int backend_id;
+    struct ggml_context * ctx;              // tensor metadata (no_alloc)
+    ggml_backend_buffer_t buffer;           // tensor data on the backend
+};
 
 // Helper function prototypes
-static void ggml_p9ml_membrane_init_arrays(struct ggml_p9ml_membrane * membrane);
-static void ggml_p9ml_membrane_free_arrays(struct ggml_p9ml_membrane * membrane);
-static float ggml_p9ml_generate_noise(float scale);
-static void ggml_p9ml_propagate_namespace(struct ggml_p9ml_membrane * membrane, struct ggml_p9ml_namespace * ns);
+static void ggml_p9ml_membrane_mark_dirty(struct ggml_p9ml_membrane * membrane, uint32_t passes);
+static void ggml_p9ml_mapping_free(struct ggml_p9ml_mapping * mapping);
+static struct ggml_p9ml_membrane * ggml_p9ml_membrane_init(
+    struct ggml_p9ml_arena * arena,
+    const char * name,
+    int level,
+    struct ggml_context * ctx);
+static void * ggml_p9ml_membrane_alloc(struct ggml_p9ml_membrane * membrane, size_t size);
+static int ggml_p9ml_membrane_grow(struct ggml_p9ml_membrane * membrane, void ** table, int n, int capacity, size_t elem_size);
+static bool ggml_p9ml_object_is_host(const struct ggml_tensor * tensor);
+static size_t ggml_p9ml_object_host_bytes(const struct ggml_tensor * tensor);
+static void ggml_p9ml_object_release(struct ggml_p9ml_membrane * membrane, int slot);
+static void ggml_p9ml_object_drop_cow(struct ggml_p9ml_membrane * membrane, int slot);
+static void ggml_p9ml_membrane_drop_spill(struct ggml_p9ml_membrane * membrane);
+static void ggml_p9ml_namespace_index_object(struct ggml_p9ml_membrane * membrane, int slot);
+static void ggml_p9ml_membrane_invalidate_index(struct ggml_p9ml_membrane * membrane);
+static void ggml_p9ml_index_free(struct ggml_p9ml_index * index);
+
+//
+// Fake-quantization passes
+//
+// A pass is a list of (object, type) groups, each split into tiles of rows and whole quantization
+// blocks that are processed as independent tasks by the traversal engine. Every chunk reports its
+// squared quantization error, against the pass reference tensor if any.
+// Objects held by a namespace backend (shards) are processed on that backend instead, by one graph of
+// fake-quantization ops per backend that runs while the host tasks are processed.
+//
+
+struct ggml_p9ml_qat_chunk {
+    struct ggml_p9ml_membrane * membrane;
+    int slot;                               // object index in the membrane
+    int group;                              // (object, type) group of the chunk
+    enum ggml_type type;                    // target quantization type
+    uint64_t id;                            // noise stream of the object
+    int64_t ir0;                            // first row
+    int64_t ir1;                            // last row (exclusive)
+    int64_t ic0;                            // first column
+    int64_t ic1;                            // last column (exclusive)
+    float * rmse;                           // tile map entry (NULL if none)
+    double sq_err;                          // sum of squared errors over the rows (< 0 on failure)
+    double sq_src;                          // sum of squared source values over the rows
+    int64_t t_start;                        // time of the task (when the pass is recorded)
+    int64_t t_end;
+};
+
+// (object, type) group of an object held by a namespace backend
+struct ggml_p9ml_qat_job {
+    struct ggml_p9ml_membrane * membrane;
+    int slot;
+    int group;
+    enum ggml_type type;
+    uint64_t id;                            // noise stream of the object
+    int backend_id;                         // namespace backend that holds the object
+    const struct ggml_p9ml_tile_map * map;  // tile map to fill (NULL if none)
+    struct ggml_tensor * out_err;           // graph outputs: squared error (per tile with a map)
+    struct ggml_tensor * out_src;
+    double sq_err;                          // sum of squared errors (< 0 on failure)
+    double sq_src;                          // sum of squared source values
+};
+
+struct ggml_p9ml_qat_group {
+    struct ggml_p9ml_membrane * membrane;
+    int slot;
+};
+
+// ggml_vec_sq_err_f32 of the CPU backend
+typedef void (*ggml_p9ml_sq_err_t)(int n, double * sq_err, double * sq_x, const float * x, const float * y);
+
+struct ggml_p9ml_qat_pass {
+    enum ggml_p9ml_pass kind;               // operation the pass is recorded as
+    const struct ggml_p9ml_membrane * membrane; // membrane the operation was called on
+    uint64_t run;                           // stats run (0: not recorded)
+    uint64_t seed;                          // noise seed
+    float noise_scale;                      // noise standard deviation (0 to disable)
+    bool write_back;                        // replace the objects with their fake-quantized values
+    const struct ggml_tensor * reference;   // FP values to compare with (NULL: the objects themselves)
+    struct ggml_p9ml_qat_chunk * chunks;
+    int n_chunks;
+    int max_chunks;
+    struct ggml_p9ml_qat_job * jobs;
+    int n_jobs;
+    int max_jobs;
+    struct ggml_p9ml_qat_group * groups;    // object of each group
+    int n_groups;
+    int max_groups;
+    ggml_p9ml_sq_err_t sq_err_f32;          // error kernel of the CPU backend (NULL: scalar)
+    int64_t scratch_elements;               // largest chunk, in elements
+    size_t scratch_size;                    // per-thread scratch size in bytes
+    void * scratch[GGML_MAX_N_THREADS];     // per-thread scratch, allocated on first use
+};
+
+static struct ggml_p9ml_qat_pass * ggml_p9ml_qat_pass_new(
+    enum ggml_p9ml_pass kind,
+    const struct ggml_p9ml_membrane * membrane,
+    uint64_t seed,
+    float noise_scale,
+    bool write_back);
+static void ggml_p9ml_qat_pass_free(struct ggml_p9ml_qat_pass * pass);
+static int ggml_p9ml_qat_pass_add(
+    struct ggml_p9ml_qat_pass * pass,
+    struct ggml_p9ml_membrane * membrane,
+    int slot,
+    enum ggml_type type,
+    const struct ggml_p9ml_tile_map * map);
+static int ggml_p9ml_qat_pass_run(struct ggml_p9ml_qat_pass * pass, struct ggml_p9ml_namespace * ns, double * sq_err, double * sq_src);
+static void ggml_p9ml_noise_generate(float * dst, int64_t n, int64_t offset, uint64_t seed, uint64_t id, enum ggml_p9ml_noise_type type, float scale, bool accumulate);
+static void ggml_p9ml_membrane_destroy(struct ggml_p9ml_membrane * membrane);
+static uint64_t ggml_p9ml_stats_begin(struct ggml_p9ml_namespace * ns);
+static struct ggml_p9ml_stats_record * ggml_p9ml_stats_add(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    enum ggml_p9ml_pass pass,
+    const struct ggml_p9ml_membrane * membrane,
+    bool total,
+    int64_t t_start,
+    int64_t t_end);
+static void ggml_p9ml_stats_add_pass(struct ggml_p9ml_namespace * ns, const struct ggml_p9ml_qat_pass * pass, int64_t t_start, int64_t t_end);
+static void ggml_p9ml_stats_add_membrane(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    enum ggml_p9ml_pass pass,
+    const struct ggml_p9ml_membrane * membrane,
+    int64_t t_start);
+static void ggml_p9ml_stats_add_total(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    enum ggml_p9ml_pass pass,
+    const struct ggml_p9ml_membrane * membrane,
+    int64_t t_start);
+struct ggml_p9ml_node_timing;
+static struct ggml_p9ml_node_timing * ggml_p9ml_node_timing_new(struct ggml_p9ml_namespace * ns, struct ggml_cgraph * graph);
+static void ggml_p9ml_node_timing_free(struct ggml_p9ml_node_timing * timing);
+static bool ggml_p9ml_node_timing_eval(struct ggml_tensor * t, bool ask, void * user_data);
+static void ggml_p9ml_stats_add_compute(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    const struct ggml_cgraph * graph,
+    const struct ggml_p9ml_node_timing * timing,
+    int64_t t_start);
+
+//
+// Traversal engine
+//
+// The membrane tree is flattened iteratively (no recursion, so deep trees are safe) into a
+// list in topological order: every membrane comes after its parent and the membranes of the
+// same depth are contiguous (a wave). Passes over the tree are expressed as tasks that are
+// pulled from a shared counter by the threads of the namespace CPU backend, so that sibling
+// membranes and the chunks of their objects are processed concurrently.
+//
+
+struct ggml_p9ml_work_list {
+    struct ggml_p9ml_membrane ** membranes; // membranes in topological (BFS) order
+    int * wave_offsets;                     // wave d spans [wave_offsets[d], wave_offsets[d + 1])
+    int n_membranes;
+    int n_waves;
+};
+
+typedef void (*ggml_p9ml_task_t)(int task, int ith, void * userdata);
+
+//
+// Namespace arena
+//
+// Bump allocator for the membranes of a namespace and their tables. Memory comes from a short list
+// of blocks of geometrically increasing size, and is released all at once by ggml_p9ml_namespace_free.
+// Tables that outgrow their capacity are reallocated at twice the size, the old storage is abandoned
+// (bounded by the size of the live tables).
+//
+
+struct ggml_p9ml_arena_block {
+    struct ggml_p9ml_arena_block * next;
+    size_t size;                            // usable bytes after the header
+    size_t used;
+};
+
+struct ggml_p9ml_arena {
+    struct ggml_p9ml_arena_block * head;    // block currently being filled
+    size_t next_block_size;
+    size_t total_size;                      // bytes reserved by all the blocks
+};
+
+static struct ggml_p9ml_arena * ggml_p9ml_arena_new(void);
+static void ggml_p9ml_arena_free(struct ggml_p9ml_arena * arena);
+static void * ggml_p9ml_arena_alloc(struct ggml_p9ml_arena * arena, size_t size);
+
+static int ggml_p9ml_work_list_build(struct ggml_p9ml_membrane * root, struct ggml_p9ml_work_list * list);
+static int ggml_p9ml_work_list_build_resident(struct ggml_p9ml_membrane * root, struct ggml_p9ml_work_list * list);
+static int ggml_p9ml_work_list_reload(struct ggml_p9ml_work_list * list);
+static void ggml_p9ml_work_list_free(struct ggml_p9ml_work_list * list);
+static ggml_backend_t ggml_p9ml_cpu_backend(const struct ggml_p9ml_namespace * ns);
+static void * ggml_p9ml_cpu_proc_address(const struct ggml_p9ml_namespace * ns, const char * name);
+static void ggml_p9ml_namespace_sched_free(struct ggml_p9ml_namespace * ns);
+static int ggml_p9ml_run_tasks(
+    struct ggml_p9ml_namespace * ns,
+    const int * phase_offsets,
+    int n_phases,
+    const int * task_nodes,
+    ggml_p9ml_task_t fun,
+    void * userdata);
 
 //
 // Membrane creation and management
@@ -32,34 +295,7 @@ struct ggml_p9ml_membrane * ggml_p9ml_membrane_new(
     int level,
     struct ggml_context * ctx) {
     
-    struct ggml_p9ml_membrane * membrane = malloc(sizeof(struct ggml_p9ml_membrane));
-    if (!membrane) {
-        return NULL;
-    }
-    
-    // Initialize basic properties
-    strncpy(membrane->name, name ? name : "unnamed", P9ML_MEMBRANE_NAME_MAX - 1);
-    membrane->name[P9ML_MEMBRANE_NAME_MAX - 1] = '\0';
-    membrane->level = level;
-    membrane->ctx = ctx;
-    membrane->ns = NULL;
-    membrane->parent = NULL;
-    
-    // Initialize counters
-    membrane->num_children = 0;
-    membrane->max_children = P9ML_DEFAULT_MAX_CHILDREN;
-    membrane->num_objects = 0;
-    membrane->max_objects = P9ML_DEFAULT_MAX_OBJECTS;
-    membrane->num_rules = 0;
-    membrane->max_rules = P9ML_DEFAULT_MAX_RULES;
-    
-    // Initialize QAT config
-    membrane->qat_config = NULL;
-    
-    // Allocate arrays
-    ggml_p9ml_membrane_init_arrays(membrane);
-    
-    return membrane;
+    return ggml_p9ml_membrane_init(NULL, name, level, ctx);
 }
 
 void ggml_p9ml_membrane_free(struct ggml_p9ml_membrane * membrane) {
@@ -67,23 +303,35 @@ void ggml_p9ml_membrane_free(struct ggml_p9ml_membrane * membrane) {
         return;
     }
     
-    // Free child membranes first
-    for (int i = 0; i < membrane->num_children; i++) {
-        if (membrane->children[i]) {
-            ggml_p9ml_membrane_free(membrane->children[i]);
+    // The lookups of the namespace must not reach the freed subtree any more
+    ggml_p9ml_membrane_invalidate_index(membrane);
+    struct ggml_p9ml_membrane * top = membrane->parent;
+    for (int c = 0; top && c < top->num_children; c++) {
+        if (top->children[c] == membrane) {
+            memmove(&top->children[c], &top->children[c + 1], (top->num_children - c - 1) * sizeof(struct ggml_p9ml_membrane *));
+            top->num_children--;
+            break;
         }
     }
-    
-    // Free QAT config if exists
-    if (membrane->qat_config) {
-        ggml_p9ml_qat_config_free(membrane->qat_config);
+    if (!top && membrane->ns && membrane->ns->root == membrane) {
+        membrane->ns->root = NULL;
     }
     
-    // Free arrays
-    ggml_p9ml_membrane_free_arrays(membrane);
-    
-    // Free the membrane itself
-    free(membrane);
+    // Free child membranes first, walking the tree post-order through the parent links
+    struct ggml_p9ml_membrane * cur = membrane;
+    while (cur) {
+        if (cur->num_children > 0) {
+            struct ggml_p9ml_membrane * child = cur->children[--cur->num_children];
+            if (child) {
+                cur = child;
+            }
+            continue;
+        }
+        
+        struct ggml_p9ml_membrane * parent = cur == membrane ? NULL : cur->parent;
+        ggml_p9ml_membrane_destroy(cur);
+        cur = parent;
+    }
 }
 
 int ggml_p9ml_membrane_add_child(
@@ -95,14 +343,22 @@ int ggml_p9ml_membrane_add_child(
     }
     
     if (parent->num_children >= parent->max_children) {
-        return -1; // No space for more children
+        const int max_children = 2 * parent->max_children;
+        if (ggml_p9ml_membrane_grow(parent, (void **) &parent->children, parent->num_children, max_children, sizeof(struct ggml_p9ml_membrane *)) != 0) {
+            return -1;
+        }
+        parent->max_children = max_children;
     }
     
+    ggml_p9ml_membrane_mark_dirty(parent, child->dirty);
+    
     parent->children[parent->num_children] = child;
     child->parent = parent;
     child->ns = parent->ns;
     parent->num_children++;
     
+    ggml_p9ml_membrane_invalidate_index(parent);
+    
     return 0;
 }
 
@@ -114,12 +370,111 @@ int ggml_p9ml_membrane_add_object(
         return -1;
     }
     
+    // the spill file only holds the objects the membrane had when it was evicted
+    if (ggml_p9ml_membrane_reload(membrane) != 0) {
+        return -1;
+    }
+    
     if (membrane->num_objects >= membrane->max_objects) {
-        return -1; // No space for more objects
+        const int max_objects = 2 * membrane->max_objects;
+        if (ggml_p9ml_membrane_grow(membrane, (void **) &membrane->objects,       membrane->num_objects, max_objects, sizeof(struct ggml_tensor *)) != 0 ||
+            ggml_p9ml_membrane_grow(membrane, (void **) &membrane->object_errors, membrane->num_objects, max_objects, sizeof(float)) != 0 ||
+            ggml_p9ml_membrane_grow(membrane, (void **) &membrane->object_types,  membrane->num_objects, max_objects, sizeof(enum ggml_type)) != 0 ||
+            ggml_p9ml_membrane_grow(membrane, (void **) &membrane->tile_maps,     membrane->num_objects, max_objects, sizeof(struct ggml_p9ml_tile_map)) != 0 ||
+            ggml_p9ml_membrane_grow(membrane, (void **) &membrane->object_states, membrane->num_objects, max_objects, sizeof(struct ggml_p9ml_object_state)) != 0 ||
+            ggml_p9ml_membrane_grow(membrane, (void **) &membrane->calibrations,  membrane->num_objects, max_objects, sizeof(struct ggml_p9ml_calibration)) != 0) {
+            return -1;
+        }
+        membrane->max_objects = max_objects;
     }
     
     membrane->objects[membrane->num_objects] = tensor;
+    membrane->object_errors[membrane->num_objects] = -1.0f;
+    membrane->object_types[membrane->num_objects] = tensor->type;
+    memset(&membrane->tile_maps[membrane->num_objects], 0, sizeof(struct ggml_p9ml_tile_map));
+    memset(&membrane->object_states[membrane->num_objects], 0, sizeof(struct ggml_p9ml_object_state));
+    memset(&membrane->calibrations[membrane->num_objects], 0, sizeof(struct ggml_p9ml_calibration));
+    membrane->object_states[membrane->num_objects].version = 1;
     membrane->num_objects++;
+    membrane->nbytes += ggml_p9ml_object_host_bytes(tensor);
+    
+    ggml_p9ml_namespace_index_object(membrane, membrane->num_objects - 1);
+    
+    ggml_p9ml_membrane_mark_dirty(membrane, GGML_P9ML_DIRTY_ALL);
+    
+    return 0;
+}
+
+int ggml_p9ml_membrane_touch(
+    struct ggml_p9ml_membrane * membrane,
+    int index) {
+    
+    if (!membrane || index >= membrane->num_objects) {
+        return -1;
+    }
+    
+    const int i0 = index < 0 ? 0 : index;
+    const int i1 = index < 0 ? membrane->num_objects : index + 1;
+    for (int i = i0; i < i1; i++) {
+        membrane->object_states[i].version++;
+    }
+    
+    ggml_p9ml_membrane_mark_dirty(membrane, GGML_P9ML_DIRTY_ALL);
+    
+    return 0;
+}
+
+struct ggml_p9ml_rule ggml_p9ml_rule_transform(int object, ggml_p9ml_transform_t transform, void * userdata) {
+    struct ggml_p9ml_rule rule = { GGML_P9ML_RULE_TRANSFORM, object, -1, -1, transform, userdata };
+    return rule;
+}
+
+struct ggml_p9ml_rule ggml_p9ml_rule_communicate(int object, int target, int target_object) {
+    struct ggml_p9ml_rule rule = { GGML_P9ML_RULE_COMMUNICATE, object, target, target_object, NULL, NULL };
+    return rule;
+}
+
+struct ggml_p9ml_rule ggml_p9ml_rule_divide(void) {
+    struct ggml_p9ml_rule rule = { GGML_P9ML_RULE_DIVIDE, -1, -1, -1, NULL, NULL };
+    return rule;
+}
+
+struct ggml_p9ml_rule ggml_p9ml_rule_dissolve(void) {
+    struct ggml_p9ml_rule rule = { GGML_P9ML_RULE_DISSOLVE, -1, -1, -1, NULL, NULL };
+    return rule;
+}
+
+struct ggml_p9ml_rule ggml_p9ml_rule_move(int object, int target) {
+    struct ggml_p9ml_rule rule = { GGML_P9ML_RULE_MOVE, object, target, -1, NULL, NULL };
+    return rule;
+}
+
+struct ggml_p9ml_rule ggml_p9ml_rule_share(int object, int target) {
+    struct ggml_p9ml_rule rule = { GGML_P9ML_RULE_SHARE, object, target, -1, NULL, NULL };
+    return rule;
+}
+
+int ggml_p9ml_membrane_add_rule(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_rule rule) {
+    
+    if (!membrane) {
+        return -1;
+    }
+    
+    if (rule.type == GGML_P9ML_RULE_TRANSFORM && !rule.transform) {
+        return -1;
+    }
+    
+    if (membrane->num_rules >= membrane->max_rules) {
+        const int max_rules = 2 * membrane->max_rules;
+        if (ggml_p9ml_membrane_grow(membrane, (void **) &membrane->rules, membrane->num_rules, max_rules, sizeof(struct ggml_p9ml_rule)) != 0) {
+            return -1;
+        }
+        membrane->max_rules = max_rules;
+    }
+    
+    membrane->rules[membrane->num_rules++] = rule;
     
     return 0;
 }
@@ -142,8 +497,30 @@ struct ggml_p9ml_namespace * ggml_p9ml_namespace_new(
     ns->name[P9ML_MEMBRANE_NAME_MAX - 1] = '\0';
     ns->root = NULL;
     ns->backend = backend;
+    ns->n_backends = 0;
+    ns->sched = NULL;
+    ns->sched_graph_size = 0;
+    memset(ns->sched_bufts, 0, sizeof(ns->sched_bufts));
+    ns->shards = NULL;
+    ns->n_shards = 0;
+    ns->max_shards = 0;
+    if (backend) {
+        ns->backends[ns->n_backends++] = backend;
+    }
+    ns->threadpool = NULL;
+    ns->arena = NULL;
+    ns->galloc = NULL;
+    ns->mapping = NULL;
+    ns->index = NULL;
+    ns->stats = NULL;
+    ns->memory_budget = 0;
+    ns->spill_prefix = NULL;
+    ns->n_spills = 0;
+    ns->evict_status = 0;
+    ns->clock = 0;
     
     // Default QAT settings
+    ns->seed = GGML_P9ML_DEFAULT_SEED;
     ns->noise_scale = 0.1f;
     ns->target_bits = 8;
     ns->mixed_precision = false;
@@ -161,10 +538,64 @@ void ggml_p9ml_namespace_free(struct ggml_p9ml_namespace * ns) {
         return;
     }
     
+    // Spill files of the evicted membranes, references of the arena membranes to shared objects
+    // (a heap root may already be freed, heap membranes release their references themselves)
+    // Clones come after their originals in BFS order, releasing them first saves the originals handing their data over
+    struct ggml_p9ml_work_list list;
+    const bool walk = ns->root && (ns->spill_prefix || (ns->arena && ns->root->arena == ns->arena));
+    if (walk && ggml_p9ml_work_list_build(ns->root, &list) == 0) {
+        for (int i = list.n_membranes - 1; i >= 0; i--) {
+            struct ggml_p9ml_membrane * membrane = list.membranes[i];
+            ggml_p9ml_membrane_drop_spill(membrane);
+            for (int j = 0; j < membrane->num_objects && membrane->arena == ns->arena; j++) {
+                ggml_p9ml_object_release(membrane, j);
+            }
+        }
+        ggml_p9ml_work_list_free(&list);
+    }
+    free(ns->spill_prefix);
+    ggml_p9ml_index_free(ns->index);
+    ggml_p9ml_namespace_set_stats(ns, 0);
+    
     // Note: We don't free the root membrane here as it might be managed elsewhere
+    // Membranes allocated in the namespace arena are released with it
+    ggml_p9ml_arena_free(ns->arena);
+    ggml_gallocr_free(ns->galloc);
+    ggml_p9ml_namespace_sched_free(ns);
+    for (int i = 0; i < ns->n_shards; i++) {
+        ggml_backend_buffer_free(ns->shards[i].buffer);
+        ggml_free(ns->shards[i].ctx);
+    }
+    free(ns->shards);
+    ggml_p9ml_mapping_free(ns->mapping);
     free(ns);
 }
 
+struct ggml_p9ml_membrane * ggml_p9ml_namespace_membrane_new(
+    struct ggml_p9ml_namespace * ns,
+    const char * name,
+    int level,
+    struct ggml_context * ctx) {
+    
+    if (!ns) {
+        return NULL;
+    }
+    
+    if (!ns->arena) {
+        ns->arena = ggml_p9ml_arena_new();
+        if (!ns->arena) {
+            return NULL;
+        }
+    }
+    
+    struct ggml_p9ml_membrane * membrane = ggml_p9ml_membrane_init(ns->arena, name, level, ctx);
+    if (membrane) {
+        membrane->ns = ns;
+    }
+    
+    return membrane;
+}
+
 int ggml_p9ml_namespace_set_root(
     struct ggml_p9ml_namespace * ns,
     struct ggml_p9ml_membrane * root) {
@@ -173,356 +604,6310 @@ int ggml_p9ml_namespace_set_root(
         return -1;
     }
     
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build(root, &list) != 0) {
+        return -1;
+    }
+    
     ns->root = root;
-    ggml_p9ml_propagate_namespace(root, ns);
+    for (int i = 0; i < list.n_membranes; i++) {
+        list.membranes[i]->ns = ns;
+    }
+    ggml_p9ml_index_free(ns->index);
+    ns->index = NULL;
+    
+    ggml_p9ml_work_list_free(&list);
     
     return 0;
 }
 
-//
-// Data-Free QAT Functions
-//
+int ggml_p9ml_namespace_set_threadpool(
+    struct ggml_p9ml_namespace * ns,
+    struct ggml_threadpool * threadpool) {
 
-struct ggml_p9ml_qat_config * ggml_p9ml_qat_config_new(
-    enum ggml_type target_type,
-    float noise_scale) {
+    if (!ns || !ns->backend) {
+        return -1;
+    }
+
+    ggml_backend_dev_t dev = ggml_backend_get_device(ns->backend);
+    if (!dev || ggml_backend_dev_type(dev) != GGML_BACKEND_DEVICE_TYPE_CPU) {
+        return -1;
+    }
+
+    // ggml-base cannot link against the CPU backend, resolve the setter through the registry
+    void (*set_threadpool)(ggml_backend_t, struct ggml_threadpool *) = NULL;
+    void * proc = ggml_backend_reg_get_proc_address(ggml_backend_dev_backend_reg(dev), "ggml_backend_cpu_set_threadpool");
+    memcpy(&set_threadpool, &proc, sizeof(proc));
+    if (!set_threadpool) {
+        return -1;
+    }
+
+    set_threadpool(ns->backend, threadpool);
+    ns->threadpool = threadpool;
+
+    return 0;
+}
+
+int ggml_p9ml_namespace_add_backend(
+    struct ggml_p9ml_namespace * ns,
+    ggml_backend_t backend) {
     
-    struct ggml_p9ml_qat_config * config = malloc(sizeof(struct ggml_p9ml_qat_config));
-    if (!config) {
-        return NULL;
+    if (!ns || !backend || ns->n_backends >= GGML_P9ML_MAX_BACKENDS) {
+        return -1;
     }
     
-    // Initialize QAT parameters
-    config->target_type = target_type;
-    config->noise_scale = noise_scale;
-    config->per_channel = true;
-    config->mixed_precision = false;
+    if (!ns->backend) {
+        ns->backend = backend;
+    }
     
-    // Advanced parameters
-    config->temperature = 1.0f;
-    config->num_steps = 100;
-    config->learning_rate = 0.001f;
+    // the scheduler is rebuilt for the new set of backends
+    ggml_p9ml_namespace_sched_free(ns);
     
-    // Forward tiled QAT
-    config->tile_size = 3;
-    config->use_reference = true;
+    ns->backends[ns->n_backends] = backend;
     
-    return config;
-}
-
-void ggml_p9ml_qat_config_free(struct ggml_p9ml_qat_config * config) {
-    if (config) {
-        free(config);
-    }
+    return ns->n_backends++;
 }
 
-int ggml_p9ml_apply_data_free_qat(
+int ggml_p9ml_membrane_set_backend(
     struct ggml_p9ml_membrane * membrane,
-    struct ggml_p9ml_qat_config * config) {
+    int backend_id) {
     
-    if (!membrane || !config) {
+    if (!membrane || backend_id < -1 || (membrane->ns && backend_id >= membrane->ns->n_backends)) {
         return -1;
     }
     
-    // Create a copy of the config for this membrane to avoid double-free issues
-    if (!membrane->qat_config) {
-        membrane->qat_config = malloc(sizeof(struct ggml_p9ml_qat_config));
-        if (!membrane->qat_config) {
-            return -1;
+    membrane->backend_id = backend_id;
+    
+    return 0;
+}
+
+//
+// Object index
+//
+// Open-addressing hash table from the name and the path of every object of the namespace tree to its membrane and
+// slot. Keys are copied into a single pool (entries hold offsets, so the pool can grow). The first key inserted
+// wins, which matches breadth-first order as long as the index is built by a traversal of the tree and an object
+// whose key is already present invalidates it instead of being appended.
+// A second table counts the slots that hold each storage tensor (the object, or the tensor it views), named or not.
+//
+
+#define P9ML_INDEX_MIN_CAPACITY 64
+
+struct ggml_p9ml_index_entry {
+    uint64_t hash;                          // 0: empty
+    size_t key;                             // offset of the key in the pool
+    struct ggml_p9ml_membrane * membrane;
+    int slot;
+};
+
+struct ggml_p9ml_index_storage {
+    const struct ggml_tensor * tensor;      // NULL: empty
+    int n_slots;
+};
+
+struct ggml_p9ml_index {
+    struct ggml_p9ml_index_entry * entries;
+    size_t n_entries;
+    size_t capacity;                        // power of two, at most half full
+    char * keys;
+    size_t keys_size;
+    size_t keys_capacity;
+    struct ggml_p9ml_index_storage * storages;
+    size_t n_storages;
+    size_t storage_capacity;                // power of two, at most half full
+};
+
+static uint64_t ggml_p9ml_fnv1a(uint64_t hash, const void * data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ ((const unsigned char *) data)[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// FNV-1a, never 0 (empty entries)
+static uint64_t ggml_p9ml_index_hash(const char * key) {
+    const uint64_t hash = ggml_p9ml_fnv1a(0xcbf29ce484222325ULL, key, strlen(key));
+    return hash ? hash : 1;
+}
+
+// Noise stream of an object: the hash of its name, its slot and the names of its membranes up to the top of the
+// tree, taken the first time a pass needs it. The object keeps it when it moves, its membrane dissolves or divides,
+// so its noise does not depend on the membrane a pass starts from or on the other membranes of the tree.
+static uint64_t ggml_p9ml_object_id(struct ggml_p9ml_membrane * membrane, int slot) {
+    struct ggml_p9ml_object_state * state = &membrane->object_states[slot];
+    if (state->id == 0) {
+        const char * name = membrane->objects[slot]->name;
+        uint64_t hash = ggml_p9ml_fnv1a(0xcbf29ce484222325ULL, name, strlen(name));
+        hash = ggml_p9ml_fnv1a(hash, &slot, sizeof(slot));
+        for (const struct ggml_p9ml_membrane * cur = membrane; cur; cur = cur->parent) {
+            hash = ggml_p9ml_fnv1a(hash, "/", 1);
+            hash = ggml_p9ml_fnv1a(hash, cur->name, strlen(cur->name));
+        }
+        state->id = hash ? hash : 1;
+    }
+    return state->id;
+}
+
+static void ggml_p9ml_index_free(struct ggml_p9ml_index * index) {
+    if (!index) {
+        return;
+    }
+    
+    free(index->entries);
+    free(index->keys);
+    free(index->storages);
+    free(index);
+}
+
+static const struct ggml_tensor * ggml_p9ml_object_storage(const struct ggml_tensor * tensor) {
+    return tensor->view_src ? tensor->view_src : tensor;
+}
+
+static size_t ggml_p9ml_index_storage_hash(const struct ggml_tensor * tensor) {
+    return (size_t) (((uint64_t) (uintptr_t) tensor >> 4) * 0x9E3779B97F4A7C15ULL >> 16);
+}
+
+static struct ggml_p9ml_index_storage * ggml_p9ml_index_storage_lookup(const struct ggml_p9ml_index * index, const struct ggml_tensor * tensor) {
+    const size_t mask = index->storage_capacity - 1;
+    for (size_t i = ggml_p9ml_index_storage_hash(tensor) & mask; ; i = (i + 1) & mask) {
+        struct ggml_p9ml_index_storage * storage = &index->storages[i];
+        if (storage->tensor == tensor || storage->tensor == NULL) {
+            return storage;
         }
-        // Copy the config
-        *(membrane->qat_config) = *config;
     }
+}
+
+// Count one more slot holding the storage of an object
+static int ggml_p9ml_index_add_storage(struct ggml_p9ml_index * index, const struct ggml_tensor * object) {
+    const struct ggml_tensor * tensor = ggml_p9ml_object_storage(object);
     
-    // Apply quantization to all objects in the membrane
-    for (int i = 0; i < membrane->num_objects; i++) {
-        struct ggml_tensor * tensor = membrane->objects[i];
-        if (!tensor) continue;
-        
-        // Skip if tensor is not quantizable
-        if (tensor->type != GGML_TYPE_F32 && tensor->type != GGML_TYPE_F16) {
-            continue;
+    if (2*(index->n_storages + 1) > index->storage_capacity) {
+        const size_t capacity = 2*index->storage_capacity;
+        struct ggml_p9ml_index_storage * storages = calloc(capacity, sizeof(struct ggml_p9ml_index_storage));
+        if (!storages) {
+            return -1;
         }
-        
-        // Get tensor data
-        float * data = (float *)tensor->data;
-        if (!data) continue;
-        
-        size_t n_elements = ggml_nelements(tensor);
-        
-        // Add noise for data-free training simulation
-        for (size_t j = 0; j < n_elements; j++) {
-            data[j] += ggml_p9ml_generate_noise(config->noise_scale);
+        struct ggml_p9ml_index_storage * old = index->storages;
+        const size_t old_capacity = index->storage_capacity;
+        index->storages = storages;
+        index->storage_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].tensor) {
+                *ggml_p9ml_index_storage_lookup(index, old[i].tensor) = old[i];
+            }
         }
-        
-        // Note: Actual quantization would be applied here
-        // For now, we simulate the effect with noise injection
+        free(old);
     }
     
-    // Apply to child membranes recursively
-    for (int i = 0; i < membrane->num_children; i++) {
-        ggml_p9ml_apply_data_free_qat(membrane->children[i], config);
+    struct ggml_p9ml_index_storage * storage = ggml_p9ml_index_storage_lookup(index, tensor);
+    if (!storage->tensor) {
+        storage->tensor = tensor;
+        index->n_storages++;
     }
+    storage->n_slots++;
     
     return 0;
 }
 
-struct ggml_tensor * ggml_p9ml_generate_synthetic_data(
-    struct ggml_context * ctx,
-    const int64_t * shape,
-    int n_dims,
-    float noise_scale) {
-    
-    if (!ctx || !shape || n_dims <= 0) {
-        return NULL;
+static struct ggml_p9ml_index_entry * ggml_p9ml_index_lookup(const struct ggml_p9ml_index * index, const char * key, uint64_t hash) {
+    for (size_t i = hash & (index->capacity - 1); index->entries[i].hash != 0; i = (i + 1) & (index->capacity - 1)) {
+        struct ggml_p9ml_index_entry * entry = &index->entries[i];
+        if (entry->hash == hash && strcmp(index->keys + entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Returns 1 if the key is already present (the entry is not replaced)
+static int ggml_p9ml_index_insert(struct ggml_p9ml_index * index, const char * key, struct ggml_p9ml_membrane * membrane, int slot) {
+    const uint64_t hash = ggml_p9ml_index_hash(key);
+    if (ggml_p9ml_index_lookup(index, key, hash)) {
+        return 1;
     }
     
-    struct ggml_tensor * tensor = NULL;
-    
-    // Create tensor based on dimensions
-    switch (n_dims) {
-        case 1:
-            tensor = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, shape[0]);
-            break;
-        case 2:
-            tensor = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, shape[0], shape[1]);
-            break;
-        case 3:
-            tensor = ggml_new_tensor_3d(ctx, GGML_TYPE_F32, shape[0], shape[1], shape[2]);
+    if (2*(index->n_entries + 1) > index->capacity) {
+        const size_t capacity = 2*index->capacity;
+        struct ggml_p9ml_index_entry * entries = calloc(capacity, sizeof(struct ggml_p9ml_index_entry));
+        if (!entries) {
+            return -1;
+        }
+        for (size_t i = 0; i < index->capacity; i++) {
+            if (index->entries[i].hash != 0) {
+                size_t j = index->entries[i].hash & (capacity - 1);
+                while (entries[j].hash != 0) {
+                    j = (j + 1) & (capacity - 1);
+                }
+                entries[j] = index->entries[i];
+            }
+        }
+        free(index->entries);
+        index->entries  = entries;
+        index->capacity = capacity;
+    }
+    
+    const size_t len = strlen(key) + 1;
+    if (index->keys_size + len > index->keys_capacity) {
+        const size_t keys_capacity = MAX(2*index->keys_capacity, index->keys_size + len);
+        char * keys = realloc(index->keys, keys_capacity);
+        if (!keys) {
+            return -1;
+        }
+        index->keys          = keys;
+        index->keys_capacity = keys_capacity;
+    }
+    memcpy(index->keys + index->keys_size, key, len);
+    
+    size_t i = hash & (index->capacity - 1);
+    while (index->entries[i].hash != 0) {
+        i = (i + 1) & (index->capacity - 1);
+    }
+    index->entries[i].hash     = hash;
+    index->entries[i].key      = index->keys_size;
+    index->entries[i].membrane = membrane;
+    index->entries[i].slot     = slot;
+    index->n_entries++;
+    index->keys_size += len;
+    
+    return 0;
+}
+
+// Write the path of a membrane ("root/child/...") to buf, returns its length (0 if the membrane is not under root)
+static size_t ggml_p9ml_membrane_path(const struct ggml_p9ml_membrane * membrane, const struct ggml_p9ml_membrane * root, char * buf, size_t size) {
+    size_t len = 0;
+    const struct ggml_p9ml_membrane * cur = membrane;
+    for (; cur; cur = cur == root ? NULL : cur->parent) {
+        len += strlen(cur->name) + (cur == membrane ? 0 : 1);
+        if (cur == root) {
             break;
-        case 4:
-            tensor = ggml_new_tensor_4d(ctx, GGML_TYPE_F32, shape[0], shape[1], shape[2], shape[3]);
+        }
+    }
+    if (!cur || len >= size) {
+        return 0;
+    }
+    
+    // filled from the end
+    size_t end = len;
+    for (cur = membrane; ; cur = cur->parent) {
+        const size_t n = strlen(cur->name);
+        if (cur != membrane) {
+            buf[--end] = '/';
+        }
+        end -= n;
+        memcpy(buf + end, cur->name, n);
+        if (cur == root) {
             break;
+        }
+    }
+    buf[len] = '\0';
+    
+    return len;
+}
+
+// Index the name and the path of an object, returns 1 if one of them is already present
+static int ggml_p9ml_index_add_object(struct ggml_p9ml_index * index, const struct ggml_p9ml_membrane * root, struct ggml_p9ml_membrane * membrane, int slot) {
+    if (ggml_p9ml_index_add_storage(index, membrane->objects[slot]) != 0) {
+        return -1;
+    }
+    
+    const char * name = membrane->objects[slot]->name;
+    if (name[0] == '\0') {
+        return 0;
+    }
+    
+    size_t size = GGML_MAX_NAME + 1;
+    for (const struct ggml_p9ml_membrane * cur = membrane; cur; cur = cur == root ? NULL : cur->parent) {
+        size += P9ML_MEMBRANE_NAME_MAX;
+    }
+    
+    char buf[8*P9ML_MEMBRANE_NAME_MAX];
+    char * path = size <= sizeof(buf) ? buf : malloc(size);
+    if (!path) {
+        return -1;
+    }
+    
+    const size_t len = ggml_p9ml_membrane_path(membrane, root, path, size - GGML_MAX_NAME - 1);
+    snprintf(path + len, size - len, "/%s", name);
+    
+    const int by_name = ggml_p9ml_index_insert(index, name, membrane, slot);
+    const int by_path = by_name < 0 || len == 0 ? by_name : ggml_p9ml_index_insert(index, path, membrane, slot);
+    
+    if (path != buf) {
+        free(path);
+    }
+    
+    return by_name < 0 || by_path < 0 ? -1 : MAX(by_name, by_path);
+}
+
+static struct ggml_p9ml_index * ggml_p9ml_index_build(struct ggml_p9ml_namespace * ns) {
+    struct ggml_p9ml_index * index = calloc(1, sizeof(struct ggml_p9ml_index));
+    if (!index) {
+        return NULL;
+    }
+    
+    index->capacity = P9ML_INDEX_MIN_CAPACITY;
+    index->entries  = calloc(index->capacity, sizeof(struct ggml_p9ml_index_entry));
+    index->storage_capacity = P9ML_INDEX_MIN_CAPACITY;
+    index->storages = calloc(index->storage_capacity, sizeof(struct ggml_p9ml_index_storage));
+    
+    struct ggml_p9ml_work_list list;
+    if (!index->entries || !index->storages || ggml_p9ml_work_list_build(ns->root, &list) != 0) {
+        ggml_p9ml_index_free(index);
+        return NULL;
+    }
+    
+    int result = 0;
+    for (int m = 0; m < list.n_membranes && result >= 0; m++) {
+        for (int i = 0; i < list.membranes[m]->num_objects && result >= 0; i++) {
+            result = ggml_p9ml_index_add_object(index, ns->root, list.membranes[m], i);
+        }
+    }
+    
+    ggml_p9ml_work_list_free(&list);
+    
+    if (result < 0) {
+        ggml_p9ml_index_free(index);
+        return NULL;
+    }
+    
+    return index;
+}
+
+// Namespace whose tree holds the membrane (the ns links of membranes attached below a detached subtree may be unset)
+static struct ggml_p9ml_namespace * ggml_p9ml_membrane_tree_namespace(const struct ggml_p9ml_membrane * membrane) {
+    const struct ggml_p9ml_membrane * top = membrane;
+    while (top->parent) {
+        top = top->parent;
+    }
+    return top->ns && top->ns->root == top ? top->ns : NULL;
+}
+
+// The tree of the membrane changed, the index is rebuilt on the next lookup
+static void ggml_p9ml_membrane_invalidate_index(struct ggml_p9ml_membrane * membrane) {
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_membrane_tree_namespace(membrane);
+    if (ns && ns->index) {
+        ggml_p9ml_index_free(ns->index);
+        ns->index = NULL;
+    }
+}
+
+// Index an object added to a membrane (appending keeps breadth-first order unless one of its keys is taken)
+static void ggml_p9ml_namespace_index_object(struct ggml_p9ml_membrane * membrane, int slot) {
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_membrane_tree_namespace(membrane);
+    if (!ns || !ns->index) {
+        return;
+    }
+    
+    if (ggml_p9ml_index_add_object(ns->index, ns->root, membrane, slot) != 0) {
+        ggml_p9ml_index_free(ns->index);
+        ns->index = NULL;
+    }
+}
+
+struct ggml_tensor * ggml_p9ml_namespace_find(
+    struct ggml_p9ml_namespace * ns,
+    const char * key,
+    struct ggml_p9ml_membrane ** membrane,
+    int * slot) {
+    
+    if (!ns || !key || !ns->root) {
+        return NULL;
+    }
+    
+    if (!ns->index && !(ns->index = ggml_p9ml_index_build(ns))) {
+        return NULL;
+    }
+    
+    const struct ggml_p9ml_index_entry * entry = ggml_p9ml_index_lookup(ns->index, key, ggml_p9ml_index_hash(key));
+    if (!entry) {
+        return NULL;
+    }
+    
+    if (membrane) {
+        *membrane = entry->membrane;
+    }
+    if (slot) {
+        *slot = entry->slot;
+    }
+    
+    return entry->membrane->objects[entry->slot];
+}
+
+//
+// Data-Free QAT Functions
+//
+
+struct ggml_p9ml_qat_config * ggml_p9ml_qat_config_new(
+    enum ggml_type target_type,
+    float noise_scale) {
+    
+    struct ggml_p9ml_qat_config * config = malloc(sizeof(struct ggml_p9ml_qat_config));
+    if (!config) {
+        return NULL;
+    }
+    
+    // Initialize QAT parameters
+    config->target_type = target_type;
+    config->noise_scale = noise_scale;
+    config->per_channel = true;
+    config->mixed_precision = false;
+    
+    // Advanced parameters
+    config->temperature = 1.0f;
+    config->num_steps = 100;
+    config->learning_rate = 0.001f;
+    
+    // Calibration
+    config->scale_steps = 8;
+    config->scale_range = 0.1f;
+    
+    // Forward tiled QAT
+    config->tile_size = 0;
+    config->use_reference = true;
+    
+    return config;
+}
+
+void ggml_p9ml_qat_config_free(struct ggml_p9ml_qat_config * config) {
+    if (config) {
+        free(config);
+    }
+}
+
+// Types that ggml_quantize_chunk can produce (those that require an importance matrix need calibrated objects)
+static bool ggml_p9ml_can_fake_quantize(enum ggml_type type) {
+    switch (type) {
+        case GGML_TYPE_F16:
+        case GGML_TYPE_BF16:
+        case GGML_TYPE_Q4_0:
+        case GGML_TYPE_Q4_1:
+        case GGML_TYPE_Q5_0:
+        case GGML_TYPE_Q5_1:
+        case GGML_TYPE_Q8_0:
+        case GGML_TYPE_Q2_K:
+        case GGML_TYPE_Q3_K:
+        case GGML_TYPE_Q4_K:
+        case GGML_TYPE_Q5_K:
+        case GGML_TYPE_Q6_K:
+        case GGML_TYPE_TQ1_0:
+        case GGML_TYPE_TQ2_0:
+        case GGML_TYPE_IQ4_NL:
+        case GGML_TYPE_IQ4_XS:
+        case GGML_TYPE_IQ3_XXS:
+        case GGML_TYPE_IQ3_S:
+        case GGML_TYPE_IQ2_XXS:
+        case GGML_TYPE_IQ2_XS:
+        case GGML_TYPE_IQ2_S:
+        case GGML_TYPE_IQ1_S:
+        case GGML_TYPE_IQ1_M:
+            return true;
         default:
-            return NULL;
+            return false;
+    }
+}
+
+// Importance matrix of a calibrated object (NULL if none)
+static const float * ggml_p9ml_object_imatrix(const struct ggml_p9ml_membrane * membrane, int slot) {
+    const struct ggml_p9ml_calibration * cal = &membrane->calibrations[slot];
+    return cal->imatrix && cal->n_cols == membrane->objects[slot]->ne[0] ? cal->imatrix : NULL;
+}
+
+// Settings of a QAT pass, objects fake-quantized with the same key and not modified since are skipped
+static uint64_t ggml_p9ml_qat_key(const struct ggml_p9ml_qat_config * config, uint64_t seed) {
+    uint32_t noise_bits;
+    memcpy(&noise_bits, &config->noise_scale, sizeof(noise_bits));
+    
+    // splitmix64 finalizer of the settings, never 0 (no pass)
+    uint64_t key = seed ^ ((uint64_t) config->target_type << 32) ^ noise_bits;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    key =  key ^ (key >> 31);
+    
+    return key ? key : 1;
+}
+
+static bool ggml_p9ml_object_is_host(const struct ggml_tensor * tensor) {
+    return tensor->data && (!tensor->buffer || ggml_backend_buffer_is_host(tensor->buffer));
+}
+
+// Host memory of an object counted by the memory budget (views are counted with their source)
+static size_t ggml_p9ml_object_host_bytes(const struct ggml_tensor * tensor) {
+    return ggml_p9ml_object_is_host(tensor) && !tensor->view_src ? ggml_nbytes(tensor) : 0;
+}
+
+// Drop the slot from the count of the slots sharing the object data (the data itself is not owned by the slots)
+static void ggml_p9ml_object_release(struct ggml_p9ml_membrane * membrane, int slot) {
+    struct ggml_p9ml_object_state * state = &membrane->object_states[slot];
+    if (state->refs && --*state->refs == 0) {
+        free(state->refs);
+    }
+    state->refs = NULL;
+    ggml_p9ml_object_drop_cow(membrane, slot);
+}
+
+static bool ggml_p9ml_object_has_quantizable_layout(const struct ggml_tensor * tensor, enum ggml_type type) {
+    if (!ggml_is_contiguous(tensor)) {
+        return false;
+    }
+    if (tensor->type != GGML_TYPE_F32 && tensor->type != GGML_TYPE_F16 && tensor->type != GGML_TYPE_BF16) {
+        return false;
+    }
+    return tensor->ne[0] % ggml_blck_size(type) == 0;
+}
+
+// Objects that can be fake-quantized in place to the given type
+static bool ggml_p9ml_object_is_quantizable(const struct ggml_tensor * tensor, enum ggml_type type) {
+    return tensor && ggml_p9ml_object_is_host(tensor) && ggml_p9ml_object_has_quantizable_layout(tensor, type);
+}
+
+// Namespace backend that holds a device object (-1 for host objects and objects of other buffers)
+static int ggml_p9ml_object_backend(const struct ggml_p9ml_membrane * membrane, const struct ggml_tensor * tensor) {
+    if (!membrane->ns || !tensor->buffer || !tensor->data || ggml_p9ml_object_is_host(tensor)) {
+        return -1;
+    }
+    
+    ggml_backend_buffer_type_t buft = ggml_backend_buffer_get_type(tensor->buffer);
+    for (int b = 0; b < membrane->ns->n_backends; b++) {
+        if (ggml_backend_get_default_buffer_type(membrane->ns->backends[b]) == buft) {
+            return b;
+        }
+    }
+    
+    return -1;
+}
+
+// Objects that a pass can fake-quantize, on the host or on the namespace backend that holds them
+static bool ggml_p9ml_object_is_pass_quantizable(const struct ggml_p9ml_membrane * membrane, int slot, enum ggml_type type) {
+    const struct ggml_tensor * tensor = membrane->objects[slot];
+    if (!tensor || !ggml_p9ml_object_has_quantizable_layout(tensor, type)) {
+        return false;
+    }
+    return ggml_p9ml_object_is_host(tensor) || ggml_p9ml_object_backend(membrane, tensor) >= 0;
+}
+
+// sum((x - y)^2) and sum(x^2), the vectorized kernel of the CPU backend (pass->sq_err_f32) if the
+// namespace has one
+static void ggml_p9ml_sq_err(const struct ggml_p9ml_qat_pass * pass, const float * x, const float * y, int64_t n, double * sq_err, double * sq_x) {
+    if (pass->sq_err_f32 && n <= INT_MAX) {
+        pass->sq_err_f32((int) n, sq_err, sq_x, x, y);
+        return;
+    }
+    
+    double sum_err = 0.0;
+    double sum_x   = 0.0;
+    for (int64_t i = 0; i < n; i++) {
+        const float d = x[i] - y[i];
+        sum_err += (double) (d*d);
+        sum_x   += (double) (x[i]*x[i]);
+    }
+    
+    *sq_err = sum_err;
+    *sq_x   = sum_x;
+}
+
+// Rows [ir0, ir1) x columns [ic0, ic1) of a contiguous tensor as packed floats
+static void ggml_p9ml_tile_to_float(const struct ggml_tensor * tensor, int64_t ir0, int64_t ir1, int64_t ic0, int64_t ic1, float * dst) {
+    const size_t offs = ggml_row_size(tensor->type, ic0);
+    const int64_t n   = ic1 - ic0;
+    
+    for (int64_t ir = ir0; ir < ir1; ir++) {
+        const char * row = (const char *) tensor->data + ir*tensor->nb[1] + offs;
+        if (tensor->type == GGML_TYPE_F32) {
+            memcpy(dst, row, n*sizeof(float));
+        } else {
+            ggml_get_type_traits(tensor->type)->to_float(row, dst, n);
+        }
+        dst += n;
+    }
+}
+
+static void ggml_p9ml_tile_from_float(struct ggml_tensor * tensor, int64_t ir0, int64_t ir1, int64_t ic0, int64_t ic1, const float * src) {
+    const size_t offs = ggml_row_size(tensor->type, ic0);
+    const int64_t n   = ic1 - ic0;
+    
+    for (int64_t ir = ir0; ir < ir1; ir++) {
+        char * row = (char *) tensor->data + ir*tensor->nb[1] + offs;
+        if (tensor->type == GGML_TYPE_F32) {
+            memcpy(row, src, n*sizeof(float));
+        } else {
+            ggml_get_type_traits(tensor->type)->from_float_ref(src, row, n);
+        }
+        src += n;
+    }
+}
+
+// Calibrated scales of an object that apply to type (NULL if none): one per row, or one per block of type
+static const float * ggml_p9ml_object_scales(const struct ggml_p9ml_membrane * membrane, int slot, enum ggml_type type, int64_t * n_row_scales) {
+    const struct ggml_tensor * tensor = membrane->objects[slot];
+    const struct ggml_p9ml_calibration * cal = &membrane->calibrations[slot];
+    
+    if (!cal->scales || cal->n_rows != ggml_nrows(tensor) ||
+        (cal->n_row_scales != 1 && cal->n_row_scales != tensor->ne[0]/ggml_blck_size(type))) {
+        return NULL;
+    }
+    
+    *n_row_scales = cal->n_row_scales;
+    return cal->scales;
+}
+
+// Multiply (or divide) a packed tile of columns [ic0, ic0 + ncols) by its scales, n_row_scales per row
+// of n_per_row columns
+static void ggml_p9ml_scale_tile(float * x, int64_t nrows, int64_t ic0, int64_t ncols, int64_t n_per_row,
+                                 const float * scales, int64_t n_row_scales, bool inverse) {
+    const int64_t cols_per_scale = n_per_row/n_row_scales;
+    for (int64_t r = 0; r < nrows; r++) {
+        for (int64_t j = 0; j < ncols; j++) {
+            const float s = scales[r*n_row_scales + (ic0 + j)/cols_per_scale];
+            x[r*ncols + j] = inverse ? x[r*ncols + j]/s : x[r*ncols + j]*s;
+        }
+    }
+}
+
+// Task: quantize + dequantize a tile, accumulate the squared error and optionally write back
+
+static void ggml_p9ml_fake_quant_task(int task, int ith, void * userdata) {
+    struct ggml_p9ml_qat_pass  * pass  = (struct ggml_p9ml_qat_pass *) userdata;
+    struct ggml_p9ml_qat_chunk * chunk = &pass->chunks[task];
+    
+    if (pass->run) {
+        chunk->t_start = ggml_time_us();
+    }
+    
+    if (!pass->scratch[ith]) {
+        pass->scratch[ith] = malloc(pass->scratch_size);
+        if (!pass->scratch[ith]) {
+            chunk->sq_err = -1.0;
+            return;
+        }
+    }
+    
+    struct ggml_tensor * tensor = chunk->membrane->objects[chunk->slot];
+    
+    const int64_t ncols = chunk->ic1 - chunk->ic0;
+    const int64_t nrows = chunk->ir1 - chunk->ir0;
+    const int64_t n     = nrows*ncols;
+    
+    float * src = (float *) pass->scratch[ith];
+    float * deq = src + pass->scratch_elements;
+    float * ref = pass->reference ? deq + pass->scratch_elements : src;
+    void  * q   = (pass->reference ? ref : deq) + pass->scratch_elements;
+    
+    ggml_p9ml_tile_to_float(tensor, chunk->ir0, chunk->ir1, chunk->ic0, chunk->ic1, src);
+    if (pass->reference) {
+        ggml_p9ml_tile_to_float(pass->reference, chunk->ir0, chunk->ir1, chunk->ic0, chunk->ic1, ref);
+    }
+    
+    // Add noise for data-free training simulation, element (row, column) of the object takes its value of the stream
+    if (pass->noise_scale > 0.0f) {
+        if (ncols == tensor->ne[0]) {
+            ggml_p9ml_noise_generate(src, n, chunk->ir0*tensor->ne[0], pass->seed, chunk->id, GGML_P9ML_NOISE_GAUSSIAN, pass->noise_scale, true);
+        } else {
+            for (int64_t r = 0; r < nrows; r++) {
+                ggml_p9ml_noise_generate(src + r*ncols, ncols, (chunk->ir0 + r)*tensor->ne[0] + chunk->ic0, pass->seed, chunk->id,
+                    GGML_P9ML_NOISE_GAUSSIAN, pass->noise_scale, true);
+            }
+        }
+    }
+    
+    // Calibrated scales: quantize s*w, dequantize to q(s*w)/s
+    int64_t n_row_scales = 0;
+    const float * scales  = ggml_p9ml_object_scales(chunk->membrane, chunk->slot, chunk->type, &n_row_scales);
+    const float * imatrix = ggml_p9ml_object_imatrix(chunk->membrane, chunk->slot);
+    if (scales) {
+        scales += chunk->ir0*n_row_scales;
+        ggml_p9ml_scale_tile(src, nrows, chunk->ic0, ncols, tensor->ne[0], scales, n_row_scales, false);
+    }
+    
+    // Blocks are quantized independently, so a tile of whole blocks matches the full rows
+    ggml_quantize_chunk(chunk->type, src, q, 0, nrows, ncols, imatrix ? imatrix + chunk->ic0 : NULL);
+    ggml_get_type_traits(chunk->type)->to_float(q, deq, n);
+    
+    if (scales) {
+        ggml_p9ml_scale_tile(src, nrows, chunk->ic0, ncols, tensor->ne[0], scales, n_row_scales, true);
+        ggml_p9ml_scale_tile(deq, nrows, chunk->ic0, ncols, tensor->ne[0], scales, n_row_scales, true);
+    }
+    
+    ggml_p9ml_sq_err(pass, ref, deq, n, &chunk->sq_err, &chunk->sq_src);
+    
+    if (chunk->rmse) {
+        *chunk->rmse = (float) sqrt(chunk->sq_err / (double) n);
+    }
+    
+    if (pass->write_back) {
+        ggml_p9ml_tile_from_float(tensor, chunk->ir0, chunk->ir1, chunk->ic0, chunk->ic1, deq);
+    }
+    
+    if (pass->run) {
+        chunk->t_end = ggml_time_us();
+    }
+}
+
+int ggml_p9ml_apply_data_free_qat(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_qat_config * config) {
+    
+    if (!membrane || !config) {
+        return -1;
+    }
+    
+    if (!ggml_p9ml_can_fake_quantize(config->target_type)) {
+        GGML_LOG_WARN("%s: cannot fake-quantize to type %s\n", __func__, ggml_type_name(config->target_type));
+        return -1;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(membrane, &list) != 0) {
+        return -1;
+    }
+    
+    struct ggml_p9ml_qat_pass * pass = ggml_p9ml_qat_pass_new(GGML_P9ML_PASS_QAT, membrane,
+        membrane->ns ? membrane->ns->seed : GGML_P9ML_DEFAULT_SEED, config->noise_scale, true);
+    if (!pass) {
+        ggml_p9ml_work_list_free(&list);
+        return -1;
+    }
+    
+    int result = 0;
+    
+    const uint64_t key = ggml_p9ml_qat_key(config, pass->seed);
+    
+    // Split every modified quantizable object of the tree into chunks of rows
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        
+        if (!(cur->dirty & GGML_P9ML_DIRTY_QAT) && cur->qat_key == key) {
+            continue;
+        }
+        
+        // Create a copy of the config for this membrane to avoid double-free issues
+        if (!cur->qat_config) {
+            cur->qat_config = ggml_p9ml_membrane_alloc(cur, sizeof(struct ggml_p9ml_qat_config));
+            if (!cur->qat_config) {
+                result = -1;
+                break;
+            }
+            // Copy the config
+            *(cur->qat_config) = *config;
+        }
+        
+        for (int i = 0; i < cur->num_objects && result == 0; i++) {
+            const struct ggml_p9ml_object_state * state = &cur->object_states[i];
+            if (state->qat_version == state->version && state->qat_key == key) {
+                continue;
+            }
+            cur->object_errors[i] = -1.0f;
+            
+            // aliases are quantized through the object they view
+            if (!state->alias && ggml_p9ml_object_is_pass_quantizable(cur, i, config->target_type)) {
+                if (ggml_quantize_requires_imatrix(config->target_type) && !ggml_p9ml_object_imatrix(cur, i)) {
+                    GGML_LOG_WARN("%s: type %s needs an importance matrix, object '%s' is not calibrated\n", __func__,
+                                  ggml_type_name(config->target_type), cur->objects[i]->name);
+                    result = -1;
+                    break;
+                }
+                // the pass writes the object, data shared with a divided membrane is copied first
+                if (ggml_p9ml_membrane_unshare(cur, i) != 0 ||
+                    ggml_p9ml_qat_pass_add(pass, cur, i, config->target_type, NULL) < 0) {
+                    result = -1;
+                }
+            }
+        }
+    }
+    
+    double * sq_err = malloc((pass->n_groups + 1) * sizeof(double));
+    if (!sq_err) {
+        result = -1;
+    }
+    
+    if (result == 0) {
+        result = ggml_p9ml_qat_pass_run(pass, membrane->ns, sq_err, NULL);
+    }
+    
+    // Per-object RMSE (one group per object), the objects were written back
+    for (int g = 0; g < pass->n_groups && result == 0; g++) {
+        struct ggml_p9ml_membrane * cur = pass->groups[g].membrane;
+        const int slot = pass->groups[g].slot;
+        cur->object_errors[slot] = (float) sqrt(sq_err[g] / (double) ggml_nelements(cur->objects[slot]));
+        cur->object_states[slot].version++;
+        ggml_p9ml_membrane_mark_dirty(cur, GGML_P9ML_DIRTY_MIXED);
+    }
+    
+    // The subtree is up to date with these settings
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        for (int i = 0; i < cur->num_objects; i++) {
+            cur->object_states[i].qat_version = cur->object_states[i].version;
+            cur->object_states[i].qat_key = key;
+        }
+        cur->dirty &= ~GGML_P9ML_DIRTY_QAT;
+        cur->qat_key = key;
+    }
+    
+    free(sq_err);
+    ggml_p9ml_qat_pass_free(pass);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+struct ggml_tensor * ggml_p9ml_generate_synthetic_data(
+    struct ggml_context * ctx,
+    const int64_t * shape,
+    int n_dims,
+    float noise_scale) {
+    
+    if (!ctx || !shape || n_dims <= 0) {
+        return NULL;
+    }
+    
+    struct ggml_tensor * tensor = NULL;
+    
+    // Create tensor based on dimensions
+    switch (n_dims) {
+        case 1:
+            tensor = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, shape[0]);
+            break;
+        case 2:
+            tensor = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, shape[0], shape[1]);
+            break;
+        case 3:
+            tensor = ggml_new_tensor_3d(ctx, GGML_TYPE_F32, shape[0], shape[1], shape[2]);
+            break;
+        case 4:
+            tensor = ggml_new_tensor_4d(ctx, GGML_TYPE_F32, shape[0], shape[1], shape[2], shape[3]);
+            break;
+        default:
+            return NULL;
+    }
+    
+    if (!tensor) {
+        return NULL;
+    }
+    
+    // Fill with synthetic data (Gaussian noise), the stream is the offset of the tensor in the context
+    const uint64_t id = (uint64_t) ((const char *) tensor - (const char *) ggml_get_mem_buffer(ctx));
+    
+    float * data = (float *)tensor->data;
+    if (data) {
+        ggml_p9ml_noise_fill(data, ggml_nelements(tensor), 0, GGML_P9ML_DEFAULT_SEED, id, GGML_P9ML_NOISE_GAUSSIAN, noise_scale);
+    }
+    
+    return tensor;
+}
+
+// Size the tile map of an object: whole quantization blocks, about tile_elements per tile
+static int ggml_p9ml_tile_map_init(struct ggml_p9ml_membrane * membrane, int slot, enum ggml_type type, int64_t tile_elements) {
+    const struct ggml_tensor * tensor = membrane->objects[slot];
+    struct ggml_p9ml_tile_map * map = &membrane->tile_maps[slot];
+    
+    const int64_t blck      = ggml_blck_size(type);
+    const int64_t n_per_row = tensor->ne[0];
+    const int64_t nr        = ggml_nrows(tensor);
+    
+    map->tile_cols = n_per_row <= tile_elements ? n_per_row : MAX(blck, tile_elements/blck*blck);
+    map->tile_rows = MIN(nr, MAX(1, tile_elements/map->tile_cols));
+    map->n_x       = (n_per_row + map->tile_cols - 1)/map->tile_cols;
+    map->n_y       = (nr + map->tile_rows - 1)/map->tile_rows;
+    
+    const int64_t n_tiles = map->n_x*map->n_y;
+    if (n_tiles > map->capacity) {
+        float * rmse = ggml_p9ml_membrane_alloc(membrane, n_tiles*sizeof(float));
+        if (!rmse) {
+            return -1;
+        }
+        if (!membrane->arena) {
+            free(map->rmse);
+        }
+        map->rmse = rmse;
+        map->capacity = n_tiles;
+    }
+    
+    for (int64_t t = 0; t < n_tiles; t++) {
+        map->rmse[t] = -1.0f;
+    }
+    
+    return 0;
+}
+
+int ggml_p9ml_forward_tiled_qat(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_qat_config * config,
+    struct ggml_tensor * reference) {
+    
+    if (!membrane || !config) {
+        return -1;
+    }
+    
+    if (!ggml_p9ml_can_fake_quantize(config->target_type)) {
+        GGML_LOG_WARN("%s: cannot fake-quantize to type %s\n", __func__, ggml_type_name(config->target_type));
+        return -1;
+    }
+    
+    if (!config->use_reference) {
+        reference = NULL;
+    }
+    
+    if (reference && (!ggml_p9ml_object_is_host(reference) || !ggml_is_contiguous(reference) ||
+        (reference->type != GGML_TYPE_F32 && reference->type != GGML_TYPE_F16 && reference->type != GGML_TYPE_BF16))) {
+        GGML_LOG_WARN("%s: the reference must be a contiguous F32, F16 or BF16 host tensor\n", __func__);
+        return -1;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(membrane, &list) != 0) {
+        return -1;
+    }
+    
+    struct ggml_p9ml_qat_pass * pass = ggml_p9ml_qat_pass_new(GGML_P9ML_PASS_TILED_QAT, membrane, 0, 0.0f, false);
+    if (!pass) {
+        ggml_p9ml_work_list_free(&list);
+        return -1;
+    }
+    pass->reference = reference;
+    
+    const int64_t tile_elements = config->tile_size > 0 ? config->tile_size : P9ML_QAT_CHUNK_ELEMENTS;
+    
+    int result = 0;
+    
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        
+        for (int i = 0; i < cur->num_objects && result == 0; i++) {
+            const struct ggml_tensor * tensor = cur->objects[i];
+            
+            cur->object_errors[i] = -1.0f;
+            cur->tile_maps[i].n_x = 0;
+            cur->tile_maps[i].n_y = 0;
+            
+            // the reference only stands for the objects of its shape, the others are skipped
+            if (!ggml_p9ml_object_is_pass_quantizable(cur, i, config->target_type) ||
+                (reference && !ggml_are_same_shape(tensor, reference))) {
+                continue;
+            }
+            
+            if (ggml_quantize_requires_imatrix(config->target_type) && !ggml_p9ml_object_imatrix(cur, i)) {
+                GGML_LOG_WARN("%s: type %s needs an importance matrix, object '%s' is not calibrated\n", __func__,
+                              ggml_type_name(config->target_type), tensor->name);
+                result = -1;
+                break;
+            }
+            
+            if (ggml_p9ml_tile_map_init(cur, i, config->target_type, tile_elements) != 0 ||
+                ggml_p9ml_qat_pass_add(pass, cur, i, config->target_type, &cur->tile_maps[i]) < 0) {
+                result = -1;
+            }
+        }
+    }
+    
+    double * sq_err = malloc((pass->n_groups + 1) * sizeof(double));
+    if (!sq_err) {
+        result = -1;
+    }
+    
+    if (result == 0 && reference && pass->n_groups == 0) {
+        GGML_LOG_WARN("%s: no object has the shape of the reference\n", __func__);
+        result = -1;
+    }
+    
+    if (result == 0) {
+        result = ggml_p9ml_qat_pass_run(pass, membrane->ns, sq_err, NULL);
+    }
+    
+    for (int g = 0; g < pass->n_groups && result == 0; g++) {
+        struct ggml_p9ml_membrane * cur = pass->groups[g].membrane;
+        const int slot = pass->groups[g].slot;
+        cur->object_errors[slot] = (float) sqrt(sq_err[g] / (double) ggml_nelements(cur->objects[slot]));
+    }
+    
+    free(sq_err);
+    ggml_p9ml_qat_pass_free(pass);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+// Candidate types of the mixed-precision search
+static const enum ggml_type ggml_p9ml_mixed_precision_types[] = {
+    GGML_TYPE_Q2_K,
+    GGML_TYPE_Q3_K,
+    GGML_TYPE_Q4_0,
+    GGML_TYPE_Q4_K,
+    GGML_TYPE_Q5_0,
+    GGML_TYPE_Q5_K,
+    GGML_TYPE_Q6_K,
+    GGML_TYPE_Q8_0,
+    GGML_TYPE_F16,
+};
+
+#define P9ML_MIXED_PRECISION_MAX_CANDIDATES (1 + (int) (sizeof(ggml_p9ml_mixed_precision_types)/sizeof(ggml_p9ml_mixed_precision_types[0])))
+
+static_assert(P9ML_MIXED_PRECISION_MAX_CANDIDATES == GGML_P9ML_MP_TYPES + 1, "GGML_P9ML_MP_TYPES != number of candidate types");
+
+// A (type, size, error) option of one object
+struct ggml_p9ml_mp_candidate {
+    enum ggml_type type;
+    int group;                              // index of the candidate type (-1 for the original type)
+    size_t nbytes;
+    double sq_err;
+};
+
+struct ggml_p9ml_mp_object {
+    struct ggml_p9ml_membrane * membrane;
+    int slot;
+    double sq_src;                          // sum of squares of the object
+    struct ggml_p9ml_mp_candidate hull[P9ML_MIXED_PRECISION_MAX_CANDIDATES]; // by increasing size
+    int n_hull;
+    int pos;                                // selected hull point
+    bool blocked;                           // a downgrade of this object did not fit in the budget
+};
+
+// Downgrade of one object from hull point pos + 1 to pos
+struct ggml_p9ml_mp_step {
+    int object;
+    int pos;
+    double cost;                            // error added per byte saved
+};
+
+static int ggml_p9ml_mp_step_cmp(const void * a, const void * b) {
+    const struct ggml_p9ml_mp_step * sa = (const struct ggml_p9ml_mp_step *) a;
+    const struct ggml_p9ml_mp_step * sb = (const struct ggml_p9ml_mp_step *) b;
+    if (sa->cost != sb->cost) {
+        return sa->cost < sb->cost ? -1 : 1;
+    }
+    if (sa->object != sb->object) {
+        return sa->object - sb->object;
+    }
+    return sb->pos - sa->pos;
+}
+
+// Lower convex hull of the candidates in the (size, error) plane, by increasing size
+// The error of the points is strictly decreasing and the error added per byte saved increases
+// as the size decreases, so the greedy below solves the LP relaxation of the multiple-choice knapsack
+static int ggml_p9ml_mp_hull(struct ggml_p9ml_mp_candidate * cand, int n, struct ggml_p9ml_mp_candidate * hull) {
+    // insertion sort by size, then error
+    for (int i = 1; i < n; i++) {
+        struct ggml_p9ml_mp_candidate c = cand[i];
+        int j = i - 1;
+        while (j >= 0 && (cand[j].nbytes > c.nbytes || (cand[j].nbytes == c.nbytes && cand[j].sq_err > c.sq_err))) {
+            cand[j + 1] = cand[j];
+            j--;
+        }
+        cand[j + 1] = c;
+    }
+    
+    int n_hull = 0;
+    for (int i = 0; i < n; i++) {
+        const struct ggml_p9ml_mp_candidate * c = &cand[i];
+        
+        // dominated: not smaller than a point with less or equal error
+        if (n_hull > 0 && c->sq_err >= hull[n_hull - 1].sq_err) {
+            continue;
+        }
+        
+        // not convex: the previous point lies on or above the segment to the new point
+        while (n_hull > 1) {
+            const struct ggml_p9ml_mp_candidate * a = &hull[n_hull - 2];
+            const struct ggml_p9ml_mp_candidate * b = &hull[n_hull - 1];
+            const double cross = ((double) b->nbytes - (double) a->nbytes) * (c->sq_err - a->sq_err) -
+                                 (b->sq_err - a->sq_err) * ((double) c->nbytes - (double) a->nbytes);
+            if (cross > 0.0) {
+                break;
+            }
+            n_hull--;
+        }
+        
+        hull[n_hull++] = *c;
+    }
+    
+    return n_hull;
+}
+
+int ggml_p9ml_mixed_precision_quantize(
+    struct ggml_p9ml_membrane * membrane,
+    float quality_threshold) {
+    
+    if (!membrane) {
+        return -1;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(membrane, &list) != 0) {
+        return -1;
+    }
+    
+    int n_objects = 0;
+    for (int m = 0; m < list.n_membranes; m++) {
+        n_objects += list.membranes[m]->num_objects;
+    }
+    
+    const int n_types = P9ML_MIXED_PRECISION_MAX_CANDIDATES - 1;
+    
+    struct ggml_p9ml_qat_pass * pass = ggml_p9ml_qat_pass_new(GGML_P9ML_PASS_MIXED_PRECISION, membrane, 0, 0.0f, false);
+    struct ggml_p9ml_mp_object * objects = calloc(n_objects + 1, sizeof(struct ggml_p9ml_mp_object));
+    struct ggml_p9ml_mp_step * steps = malloc((n_objects * n_types + 1) * sizeof(struct ggml_p9ml_mp_step));
+    int * groups = malloc((n_objects * n_types + 1) * sizeof(int));
+    
+    int result = pass && objects && steps && groups ? 0 : -1;
+    
+    // Measure the error of every candidate type on every modified quantizable object, in parallel
+    int n = 0;
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        for (int i = 0; i < cur->num_objects && result == 0; i++) {
+            struct ggml_p9ml_mp_object * obj = &objects[n];
+            obj->membrane = cur;
+            obj->slot = i;
+            const bool cached = cur->object_states[i].mp_version == cur->object_states[i].version;
+            for (int t = 0; t < n_types; t++) {
+                const enum ggml_type type = ggml_p9ml_mixed_precision_types[t];
+                groups[n*n_types + t] = -1;
+                if (!cached && type != cur->objects[i]->type && ggml_p9ml_object_is_pass_quantizable(cur, i, type)) {
+                    groups[n*n_types + t] = ggml_p9ml_qat_pass_add(pass, cur, i, type, NULL);
+                    if (groups[n*n_types + t] < 0) {
+                        result = -1;
+                    }
+                }
+            }
+            n++;
+        }
+    }
+    
+    double * sq_err = result == 0 ? malloc((pass->n_groups + 1) * sizeof(double)) : NULL;
+    double * sq_src = result == 0 ? malloc((pass->n_groups + 1) * sizeof(double)) : NULL;
+    if (result == 0 && (!sq_err || !sq_src)) {
+        result = -1;
+    }
+    
+    if (result == 0) {
+        result = ggml_p9ml_qat_pass_run(pass, membrane->ns, sq_err, sq_src);
+    }
+    
+    // Cache the measured errors
+    for (int o = 0; o < n_objects && result == 0; o++) {
+        struct ggml_p9ml_object_state * state = &objects[o].membrane->object_states[objects[o].slot];
+        if (state->mp_version == state->version) {
+            continue;
+        }
+        state->mp_version = state->version;
+        state->mp_sq_src = 0.0;
+        for (int t = 0; t < n_types; t++) {
+            const int g = groups[o*n_types + t];
+            state->mp_sq_err[t] = g < 0 ? -1.0 : sq_err[g];
+            if (g >= 0) {
+                state->mp_sq_src = sq_src[g];
+            }
+        }
+    }
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        list.membranes[m]->dirty &= ~GGML_P9ML_DIRTY_MIXED;
+    }
+    
+    // Size/error frontier of each object, starting from the original type (no error)
+    double total_src = 0.0;
+    double total_err = 0.0;
+    int n_steps = 0;
+    
+    for (int o = 0; o < n_objects && result == 0; o++) {
+        struct ggml_p9ml_mp_object * obj = &objects[o];
+        const struct ggml_tensor * tensor = obj->membrane->objects[obj->slot];
+        
+        struct ggml_p9ml_mp_candidate cand[P9ML_MIXED_PRECISION_MAX_CANDIDATES];
+        int n_cand = 0;
+        
+        cand[n_cand].type   = tensor->type;
+        cand[n_cand].group  = -1;
+        cand[n_cand].nbytes = ggml_nbytes(tensor);
+        cand[n_cand].sq_err = 0.0;
+        n_cand++;
+        
+        const struct ggml_p9ml_object_state * state = &obj->membrane->object_states[obj->slot];
+        obj->sq_src = state->mp_sq_src;
+        for (int t = 0; t < n_types; t++) {
+            if (state->mp_sq_err[t] < 0.0) {
+                continue;
+            }
+            
+            cand[n_cand].type   = ggml_p9ml_mixed_precision_types[t];
+            cand[n_cand].group  = t;
+            cand[n_cand].nbytes = ggml_row_size(cand[n_cand].type, tensor->ne[0]) * ggml_nrows(tensor);
+            cand[n_cand].sq_err = state->mp_sq_err[t];
+            n_cand++;
+        }
+        
+        obj->n_hull = ggml_p9ml_mp_hull(cand, n_cand, obj->hull);
+        obj->pos = obj->n_hull - 1;
+        
+        total_src += obj->sq_src;
+        total_err += obj->hull[obj->pos].sq_err;
+        
+        for (int h = obj->n_hull - 2; h >= 0; h--) {
+            struct ggml_p9ml_mp_step * step = &steps[n_steps++];
+            step->object = o;
+            step->pos = h;
+            step->cost = (obj->hull[h].sq_err - obj->hull[h + 1].sq_err) /
+                         (double) (obj->hull[h + 1].nbytes - obj->hull[h].nbytes);
+        }
+    }
+    
+    // Greedy knapsack: apply the cheapest downgrades (error added per byte saved) while the error fits
+    if (result == 0) {
+        const double budget = (double) quality_threshold * total_src;
+        
+        qsort(steps, n_steps, sizeof(struct ggml_p9ml_mp_step), ggml_p9ml_mp_step_cmp);
+        
+        for (int s = 0; s < n_steps; s++) {
+            struct ggml_p9ml_mp_object * obj = &objects[steps[s].object];
+            if (obj->blocked || obj->pos != steps[s].pos + 1) {
+                continue;
+            }
+            
+            const double added = obj->hull[steps[s].pos].sq_err - obj->hull[obj->pos].sq_err;
+            if (total_err + added > budget) {
+                obj->blocked = true;
+                continue;
+            }
+            
+            total_err += added;
+            obj->pos = steps[s].pos;
+        }
+    }
+    
+    // Write back the chosen types and the namespace metrics
+    if (result == 0) {
+        size_t total_params = 0;
+        size_t quantized_params = 0;
+        size_t original_size = 0;
+        size_t quantized_size = 0;
+        
+        for (int o = 0; o < n_objects; o++) {
+            struct ggml_p9ml_mp_object * obj = &objects[o];
+            const struct ggml_tensor * tensor = obj->membrane->objects[obj->slot];
+            const struct ggml_p9ml_mp_candidate * choice = &obj->hull[obj->pos];
+            
+            obj->membrane->object_types[obj->slot] = choice->type;
+            obj->membrane->object_errors[obj->slot] = choice->group < 0 ? -1.0f :
+                (float) sqrt(choice->sq_err / (double) ggml_nelements(tensor));
+            
+            total_params += ggml_nelements(tensor);
+            original_size += ggml_nbytes(tensor);
+            quantized_size += choice->nbytes;
+            if (choice->type != tensor->type) {
+                quantized_params += ggml_nelements(tensor);
+            }
+        }
+        
+        if (membrane->ns) {
+            struct ggml_p9ml_namespace * ns = membrane->ns;
+            ns->mixed_precision = true;
+            ns->total_params = total_params;
+            ns->quantized_params = quantized_params;
+            ns->compression_ratio = quantized_size > 0 ? (float) ((double) original_size / (double) quantized_size) : 1.0f;
+        }
+    }
+    
+    free(sq_err);
+    free(sq_src);
+    free(groups);
+    free(steps);
+    free(objects);
+    ggml_p9ml_qat_pass_free(pass);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+//
+// Counter-based noise generator
+//
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"):
+//   key     = seed
+//   counter = (block, id), where block = element / 4
+// Each counter yields 4 random words, one per element of the block.
+// The rounds are vectorized over consecutive blocks (AVX-512 and AVX2 are detected at run time); the
+// conversion to floats is shared by all paths so that the result is bit-identical regardless of the
+// instruction set and of the chunking.
+//
+
+#define P9ML_PHILOX_M0 0xD2511F53u
+#define P9ML_PHILOX_M1 0xCD9E8D57u
+#define P9ML_PHILOX_W0 0x9E3779B9u
+#define P9ML_PHILOX_W1 0xBB67AE85u
+#define P9ML_PHILOX_ROUNDS 10
+#define P9ML_NOISE_BATCH 64 // blocks generated per batch
+
+static inline void ggml_p9ml_philox_block(uint32_t * out, uint64_t block, uint64_t id, uint64_t seed) {
+    uint32_t c0 = (uint32_t) block;
+    uint32_t c1 = (uint32_t) (block >> 32);
+    uint32_t c2 = (uint32_t) id;
+    uint32_t c3 = (uint32_t) (id >> 32);
+    uint32_t k0 = (uint32_t) seed;
+    uint32_t k1 = (uint32_t) (seed >> 32);
+
+    for (int r = 0; r < P9ML_PHILOX_ROUNDS; r++) {
+        const uint64_t p0 = (uint64_t) P9ML_PHILOX_M0 * c0;
+        const uint64_t p1 = (uint64_t) P9ML_PHILOX_M1 * c2;
+        const uint32_t t0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        const uint32_t t2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t) p1;
+        c3 = (uint32_t) p0;
+        c0 = t0;
+        c2 = t2;
+        k0 += P9ML_PHILOX_W0;
+        k1 += P9ML_PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+#if defined(P9ML_X86_DISPATCH)
+P9ML_TARGET("avx512f") static inline void ggml_p9ml_philox_mulhilo_avx512(__m512i a, uint32_t m, __m512i * hi, __m512i * lo) {
+    const __m512i vm     = _mm512_set1_epi32((int) m);
+    const __m512i p_even = _mm512_mul_epu32(a, vm);
+    const __m512i p_odd  = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), vm);
+    *lo = _mm512_mullo_epi32(a, vm);
+    *hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(p_even, 32), p_odd);
+}
+
+// 16 consecutive blocks, the low word of the block index must not wrap
+P9ML_TARGET("avx512f") static void ggml_p9ml_philox_blocks_x16(uint32_t * out, uint64_t block, uint64_t id, uint64_t seed) {
+    __m512i c0 = _mm512_add_epi32(_mm512_set1_epi32((int) (uint32_t) block),
+                                  _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    __m512i c1 = _mm512_set1_epi32((int) (uint32_t) (block >> 32));
+    __m512i c2 = _mm512_set1_epi32((int) (uint32_t) id);
+    __m512i c3 = _mm512_set1_epi32((int) (uint32_t) (id >> 32));
+    uint32_t k0 = (uint32_t) seed;
+    uint32_t k1 = (uint32_t) (seed >> 32);
+
+    for (int r = 0; r < P9ML_PHILOX_ROUNDS; r++) {
+        __m512i hi0, lo0, hi1, lo1;
+        ggml_p9ml_philox_mulhilo_avx512(c0, P9ML_PHILOX_M0, &hi0, &lo0);
+        ggml_p9ml_philox_mulhilo_avx512(c2, P9ML_PHILOX_M1, &hi1, &lo1);
+        c0 = _mm512_xor_si512(_mm512_xor_si512(hi1, c1), _mm512_set1_epi32((int) k0));
+        c2 = _mm512_xor_si512(_mm512_xor_si512(hi0, c3), _mm512_set1_epi32((int) k1));
+        c1 = lo1;
+        c3 = lo0;
+        k0 += P9ML_PHILOX_W0;
+        k1 += P9ML_PHILOX_W1;
+    }
+
+    uint32_t lanes[4][16];
+    _mm512_storeu_si512((void *) lanes[0], c0);
+    _mm512_storeu_si512((void *) lanes[1], c1);
+    _mm512_storeu_si512((void *) lanes[2], c2);
+    _mm512_storeu_si512((void *) lanes[3], c3);
+    for (int b = 0; b < 16; b++) {
+        for (int j = 0; j < 4; j++) {
+            out[4*b + j] = lanes[j][b];
+        }
+    }
+}
+
+P9ML_TARGET("avx2") static inline void ggml_p9ml_philox_mulhilo_avx2(__m256i a, uint32_t m, __m256i * hi, __m256i * lo) {
+    const __m256i vm     = _mm256_set1_epi32((int) m);
+    const __m256i p_even = _mm256_mul_epu32(a, vm);
+    const __m256i p_odd  = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), vm);
+    *lo = _mm256_mullo_epi32(a, vm);
+    *hi = _mm256_blend_epi32(_mm256_srli_epi64(p_even, 32), p_odd, 0xAA);
+}
+
+// 8 consecutive blocks, the low word of the block index must not wrap
+P9ML_TARGET("avx2") static void ggml_p9ml_philox_blocks_x8(uint32_t * out, uint64_t block, uint64_t id, uint64_t seed) {
+    __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((int) (uint32_t) block), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i c1 = _mm256_set1_epi32((int) (uint32_t) (block >> 32));
+    __m256i c2 = _mm256_set1_epi32((int) (uint32_t) id);
+    __m256i c3 = _mm256_set1_epi32((int) (uint32_t) (id >> 32));
+    uint32_t k0 = (uint32_t) seed;
+    uint32_t k1 = (uint32_t) (seed >> 32);
+
+    for (int r = 0; r < P9ML_PHILOX_ROUNDS; r++) {
+        __m256i hi0, lo0, hi1, lo1;
+        ggml_p9ml_philox_mulhilo_avx2(c0, P9ML_PHILOX_M0, &hi0, &lo0);
+        ggml_p9ml_philox_mulhilo_avx2(c2, P9ML_PHILOX_M1, &hi1, &lo1);
+        c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int) k0));
+        c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int) k1));
+        c1 = lo1;
+        c3 = lo0;
+        k0 += P9ML_PHILOX_W0;
+        k1 += P9ML_PHILOX_W1;
+    }
+
+    // transpose (word, block) -> (block, word)
+    const __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+    const __m256i t1 = _mm256_unpackhi_epi32(c0, c1);
+    const __m256i t2 = _mm256_unpacklo_epi32(c2, c3);
+    const __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+    const __m256i b04 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i b15 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i b26 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i b37 = _mm256_unpackhi_epi64(t1, t3);
+    _mm256_storeu_si256((__m256i *) (out +  0), _mm256_permute2x128_si256(b04, b15, 0x20));
+    _mm256_storeu_si256((__m256i *) (out +  8), _mm256_permute2x128_si256(b26, b37, 0x20));
+    _mm256_storeu_si256((__m256i *) (out + 16), _mm256_permute2x128_si256(b04, b15, 0x31));
+    _mm256_storeu_si256((__m256i *) (out + 24), _mm256_permute2x128_si256(b26, b37, 0x31));
+}
+#elif defined(__ARM_NEON)
+static inline void ggml_p9ml_philox_mulhilo_neon(uint32x4_t a, uint32_t m, uint32x4_t * hi, uint32x4_t * lo) {
+    const uint32x2_t vm   = vdup_n_u32(m);
+    const uint64x2_t p_lo = vmull_u32(vget_low_u32(a),  vm);
+    const uint64x2_t p_hi = vmull_u32(vget_high_u32(a), vm);
+    const uint32x4x2_t p  = vuzpq_u32(vreinterpretq_u32_u64(p_lo), vreinterpretq_u32_u64(p_hi));
+    *lo = p.val[0];
+    *hi = p.val[1];
+}
+
+// 4 consecutive blocks, the low word of the block index must not wrap
+static void ggml_p9ml_philox_blocks_x4(uint32_t * out, uint64_t block, uint64_t id, uint64_t seed) {
+    static const uint32_t iota[4] = { 0, 1, 2, 3 };
+    uint32x4_t c0 = vaddq_u32(vdupq_n_u32((uint32_t) block), vld1q_u32(iota));
+    uint32x4_t c1 = vdupq_n_u32((uint32_t) (block >> 32));
+    uint32x4_t c2 = vdupq_n_u32((uint32_t) id);
+    uint32x4_t c3 = vdupq_n_u32((uint32_t) (id >> 32));
+    uint32_t k0 = (uint32_t) seed;
+    uint32_t k1 = (uint32_t) (seed >> 32);
+
+    for (int r = 0; r < P9ML_PHILOX_ROUNDS; r++) {
+        uint32x4_t hi0, lo0, hi1, lo1;
+        ggml_p9ml_philox_mulhilo_neon(c0, P9ML_PHILOX_M0, &hi0, &lo0);
+        ggml_p9ml_philox_mulhilo_neon(c2, P9ML_PHILOX_M1, &hi1, &lo1);
+        c0 = veorq_u32(veorq_u32(hi1, c1), vdupq_n_u32(k0));
+        c2 = veorq_u32(veorq_u32(hi0, c3), vdupq_n_u32(k1));
+        c1 = lo1;
+        c3 = lo0;
+        k0 += P9ML_PHILOX_W0;
+        k1 += P9ML_PHILOX_W1;
+    }
+
+    uint32x4x4_t v = { { c0, c1, c2, c3 } };
+    vst4q_u32(out, v);
+}
+#endif
+
+// 4*n_blocks random words of the blocks [block, block + n_blocks)
+static void ggml_p9ml_philox_blocks(uint32_t * out, uint64_t block, int n_blocks, uint64_t id, uint64_t seed) {
+    int b = 0;
+#if defined(P9ML_X86_DISPATCH)
+    if (__builtin_cpu_supports("avx512f")) {
+        for (; b + 15 < n_blocks && (uint32_t) (block + b) <= UINT32_MAX - 15; b += 16) {
+            ggml_p9ml_philox_blocks_x16(out + 4*b, block + b, id, seed);
+        }
+    } else if (__builtin_cpu_supports("avx2")) {
+        for (; b + 7 < n_blocks && (uint32_t) (block + b) <= UINT32_MAX - 7; b += 8) {
+            ggml_p9ml_philox_blocks_x8(out + 4*b, block + b, id, seed);
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; b + 3 < n_blocks && (uint32_t) (block + b) <= UINT32_MAX - 3; b += 4) {
+        ggml_p9ml_philox_blocks_x4(out + 4*b, block + b, id, seed);
+    }
+#endif
+    for (; b < n_blocks; b++) {
+        ggml_p9ml_philox_block(out + 4*b, block + b, id, seed);
+    }
+}
+
+// [0, 1) with 24 bits of precision
+static inline float ggml_p9ml_u32_to_unit(uint32_t x) {
+    return (float) (x >> 8) * (1.0f / 16777216.0f);
+}
+
+static void ggml_p9ml_noise_generate(
+    float * dst,
+    int64_t n,
+    int64_t offset,
+    uint64_t seed,
+    uint64_t id,
+    enum ggml_p9ml_noise_type type,
+    float scale,
+    bool accumulate) {
+
+    uint32_t bits[4*P9ML_NOISE_BATCH];
+    float    vals[4*P9ML_NOISE_BATCH];
+
+    int64_t i = 0;
+    while (i < n) {
+        const int64_t e0    = offset + i;                 // first element of the batch
+        const int64_t block = e0 / 4;
+        const int64_t skip  = e0 - 4*block;               // elements of the first block before e0
+        const int64_t count = MIN(n - i, 4*P9ML_NOISE_BATCH - skip);
+        const int n_blocks  = (int) ((skip + count + 3) / 4);
+
+        ggml_p9ml_philox_blocks(bits, (uint64_t) block, n_blocks, id, seed);
+
+        if (type == GGML_P9ML_NOISE_UNIFORM) {
+            for (int j = 0; j < 4*n_blocks; j++) {
+                vals[j] = (2.0f*ggml_p9ml_u32_to_unit(bits[j]) - 1.0f) * scale;
+            }
+        } else {
+            // Box-Muller, one pair per half block
+            for (int j = 0; j < 4*n_blocks; j += 2) {
+                const float u1    = ggml_p9ml_u32_to_unit(bits[j]) + (1.0f / 16777216.0f); // (0, 1]
+                const float u2    = ggml_p9ml_u32_to_unit(bits[j + 1]);
+                const float r     = sqrtf(-2.0f * logf(u1)) * scale;
+                const float theta = 6.28318530717958647692f * u2;
+                vals[j]     = r * cosf(theta);
+                vals[j + 1] = r * sinf(theta);
+            }
+        }
+
+        if (accumulate) {
+            for (int64_t j = 0; j < count; j++) {
+                dst[i + j] += vals[skip + j];
+            }
+        } else {
+            memcpy(dst + i, vals + skip, count*sizeof(float));
+        }
+
+        i += count;
+    }
+}
+
+void ggml_p9ml_noise_fill(
+    float * dst,
+    int64_t n,
+    int64_t offset,
+    uint64_t seed,
+    uint64_t id,
+    enum ggml_p9ml_noise_type type,
+    float scale) {
+
+    if (!dst || n <= 0 || offset < 0) {
+        return;
+    }
+
+    ggml_p9ml_noise_generate(dst, n, offset, seed, id, type, scale, false);
+}
+
+//
+// Calibration
+//
+
+#define P9ML_CALIBRATION_SAMPLES 64 // synthetic activations per object
+
+// Objects whose activations can be computed with ggml_mul_mat and whose rows can be rescaled
+static bool ggml_p9ml_object_is_calibratable(const struct ggml_tensor * tensor) {
+    if (!tensor || !ggml_p9ml_object_is_host(tensor) || !ggml_is_contiguous(tensor) || !ggml_is_matrix(tensor)) {
+        return false;
+    }
+    return tensor->type == GGML_TYPE_F32 || tensor->type == GGML_TYPE_F16 || tensor->type == GGML_TYPE_BF16;
+}
+
+// Rows [ir0, ir1) of an object whose scales are searched
+struct ggml_p9ml_scale_chunk {
+    struct ggml_p9ml_membrane * membrane;
+    int slot;
+    int64_t ir0;
+    int64_t ir1;
+};
+
+struct ggml_p9ml_scale_search {
+    enum ggml_type type;
+    int n_steps;                            // candidate scales 1 + k*step, k = -n_steps..n_steps
+    float step;
+    struct ggml_p9ml_scale_chunk * chunks;
+    int n_chunks;
+    atomic_int failed;                      // set by the tasks that run out of memory
+};
+
+// Scales minimizing the importance-weighted quantization error, sum_j imatrix[j]*(w[j] - q(s*w)[j]/s)^2, of each
+// group of n/n_row_scales columns of each row. The blocks are quantized independently, so each candidate
+// quantizes the whole row once and every group keeps its best candidate.
+static void ggml_p9ml_scale_search_task(int task, int ith, void * userdata) {
+    GGML_UNUSED(ith);
+    
+    struct ggml_p9ml_scale_search * search = (struct ggml_p9ml_scale_search *) userdata;
+    const struct ggml_p9ml_scale_chunk * chunk = &search->chunks[task];
+    const struct ggml_tensor * tensor = chunk->membrane->objects[chunk->slot];
+    struct ggml_p9ml_calibration * cal = &chunk->membrane->calibrations[chunk->slot];
+    
+    const int64_t n  = tensor->ne[0];
+    const int64_t ns = cal->n_row_scales;
+    const int64_t gs = n/ns;                // columns per scale
+    double * best_err = malloc(ns*sizeof(double) + (3*n)*sizeof(float) + ggml_row_size(search->type, n));
+    if (!best_err) {
+        atomic_store(&search->failed, 1);
+        return;
+    }
+    float * src    = (float *) (best_err + ns);
+    float * scaled = src + n;
+    float * deq    = scaled + n;
+    void  * q      = deq + n;
+    
+    for (int64_t ir = chunk->ir0; ir < chunk->ir1; ir++) {
+        ggml_p9ml_tile_to_float(tensor, ir, ir + 1, 0, n, src);
+        
+        float * best_scale = cal->scales + ir*ns;
+        for (int64_t g = 0; g < ns; g++) {
+            best_scale[g] = 1.0f;
+            best_err[g]   = INFINITY;
+        }
+        for (int k = -search->n_steps; k <= search->n_steps; k++) {
+            const float s = 1.0f + (float) k*search->step;
+            if (s <= 0.0f) {
+                continue;
+            }
+            for (int64_t j = 0; j < n; j++) {
+                scaled[j] = s*src[j];
+            }
+            ggml_quantize_chunk(search->type, scaled, q, 0, 1, n, cal->imatrix);
+            ggml_get_type_traits(search->type)->to_float(q, deq, n);
+            
+            for (int64_t g = 0; g < ns; g++) {
+                double err = 0.0;
+                for (int64_t j = g*gs; j < (g + 1)*gs; j++) {
+                    const float d = src[j] - deq[j]/s;
+                    err += (double) (cal->imatrix[j]*d*d);
+                }
+                if (err < best_err[g]) {
+                    best_err[g]   = err;
+                    best_scale[g] = s;
+                }
+            }
+        }
+    }
+    
+    free(best_err);
+}
+
+// Table of n floats of a calibration, reused when large enough
+static float * ggml_p9ml_calibration_table(struct ggml_p9ml_membrane * membrane, float * table, int64_t n_old, int64_t n) {
+    if (table && n_old >= n) {
+        return table;
+    }
+    float * data = ggml_p9ml_membrane_alloc(membrane, n*sizeof(float));
+    if (data && !membrane->arena) {
+        free(table);
+    }
+    return data;
+}
+
+// Importance matrix of the objects of one membrane: synthetic activations flow through the objects in order,
+// an object whose rows match the outputs of the previous one gets them (RMS-normalized) as its input
+static int ggml_p9ml_calibrate_membrane(struct ggml_p9ml_namespace * ns, ggml_backend_t backend, struct ggml_p9ml_membrane * membrane) {
+    const size_t graph_size = GGML_DEFAULT_GRAPH_SIZE + 8*(size_t) membrane->num_objects;
+    
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ ggml_tensor_overhead()*graph_size + ggml_graph_overhead_custom(graph_size, false),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    struct ggml_tensor ** inputs = malloc((membrane->num_objects + 1)*sizeof(struct ggml_tensor *));
+    struct ggml_tensor ** sums   = malloc((membrane->num_objects + 1)*sizeof(struct ggml_tensor *));
+    if (!ctx || !inputs || !sums) {
+        ggml_free(ctx);
+        free(inputs);
+        free(sums);
+        return -1;
+    }
+    
+    struct ggml_cgraph * gf = ggml_new_graph_custom(ctx, graph_size, false);
+    struct ggml_tensor * prev = NULL;
+    
+    int n_calibrated = 0;
+    for (int i = 0; i < membrane->num_objects; i++) {
+        struct ggml_tensor * object = membrane->objects[i];
+        inputs[i] = NULL;
+        sums[i]   = NULL;
+        if (!ggml_p9ml_object_is_calibratable(object)) {
+            continue;
+        }
+        
+        struct ggml_tensor * x = NULL;
+        if (prev && prev->ne[0] == object->ne[0]) {
+            x = ggml_rms_norm(ctx, prev, 1e-6f);
+        } else {
+            x = inputs[i] = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, object->ne[0], P9ML_CALIBRATION_SAMPLES);
+            ggml_set_input(x);
+        }
+        
+        // mean square of each input column over the samples
+        sums[i] = ggml_sum_rows(ctx, ggml_cont(ctx, ggml_transpose(ctx, ggml_sqr(ctx, x))));
+        ggml_set_output(sums[i]);
+        ggml_build_forward_expand(gf, sums[i]);
+        
+        prev = ggml_mul_mat(ctx, object, x);
+        n_calibrated++;
+    }
+    // the last outputs only matter if they are consumed
+    
+    int result = 0;
+    
+    if (n_calibrated > 0) {
+        if (!ns->galloc) {
+            ns->galloc = ggml_gallocr_new(ggml_backend_get_default_buffer_type(backend));
+        }
+        if (!ns->galloc || !ggml_gallocr_alloc_graph(ns->galloc, gf)) {
+            result = -1;
+        }
+    }
+    
+    for (int i = 0; i < membrane->num_objects && result == 0 && n_calibrated > 0; i++) {
+        if (!inputs[i]) {
+            continue;
+        }
+        const int64_t n = ggml_nelements(inputs[i]);
+        float * data = malloc(n*sizeof(float));
+        if (!data) {
+            result = -1;
+            break;
+        }
+        ggml_p9ml_noise_fill(data, n, 0, ns->seed, ggml_p9ml_object_id(membrane, i), GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+        ggml_backend_tensor_set(inputs[i], data, 0, n*sizeof(float));
+        free(data);
+    }
+    
+    if (result == 0 && n_calibrated > 0 && ggml_backend_graph_compute(backend, gf) != GGML_STATUS_SUCCESS) {
+        result = -1;
+    }
+    
+    for (int i = 0; i < membrane->num_objects && result == 0; i++) {
+        if (!sums[i]) {
+            continue;
+        }
+        struct ggml_p9ml_calibration * cal = &membrane->calibrations[i];
+        const int64_t n_cols = membrane->objects[i]->ne[0];
+        
+        float * imatrix = ggml_p9ml_calibration_table(membrane, cal->imatrix, cal->n_cols, n_cols);
+        if (!imatrix) {
+            result = -1;
+            break;
+        }
+        cal->imatrix = imatrix;
+        cal->n_cols  = n_cols;
+        
+        ggml_backend_tensor_get(sums[i], cal->imatrix, 0, n_cols*sizeof(float));
+        for (int64_t j = 0; j < n_cols; j++) {
+            cal->imatrix[j] /= (float) P9ML_CALIBRATION_SAMPLES;
+        }
+    }
+    
+    free(sums);
+    free(inputs);
+    ggml_free(ctx);
+    
+    return result;
+}
+
+int ggml_p9ml_calibrate(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_qat_config * config) {
+    
+    if (!membrane || !config) {
+        return -1;
+    }
+    
+    struct ggml_p9ml_namespace * ns = membrane->ns;
+    ggml_backend_t backend = ggml_p9ml_cpu_backend(ns);
+    if (!backend) {
+        GGML_LOG_WARN("%s: calibration needs a namespace with a CPU backend\n", __func__);
+        return -1;
+    }
+    
+    const bool search_scales = config->per_channel && config->scale_steps > 0 && config->scale_range > 0.0f;
+    if (search_scales && !ggml_p9ml_can_fake_quantize(config->target_type)) {
+        GGML_LOG_WARN("%s: cannot fake-quantize to type %s\n", __func__, ggml_type_name(config->target_type));
+        return -1;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(membrane, &list) != 0) {
+        return -1;
+    }
+    
+    int result = 0;
+    
+    const uint64_t run = ggml_p9ml_stats_begin(ns);
+    const int64_t t_start = run ? ggml_time_us() : 0;
+    
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        const int64_t t_membrane = run ? ggml_time_us() : 0;
+        result = ggml_p9ml_calibrate_membrane(ns, backend, list.membranes[m]);
+        ggml_p9ml_stats_add_membrane(ns, run, GGML_P9ML_PASS_CALIBRATE, list.membranes[m], t_membrane);
+    }
+    
+    // Scales, in parallel over chunks of rows
+    struct ggml_p9ml_scale_search search = { config->target_type, config->scale_steps, config->scale_range/(float) config->scale_steps, NULL, 0, 0 };
+    
+    // the blocks of the quantized types carry their own scale, the search scale folds into it
+    const bool per_block = ggml_is_quantized(config->target_type) && ggml_blck_size(config->target_type) > 1;
+    int max_chunks = 0;
+    
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        for (int i = 0; i < cur->num_objects && result == 0; i++) {
+            struct ggml_p9ml_calibration * cal = &cur->calibrations[i];
+            const struct ggml_tensor * tensor = cur->objects[i];
+            
+            if (!search_scales || !cal->imatrix || !ggml_p9ml_object_is_calibratable(tensor) ||
+                !ggml_p9ml_object_is_quantizable(tensor, config->target_type)) {
+                cal->n_rows = 0; // no scales
+                continue;
+            }
+            
+            const int64_t nr = ggml_nrows(tensor);
+            const int64_t n_row_scales = per_block ? tensor->ne[0]/ggml_blck_size(config->target_type) : 1;
+            float * scales = ggml_p9ml_calibration_table(cur, cal->scales, cal->n_rows*cal->n_row_scales, nr*n_row_scales);
+            if (!scales) {
+                result = -1;
+                break;
+            }
+            cal->scales = scales;
+            cal->n_rows = nr;
+            cal->n_row_scales = n_row_scales;
+            
+            const int64_t rows_per_chunk = MAX(1, P9ML_QAT_CHUNK_ELEMENTS/tensor->ne[0]);
+            for (int64_t ir0 = 0; ir0 < nr; ir0 += rows_per_chunk) {
+                if (search.n_chunks == max_chunks) {
+                    max_chunks = max_chunks > 0 ? 2*max_chunks : 64;
+                    struct ggml_p9ml_scale_chunk * chunks = realloc(search.chunks, max_chunks*sizeof(struct ggml_p9ml_scale_chunk));
+                    if (!chunks) {
+                        result = -1;
+                        break;
+                    }
+                    search.chunks = chunks;
+                }
+                struct ggml_p9ml_scale_chunk * chunk = &search.chunks[search.n_chunks++];
+                chunk->membrane = cur;
+                chunk->slot = i;
+                chunk->ir0 = ir0;
+                chunk->ir1 = MIN(nr, ir0 + rows_per_chunk);
+            }
+        }
+    }
+    
+    if (result == 0 && search.n_chunks > 0) {
+        const int phase_offsets[2] = { 0, search.n_chunks };
+        if (ggml_p9ml_run_tasks(ns, phase_offsets, 1, NULL, ggml_p9ml_scale_search_task, &search) != 0 || search.failed) {
+            result = -1;
+        }
+    }
+    
+    // The results of the previous passes do not account for the calibration
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        for (int i = 0; i < cur->num_objects; i++) {
+            cur->object_states[i].qat_version = 0;
+            cur->object_states[i].mp_version  = 0;
+        }
+        ggml_p9ml_membrane_mark_dirty(cur, GGML_P9ML_DIRTY_ALL);
+    }
+    
+    ggml_p9ml_stats_add_total(ns, run, GGML_P9ML_PASS_CALIBRATE, membrane, t_start);
+    
+    free(search.chunks);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+//
+// Straight-through-estimator QAT
+//
+
+#define P9ML_QAT_TRAIN_BATCH   32 // synthetic samples per optimizer step
+#define P9ML_QAT_TRAIN_OBJECTS 32 // objects trained together, bounded by the ggml-opt graph size
+
+// Object trained as an FP32 latent copy, seen through ggml_fake_quant_ext in the forward pass
+// (whose gradient reaches the latent weights unchanged)
+struct ggml_p9ml_ste_object {
+    int slot;
+    struct ggml_tensor * latent;            // trained weights
+    struct ggml_tensor * reference;         // FP weights before training (distillation teacher)
+    struct ggml_tensor * scales;            // calibrated scales (NULL if none)
+    struct ggml_tensor * imatrix;           // calibrated importance matrix (NULL if none)
+};
+
+// An object takes the RMS-normalized teacher outputs of the previous object as its inputs when their shapes
+// chain (as in ggml_p9ml_calibrate), synthetic inputs otherwise
+static bool ggml_p9ml_ste_chained(const struct ggml_p9ml_membrane * membrane, const struct ggml_p9ml_ste_object * objects, int k) {
+    return k > 0 && objects[k - 1].slot == objects[k].slot - 1 &&
+           membrane->objects[objects[k - 1].slot]->ne[1] == membrane->objects[objects[k].slot]->ne[0];
+}
+
+// Static tensors of the trained objects, the stacked synthetic inputs and the forward graph of the loss
+static struct ggml_tensor * ggml_p9ml_ste_build(
+    struct ggml_context * ctx_static,
+    struct ggml_context * ctx_compute,
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_ste_object * objects,
+    int n_objects,
+    enum ggml_type type,
+    struct ggml_tensor ** loss) {
+    
+    int64_t n_inputs = 0;
+    for (int k = 0; k < n_objects; k++) {
+        const struct ggml_tensor * object = membrane->objects[objects[k].slot];
+        int64_t n_row_scales = 0;
+        const bool has_scales = ggml_p9ml_object_scales(membrane, objects[k].slot, type, &n_row_scales) != NULL;
+        objects[k].latent    = ggml_new_tensor_2d(ctx_static, GGML_TYPE_F32, object->ne[0], object->ne[1]);
+        objects[k].reference = ggml_new_tensor_2d(ctx_static, GGML_TYPE_F32, object->ne[0], object->ne[1]);
+        objects[k].scales    = has_scales ? ggml_new_tensor_2d(ctx_static, GGML_TYPE_F32, n_row_scales, object->ne[1]) : NULL;
+        objects[k].imatrix   = ggml_p9ml_object_imatrix(membrane, objects[k].slot) ? ggml_new_tensor_1d(ctx_static, GGML_TYPE_F32, object->ne[0]) : NULL;
+        ggml_set_param(objects[k].latent);
+        if (!ggml_p9ml_ste_chained(membrane, objects, k)) {
+            n_inputs += object->ne[0];
+        }
+    }
+    struct ggml_tensor * inputs = ggml_new_tensor_2d(ctx_static, GGML_TYPE_F32, n_inputs, P9ML_QAT_TRAIN_BATCH);
+    ggml_set_input(inputs);
+    
+    *loss = NULL;
+    struct ggml_tensor * teacher = NULL;
+    int64_t offset = 0;
+    for (int k = 0; k < n_objects; k++) {
+        const struct ggml_p9ml_ste_object * cur = &objects[k];
+        const int64_t ncols = cur->latent->ne[0];
+        
+        struct ggml_tensor * x = NULL;
+        if (ggml_p9ml_ste_chained(membrane, objects, k)) {
+            x = ggml_rms_norm(ctx_compute, teacher, 1e-6f);
+        } else {
+            x = ggml_view_2d(ctx_compute, inputs, ncols, P9ML_QAT_TRAIN_BATCH, inputs->nb[1], offset*sizeof(float));
+            if (cur->imatrix) {
+                x = ggml_mul(ctx_compute, x, ggml_sqrt(ctx_compute, cur->imatrix));
+            }
+            offset += ncols;
+        }
+        
+        struct ggml_tensor * student = ggml_mul_mat(ctx_compute, ggml_fake_quant_ext(ctx_compute, cur->latent, cur->scales, cur->imatrix, type), x);
+        teacher = ggml_mul_mat(ctx_compute, cur->reference, x);
+        
+        // mean square error of the outputs, per sample
+        struct ggml_tensor * err = ggml_sqr(ctx_compute, ggml_sub(ctx_compute, student, teacher));
+        err = ggml_scale(ctx_compute, ggml_sum_rows(ctx_compute, err), 1.0f/(float) cur->latent->ne[1]);
+        *loss = *loss ? ggml_add(ctx_compute, *loss, err) : err;
+    }
+    
+    return inputs;
+}
+
+// Load the latent and reference weights and the calibration from the objects
+static int ggml_p9ml_ste_load(struct ggml_p9ml_membrane * membrane, const struct ggml_p9ml_ste_object * objects, int n_objects) {
+    for (int k = 0; k < n_objects; k++) {
+        const struct ggml_p9ml_ste_object * cur = &objects[k];
+        const struct ggml_tensor * object = membrane->objects[cur->slot];
+        const struct ggml_p9ml_calibration * cal = &membrane->calibrations[cur->slot];
+        
+        float * data = malloc(ggml_nbytes(cur->latent));
+        if (!data) {
+            return -1;
+        }
+        ggml_p9ml_tile_to_float(object, 0, object->ne[1], 0, object->ne[0], data);
+        ggml_backend_tensor_set(cur->latent,    data, 0, ggml_nbytes(cur->latent));
+        ggml_backend_tensor_set(cur->reference, data, 0, ggml_nbytes(cur->reference));
+        free(data);
+        
+        if (cur->scales) {
+            ggml_backend_tensor_set(cur->scales, cal->scales, 0, ggml_nbytes(cur->scales));
+        }
+        if (cur->imatrix) {
+            ggml_backend_tensor_set(cur->imatrix, cal->imatrix, 0, ggml_nbytes(cur->imatrix));
+        }
+    }
+    return 0;
+}
+
+// Distill objects [0, n_objects) of a membrane into their fake-quantized version with ggml-opt (AdamW):
+// the loss is the sum over the objects of the mean square of q(latent)*x - reference*x
+static int ggml_p9ml_qat_train_objects(
+    struct ggml_p9ml_namespace * ns,
+    ggml_backend_t backend,
+    ggml_backend_sched_t sched,
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_ste_object * objects,
+    int n_objects,
+    const struct ggml_p9ml_qat_config * config) {
+    
+    struct ggml_init_params params_static = {
+        /*.mem_size   =*/ ggml_tensor_overhead()*(4*(size_t) n_objects + 1),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    struct ggml_init_params params_compute = {
+        /*.mem_size   =*/ ggml_tensor_overhead()*4*GGML_DEFAULT_GRAPH_SIZE + 3*ggml_graph_overhead_custom(GGML_DEFAULT_GRAPH_SIZE, true),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    struct ggml_context * ctx_static  = ggml_init(params_static);
+    struct ggml_context * ctx_compute = ggml_init(params_compute);
+    if (!ctx_static || !ctx_compute) {
+        ggml_free(ctx_compute);
+        ggml_free(ctx_static);
+        return -1;
+    }
+    
+    struct ggml_tensor * loss = NULL;
+    struct ggml_tensor * inputs = ggml_p9ml_ste_build(ctx_static, ctx_compute, membrane, objects, n_objects, config->target_type, &loss);
+    
+    const int64_t n_host = ggml_nelements(inputs);
+    float * host = malloc(n_host*sizeof(float));
+    ggml_backend_buffer_t buffer = ggml_backend_alloc_ctx_tensors(ctx_static, backend);
+    
+    int result = host && buffer ? ggml_p9ml_ste_load(membrane, objects, n_objects) : -1;
+    
+    ggml_opt_context_t opt_ctx = NULL;
+    struct ggml_opt_optimizer_params opt_pars = ggml_opt_get_default_optimizer_params(NULL);
+    opt_pars.adamw.alpha = config->learning_rate;
+    
+    if (result == 0) {
+        struct ggml_opt_params params = ggml_opt_default_params(sched, GGML_OPT_LOSS_TYPE_MEAN);
+        params.ctx_compute     = ctx_compute;
+        params.inputs          = inputs;
+        params.outputs         = loss;
+        params.get_opt_pars    = ggml_opt_get_constant_optimizer_params;
+        params.get_opt_pars_ud = &opt_pars;
+        opt_ctx = ggml_opt_init(params);
+    }
+    
+    for (int step = 0; step < config->num_steps && result == 0; step++) {
+        // fresh samples each step, from the noise stream of the first trained object
+        ggml_p9ml_noise_fill(host, n_host, step*n_host, ns->seed, ggml_p9ml_object_id(membrane, objects[0].slot), GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+        
+        ggml_opt_alloc(opt_ctx, /*backward =*/ true);
+        ggml_backend_tensor_set(inputs, host, 0, ggml_nbytes(inputs));
+        ggml_opt_eval(opt_ctx, NULL);
+    }
+    
+    // Trained weights back into the objects
+    for (int k = 0; k < n_objects && result == 0; k++) {
+        struct ggml_tensor * object = membrane->objects[objects[k].slot];
+        float * data = malloc(ggml_nbytes(objects[k].latent));
+        if (!data || ggml_p9ml_membrane_unshare(membrane, objects[k].slot) != 0) {
+            free(data);
+            result = -1;
+            break;
+        }
+        ggml_backend_tensor_get(objects[k].latent, data, 0, ggml_nbytes(objects[k].latent));
+        ggml_p9ml_tile_from_float(object, 0, object->ne[1], 0, object->ne[0], data);
+        ggml_p9ml_membrane_touch(membrane, objects[k].slot);
+        free(data);
+    }
+    
+    ggml_opt_free(opt_ctx);
+    ggml_backend_buffer_free(buffer);
+    free(host);
+    ggml_free(ctx_compute);
+    ggml_free(ctx_static);
+    
+    return result;
+}
+
+int ggml_p9ml_qat_train(
+    struct ggml_p9ml_membrane * membrane,
+    struct ggml_p9ml_qat_config * config) {
+    
+    if (!membrane || !config || config->num_steps < 0 || config->learning_rate <= 0.0f) {
+        return -1;
+    }
+    
+    if (!ggml_p9ml_can_fake_quantize(config->target_type)) {
+        GGML_LOG_WARN("%s: cannot fake-quantize to type %s\n", __func__, ggml_type_name(config->target_type));
+        return -1;
+    }
+    
+    struct ggml_p9ml_namespace * ns = membrane->ns;
+    ggml_backend_t backend = ggml_p9ml_cpu_backend(ns);
+    if (!backend) {
+        GGML_LOG_WARN("%s: training needs a namespace with a CPU backend\n", __func__);
+        return -1;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(membrane, &list) != 0) {
+        return -1;
+    }
+    
+    ggml_backend_sched_t sched = ggml_backend_sched_new(&backend, NULL, 1, 4*GGML_DEFAULT_GRAPH_SIZE, false, false);
+    struct ggml_p9ml_ste_object objects[P9ML_QAT_TRAIN_OBJECTS];
+    int result = sched ? 0 : -1;
+    
+    const uint64_t run = ggml_p9ml_stats_begin(ns);
+    const int64_t t_start = run ? ggml_time_us() : 0;
+    
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        const int64_t t_membrane = run ? ggml_time_us() : 0;
+        int n_objects = 0;
+        
+        for (int i = 0; i <= cur->num_objects && result == 0; i++) {
+            if (i < cur->num_objects) {
+                const struct ggml_tensor * object = cur->objects[i];
+                if (cur->object_states[i].alias || !ggml_p9ml_object_is_calibratable(object) ||
+                    !ggml_p9ml_object_is_quantizable(object, config->target_type)) {
+                    continue;
+                }
+                if (ggml_quantize_requires_imatrix(config->target_type) && !ggml_p9ml_object_imatrix(cur, i)) {
+                    GGML_LOG_WARN("%s: type %s needs an importance matrix, object '%s' is not calibrated\n", __func__,
+                                  ggml_type_name(config->target_type), object->name);
+                    result = -1;
+                    break;
+                }
+                memset(&objects[n_objects], 0, sizeof(struct ggml_p9ml_ste_object));
+                objects[n_objects++].slot = i;
+            }
+            
+            if (n_objects > 0 && (n_objects == P9ML_QAT_TRAIN_OBJECTS || i == cur->num_objects)) {
+                result = ggml_p9ml_qat_train_objects(ns, backend, sched, cur, objects, n_objects, config);
+                n_objects = 0;
+            }
+        }
+        
+        ggml_p9ml_stats_add_membrane(ns, run, GGML_P9ML_PASS_TRAIN, cur, t_membrane);
+    }
+    
+    ggml_p9ml_stats_add_total(ns, run, GGML_P9ML_PASS_TRAIN, membrane, t_start);
+    
+    ggml_backend_sched_free(sched);
+    ggml_p9ml_work_list_free(&list);
+    
+    // Trained weights are replaced by their fake-quantized values
+    return result == 0 ? ggml_p9ml_apply_data_free_qat(membrane, config) : result;
+}
+
+//
+// Copy-on-write division
+//
+// A cloned object is a new tensor with the data pointer of the object it was cloned from. The objects
+// that read the same data form a group, and the first write of P9-ML to one of them gives it a copy of
+// its own. The object whose memory holds the data hands a copy over to the group instead, so that its
+// tensor keeps its memory (the copy is not counted by the memory budget).
+//
+
+struct ggml_p9ml_cow {
+    struct ggml_tensor ** tensors;          // objects that read the data
+    int n_tensors;
+    int max_tensors;
+    const struct ggml_tensor * owner;       // object whose memory holds the data (NULL: data)
+    void * data;                            // copy handed over by the owner (or NULL)
+    size_t size;                            // ggml_nbytes of the objects
+};
+
+static int ggml_p9ml_cow_add(struct ggml_p9ml_cow * cow, struct ggml_tensor * tensor) {
+    if (cow->n_tensors == cow->max_tensors) {
+        const int max_tensors = cow->max_tensors > 0 ? 2*cow->max_tensors : 4;
+        struct ggml_tensor ** tensors = realloc(cow->tensors, max_tensors * sizeof(struct ggml_tensor *));
+        if (!tensors) {
+            return -1;
+        }
+        cow->tensors = tensors;
+        cow->max_tensors = max_tensors;
+    }
+    cow->tensors[cow->n_tensors++] = tensor;
+    
+    return 0;
+}
+
+// Remove an object from its group. With keep_data, the object keeps reading the data it reads now
+// (its memory, or a copy of the data). Otherwise the slot is released: the owner may hand its private
+// copy over instead of copying it.
+static int ggml_p9ml_cow_leave(struct ggml_p9ml_object_state * state, struct ggml_tensor * object, bool keep_data) {
+    struct ggml_p9ml_cow * cow = state->cow;
+    
+    if (cow->n_tensors > 1 && cow->owner == object) {
+        void * data = keep_data ? NULL : state->cow_data;
+        if (data) {
+            state->cow_data = NULL;
+        } else {
+            data = ggml_aligned_malloc(cow->size);
+            if (!data) {
+                return -1;
+            }
+            memcpy(data, object->data, cow->size);
+        }
+        for (int t = 0; t < cow->n_tensors; t++) {
+            if (cow->tensors[t] != object) {
+                cow->tensors[t]->data   = data;
+                cow->tensors[t]->buffer = NULL;
+            }
+        }
+        cow->owner = NULL;
+        cow->data  = data;
+    } else if (cow->n_tensors > 1 && keep_data) {
+        void * data = ggml_aligned_malloc(cow->size);
+        if (!data) {
+            return -1;
+        }
+        memcpy(data, object->data, cow->size);
+        object->data   = data;
+        object->buffer = NULL;
+        state->cow_data = data;
+    } else if (cow->n_tensors == 1 && cow->data) {
+        // the last object takes the copy of the group over
+        state->cow_data = cow->data;
+        cow->data = NULL;
+    }
+    
+    for (int t = 0; t < cow->n_tensors; t++) {
+        if (cow->tensors[t] == object) {
+            cow->tensors[t] = cow->tensors[--cow->n_tensors];
+            break;
+        }
+    }
+    if (cow->n_tensors == 0) {
+        free(cow->tensors);
+        free(cow);
+    }
+    state->cow = NULL;
+    
+    return 0;
+}
+
+// The slot no longer uses its object data
+static void ggml_p9ml_object_drop_cow(struct ggml_p9ml_membrane * membrane, int slot) {
+    struct ggml_p9ml_object_state * state = &membrane->object_states[slot];
+    struct ggml_tensor * object = membrane->objects[slot];
+    
+    if (state->cow && ggml_p9ml_cow_leave(state, object, false) != 0) {
+        // out of memory: the other objects keep reading this one, that is not freed
+        GGML_LOG_WARN("%s: cannot copy the data of object '%s' for its clones\n", __func__, object->name);
+        state->cow->owner = NULL;
+        ggml_p9ml_cow_leave(state, object, false);
+    }
+    if (state->cow_data) {
+        ggml_aligned_free(state->cow_data, ggml_nbytes(object));
+        state->cow_data = NULL;
+    }
+    state->cow_clone = false;
+}
+
+int ggml_p9ml_membrane_unshare(
+    struct ggml_p9ml_membrane * membrane,
+    int index) {
+    
+    if (!membrane || index >= membrane->num_objects) {
+        return -1;
+    }
+    
+    const int i0 = index < 0 ? 0 : index;
+    const int i1 = index < 0 ? membrane->num_objects : index + 1;
+    for (int i = i0; i < i1; i++) {
+        struct ggml_p9ml_object_state * state = &membrane->object_states[i];
+        if (!state->cow) {
+            continue;
+        }
+        if (ggml_p9ml_cow_leave(state, membrane->objects[i], true) != 0) {
+            GGML_LOG_WARN("%s: cannot copy the data of object '%s'\n", __func__, membrane->objects[i]->name);
+            return -1;
+        }
+        if (state->cow_clone) {
+            membrane->nbytes += ggml_p9ml_object_host_bytes(membrane->objects[i]);
+            state->cow_clone = false;
+        }
+    }
+    
+    return 0;
+}
+
+// Copy of one membrane of a divided subtree, without its children
+static struct ggml_p9ml_membrane * ggml_p9ml_membrane_clone_one(struct ggml_p9ml_membrane * membrane, bool root) {
+    struct ggml_p9ml_membrane * copy = ggml_p9ml_membrane_init(membrane->arena, membrane->name, membrane->level, membrane->ctx);
+    if (!copy) {
+        return NULL;
+    }
+    copy->ns = membrane->ns;
+    copy->backend_id = membrane->backend_id;
+    copy->numa_node = membrane->numa_node;
+    
+    int result = 0;
+    
+    for (int i = 0; i < membrane->num_objects && result == 0; i++) {
+        struct ggml_tensor * object = membrane->objects[i];
+        struct ggml_p9ml_object_state * state = &membrane->object_states[i];
+        
+        // the clone only needs tensor metadata, in any context (no_alloc ones included)
+        if (!ggml_p9ml_object_is_host(object)) {
+            GGML_LOG_WARN("%s: cannot divide membrane '%s' with device object '%s'\n", __func__, membrane->name, object->name);
+            result = -1;
+            break;
+        }
+        if (!membrane->ctx || ggml_get_mem_size(membrane->ctx) - ggml_used_mem(membrane->ctx) < ggml_tensor_overhead()) {
+            GGML_LOG_WARN("%s: no room for a clone of '%s' in the context of membrane '%s'\n", __func__, object->name, membrane->name);
+            result = -1;
+            break;
+        }
+        
+        const bool no_alloc = ggml_get_no_alloc(membrane->ctx);
+        ggml_set_no_alloc(membrane->ctx, true);
+        struct ggml_tensor * clone = ggml_dup_tensor(membrane->ctx, object);
+        ggml_set_no_alloc(membrane->ctx, no_alloc);
+        ggml_set_name(clone, object->name);
+        memcpy(clone->nb, object->nb, sizeof(clone->nb));
+        
+        // objects shared by a share rule can be written through another slot, they are copied now
+        void * data = NULL;
+        if (state->refs) {
+            data = ggml_aligned_malloc(ggml_nbytes(object));
+            if (!data) {
+                result = -1;
+                break;
+            }
+            memcpy(data, object->data, ggml_nbytes(object));
+            clone->data = data;
+        } else {
+            clone->data   = object->data;
+            clone->buffer = object->buffer;
+        }
+        
+        if (ggml_p9ml_membrane_add_object(copy, clone) != 0) {
+            ggml_aligned_free(data, ggml_nbytes(object));
+            result = -1;
+            break;
+        }
+        
+        // the versions are kept: the passes skip the clone while it does not change
+        const int j = copy->num_objects - 1;
+        copy->object_errors[j] = membrane->object_errors[i];
+        copy->object_types[j]  = membrane->object_types[i];
+        copy->object_states[j] = *state;
+        copy->object_states[j].refs      = NULL;
+        copy->object_states[j].alias     = false;
+        copy->object_states[j].cow       = NULL;
+        copy->object_states[j].cow_data  = data;
+        copy->object_states[j].cow_clone = false;
+        
+        if (!data) {
+            if (!state->cow) {
+                state->cow = calloc(1, sizeof(struct ggml_p9ml_cow));
+                if (!state->cow) {
+                    result = -1;
+                    break;
+                }
+                state->cow->owner = object;
+                state->cow->size  = ggml_nbytes(object);
+                if (ggml_p9ml_cow_add(state->cow, object) != 0) {
+                    free(state->cow);
+                    state->cow = NULL;
+                    result = -1;
+                    break;
+                }
+            }
+            if (ggml_p9ml_cow_add(state->cow, clone) != 0) {
+                result = -1;
+                break;
+            }
+            copy->object_states[j].cow       = state->cow;
+            copy->object_states[j].cow_clone = true;
+            copy->nbytes -= ggml_p9ml_object_host_bytes(clone);
+        }
+        
+        const struct ggml_p9ml_calibration * cal = &membrane->calibrations[i];
+        struct ggml_p9ml_calibration * cal_copy = &copy->calibrations[j];
+        cal_copy->n_cols = cal->n_cols;
+        cal_copy->n_rows = cal->n_rows;
+        cal_copy->n_row_scales = cal->n_row_scales;
+        if (cal->imatrix) {
+            cal_copy->imatrix = ggml_p9ml_membrane_alloc(copy, cal->n_cols * sizeof(float));
+            result = cal_copy->imatrix ? 0 : -1;
+            if (result == 0) {
+                memcpy(cal_copy->imatrix, cal->imatrix, cal->n_cols * sizeof(float));
+            }
+        }
+        if (cal->scales && result == 0) {
+            cal_copy->scales = ggml_p9ml_membrane_alloc(copy, cal->n_rows * cal->n_row_scales * sizeof(float));
+            result = cal_copy->scales ? 0 : -1;
+            if (result == 0) {
+                memcpy(cal_copy->scales, cal->scales, cal->n_rows * cal->n_row_scales * sizeof(float));
+            }
+        }
+    }
+    
+    // the divide rule of the divided membrane fires once, the clone does not divide again
+    for (int r = 0; r < membrane->num_rules && result == 0; r++) {
+        if (!root || membrane->rules[r].type != GGML_P9ML_RULE_DIVIDE) {
+            result = ggml_p9ml_membrane_add_rule(copy, membrane->rules[r]);
+        }
+    }
+    
+    if (result != 0) {
+        ggml_p9ml_membrane_free(copy);
+        return NULL;
+    }
+    
+    return copy;
+}
+
+// Copy-on-write clone of a membrane subtree, not attached to the tree
+static struct ggml_p9ml_membrane * ggml_p9ml_membrane_clone(struct ggml_p9ml_membrane * membrane) {
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(membrane, &list) != 0) {
+        return NULL;
+    }
+    
+    struct ggml_p9ml_membrane ** clones = malloc(list.n_membranes * sizeof(struct ggml_p9ml_membrane *));
+    int result = clones && (clones[0] = ggml_p9ml_membrane_clone_one(membrane, true)) ? 0 : -1;
+    
+    // Breadth-first order: the children of membrane m follow those of the membranes before it
+    int next = 1;
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        const struct ggml_p9ml_membrane * cur = list.membranes[m];
+        for (int c = 0; c < cur->num_children && result == 0; c++) {
+            if (!cur->children[c]) {
+                continue;
+            }
+            clones[next] = ggml_p9ml_membrane_clone_one(cur->children[c], false);
+            if (!clones[next] || ggml_p9ml_membrane_add_child(clones[m], clones[next]) != 0) {
+                ggml_p9ml_membrane_free(clones[next]);
+                result = -1;
+                break;
+            }
+            next++;
+        }
+    }
+    
+    struct ggml_p9ml_membrane * clone = NULL;
+    if (result == 0) {
+        clone = clones[0];
+    } else if (clones) {
+        ggml_p9ml_membrane_free(clones[0]);
+    }
+    
+    free(clones);
+    ggml_p9ml_work_list_free(&list);
+    
+    return clone;
+}
+
+struct ggml_p9ml_membrane * ggml_p9ml_membrane_divide(struct ggml_p9ml_membrane * membrane) {
+    if (!membrane || !membrane->parent) {
+        return NULL;
+    }
+    
+    struct ggml_p9ml_membrane * clone = ggml_p9ml_membrane_clone(membrane);
+    if (clone && ggml_p9ml_membrane_add_child(membrane->parent, clone) != 0) {
+        ggml_p9ml_membrane_free(clone);
+        return NULL;
+    }
+    
+    return clone;
+}
+
+//
+// Membrane evolution (P-Systems computation)
+//
+
+// Write of a rule result into an object at the end of the step
+struct ggml_p9ml_evolve_write {
+    struct ggml_tensor * value;
+    struct ggml_tensor * object;
+    struct ggml_p9ml_membrane * membrane;   // owner of the object
+    int slot;
+};
+
+// Membrane created by a divide rule, attached to the parent once the step succeeds
+struct ggml_p9ml_evolve_division {
+    struct ggml_p9ml_membrane * membrane;
+    struct ggml_p9ml_membrane * copy;
+};
+
+// Object moved or shared by a rule, transferred once the step is computed
+struct ggml_p9ml_evolve_transfer {
+    struct ggml_p9ml_membrane * membrane;
+    struct ggml_tensor * object;            // found again by address, earlier moves may shift the slots
+    struct ggml_p9ml_membrane * target;
+    bool share;
+};
+
+// One evolution step of a membrane tree, lowered to a single graph
+struct ggml_p9ml_evolve_step {
+    struct ggml_context * ctx;              // graph and rule results (no_alloc)
+    struct ggml_cgraph * graph;
+    struct ggml_p9ml_evolve_write * writes;
+    int n_writes;
+    struct ggml_p9ml_evolve_division * divisions;
+    int n_divisions;
+    struct ggml_p9ml_membrane ** dissolved; // in topological order
+    int n_dissolved;
+    struct ggml_p9ml_evolve_transfer * transfers;
+    int n_transfers;
+};
+
+static struct ggml_p9ml_membrane * ggml_p9ml_rule_target(struct ggml_p9ml_membrane * membrane, const struct ggml_p9ml_rule * rule) {
+    if (rule->target < 0) {
+        return membrane->parent;
+    }
+    return rule->target < membrane->num_children ? membrane->children[rule->target] : NULL;
+}
+
+// Emit the ops of the rules of a membrane
+static int ggml_p9ml_membrane_lower_rules(struct ggml_p9ml_membrane * membrane, struct ggml_p9ml_evolve_step * step) {
+    for (int r = 0; r < membrane->num_rules; r++) {
+        const struct ggml_p9ml_rule * rule = &membrane->rules[r];
+        
+        switch (rule->type) {
+            case GGML_P9ML_RULE_TRANSFORM:
+            case GGML_P9ML_RULE_COMMUNICATE:
+                {
+                    if (rule->object < 0 || rule->object >= membrane->num_objects) {
+                        GGML_LOG_WARN("%s: rule %d of membrane '%s' has no object %d\n", __func__, r, membrane->name, rule->object);
+                        return -1;
+                    }
+                    
+                    struct ggml_tensor * object = membrane->objects[rule->object];
+                    struct ggml_tensor * value  = NULL;
+                    struct ggml_tensor * dst    = object;
+                    struct ggml_p9ml_membrane * owner = membrane;
+                    int slot = rule->object;
+                    
+                    if (rule->type == GGML_P9ML_RULE_TRANSFORM) {
+                        value = rule->transform(step->ctx, membrane, object, rule->userdata);
+                    } else {
+                        struct ggml_p9ml_membrane * target = ggml_p9ml_rule_target(membrane, rule);
+                        if (!target || rule->target_object < 0 || rule->target_object >= target->num_objects) {
+                            GGML_LOG_WARN("%s: invalid target of rule %d of membrane '%s'\n", __func__, r, membrane->name);
+                            return -1;
+                        }
+                        // the parent of the evolved subtree may have been evicted
+                        if (ggml_p9ml_membrane_reload(target) != 0) {
+                            return -1;
+                        }
+                        // snapshot: the source may itself be written by the step
+                        value = ggml_dup(step->ctx, object);
+                        dst   = target->objects[rule->target_object];
+                        owner = target;
+                        slot  = rule->target_object;
+                    }
+                    
+                    if (!value || ggml_nelements(value) != ggml_nelements(dst)) {
+                        GGML_LOG_WARN("%s: rule %d of membrane '%s' does not produce a value for '%s'\n", __func__, r, membrane->name, dst->name);
+                        return -1;
+                    }
+                    if (value == dst) {
+                        break;
+                    }
+                    
+                    ggml_build_forward_expand(step->graph, value);
+                    step->writes[step->n_writes].value    = value;
+                    step->writes[step->n_writes].object   = dst;
+                    step->writes[step->n_writes].membrane = owner;
+                    step->writes[step->n_writes].slot     = slot;
+                    step->n_writes++;
+                } break;
+            case GGML_P9ML_RULE_DIVIDE:
+                {
+                    // lowered before the other rules
+                } break;
+            case GGML_P9ML_RULE_MOVE:
+            case GGML_P9ML_RULE_SHARE:
+                {
+                    struct ggml_p9ml_membrane * target = ggml_p9ml_rule_target(membrane, rule);
+                    if (!target || rule->object < 0 || rule->object >= membrane->num_objects) {
+                        GGML_LOG_WARN("%s: invalid object or target of rule %d of membrane '%s'\n", __func__, r, membrane->name);
+                        return -1;
+                    }
+                    step->transfers[step->n_transfers].membrane = membrane;
+                    step->transfers[step->n_transfers].object   = membrane->objects[rule->object];
+                    step->transfers[step->n_transfers].target   = target;
+                    step->transfers[step->n_transfers].share    = rule->type == GGML_P9ML_RULE_SHARE;
+                    step->n_transfers++;
+                } break;
+            case GGML_P9ML_RULE_DISSOLVE:
+                {
+                    if (!membrane->parent) {
+                        GGML_LOG_WARN("%s: membrane '%s' has no parent to dissolve into\n", __func__, membrane->name);
+                        return -1;
+                    }
+                    if (step->n_dissolved == 0 || step->dissolved[step->n_dissolved - 1] != membrane) {
+                        step->dissolved[step->n_dissolved++] = membrane;
+                    }
+                } break;
+        }
+    }
+    
+    return 0;
+}
+
+// Rules of a membrane that refer to slot `slot` of `owner` are removed, those that refer to a later slot are shifted
+static void ggml_p9ml_rules_remove_slot(struct ggml_p9ml_membrane * membrane, const struct ggml_p9ml_membrane * owner, int slot) {
+    int n = 0;
+    for (int r = 0; r < membrane->num_rules; r++) {
+        struct ggml_p9ml_rule rule = membrane->rules[r];
+        int * ref = NULL;
+        if (membrane == owner && rule.type != GGML_P9ML_RULE_DIVIDE && rule.type != GGML_P9ML_RULE_DISSOLVE) {
+            ref = &rule.object;
+        } else if (rule.type == GGML_P9ML_RULE_COMMUNICATE && ggml_p9ml_rule_target(membrane, &rule) == owner) {
+            ref = &rule.target_object;
+        }
+        if (ref && *ref == slot) {
+            continue;
+        }
+        if (ref && *ref > slot) {
+            (*ref)--;
+        }
+        membrane->rules[n++] = rule;
+    }
+    membrane->num_rules = n;
+}
+
+// Check all the transfers of a step before any is applied: an object leaves its membrane once (a later transfer
+// would not find it), and the contexts of the targets have room for the views of all the shared objects
+static int ggml_p9ml_evolve_check_transfers(const struct ggml_p9ml_evolve_step * step) {
+    for (int t = 0; t < step->n_transfers; t++) {
+        const struct ggml_p9ml_evolve_transfer * cur = &step->transfers[t];
+        size_t n_views = 0;
+        for (int u = 0; u <= t; u++) {
+            const struct ggml_p9ml_evolve_transfer * prev = &step->transfers[u];
+            if (u < t && !prev->share && prev->membrane == cur->membrane && prev->object == cur->object) {
+                GGML_LOG_WARN("%s: object '%s' of membrane '%s' is transferred again after it moved\n", __func__, cur->object->name, cur->membrane->name);
+                return -1;
+            }
+            if (cur->share && prev->share && prev->target->ctx == cur->target->ctx) {
+                n_views++;
+            }
+        }
+        // the alias only needs tensor metadata, in any context (no_alloc ones included)
+        if (cur->share && (!cur->target->ctx ||
+            ggml_get_mem_size(cur->target->ctx) - ggml_used_mem(cur->target->ctx) < n_views*ggml_tensor_overhead())) {
+            GGML_LOG_WARN("%s: no room for a view of '%s' in the context of membrane '%s'\n", __func__, cur->object->name, cur->target->name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Move or share an object, no data is copied
+static int ggml_p9ml_membrane_transfer(const struct ggml_p9ml_evolve_transfer * transfer) {
+    struct ggml_p9ml_membrane * membrane = transfer->membrane;
+    struct ggml_p9ml_membrane * target   = transfer->target;
+    struct ggml_tensor * object = transfer->object;
+    
+    int slot = 0;
+    while (slot < membrane->num_objects && membrane->objects[slot] != object) {
+        slot++;
+    }
+    if (slot == membrane->num_objects) {
+        GGML_LOG_WARN("%s: object '%s' already left membrane '%s'\n", __func__, object->name, membrane->name);
+        return -1;
+    }
+    
+    if (transfer->share) {
+        // the alias only needs tensor metadata, in any context (no_alloc ones included)
+        if (!target->ctx || ggml_get_mem_size(target->ctx) - ggml_used_mem(target->ctx) < ggml_tensor_overhead()) {
+            GGML_LOG_WARN("%s: no room for a view of '%s' in the context of membrane '%s'\n", __func__, object->name, target->name);
+            return -1;
+        }
+        
+        // the alias keeps the data pointer of the object, that must not change any more
+        if (ggml_p9ml_membrane_unshare(membrane, slot) != 0) {
+            return -1;
+        }
+        
+        struct ggml_p9ml_object_state * state = &membrane->object_states[slot];
+        if (!state->refs) {
+            state->refs = malloc(sizeof(int));
+            if (!state->refs) {
+                return -1;
+            }
+            *state->refs = 1;
+        }
+        
+        struct ggml_tensor * alias = ggml_view_tensor(target->ctx, object);
+        ggml_set_name(alias, object->name);
+        if ((object->buffer && ggml_backend_view_init(alias) != GGML_STATUS_SUCCESS) ||
+            ggml_p9ml_membrane_add_object(target, alias) != 0) {
+            return -1;
+        }
+        struct ggml_p9ml_object_state * alias_state = &target->object_states[target->num_objects - 1];
+        alias_state->refs  = state->refs;
+        alias_state->alias = true;
+        (*state->refs)++;
+        
+        return 0;
+    }
+    
+    if (ggml_p9ml_membrane_add_object(target, object) != 0) {
+        return -1;
+    }
+    
+    // the state, the calibration and the reference go along (as for a dissolved membrane)
+    const int i = target->num_objects - 1;
+    target->object_errors[i] = membrane->object_errors[slot];
+    target->object_types[i]  = membrane->object_types[slot];
+    target->object_states[i] = membrane->object_states[slot];
+    if (target->object_states[i].cow_clone) {
+        target->nbytes -= ggml_p9ml_object_host_bytes(object);
+    }
+    if (target->arena == membrane->arena) {
+        target->calibrations[i] = membrane->calibrations[slot];
+    } else {
+        target->object_states[i].qat_version = 0;
+        target->object_states[i].mp_version  = 0;
+        if (!membrane->arena) {
+            free(membrane->calibrations[slot].imatrix);
+            free(membrane->calibrations[slot].scales);
+        }
+    }
+    if (!membrane->arena) {
+        free(membrane->tile_maps[slot].rmse);
+    }
+    
+    const int n = membrane->num_objects - slot - 1;
+    memmove(&membrane->objects[slot],       &membrane->objects[slot + 1],       n*sizeof(struct ggml_tensor *));
+    memmove(&membrane->object_errors[slot], &membrane->object_errors[slot + 1], n*sizeof(float));
+    memmove(&membrane->object_types[slot],  &membrane->object_types[slot + 1],  n*sizeof(enum ggml_type));
+    memmove(&membrane->tile_maps[slot],     &membrane->tile_maps[slot + 1],     n*sizeof(struct ggml_p9ml_tile_map));
+    memmove(&membrane->object_states[slot], &membrane->object_states[slot + 1], n*sizeof(struct ggml_p9ml_object_state));
+    memmove(&membrane->calibrations[slot],  &membrane->calibrations[slot + 1],  n*sizeof(struct ggml_p9ml_calibration));
+    membrane->num_objects--;
+    membrane->nbytes -= target->object_states[i].cow_clone ? 0 : ggml_p9ml_object_host_bytes(object);
+    
+    // the rules that read or write the slots of the membrane
+    ggml_p9ml_rules_remove_slot(membrane, membrane, slot);
+    if (membrane->parent) {
+        ggml_p9ml_rules_remove_slot(membrane->parent, membrane, slot);
+    }
+    for (int c = 0; c < membrane->num_children; c++) {
+        if (membrane->children[c]) {
+            ggml_p9ml_rules_remove_slot(membrane->children[c], membrane, slot);
+        }
+    }
+    ggml_p9ml_membrane_invalidate_index(membrane);
+    
+    return 0;
+}
+
+// Move the objects and the children of a membrane to its parent and free it
+static int ggml_p9ml_membrane_dissolve(struct ggml_p9ml_membrane * membrane) {
+    struct ggml_p9ml_membrane * parent = membrane->parent;
+    
+    for (int i = 0; i < membrane->num_objects; i++) {
+        if (ggml_p9ml_membrane_add_object(parent, membrane->objects[i]) != 0) {
+            return -1;
+        }
+        // the object is unchanged, keep what the passes know about it (and its reference)
+        parent->object_states[parent->num_objects - 1] = membrane->object_states[i];
+        if (membrane->object_states[i].cow_clone) {
+            parent->nbytes -= ggml_p9ml_object_host_bytes(membrane->objects[i]);
+        }
+        membrane->object_states[i].refs     = NULL;
+        membrane->object_states[i].cow      = NULL;
+        membrane->object_states[i].cow_data = NULL;
+        if (parent->arena == membrane->arena) {
+            parent->calibrations[parent->num_objects - 1] = membrane->calibrations[i];
+            memset(&membrane->calibrations[i], 0, sizeof(struct ggml_p9ml_calibration));
+        } else {
+            parent->object_states[parent->num_objects - 1].qat_version = 0;
+            parent->object_states[parent->num_objects - 1].mp_version  = 0;
+        }
+    }
+    for (int c = 0; c < membrane->num_children; c++) {
+        if (ggml_p9ml_membrane_add_child(parent, membrane->children[c]) != 0) {
+            return -1;
+        }
+    }
+    membrane->num_children = 0;
+    
+    for (int c = 0; c < parent->num_children; c++) {
+        if (parent->children[c] == membrane) {
+            memmove(&parent->children[c], &parent->children[c + 1], (parent->num_children - c - 1) * sizeof(struct ggml_p9ml_membrane *));
+            parent->num_children--;
+            break;
+        }
+    }
+    
+    // the slots of the moved objects changed
+    ggml_p9ml_membrane_invalidate_index(parent);
+    ggml_p9ml_membrane_destroy(membrane);
+    
+    return 0;
+}
+
+int ggml_p9ml_membrane_evolve(struct ggml_p9ml_membrane * membrane) {
+    if (!membrane) {
+        return -1;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(membrane, &list) != 0) {
+        return -1;
+    }
+    
+    int n_rules   = 0;
+    int n_writes  = 0;
+    for (int m = 0; m < list.n_membranes; m++) {
+        const struct ggml_p9ml_membrane * cur = list.membranes[m];
+        n_rules += cur->num_rules;
+        for (int r = 0; r < cur->num_rules; r++) {
+            n_writes += cur->rules[r].type == GGML_P9ML_RULE_DIVIDE ? 0 : 1;
+        }
+    }
+    
+    if (n_rules == 0) {
+        ggml_p9ml_work_list_free(&list);
+        return 0;
+    }
+    
+    const size_t graph_size = GGML_DEFAULT_GRAPH_SIZE + (size_t) P9ML_RULE_MAX_NODES*n_rules + 2*(size_t) n_writes;
+    
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ ggml_tensor_overhead()*graph_size + ggml_graph_overhead_custom(graph_size, false),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    
+    const uint64_t run = ggml_p9ml_stats_begin(membrane->ns);
+    const int64_t t_start = run ? ggml_time_us() : 0;
+    
+    struct ggml_p9ml_evolve_step step = { 0 };
+    step.ctx       = ggml_init(params);
+    step.writes    = malloc(n_writes * sizeof(struct ggml_p9ml_evolve_write));
+    step.divisions = malloc(n_rules * sizeof(struct ggml_p9ml_evolve_division));
+    step.dissolved = malloc(n_rules * sizeof(struct ggml_p9ml_membrane *));
+    step.transfers = malloc(n_rules * sizeof(struct ggml_p9ml_evolve_transfer));
+    
+    int result = step.ctx && step.writes && step.divisions && step.dissolved && step.transfers ? 0 : -1;
+    
+    // Divide rules first: the clones share the objects as they are at the start of the step
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        for (int r = 0; r < cur->num_rules && result == 0; r++) {
+            if (cur->rules[r].type == GGML_P9ML_RULE_DIVIDE) {
+                struct ggml_p9ml_membrane * copy = cur->parent ? ggml_p9ml_membrane_clone(cur) : NULL;
+                if (!copy) {
+                    GGML_LOG_WARN("%s: cannot divide membrane '%s'\n", __func__, cur->name);
+                    result = -1;
+                    break;
+                }
+                step.divisions[step.n_divisions].membrane = cur;
+                step.divisions[step.n_divisions].copy     = copy;
+                step.n_divisions++;
+            }
+        }
+    }
+    
+    // The objects written by the step get their own data before the rules take views of them
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * cur = list.membranes[m];
+        for (int r = 0; r < cur->num_rules && result == 0; r++) {
+            const struct ggml_p9ml_rule * rule = &cur->rules[r];
+            struct ggml_p9ml_membrane * owner = rule->type == GGML_P9ML_RULE_TRANSFORM ? cur :
+                                                rule->type == GGML_P9ML_RULE_COMMUNICATE ? ggml_p9ml_rule_target(cur, rule) : NULL;
+            const int slot = rule->type == GGML_P9ML_RULE_TRANSFORM ? rule->object : rule->target_object;
+            if (owner && slot >= 0 && slot < owner->num_objects) {
+                result = ggml_p9ml_membrane_unshare(owner, slot);
+            }
+        }
+    }
+    
+    // Reads: the results of all the rules, then writes: copies into the objects
+    if (result == 0) {
+        step.graph = ggml_new_graph_custom(step.ctx, graph_size, false);
+    }
+    
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        result = ggml_p9ml_membrane_lower_rules(list.membranes[m], &step);
+    }
+    
+    // Nothing is computed or moved unless all the transfers can be applied
+    if (result == 0) {
+        result = ggml_p9ml_evolve_check_transfers(&step);
+    }
+    
+    for (int w = 0; w < step.n_writes && result == 0; w++) {
+        ggml_build_forward_expand(step.graph, ggml_cpy(step.ctx, step.writes[w].value, step.writes[w].object));
+    }
+    
+    if (result == 0 && ggml_graph_n_nodes(step.graph) > 0) {
+        struct ggml_p9ml_namespace * ns = membrane->ns;
+        ggml_backend_t backend = ggml_p9ml_cpu_backend(ns);
+        if (ns && ns->n_backends > 1) {
+            // objects may live on other backends
+            result = ggml_p9ml_namespace_compute(ns, step.graph);
+        } else if (!backend) {
+            GGML_LOG_WARN("%s: evolution rules need a namespace with a CPU backend\n", __func__);
+            result = -1;
+        } else {
+            if (!ns->galloc) {
+                ns->galloc = ggml_gallocr_new(ggml_backend_get_default_buffer_type(backend));
+            }
+            if (!ns->galloc || !ggml_gallocr_alloc_graph(ns->galloc, step.graph) ||
+                ggml_backend_graph_compute(backend, step.graph) != GGML_STATUS_SUCCESS) {
+                result = -1;
+            }
+        }
+    }
+    
+    // The written objects are modified
+    uint64_t bytes_written = 0;
+    for (int w = 0; w < step.n_writes && result == 0; w++) {
+        ggml_p9ml_membrane_touch(step.writes[w].membrane, step.writes[w].slot);
+        bytes_written += ggml_nbytes(step.writes[w].object);
+    }
+    
+    struct ggml_p9ml_stats_record * record = ggml_p9ml_stats_add(membrane->ns, run, GGML_P9ML_PASS_EVOLVE, membrane, true, t_start, run ? ggml_time_us() : 0);
+    if (record) {
+        record->busy_us = record->t_end_us - record->t_start_us;
+        record->bytes_written = bytes_written;
+    }
+    
+    // Structural changes once the values are computed
+    for (int d = 0; d < step.n_divisions; d++) {
+        struct ggml_p9ml_membrane * cur = step.divisions[d].membrane;
+        
+        if (result != 0) {
+            ggml_p9ml_membrane_free(step.divisions[d].copy);
+            continue;
+        }
+        
+        result = ggml_p9ml_membrane_add_child(cur->parent, step.divisions[d].copy);
+        
+        // a divide rule fires once
+        int n = 0;
+        for (int r = 0; r < cur->num_rules; r++) {
+            if (cur->rules[r].type != GGML_P9ML_RULE_DIVIDE) {
+                cur->rules[n++] = cur->rules[r];
+            }
+        }
+        cur->num_rules = n;
+    }
+    
+    // Moves and shares, before the dissolved membranes hand their objects over
+    for (int t = 0; t < step.n_transfers && result == 0; t++) {
+        result = ggml_p9ml_membrane_transfer(&step.transfers[t]);
+    }
+    
+    // a transfer rule fires once
+    for (int t = 0; t < step.n_transfers && result == 0; t++) {
+        struct ggml_p9ml_membrane * cur = step.transfers[t].membrane;
+        int n = 0;
+        for (int r = 0; r < cur->num_rules; r++) {
+            if (cur->rules[r].type != GGML_P9ML_RULE_MOVE && cur->rules[r].type != GGML_P9ML_RULE_SHARE) {
+                cur->rules[n++] = cur->rules[r];
+            }
+        }
+        cur->num_rules = n;
+    }
+    
+    // Deepest membranes first, so that nested dissolutions cascade to the outer parent
+    for (int d = step.n_dissolved - 1; d >= 0 && result == 0; d--) {
+        result = ggml_p9ml_membrane_dissolve(step.dissolved[d]);
+    }
+    
+    free(step.transfers);
+    free(step.dissolved);
+    free(step.divisions);
+    free(step.writes);
+    ggml_free(step.ctx);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+//
+// Instrumentation
+//
+// Records are appended to a growable array of the namespace. Timed operations take a run number from
+// ggml_p9ml_stats_begin (0 when the namespace does not record), so that the cost of the instrumentation
+// is a branch when it is disabled.
+//
+
+struct ggml_p9ml_stats {
+    uint32_t flags;                         // GGML_P9ML_STATS_*
+    int64_t t0;                             // ggml_time_us when the stats were enabled or reset
+    uint64_t n_runs;
+    int n_threads;                          // threads of the last task run
+    struct ggml_p9ml_stats_record * records;
+    int n_records;
+    int max_records;
+};
+
+static const char * ggml_p9ml_pass_names[GGML_P9ML_PASS_COUNT] = {
+    "qat",
+    "tiled_qat",
+    "mixed_precision",
+    "calibrate",
+    "train",
+    "evolve",
+    "compute",
+};
+
+const char * ggml_p9ml_pass_name(enum ggml_p9ml_pass pass) {
+    return pass >= 0 && pass < GGML_P9ML_PASS_COUNT ? ggml_p9ml_pass_names[pass] : "unknown";
+}
+
+int ggml_p9ml_namespace_set_stats(
+    struct ggml_p9ml_namespace * ns,
+    uint32_t flags) {
+    
+    if (!ns) {
+        return -1;
+    }
+    
+    if (flags == 0) {
+        if (ns->stats) {
+            free(ns->stats->records);
+            free(ns->stats);
+            ns->stats = NULL;
+        }
+        return 0;
+    }
+    
+    if (!ns->stats) {
+        ns->stats = calloc(1, sizeof(struct ggml_p9ml_stats));
+        if (!ns->stats) {
+            return -1;
+        }
+        ns->stats->t0 = ggml_time_us();
+    }
+    ns->stats->flags = flags;
+    
+    return 0;
+}
+
+void ggml_p9ml_namespace_stats_reset(struct ggml_p9ml_namespace * ns) {
+    if (!ns || !ns->stats) {
+        return;
+    }
+    
+    ns->stats->t0 = ggml_time_us();
+    ns->stats->n_runs = 0;
+    ns->stats->n_records = 0;
+}
+
+int ggml_p9ml_namespace_stats_n_records(const struct ggml_p9ml_namespace * ns) {
+    return ns && ns->stats ? ns->stats->n_records : 0;
+}
+
+const struct ggml_p9ml_stats_record * ggml_p9ml_namespace_stats_get(
+    const struct ggml_p9ml_namespace * ns,
+    int i) {
+    
+    if (!ns || !ns->stats || i < 0 || i >= ns->stats->n_records) {
+        return NULL;
+    }
+    return &ns->stats->records[i];
+}
+
+// Run number of an operation, 0 if the namespace does not record it
+static uint64_t ggml_p9ml_stats_begin(struct ggml_p9ml_namespace * ns) {
+    return ns && ns->stats && (ns->stats->flags & GGML_P9ML_STATS_PASSES) ? ++ns->stats->n_runs : 0;
+}
+
+// Append a record of a run (absolute times), NULL if the run is not recorded
+// The record is valid until the next one is added
+static struct ggml_p9ml_stats_record * ggml_p9ml_stats_add(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    enum ggml_p9ml_pass pass,
+    const struct ggml_p9ml_membrane * membrane,
+    bool total,
+    int64_t t_start,
+    int64_t t_end) {
+    
+    if (run == 0) {
+        return NULL;
+    }
+    
+    struct ggml_p9ml_stats * stats = ns->stats;
+    if (stats->n_records == stats->max_records) {
+        const int max_records = stats->max_records > 0 ? 2*stats->max_records : 64;
+        struct ggml_p9ml_stats_record * records = realloc(stats->records, max_records * sizeof(struct ggml_p9ml_stats_record));
+        if (!records) {
+            return NULL;
+        }
+        stats->records = records;
+        stats->max_records = max_records;
+    }
+    
+    struct ggml_p9ml_stats_record * record = &stats->records[stats->n_records++];
+    memset(record, 0, sizeof(struct ggml_p9ml_stats_record));
+    record->pass = pass;
+    record->run = run;
+    record->total = total;
+    if (membrane) {
+        const struct ggml_p9ml_membrane * top = membrane;
+        while (top->parent) {
+            top = top->parent;
+        }
+        if (ggml_p9ml_membrane_path(membrane, top, record->membrane, sizeof(record->membrane)) == 0) {
+            snprintf(record->membrane, sizeof(record->membrane), "%s", membrane->name);
+        }
+    }
+    record->t_start_us = t_start - stats->t0;
+    record->t_end_us = t_end - stats->t0;
+    record->busy_us = total ? 0 : t_end - t_start;
+    
+    return record;
+}
+
+// Record of an operation on one membrane of a tree, that reads its objects
+static void ggml_p9ml_stats_add_membrane(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    enum ggml_p9ml_pass pass,
+    const struct ggml_p9ml_membrane * membrane,
+    int64_t t_start) {
+    
+    struct ggml_p9ml_stats_record * record = ggml_p9ml_stats_add(ns, run, pass, membrane, false, t_start, run ? ggml_time_us() : 0);
+    for (int i = 0; record && i < membrane->num_objects; i++) {
+        record->bytes_read += ggml_nbytes(membrane->objects[i]);
+    }
+}
+
+// Total of an operation over the tree of a membrane: the sum of the per-membrane records of the run
+static void ggml_p9ml_stats_add_total(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    enum ggml_p9ml_pass pass,
+    const struct ggml_p9ml_membrane * membrane,
+    int64_t t_start) {
+    
+    struct ggml_p9ml_stats_record * total = ggml_p9ml_stats_add(ns, run, pass, membrane, true, t_start, run ? ggml_time_us() : 0);
+    for (int i = 0; total && i < ns->stats->n_records - 1; i++) {
+        const struct ggml_p9ml_stats_record * record = &ns->stats->records[i];
+        if (record->run == run) {
+            total->busy_us += record->busy_us;
+            total->bytes_read += record->bytes_read;
+        }
+    }
+}
+
+// Records of a fake-quantization pass: one per membrane (its chunks are contiguous) and the total
+static void ggml_p9ml_stats_add_pass(struct ggml_p9ml_namespace * ns, const struct ggml_p9ml_qat_pass * pass, int64_t t_start, int64_t t_end) {
+    struct ggml_p9ml_stats_record sum = { 0 };
+    const int n_threads = ns->stats->n_threads;
+    
+    struct ggml_p9ml_stats_record * record = NULL;
+    for (int c = 0; c < pass->n_chunks; c++) {
+        const struct ggml_p9ml_qat_chunk * chunk = &pass->chunks[c];
+        const struct ggml_tensor * tensor = chunk->membrane->objects[chunk->slot];
+        const int64_t nrows = chunk->ir1 - chunk->ir0;
+        const int64_t ncols = chunk->ic1 - chunk->ic0;
+        const uint64_t bytes = nrows*ggml_row_size(tensor->type, ncols);
+        
+        if (c == 0 || chunk->membrane != pass->chunks[c - 1].membrane) {
+            record = ggml_p9ml_stats_add(ns, pass->run, pass->kind, chunk->membrane, false, chunk->t_start, chunk->t_end);
+            if (!record) {
+                return;
+            }
+            record->busy_us = 0;
+            record->n_threads = n_threads;
+        }
+        
+        record->t_start_us = MIN(record->t_start_us, chunk->t_start - ns->stats->t0);
+        record->t_end_us = MAX(record->t_end_us, chunk->t_end - ns->stats->t0);
+        record->busy_us += chunk->t_end - chunk->t_start;
+        record->bytes_read += bytes + (pass->reference ? nrows*ggml_row_size(pass->reference->type, ncols) : 0);
+        record->bytes_written += pass->write_back ? bytes : 0;
+        record->n_quantized += nrows*ncols;
+        record->sq_err += chunk->sq_err;
+        record->sq_src += chunk->sq_src;
+        
+        sum.busy_us += chunk->t_end - chunk->t_start;
+        sum.bytes_read += bytes + (pass->reference ? nrows*ggml_row_size(pass->reference->type, ncols) : 0);
+        sum.bytes_written += pass->write_back ? bytes : 0;
+        sum.n_quantized += nrows*ncols;
+        sum.sq_err += chunk->sq_err;
+        sum.sq_src += chunk->sq_src;
+    }
+    
+    struct ggml_p9ml_stats_record * total = ggml_p9ml_stats_add(ns, pass->run, pass->kind, pass->membrane, true, t_start, t_end);
+    if (total) {
+        total->busy_us = sum.busy_us;
+        total->n_threads = n_threads;
+        total->bytes_read = sum.bytes_read;
+        total->bytes_written = sum.bytes_written;
+        total->n_quantized = sum.n_quantized;
+        total->sq_err = sum.sq_err;
+        total->sq_src = sum.sq_src;
+    }
+}
+
+// Ops that only produce a view of their source
+static bool ggml_p9ml_op_is_view(enum ggml_op op) {
+    return op == GGML_OP_NONE || op == GGML_OP_VIEW || op == GGML_OP_RESHAPE || op == GGML_OP_PERMUTE || op == GGML_OP_TRANSPOSE;
+}
+
+// Node timing of a namespace compute: the sources of a node are looked up in a hash set of the objects and
+// the nodes (in graph order) of the tree, with the membrane of each entry in a table indexed like the set
+struct ggml_p9ml_node_timing {
+    struct ggml_p9ml_work_list list;
+    struct ggml_hash_set set;
+    int * owner;                            // membrane of each key of the set (-1: none)
+    struct ggml_p9ml_stats_record * records; // per membrane, times are absolute
+    int64_t t_prev;                         // end of the previous observed node
+};
+
+static void ggml_p9ml_node_timing_free(struct ggml_p9ml_node_timing * timing) {
+    if (!timing) {
+        return;
+    }
+    ggml_p9ml_work_list_free(&timing->list);
+    ggml_hash_set_free(&timing->set);
+    free(timing->owner);
+    free(timing->records);
+    free(timing);
+}
+
+static int ggml_p9ml_node_timing_owner(const struct ggml_p9ml_node_timing * timing, const struct ggml_tensor * tensor) {
+    if (!tensor) {
+        return -1;
+    }
+    size_t i = ggml_hash_find(&timing->set, tensor);
+    if (!ggml_bitset_get(timing->set.used, i) && tensor->view_src) {
+        i = ggml_hash_find(&timing->set, tensor->view_src);
+    }
+    return ggml_bitset_get(timing->set.used, i) ? timing->owner[i] : -1;
+}
+
+static struct ggml_p9ml_node_timing * ggml_p9ml_node_timing_new(struct ggml_p9ml_namespace * ns, struct ggml_cgraph * graph) {
+    struct ggml_p9ml_node_timing * timing = calloc(1, sizeof(struct ggml_p9ml_node_timing));
+    if (!timing || !ns->root || ggml_p9ml_work_list_build(ns->root, &timing->list) != 0) {
+        free(timing);
+        return NULL;
+    }
+    
+    int n_objects = 0;
+    for (int m = 0; m < timing->list.n_membranes; m++) {
+        n_objects += timing->list.membranes[m]->num_objects;
+    }
+    
+    timing->set = ggml_hash_set_new(n_objects + graph->n_nodes);
+    timing->owner = malloc(timing->set.size * sizeof(int));
+    timing->records = calloc(timing->list.n_membranes, sizeof(struct ggml_p9ml_stats_record));
+    if (!timing->set.keys || !timing->set.used || !timing->owner || !timing->records) {
+        ggml_p9ml_node_timing_free(timing);
+        return NULL;
+    }
+    
+    for (int m = 0; m < timing->list.n_membranes; m++) {
+        const struct ggml_p9ml_membrane * membrane = timing->list.membranes[m];
+        for (int i = 0; i < membrane->num_objects; i++) {
+            const size_t h = ggml_hash_insert(&timing->set, membrane->objects[i]);
+            if (h != GGML_HASHSET_ALREADY_EXISTS) {
+                timing->owner[h] = m;
+            }
+        }
+        timing->records[m].t_start_us = INT64_MAX;
+    }
+    
+    // The sources are the ones the scheduler will replace by copies of its inputs
+    for (int i = 0; i < graph->n_nodes; i++) {
+        struct ggml_tensor * node = graph->nodes[i];
+        int owner = -1;
+        for (int s = 0; s < GGML_MAX_SRC && owner < 0; s++) {
+            owner = ggml_p9ml_node_timing_owner(timing, node->src[s]);
+        }
+        const size_t h = ggml_hash_insert(&timing->set, node);
+        if (h != GGML_HASHSET_ALREADY_EXISTS) {
+            timing->owner[h] = owner;
+        }
+        
+        if (owner >= 0 && !ggml_p9ml_op_is_view(node->op)) {
+            for (int s = 0; s < GGML_MAX_SRC; s++) {
+                timing->records[owner].bytes_read += node->src[s] ? ggml_nbytes(node->src[s]) : 0;
+            }
+            timing->records[owner].bytes_written += ggml_nbytes(node);
+        }
+    }
+    
+    return timing;
+}
+
+// Scheduler eval callback: every node is observed, its time since the previous one is charged to its membrane
+static bool ggml_p9ml_node_timing_eval(struct ggml_tensor * t, bool ask, void * user_data) {
+    struct ggml_p9ml_node_timing * timing = (struct ggml_p9ml_node_timing *) user_data;
+    if (ask) {
+        return true;
+    }
+    
+    const int64_t now = ggml_time_us();
+    const int owner = ggml_p9ml_node_timing_owner(timing, t);
+    if (owner >= 0) {
+        struct ggml_p9ml_stats_record * record = &timing->records[owner];
+        record->t_start_us = MIN(record->t_start_us, timing->t_prev);
+        record->t_end_us = now;
+        record->busy_us += now - timing->t_prev;
+    }
+    timing->t_prev = now;
+    
+    return true;
+}
+
+// Records of a namespace compute: the total, and the membranes with timed nodes
+static void ggml_p9ml_stats_add_compute(
+    struct ggml_p9ml_namespace * ns,
+    uint64_t run,
+    const struct ggml_cgraph * graph,
+    const struct ggml_p9ml_node_timing * timing,
+    int64_t t_start) {
+    
+    const int64_t t_end = ggml_time_us();
+    
+    for (int m = 0; timing && m < timing->list.n_membranes; m++) {
+        const struct ggml_p9ml_stats_record * timed = &timing->records[m];
+        if (timed->busy_us == 0 && timed->bytes_written == 0) {
+            continue;
+        }
+        struct ggml_p9ml_stats_record * record = ggml_p9ml_stats_add(ns, run, GGML_P9ML_PASS_COMPUTE, timing->list.membranes[m], false,
+                                                                     timed->busy_us > 0 ? timed->t_start_us : t_start,
+                                                                     timed->busy_us > 0 ? timed->t_end_us : t_start);
+        if (record) {
+            record->busy_us = timed->busy_us;
+            record->bytes_read = timed->bytes_read;
+            record->bytes_written = timed->bytes_written;
+        }
+    }
+    
+    struct ggml_p9ml_stats_record * total = ggml_p9ml_stats_add(ns, run, GGML_P9ML_PASS_COMPUTE, ns->root, true, t_start, t_end);
+    if (total) {
+        total->busy_us = t_end - t_start;
+        for (int i = 0; i < graph->n_nodes; i++) {
+            const struct ggml_tensor * node = graph->nodes[i];
+            if (ggml_p9ml_op_is_view(node->op)) {
+                continue;
+            }
+            for (int s = 0; s < GGML_MAX_SRC; s++) {
+                total->bytes_read += node->src[s] ? ggml_nbytes(node->src[s]) : 0;
+            }
+            total->bytes_written += ggml_nbytes(node);
+        }
+    }
+}
+
+static void ggml_p9ml_json_string(FILE * f, const char * s) {
+    fputc('"', f);
+    for (const unsigned char * c = (const unsigned char *) s; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(f, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(f, "\\u%04x", *c);
+        } else {
+            fputc(*c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Counters of a record, shared by the JSON and trace exports
+static void ggml_p9ml_json_counters(FILE * f, const struct ggml_p9ml_stats_record * record) {
+    const double span = (double) (record->t_end_us - record->t_start_us);
+    const double utilization = record->total && record->n_threads > 0 && span > 0.0 ? (double) record->busy_us / (span * record->n_threads) : 0.0;
+    
+    fprintf(f, "\"busy_us\": %" PRId64 ", \"n_threads\": %d, \"bytes_read\": %" PRIu64 ", \"bytes_written\": %" PRIu64 ", "
+               "\"n_quantized\": %" PRIu64 ", \"sq_err\": %.9g, \"sq_src\": %.9g, \"rmse\": %.9g, \"utilization\": %.4f",
+            record->busy_us, record->n_threads, record->bytes_read, record->bytes_written, record->n_quantized,
+            record->sq_err, record->sq_src, record->n_quantized > 0 ? sqrt(record->sq_err / (double) record->n_quantized) : 0.0,
+            utilization);
+}
+
+int ggml_p9ml_namespace_stats_write_json(
+    const struct ggml_p9ml_namespace * ns,
+    const char * fname) {
+    
+    if (!ns || !fname) {
+        return -1;
+    }
+    
+    FILE * f = fopen(fname, "w");
+    if (!f) {
+        GGML_LOG_WARN("%s: cannot open '%s'\n", __func__, fname);
+        return -1;
+    }
+    
+    fprintf(f, "{\n  \"namespace\": ");
+    ggml_p9ml_json_string(f, ns->name);
+    fprintf(f, ",\n  \"total_params\": %zu,\n  \"quantized_params\": %zu,\n  \"compression_ratio\": %.6f,\n  \"records\": [",
+            ns->total_params, ns->quantized_params, (double) ns->compression_ratio);
+    
+    for (int i = 0; i < ggml_p9ml_namespace_stats_n_records(ns); i++) {
+        const struct ggml_p9ml_stats_record * record = &ns->stats->records[i];
+        fprintf(f, "%s\n    {\"pass\": \"%s\", \"run\": %" PRIu64 ", \"total\": %s, \"membrane\": ", i > 0 ? "," : "",
+                ggml_p9ml_pass_name(record->pass), record->run, record->total ? "true" : "false");
+        ggml_p9ml_json_string(f, record->membrane);
+        fprintf(f, ", \"t_start_us\": %" PRId64 ", \"t_end_us\": %" PRId64 ", ", record->t_start_us, record->t_end_us);
+        ggml_p9ml_json_counters(f, record);
+        fprintf(f, "}");
+    }
+    
+    fprintf(f, "\n  ]\n}\n");
+    
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+int ggml_p9ml_namespace_stats_write_trace(
+    const struct ggml_p9ml_namespace * ns,
+    const char * fname) {
+    
+    if (!ns || !fname) {
+        return -1;
+    }
+    
+    const int n_records = ggml_p9ml_namespace_stats_n_records(ns);
+    
+    // Row of each record: 0 for the totals, then the membranes in order of appearance
+    int * rows = malloc((n_records + 1) * sizeof(int));
+    if (!rows) {
+        return -1;
+    }
+    
+    FILE * f = fopen(fname, "w");
+    if (!f) {
+        GGML_LOG_WARN("%s: cannot open '%s'\n", __func__, fname);
+        free(rows);
+        return -1;
+    }
+    
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(f, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": ");
+    ggml_p9ml_json_string(f, ns->name);
+    fprintf(f, "}},\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"(total)\"}}");
+    
+    int n_rows = 1;
+    for (int i = 0; i < n_records; i++) {
+        const struct ggml_p9ml_stats_record * record = &ns->stats->records[i];
+        rows[i] = 0;
+        if (record->total) {
+            continue;
+        }
+        for (int j = 0; j < i && rows[i] == 0; j++) {
+            if (!ns->stats->records[j].total && strcmp(ns->stats->records[j].membrane, record->membrane) == 0) {
+                rows[i] = rows[j];
+            }
+        }
+        if (rows[i] == 0) {
+            rows[i] = n_rows++;
+            fprintf(f, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": ", rows[i]);
+            ggml_p9ml_json_string(f, record->membrane);
+            fprintf(f, "}}");
+        }
+    }
+    
+    for (int i = 0; i < n_records; i++) {
+        const struct ggml_p9ml_stats_record * record = &ns->stats->records[i];
+        fprintf(f, ",\n  {\"name\": \"%s\", \"cat\": \"p9ml\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %" PRId64 ", \"dur\": %" PRId64 ", "
+                   "\"args\": {\"run\": %" PRIu64 ", \"membrane\": ",
+                ggml_p9ml_pass_name(record->pass), rows[i], record->t_start_us, record->t_end_us - record->t_start_us, record->run);
+        ggml_p9ml_json_string(f, record->membrane);
+        fprintf(f, ", ");
+        ggml_p9ml_json_counters(f, record);
+        fprintf(f, "}}");
+    }
+    
+    fprintf(f, "\n]}\n");
+    free(rows);
+    
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+//
+// Distributed computation
+//
+
+// The scheduler moves ops to the highest priority backend that has the same buffer type, which would
+// undo the placement on backends that share one (e.g. several CPU backends): those get a buffer type of
+// their own that allocates from the shared one, so that they are scheduled separately
+
+static const char * ggml_p9ml_sched_buft_get_name(ggml_backend_buffer_type_t buft) {
+    return ggml_backend_buft_name((ggml_backend_buffer_type_t) buft->context);
+}
+
+static ggml_backend_buffer_t ggml_p9ml_sched_buft_alloc_buffer(ggml_backend_buffer_type_t buft, size_t size) {
+    return ggml_backend_buft_alloc_buffer((ggml_backend_buffer_type_t) buft->context, size);
+}
+
+static size_t ggml_p9ml_sched_buft_get_alignment(ggml_backend_buffer_type_t buft) {
+    return ggml_backend_buft_get_alignment((ggml_backend_buffer_type_t) buft->context);
+}
+
+static size_t ggml_p9ml_sched_buft_get_max_size(ggml_backend_buffer_type_t buft) {
+    return ggml_backend_buft_get_max_size((ggml_backend_buffer_type_t) buft->context);
+}
+
+static size_t ggml_p9ml_sched_buft_get_alloc_size(ggml_backend_buffer_type_t buft, const struct ggml_tensor * tensor) {
+    return ggml_backend_buft_get_alloc_size((ggml_backend_buffer_type_t) buft->context, tensor);
+}
+
+static bool ggml_p9ml_sched_buft_is_host(ggml_backend_buffer_type_t buft) {
+    return ggml_backend_buft_is_host((ggml_backend_buffer_type_t) buft->context);
+}
+
+static const struct ggml_backend_buffer_type_i ggml_p9ml_sched_buft_i = {
+    /* .get_name         = */ ggml_p9ml_sched_buft_get_name,
+    /* .alloc_buffer     = */ ggml_p9ml_sched_buft_alloc_buffer,
+    /* .get_alignment    = */ ggml_p9ml_sched_buft_get_alignment,
+    /* .get_max_size     = */ ggml_p9ml_sched_buft_get_max_size,
+    /* .get_alloc_size   = */ ggml_p9ml_sched_buft_get_alloc_size,
+    /* .is_host          = */ ggml_p9ml_sched_buft_is_host,
+};
+
+static int ggml_p9ml_namespace_sched_init(struct ggml_p9ml_namespace * ns, size_t graph_size) {
+    ggml_backend_buffer_type_t bufts[GGML_P9ML_MAX_BACKENDS];
+    
+    for (int i = 0; i < ns->n_backends; i++) {
+        bufts[i] = ggml_backend_get_default_buffer_type(ns->backends[i]);
+        for (int j = 0; j < i; j++) {
+            if (ggml_backend_get_default_buffer_type(ns->backends[j]) != bufts[i]) {
+                continue;
+            }
+            // the buffers are allocated by the shared type, the backend must accept the new one
+            struct ggml_backend_buffer_type buft = { ggml_p9ml_sched_buft_i, ggml_backend_buft_get_device(bufts[i]), bufts[i] };
+            if (!ggml_backend_supports_buft(ns->backends[i], &buft)) {
+                break;
+            }
+            ns->sched_bufts[i] = malloc(sizeof(struct ggml_backend_buffer_type));
+            if (!ns->sched_bufts[i]) {
+                ggml_p9ml_namespace_sched_free(ns);
+                return -1;
+            }
+            *ns->sched_bufts[i] = buft;
+            bufts[i] = ns->sched_bufts[i];
+            break;
+        }
+    }
+    
+    // several backends: pipeline the copies between them
+    ns->sched = ggml_backend_sched_new(ns->backends, bufts, ns->n_backends, graph_size, ns->n_backends > 1, false);
+    ns->sched_graph_size = graph_size;
+    if (!ns->sched) {
+        ggml_p9ml_namespace_sched_free(ns);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static void ggml_p9ml_namespace_sched_free(struct ggml_p9ml_namespace * ns) {
+    if (ns->sched) {
+        ggml_backend_sched_free(ns->sched);
+        ns->sched = NULL;
+    }
+    for (int i = 0; i < GGML_P9ML_MAX_BACKENDS; i++) {
+        free(ns->sched_bufts[i]);
+        ns->sched_bufts[i] = NULL;
+    }
+}
+
+// Work list of the namespace tree and the backend of each of its membranes (-1 if unplaced)
+static int * ggml_p9ml_namespace_placement(struct ggml_p9ml_namespace * ns, struct ggml_p9ml_work_list * list) {
+    if (ggml_p9ml_work_list_build(ns->root, list) != 0) {
+        return NULL;
+    }
+    
+    int * placement = malloc(list->n_membranes * sizeof(int));
+    if (!placement) {
+        ggml_p9ml_work_list_free(list);
+        return NULL;
+    }
+    
+    // Inherit the placement of the parent: the children of the i-th membrane follow each other in the list
+    placement[0] = ns->root->backend_id;
+    int next = 1;
+    for (int i = 0; i < list->n_membranes; i++) {
+        const struct ggml_p9ml_membrane * membrane = list->membranes[i];
+        for (int c = 0; c < membrane->num_children; c++) {
+            const struct ggml_p9ml_membrane * child = membrane->children[c];
+            if (child) {
+                placement[next++] = child->backend_id >= 0 ? child->backend_id : placement[i];
+            }
+        }
+    }
+    
+    for (int i = 0; i < list->n_membranes; i++) {
+        if (placement[i] >= ns->n_backends) {
+            placement[i] = -1;
+        }
+    }
+    
+    return placement;
+}
+
+// Slot for a new shard, only counted once its buffer is set
+static struct ggml_p9ml_shard * ggml_p9ml_namespace_shard_new(struct ggml_p9ml_namespace * ns, int backend_id) {
+    if (ns->n_shards >= ns->max_shards) {
+        const int max_shards = ns->max_shards > 0 ? 2*ns->max_shards : 4;
+        struct ggml_p9ml_shard * shards = realloc(ns->shards, max_shards * sizeof(struct ggml_p9ml_shard));
+        if (!shards) {
+            return NULL;
+        }
+        ns->shards = shards;
+        ns->max_shards = max_shards;
+    }
+    
+    struct ggml_p9ml_shard * shard = &ns->shards[ns->n_shards];
+    shard->backend_id = backend_id;
+    shard->ctx = NULL;
+    shard->buffer = NULL;
+    
+    return shard;
+}
+
+int ggml_p9ml_namespace_upload(struct ggml_p9ml_namespace * ns) {
+    if (!ns) {
+        return -1;
+    }
+    
+    if (!ns->root) {
+        return 0;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    int * placement = ggml_p9ml_namespace_placement(ns, &list);
+    if (!placement) {
+        return -1;
+    }
+    
+    int result = ggml_p9ml_work_list_reload(&list);
+    
+    for (int b = 0; b < ns->n_backends && result == 0; b++) {
+        ggml_backend_buffer_type_t buft = ggml_backend_get_default_buffer_type(ns->backends[b]);
+        if (ggml_backend_buft_is_host(buft)) {
+            continue;
+        }
+        
+        int n_objects = 0;
+        for (int m = 0; m < list.n_membranes; m++) {
+            if (placement[m] != b) {
+                continue;
+            }
+            for (int i = 0; i < list.membranes[m]->num_objects; i++) {
+                n_objects += ggml_p9ml_object_is_host(list.membranes[m]->objects[i]) ? 1 : 0;
+            }
+        }
+        if (n_objects == 0) {
+            continue;
+        }
+        
+        struct ggml_p9ml_shard * shard = ggml_p9ml_namespace_shard_new(ns, b);
+        if (!shard) {
+            result = -1;
+            break;
+        }
+        
+        struct ggml_init_params params = {
+            /*.mem_size   =*/ n_objects*ggml_tensor_overhead(),
+            /*.mem_buffer =*/ NULL,
+            /*.no_alloc   =*/ true,
+        };
+        
+        shard->ctx = ggml_init(params);
+        if (!shard->ctx) {
+            result = -1;
+            break;
+        }
+        
+        for (int m = 0; m < list.n_membranes; m++) {
+            if (placement[m] != b) {
+                continue;
+            }
+            for (int i = 0; i < list.membranes[m]->num_objects; i++) {
+                const struct ggml_tensor * object = list.membranes[m]->objects[i];
+                if (ggml_p9ml_object_is_host(object)) {
+                    ggml_set_name(ggml_dup_tensor(shard->ctx, object), object->name);
+                }
+            }
+        }
+        
+        shard->buffer = ggml_backend_alloc_ctx_tensors_from_buft(shard->ctx, buft);
+        if (!shard->buffer) {
+            ggml_free(shard->ctx);
+            result = -1;
+            break;
+        }
+        // the scheduler runs the ops that use weights on the backend that holds them
+        ggml_backend_buffer_set_usage(shard->buffer, GGML_BACKEND_BUFFER_USAGE_WEIGHTS);
+        ns->n_shards++;
+        
+        // Same order as the tensors of the context
+        struct ggml_tensor * dev = ggml_get_first_tensor(shard->ctx);
+        for (int m = 0; m < list.n_membranes; m++) {
+            if (placement[m] != b) {
+                continue;
+            }
+            struct ggml_p9ml_membrane * membrane = list.membranes[m];
+            for (int i = 0; i < membrane->num_objects; i++) {
+                if (!ggml_p9ml_object_is_host(membrane->objects[i])) {
+                    continue;
+                }
+                // large tensors already cached by an RPC server are sent by hash
+                ggml_backend_tensor_set(dev, membrane->objects[i]->data, 0, ggml_nbytes(dev));
+                if (!membrane->object_states[i].cow_clone) {
+                    membrane->nbytes -= ggml_p9ml_object_host_bytes(membrane->objects[i]);
+                }
+                // the host data is no longer used by the slot
+                ggml_p9ml_object_drop_cow(membrane, i);
+                membrane->objects[i] = dev;
+                dev = ggml_get_next_tensor(shard->ctx, dev);
+            }
+            ggml_p9ml_membrane_invalidate_index(membrane);
+        }
+    }
+    
+    free(placement);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+// Bytes of the objects of a membrane subtree
+static size_t ggml_p9ml_subtree_size(struct ggml_p9ml_membrane * membrane) {
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build(membrane, &list) != 0) {
+        return 0;
+    }
+    
+    size_t size = 0;
+    for (int m = 0; m < list.n_membranes; m++) {
+        for (int i = 0; i < list.membranes[m]->num_objects; i++) {
+            size += ggml_nbytes(list.membranes[m]->objects[i]);
+        }
+    }
+    
+    ggml_p9ml_work_list_free(&list);
+    
+    return size;
+}
+
+int ggml_p9ml_namespace_shard(
+    struct ggml_p9ml_namespace * ns,
+    const int * backend_ids,
+    int n_backend_ids) {
+    
+    if (!ns || !ns->root || !backend_ids || n_backend_ids <= 0 || n_backend_ids > GGML_P9ML_MAX_BACKENDS) {
+        return -1;
+    }
+    for (int b = 0; b < n_backend_ids; b++) {
+        if (backend_ids[b] < 0 || backend_ids[b] >= ns->n_backends) {
+            return -1;
+        }
+    }
+    
+    struct ggml_p9ml_membrane * root = ns->root;
+    const int n = root->num_children;
+    
+    size_t * sizes = malloc((n + 1) * sizeof(size_t));
+    int * order = malloc((n + 1) * sizeof(int));
+    if (!sizes || !order) {
+        free(sizes);
+        free(order);
+        return -1;
+    }
+    
+    // Largest subtree first (insertion sort, the number of children is small)
+    for (int c = 0; c < n; c++) {
+        sizes[c] = root->children[c] ? ggml_p9ml_subtree_size(root->children[c]) : 0;
+        int j = c;
+        while (j > 0 && sizes[order[j - 1]] < sizes[c]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = c;
+    }
+    
+    size_t load[GGML_P9ML_MAX_BACKENDS] = { 0 };
+    for (int k = 0; k < n; k++) {
+        const int c = order[k];
+        if (!root->children[c]) {
+            continue;
+        }
+        int best = 0;
+        for (int b = 1; b < n_backend_ids; b++) {
+            if (load[b] < load[best]) {
+                best = b;
+            }
+        }
+        load[best] += sizes[c];
+        root->children[c]->backend_id = backend_ids[best];
+    }
+    
+    free(sizes);
+    free(order);
+    
+    return ggml_p9ml_namespace_upload(ns);
+}
+
+// Host objects without a backend buffer, wrapped in a CPU buffer for the duration of one compute
+// The objects belong to the caller: the wrappers are detached before the compute returns
+struct ggml_p9ml_wraps {
+    struct ggml_tensor ** objects;
+    ggml_backend_buffer_t * buffers;
+    int n;
+};
+
+static void ggml_p9ml_wraps_release(struct ggml_p9ml_wraps * wraps) {
+    for (int i = 0; i < wraps->n; i++) {
+        wraps->objects[i]->buffer = NULL;
+        ggml_backend_buffer_free(wraps->buffers[i]);
+    }
+    free(wraps->objects);
+    free(wraps->buffers);
+    wraps->objects = NULL;
+    wraps->buffers = NULL;
+    wraps->n = 0;
+}
+
+// Pin the objects of the placed membranes of the namespace, then the ops that consume them
+static int ggml_p9ml_namespace_place(struct ggml_p9ml_namespace * ns, struct ggml_cgraph * graph, struct ggml_p9ml_wraps * wraps) {
+    if (!ns->root) {
+        return 0;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    int * placement = ggml_p9ml_namespace_placement(ns, &list);
+    if (!placement) {
+        return -1;
+    }
+    
+    struct ggml_hash_set in_graph = ggml_hash_set_new(2*(graph->n_nodes + graph->n_leafs) + 1);
+    wraps->objects = malloc((graph->n_nodes + graph->n_leafs + 1) * sizeof(struct ggml_tensor *));
+    wraps->buffers = malloc((graph->n_nodes + graph->n_leafs + 1) * sizeof(ggml_backend_buffer_t));
+    if (!in_graph.keys || !in_graph.used || !wraps->objects || !wraps->buffers) {
+        free(placement);
+        ggml_hash_set_free(&in_graph);
+        ggml_p9ml_work_list_free(&list);
+        return -1;
+    }
+    
+    for (int i = 0; i < graph->n_leafs; i++) {
+        ggml_hash_insert(&in_graph, graph->leafs[i]);
+    }
+    for (int i = 0; i < graph->n_nodes; i++) {
+        ggml_hash_insert(&in_graph, graph->nodes[i]);
+    }
+    
+    int result = 0;
+    
+    for (int i = 0; i < list.n_membranes && result == 0; i++) {
+        const struct ggml_p9ml_membrane * membrane = list.membranes[i];
+        for (int j = 0; j < membrane->num_objects; j++) {
+            struct ggml_tensor * object = membrane->objects[j];
+            if (!ggml_hash_contains(&in_graph, object)) {
+                continue;
+            }
+            // the scheduler can only copy the inputs of a split from a backend buffer
+            if (!object->buffer && object->data && !object->view_src) {
+                // context memory is only aligned to GGML_MEM_ALIGN
+                const size_t offset = (uintptr_t) object->data % P9ML_BUFFER_ALIGNMENT;
+                ggml_backend_buffer_t buffer = ggml_backend_cpu_buffer_from_ptr((char *) object->data - offset, ggml_nbytes(object) + offset);
+                if (!buffer) {
+                    result = -1;
+                    break;
+                }
+                object->buffer = buffer;
+                wraps->objects[wraps->n] = object;
+                wraps->buffers[wraps->n] = buffer;
+                wraps->n++;
+            }
+            if (placement[i] >= 0) {
+                ggml_backend_sched_set_tensor_backend(ns->sched, object, ns->backends[placement[i]]);
+            }
+        }
+    }
+    
+    // Ops run where their first placed input is
+    for (int i = 0; i < graph->n_nodes; i++) {
+        struct ggml_tensor * node = graph->nodes[i];
+        if (ggml_backend_sched_get_tensor_backend(ns->sched, node)) {
+            continue;
+        }
+        for (int j = 0; j < GGML_MAX_SRC; j++) {
+            if (!node->src[j]) {
+                continue;
+            }
+            ggml_backend_t backend = ggml_backend_sched_get_tensor_backend(ns->sched, node->src[j]);
+            if (backend && ggml_backend_supports_op(backend, node)) {
+                ggml_backend_sched_set_tensor_backend(ns->sched, node, backend);
+                break;
+            }
+        }
+    }
+    
+    free(placement);
+    ggml_hash_set_free(&in_graph);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+static int ggml_p9ml_namespace_graph_compute(struct ggml_p9ml_namespace * ns, struct ggml_cgraph * graph, struct ggml_p9ml_node_timing * timing) {
+    if (ns->n_backends == 0) {
+        return 0;
+    }
+    
+    ggml_backend_dev_t last = ggml_backend_get_device(ns->backends[ns->n_backends - 1]);
+    if (!last || ggml_backend_dev_type(last) != GGML_BACKEND_DEVICE_TYPE_CPU) {
+        if (ns->n_backends > 1) {
+            GGML_LOG_WARN("%s: the last backend of namespace '%s' must be a CPU backend\n", __func__, ns->name);
+            return -1;
+        }
+        // Use the namespace's backend for computation
+        return ggml_backend_graph_compute(ns->backend, graph) == GGML_STATUS_SUCCESS ? 0 : -1;
+    }
+    
+    // the hash set of the scheduler holds the leafs too
+    const size_t graph_size = 2*(size_t) MAX(ggml_graph_size(graph), GGML_DEFAULT_GRAPH_SIZE);
+    if (ns->sched && ns->sched_graph_size < graph_size) {
+        ggml_p9ml_namespace_sched_free(ns);
+    }
+    if (!ns->sched && ggml_p9ml_namespace_sched_init(ns, graph_size) != 0) {
+        return -1;
+    }
+    
+    // the graph must be allocated right after the placement, computing an unallocated graph resets it
+    struct ggml_p9ml_wraps wraps = { NULL, NULL, 0 };
+    ggml_backend_sched_reset(ns->sched);
+    if (ggml_p9ml_namespace_place(ns, graph, &wraps) != 0 || !ggml_backend_sched_alloc_graph(ns->sched, graph)) {
+        ggml_p9ml_wraps_release(&wraps);
+        return -1;
+    }
+    
+    if (timing) {
+        timing->t_prev = ggml_time_us();
+        ggml_backend_sched_set_eval_callback(ns->sched, ggml_p9ml_node_timing_eval, timing);
+    }
+    const enum ggml_status status = ggml_backend_sched_graph_compute(ns->sched, graph);
+    ggml_backend_sched_set_eval_callback(ns->sched, NULL, NULL);
+    
+    // the copies between backends are done once the compute returns
+    ggml_backend_sched_synchronize(ns->sched);
+    ggml_p9ml_wraps_release(&wraps);
+    
+    return status == GGML_STATUS_SUCCESS ? 0 : -1;
+}
+
+static int ggml_p9ml_namespace_reload_graph(struct ggml_p9ml_namespace * ns, struct ggml_cgraph * graph, uint64_t now);
+static int ggml_p9ml_namespace_enforce_budget(struct ggml_p9ml_namespace * ns, uint64_t keep);
+
+// Enforce the budget after a compute, a failed eviction does not fail the compute
+static void ggml_p9ml_namespace_trim(struct ggml_p9ml_namespace * ns, uint64_t keep) {
+    ns->evict_status = ggml_p9ml_namespace_enforce_budget(ns, keep);
+    if (ns->evict_status != 0) {
+        GGML_LOG_WARN("%s: cannot evict the membranes of namespace '%s' over its budget\n", __func__, ns->name);
+    }
+}
+
+int ggml_p9ml_namespace_compute(
+    struct ggml_p9ml_namespace * ns,
+    struct ggml_cgraph * graph) {
+    
+    if (!ns || !graph) {
+        return -1;
+    }
+    
+    const uint64_t run = ggml_p9ml_stats_begin(ns);
+    const int64_t t_start = run ? ggml_time_us() : 0;
+    struct ggml_p9ml_node_timing * timing = run && (ns->stats->flags & GGML_P9ML_STATS_NODES) ? ggml_p9ml_node_timing_new(ns, graph) : NULL;
+    
+    // the membranes of the graph are the most recently used, the budget is enforced on the others
+    const uint64_t now = ++ns->clock;
+    int result = ggml_p9ml_namespace_reload_graph(ns, graph, now);
+    if (result == 0) {
+        result = ggml_p9ml_namespace_graph_compute(ns, graph, timing);
+    }
+    if (result == 0 && run) {
+        ggml_p9ml_stats_add_compute(ns, run, graph, timing, t_start);
+    }
+    ggml_p9ml_node_timing_free(timing);
+    
+    if (result == 0) {
+        ggml_p9ml_namespace_trim(ns, now);
+    }
+    
+    return result;
+}
+
+//
+// Batched execution
+//
+// The batch graph holds the nodes of consecutive batchable entries in order (a node shared by two graphs is
+// computed once). Entries of the same namespace keep their order, so a graph can read the results of a previous one.
+//
+
+struct ggml_p9ml_executor * ggml_p9ml_executor_new(
+    ggml_backend_t backend,
+    struct ggml_threadpool * threadpool,
+    int max_nodes) {
+    
+    if (!backend || max_nodes < 0) {
+        return NULL;
+    }
+    
+    ggml_backend_dev_t dev = ggml_backend_get_device(backend);
+    if (!dev || ggml_backend_dev_type(dev) != GGML_BACKEND_DEVICE_TYPE_CPU) {
+        return NULL;
+    }
+    
+    // the backend must not ask for more threads than the threadpool has
+    ggml_backend_reg_t reg = ggml_backend_dev_backend_reg(dev);
+    void (*set_threadpool)(ggml_backend_t, struct ggml_threadpool *) = NULL;
+    int (*get_n_threads)(struct ggml_threadpool *) = NULL;
+    ggml_backend_set_n_threads_t set_n_threads = NULL;
+    if (threadpool) {
+        void * proc = ggml_backend_reg_get_proc_address(reg, "ggml_backend_cpu_set_threadpool");
+        memcpy(&set_threadpool, &proc, sizeof(proc));
+        proc = ggml_backend_reg_get_proc_address(reg, "ggml_threadpool_get_n_threads");
+        memcpy(&get_n_threads, &proc, sizeof(proc));
+        proc = ggml_backend_reg_get_proc_address(reg, "ggml_backend_set_n_threads");
+        memcpy(&set_n_threads, &proc, sizeof(proc));
+        if (!set_threadpool || !get_n_threads || !set_n_threads) {
+            return NULL;
+        }
+    }
+    
+    struct ggml_p9ml_executor * exec = calloc(1, sizeof(struct ggml_p9ml_executor));
+    if (!exec) {
+        return NULL;
+    }
+    
+    if (threadpool) {
+        set_threadpool(backend, threadpool);
+        set_n_threads(backend, get_n_threads(threadpool));
+    }
+    exec->backend = backend;
+    exec->threadpool = threadpool;
+    exec->max_nodes = max_nodes > 0 ? max_nodes : GGML_DEFAULT_GRAPH_SIZE;
+    
+    return exec;
+}
+
+void ggml_p9ml_executor_free(struct ggml_p9ml_executor * exec) {
+    if (!exec) {
+        return;
+    }
+    
+    // the caller may free the threadpool next
+    if (exec->threadpool) {
+        ggml_backend_reg_t reg = ggml_backend_dev_backend_reg(ggml_backend_get_device(exec->backend));
+        void (*set_threadpool)(ggml_backend_t, struct ggml_threadpool *) = NULL;
+        void * proc = ggml_backend_reg_get_proc_address(reg, "ggml_backend_cpu_set_threadpool");
+        memcpy(&set_threadpool, &proc, sizeof(proc));
+        set_threadpool(exec->backend, NULL);
+    }
+    
+    for (int i = 0; i < exec->n_gallocs; i++) {
+        ggml_gallocr_free(exec->gallocs[i]);
+    }
+    free(exec->gallocs);
+    free(exec->entries);
+    free(exec);
+}
+
+int ggml_p9ml_executor_add(
+    struct ggml_p9ml_executor * exec,
+    struct ggml_p9ml_namespace * ns,
+    struct ggml_cgraph * graph) {
+    
+    if (!exec || !ns || !graph) {
+        return -1;
+    }
+    
+    if (exec->n_entries == exec->max_entries) {
+        const int max_entries = exec->max_entries ? 2*exec->max_entries : 16;
+        struct ggml_p9ml_executor_entry * entries = realloc(exec->entries, max_entries*sizeof(struct ggml_p9ml_executor_entry));
+        if (!entries) {
+            return -1;
+        }
+        exec->entries = entries;
+        exec->max_entries = max_entries;
+    }
+    
+    exec->entries[exec->n_entries].ns = ns;
+    exec->entries[exec->n_entries].graph = graph;
+    
+    return exec->n_entries++;
+}
+
+// Namespaces whose graphs run on their CPU backend alone, and so on the executor backend
+static bool ggml_p9ml_executor_can_batch(const struct ggml_p9ml_namespace * ns) {
+    return ns->n_backends == 1 && ggml_p9ml_cpu_backend(ns) != NULL;
+}
+
+// Allocator of the next batch of the run, the results of the previous batches stay valid
+static ggml_gallocr_t ggml_p9ml_executor_galloc(struct ggml_p9ml_executor * exec) {
+    if (exec->n_batches == exec->n_gallocs) {
+        ggml_gallocr_t * gallocs = realloc(exec->gallocs, (exec->n_gallocs + 1)*sizeof(ggml_gallocr_t));
+        if (!gallocs) {
+            return NULL;
+        }
+        exec->gallocs = gallocs;
+        exec->gallocs[exec->n_gallocs] = ggml_gallocr_new(ggml_backend_get_default_buffer_type(exec->backend));
+        if (!exec->gallocs[exec->n_gallocs]) {
+            return NULL;
+        }
+        exec->n_gallocs++;
+    }
+    return exec->gallocs[exec->n_batches];
+}
+
+// Compute entries [begin, end) as one graph
+// computed holds the nodes of the previous batches of the run: they keep their results and are leafs of this one.
+// The nodes in shared are used by other graphs of the run, their memory is not reused by the batch.
+static int ggml_p9ml_executor_batch(struct ggml_p9ml_executor * exec, int begin, int end, struct ggml_hash_set * computed, const struct ggml_hash_set * shared) {
+    const struct ggml_p9ml_executor_entry * entries = exec->entries;
+    
+    ggml_gallocr_t galloc = ggml_p9ml_executor_galloc(exec);
+    if (!galloc) {
+        return -1;
+    }
+    
+    size_t graph_size = 0;
+    for (int i = begin; i < end; i++) {
+        graph_size += ggml_graph_n_nodes(entries[i].graph) + entries[i].graph->n_leafs;
+    }
+    
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ ggml_graph_overhead_custom(graph_size, false),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    if (!ctx) {
+        return -1;
+    }
+    
+    // the graphs are in topological order, a node shared by several of them is added once
+    struct ggml_cgraph * batch = ggml_new_graph_custom(ctx, graph_size, false);
+    for (int i = begin; i < end; i++) {
+        const struct ggml_cgraph * graph = entries[i].graph;
+        for (int n = 0; n < graph->n_leafs; n++) {
+            if (ggml_hash_insert(&batch->visited_hash_set, graph->leafs[n]) != GGML_HASHSET_ALREADY_EXISTS) {
+                batch->leafs[batch->n_leafs++] = graph->leafs[n];
+            }
+        }
+        for (int n = 0; n < graph->n_nodes; n++) {
+            struct ggml_tensor * node = graph->nodes[n];
+            if (ggml_hash_insert(&batch->visited_hash_set, node) == GGML_HASHSET_ALREADY_EXISTS) {
+                continue;
+            }
+            if (ggml_hash_contains(computed, node)) {
+                batch->leafs[batch->n_leafs++] = node;
+            } else {
+                if (ggml_hash_contains(shared, node)) {
+                    ggml_set_output(node);
+                }
+                batch->nodes[batch->n_nodes++] = node;
+            }
+        }
+    }
+    
+    // the membranes of the graphs are the most recently used, the budgets are enforced on the others
+    uint64_t * now = malloc((end - begin)*sizeof(uint64_t));
+    uint64_t * runs = malloc((end - begin)*sizeof(uint64_t));
+    int result = now && runs ? 0 : -1;
+    for (int i = begin; i < end && result == 0; i++) {
+        now[i - begin] = ++entries[i].ns->clock;
+        result = ggml_p9ml_namespace_reload_graph(entries[i].ns, entries[i].graph, now[i - begin]);
+    }
+    
+    const int64_t t_start = ggml_time_us();
+    if (result == 0) {
+        for (int i = begin; i < end; i++) {
+            runs[i - begin] = ggml_p9ml_stats_begin(entries[i].ns);
+        }
+        if (!ggml_gallocr_alloc_graph(galloc, batch) ||
+            ggml_backend_graph_compute(exec->backend, batch) != GGML_STATUS_SUCCESS) {
+            result = -1;
+        }
+    }
+    
+    for (int i = begin; i < end && result == 0; i++) {
+        if (runs[i - begin]) {
+            ggml_p9ml_stats_add_compute(entries[i].ns, runs[i - begin], entries[i].graph, NULL, t_start);
+        }
+        ggml_p9ml_namespace_trim(entries[i].ns, now[i - begin]);
+    }
+    for (int n = 0; n < batch->n_nodes && result == 0; n++) {
+        ggml_hash_insert(computed, batch->nodes[n]);
+    }
+    
+    free(now);
+    free(runs);
+    ggml_free(ctx);
+    
+    exec->n_batches++;
+    
+    return result;
+}
+
+int ggml_p9ml_executor_run(struct ggml_p9ml_executor * exec) {
+    if (!exec) {
+        return -1;
+    }
+    
+    exec->n_batches = 0;
+    exec->n_single = 0;
+    
+    size_t n_run_nodes = 0;
+    for (int i = 0; i < exec->n_entries; i++) {
+        n_run_nodes += ggml_graph_n_nodes(exec->entries[i].graph);
+    }
+    struct ggml_hash_set computed = ggml_hash_set_new(n_run_nodes + 1);
+    struct ggml_hash_set shared   = ggml_hash_set_new(n_run_nodes + 1);
+    struct ggml_hash_set seen     = ggml_hash_set_new(n_run_nodes + 1);
+    
+    int result = computed.used && shared.used && seen.used ? 0 : -1;
+    
+    // nodes of several graphs
+    for (int i = 0; i < exec->n_entries && result == 0; i++) {
+        const struct ggml_cgraph * graph = exec->entries[i].graph;
+        for (int n = 0; n < graph->n_nodes; n++) {
+            if (ggml_hash_insert(&seen, graph->nodes[n]) == GGML_HASHSET_ALREADY_EXISTS) {
+                ggml_hash_insert(&shared, graph->nodes[n]);
+            }
+        }
+    }
+    ggml_hash_set_free(&seen);
+    
+    int begin = 0;
+    int n_nodes = 0;
+    for (int i = 0; i <= exec->n_entries && result == 0; i++) {
+        const struct ggml_p9ml_executor_entry * entry = i < exec->n_entries ? &exec->entries[i] : NULL;
+        const bool batchable = entry && ggml_p9ml_executor_can_batch(entry->ns);
+        const int entry_nodes = batchable ? ggml_graph_n_nodes(entry->graph) : 0;
+        
+        // flush the batch before a graph that cannot join it
+        if (begin < i && (!batchable || n_nodes + entry_nodes > exec->max_nodes)) {
+            result = ggml_p9ml_executor_batch(exec, begin, i, &computed, &shared);
+            begin = i;
+            n_nodes = 0;
+        }
+        
+        if (!entry || result != 0) {
+            continue;
+        }
+        if (batchable) {
+            n_nodes += entry_nodes;
+        } else {
+            result = ggml_p9ml_namespace_compute(entry->ns, entry->graph);
+            exec->n_single++;
+            begin = i + 1;
+        }
+    }
+    
+    exec->n_entries = 0;
+    ggml_hash_set_free(&computed);
+    ggml_hash_set_free(&shared);
+    
+    return result;
+}
+
+//
+// NUMA placement
+//
+// ggml-cpu binds compute thread ith to a node (ith % n_nodes with GGML_NUMA_STRATEGY_DISTRIBUTE), the tasks of the
+// membranes placed on a node are queued for the threads of that node. Object pages are bound with mbind.
+//
+
+typedef int (*ggml_p9ml_numa_n_nodes_t)(void);
+typedef int (*ggml_p9ml_numa_thread_node_t)(int ith);
+
+// Nodes found by ggml_numa_init (0: not initialized or no CPU backend), and the node of each compute thread
+static int ggml_p9ml_numa_topology(const struct ggml_p9ml_namespace * ns, ggml_p9ml_numa_thread_node_t * thread_node) {
+    ggml_backend_t backend = ggml_p9ml_cpu_backend(ns);
+    if (!backend) {
+        return 0;
+    }
+    
+    ggml_backend_reg_t reg = ggml_backend_dev_backend_reg(ggml_backend_get_device(backend));
+    ggml_p9ml_numa_n_nodes_t n_nodes = NULL;
+    ggml_p9ml_numa_thread_node_t node = NULL;
+    void * proc = ggml_backend_reg_get_proc_address(reg, "ggml_backend_cpu_numa_n_nodes");
+    memcpy(&n_nodes, &proc, sizeof(proc));
+    proc = ggml_backend_reg_get_proc_address(reg, "ggml_backend_cpu_numa_thread_node");
+    memcpy(&node, &proc, sizeof(proc));
+    if (!n_nodes || !node) {
+        return 0;
+    }
+    
+    if (thread_node) {
+        *thread_node = node;
+    }
+    
+    return MIN(n_nodes(), GGML_P9ML_NUMA_MAX_NODES);
+}
+
+// Node of a membrane, inherited from the closest placed ancestor (-1: unplaced)
+static int ggml_p9ml_membrane_numa_node(const struct ggml_p9ml_membrane * membrane) {
+    while (membrane && membrane->numa_node < 0) {
+        membrane = membrane->parent;
+    }
+    return membrane ? membrane->numa_node : -1;
+}
+
+// Node of every chunk of a pass (-1: unplaced), NULL if no chunk is placed
+static int * ggml_p9ml_qat_pass_numa_nodes(const struct ggml_p9ml_qat_pass * pass, struct ggml_p9ml_namespace * ns) {
+    const int n_nodes = ggml_p9ml_numa_topology(ns, NULL);
+    if (n_nodes == 0) {
+        return NULL;
+    }
+    
+    int * nodes = malloc(pass->n_chunks * sizeof(int));
+    if (!nodes) {
+        return NULL;
+    }
+    
+    // chunks of the same membrane follow each other
+    bool placed = false;
+    const struct ggml_p9ml_membrane * membrane = NULL;
+    int node = -1;
+    for (int i = 0; i < pass->n_chunks; i++) {
+        if (pass->chunks[i].membrane != membrane) {
+            membrane = pass->chunks[i].membrane;
+            node = ggml_p9ml_membrane_numa_node(membrane);
+            node = node < n_nodes ? node : -1;
+            placed = placed || node >= 0;
+        }
+        nodes[i] = node;
+    }
+    
+    if (!placed) {
+        free(nodes);
+        return NULL;
+    }
+    
+    return nodes;
+}
+
+int ggml_p9ml_membrane_set_numa_node(
+    struct ggml_p9ml_membrane * membrane,
+    int node) {
+    
+    if (!membrane || node < -1 || node >= GGML_P9ML_NUMA_MAX_NODES) {
+        return -1;
+    }
+    
+    if (node >= 0 && node >= ggml_p9ml_numa_topology(membrane->ns ? membrane->ns : ggml_p9ml_membrane_tree_namespace(membrane), NULL)) {
+        return -1;
+    }
+    
+    membrane->numa_node = node;
+    
+    return 0;
+}
+
+// Bind the whole pages of [data, data + size) to a node, moving those already touched
+static int ggml_p9ml_numa_bind_pages(void * data, size_t size, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    const uintptr_t page  = (uintptr_t) sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = (uintptr_t) data & ~(page - 1);
+    const uintptr_t end   = ((uintptr_t) data + size + page - 1) & ~(page - 1);
+    
+    const unsigned long mask = 1ul << node;
+    if (syscall(SYS_mbind, (void *) begin, end - begin, P9ML_MPOL_BIND, &mask, 8*sizeof(mask) + 1, P9ML_MPOL_MF_MOVE) != 0) {
+        GGML_LOG_WARN("%s: mbind to node %d failed: %s\n", __func__, node, strerror(errno));
+        return -1;
+    }
+    return 0;
+#else
+    GGML_UNUSED(data);
+    GGML_UNUSED(size);
+    GGML_UNUSED(node);
+    return -1;
+#endif
+}
+
+int ggml_p9ml_namespace_numa_bind(struct ggml_p9ml_namespace * ns) {
+    if (!ns || !ns->root) {
+        return -1;
+    }
+    
+    const int n_nodes = ggml_p9ml_numa_topology(ns, NULL);
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build(ns->root, &list) != 0) {
+        return -1;
+    }
+    
+    int result = 0;
+    for (int m = 0; m < list.n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * membrane = list.membranes[m];
+        const int node = ggml_p9ml_membrane_numa_node(membrane);
+        if (node < 0 || node >= n_nodes) {
+            continue;
+        }
+        for (int i = 0; i < membrane->num_objects && result == 0; i++) {
+            struct ggml_tensor * object = membrane->objects[i];
+            const struct ggml_p9ml_object_state * state = &membrane->object_states[i];
+            if (!ggml_p9ml_object_is_host(object) || !object->data || object->view_src || state->alias ||
+                (state->cow && state->cow->owner != object)) {
+                continue;
+            }
+            result = ggml_p9ml_numa_bind_pages(object->data, ggml_nbytes(object), node);
+        }
+    }
+    
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+//
+// Serialization
+//
+
+// GGUF keys of a saved namespace, per-membrane arrays are in breadth-first order
+#define P9ML_KEY_VERSION          "p9ml.version"
+#define P9ML_KEY_NAME             "p9ml.name"
+#define P9ML_KEY_SEED             "p9ml.seed"
+#define P9ML_KEY_NOISE_SCALE      "p9ml.noise_scale"
+#define P9ML_KEY_TARGET_BITS      "p9ml.target_bits"
+#define P9ML_KEY_MIXED_PRECISION  "p9ml.mixed_precision"
+#define P9ML_KEY_TOTAL_PARAMS     "p9ml.total_params"
+#define P9ML_KEY_QUANTIZED_PARAMS "p9ml.quantized_params"
+#define P9ML_KEY_COMPRESSION      "p9ml.compression_ratio"
+#define P9ML_KEY_MEMBRANE_NAMES   "p9ml.membrane.names"
+#define P9ML_KEY_MEMBRANE_LEVELS  "p9ml.membrane.levels"
+#define P9ML_KEY_MEMBRANE_PARENTS "p9ml.membrane.parents"     // index of the parent, -1 for the root
+#define P9ML_KEY_MEMBRANE_BACKEND "p9ml.membrane.backend_ids"
+#define P9ML_KEY_MEMBRANE_OBJECTS "p9ml.membrane.n_objects"
+#define P9ML_KEY_OBJECT_NAMES     "p9ml.object.names"
+#define P9ML_KEY_OBJECT_ERRORS    "p9ml.object.errors"
+#define P9ML_KEY_QAT              "p9ml.membrane.%d.qat.%s"   // QAT config of a membrane (if any)
+#define P9ML_TENSOR_NAME          "p9ml.%d.%d"                // object slot of a membrane
+#define P9ML_FORMAT_VERSION 1
+
+// Read-only file mapping of a loaded namespace (copy-on-write, the objects can be modified in memory)
+struct ggml_p9ml_mapping {
+    void * addr;
+    size_t size;
+    struct ggml_context * ctx;              // object metadata
+    ggml_backend_buffer_t buffer;           // wraps the mapping, so that the scheduler can copy the objects
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE map;
+#endif
+};
+
+static struct ggml_p9ml_mapping * ggml_p9ml_mapping_new(const char * fname) {
+    struct ggml_p9ml_mapping * mapping = calloc(1, sizeof(struct ggml_p9ml_mapping));
+    if (!mapping) {
+        return NULL;
+    }
+    
+#if defined(_WIN32)
+    mapping->file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (mapping->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(mapping->file, &size) || size.QuadPart == 0) {
+        if (mapping->file != INVALID_HANDLE_VALUE) {
+            CloseHandle(mapping->file);
+        }
+        free(mapping);
+        return NULL;
+    }
+    mapping->size = (size_t) size.QuadPart;
+    mapping->map  = CreateFileMappingA(mapping->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    mapping->addr = mapping->map ? MapViewOfFile(mapping->map, FILE_MAP_COPY, 0, 0, 0) : NULL;
+    if (!mapping->addr) {
+        if (mapping->map) {
+            CloseHandle(mapping->map);
+        }
+        CloseHandle(mapping->file);
+        free(mapping);
+        return NULL;
+    }
+#else
+    const int fd = open(fname, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(mapping);
+        return NULL;
+    }
+    mapping->size = (size_t) st.st_size;
+    mapping->addr = mmap(NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping->addr == MAP_FAILED) {
+        free(mapping);
+        return NULL;
+    }
+#endif
+    
+    return mapping;
+}
+
+static void ggml_p9ml_mapping_free(struct ggml_p9ml_mapping * mapping) {
+    if (!mapping) {
+        return;
+    }
+    
+    ggml_backend_buffer_free(mapping->buffer);
+    ggml_free(mapping->ctx);
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping->addr);
+    CloseHandle(mapping->map);
+    CloseHandle(mapping->file);
+#else
+    munmap(mapping->addr, mapping->size);
+#endif
+    free(mapping);
+}
+
+static void ggml_p9ml_save_qat_config(struct gguf_context * gctx, int m, const struct ggml_p9ml_qat_config * config) {
+    char key[128];
+    
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "target_type");
+    gguf_set_val_i32(gctx, key, (int32_t) config->target_type);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "noise_scale");
+    gguf_set_val_f32(gctx, key, config->noise_scale);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "per_channel");
+    gguf_set_val_bool(gctx, key, config->per_channel);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "mixed_precision");
+    gguf_set_val_bool(gctx, key, config->mixed_precision);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "temperature");
+    gguf_set_val_f32(gctx, key, config->temperature);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "num_steps");
+    gguf_set_val_i32(gctx, key, config->num_steps);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "learning_rate");
+    gguf_set_val_f32(gctx, key, config->learning_rate);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "scale_steps");
+    gguf_set_val_i32(gctx, key, config->scale_steps);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "scale_range");
+    gguf_set_val_f32(gctx, key, config->scale_range);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "tile_size");
+    gguf_set_val_i32(gctx, key, config->tile_size);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "use_reference");
+    gguf_set_val_bool(gctx, key, config->use_reference);
+}
+
+// Key of the given type, -1 if it is missing or has another type
+static int64_t ggml_p9ml_find_key(const struct gguf_context * gctx, const char * key, enum gguf_type type) {
+    const int64_t id = gguf_find_key(gctx, key);
+    return id >= 0 && gguf_get_kv_type(gctx, id) == type ? id : -1;
+}
+
+static int64_t ggml_p9ml_find_arr(const struct gguf_context * gctx, const char * key, enum gguf_type type, size_t n) {
+    const int64_t id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_ARRAY);
+    return id >= 0 && gguf_get_arr_type(gctx, id) == type && gguf_get_arr_n(gctx, id) == n ? id : -1;
+}
+
+static int ggml_p9ml_load_qat_config(const struct gguf_context * gctx, int m, struct ggml_p9ml_qat_config * config) {
+    char key[128];
+    int64_t id;
+    
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "target_type");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_INT32)) < 0) {
+        return 1; // no QAT config
+    }
+    config->target_type = (enum ggml_type) gguf_get_val_i32(gctx, id);
+    if (config->target_type < 0 || config->target_type >= GGML_TYPE_COUNT) {
+        return -1;
+    }
+    
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "noise_scale");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_FLOAT32)) < 0) return -1;
+    config->noise_scale = gguf_get_val_f32(gctx, id);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "per_channel");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_BOOL)) < 0) return -1;
+    config->per_channel = gguf_get_val_bool(gctx, id);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "mixed_precision");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_BOOL)) < 0) return -1;
+    config->mixed_precision = gguf_get_val_bool(gctx, id);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "temperature");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_FLOAT32)) < 0) return -1;
+    config->temperature = gguf_get_val_f32(gctx, id);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "num_steps");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_INT32)) < 0) return -1;
+    config->num_steps = gguf_get_val_i32(gctx, id);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "learning_rate");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_FLOAT32)) < 0) return -1;
+    config->learning_rate = gguf_get_val_f32(gctx, id);
+    // files written before the scale search had its own parameters get the defaults
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "scale_steps");
+    config->scale_steps = (id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_INT32)) >= 0 ? gguf_get_val_i32(gctx, id) : 8;
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "scale_range");
+    config->scale_range = (id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_FLOAT32)) >= 0 ? gguf_get_val_f32(gctx, id) : 0.1f;
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "tile_size");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_INT32)) < 0) return -1;
+    config->tile_size = gguf_get_val_i32(gctx, id);
+    snprintf(key, sizeof(key), P9ML_KEY_QAT, m, "use_reference");
+    if ((id = ggml_p9ml_find_key(gctx, key, GGUF_TYPE_BOOL)) < 0) return -1;
+    config->use_reference = gguf_get_val_bool(gctx, id);
+    
+    return 0;
+}
+
+int ggml_p9ml_namespace_save(
+    const struct ggml_p9ml_namespace * ns,
+    const char * fname) {
+    
+    if (!ns || !ns->root || !fname) {
+        return -1;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build_resident(ns->root, &list) != 0) {
+        return -1;
+    }
+    
+    const int n_membranes = list.n_membranes;
+    int n_objects = 0;
+    for (int m = 0; m < n_membranes; m++) {
+        n_objects += list.membranes[m]->num_objects;
+    }
+    
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ (n_objects + 1)*ggml_tensor_overhead(),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    struct ggml_context * meta = ggml_init(params);
+    struct gguf_context * gctx = gguf_init_empty();
+    
+    const char ** membrane_names = malloc(n_membranes * sizeof(const char *));
+    int32_t * levels    = malloc(n_membranes * sizeof(int32_t));
+    int32_t * parents   = malloc(n_membranes * sizeof(int32_t));
+    int32_t * backends  = malloc(n_membranes * sizeof(int32_t));
+    int32_t * counts    = malloc(n_membranes * sizeof(int32_t));
+    const char ** object_names = malloc((n_objects + 1) * sizeof(const char *));
+    float * errors      = malloc((n_objects + 1) * sizeof(float));
+    void ** owned       = calloc(n_objects + 1, sizeof(void *)); // converted or downloaded data
+    
+    int result = meta && gctx && membrane_names && levels && parents && backends && counts &&
+                 object_names && errors && owned ? 0 : -1;
+    
+    if (result == 0) {
+        // the children of the i-th membrane follow each other in the list
+        parents[0] = -1;
+        int next = 1;
+        for (int m = 0; m < n_membranes; m++) {
+            const struct ggml_p9ml_membrane * membrane = list.membranes[m];
+            for (int c = 0; c < membrane->num_children; c++) {
+                if (membrane->children[c]) {
+                    parents[next++] = m;
+                }
+            }
+        }
+    }
+    
+    int k = 0;
+    for (int m = 0; m < n_membranes && result == 0; m++) {
+        const struct ggml_p9ml_membrane * membrane = list.membranes[m];
+        membrane_names[m] = membrane->name;
+        levels[m]   = membrane->level;
+        backends[m] = membrane->backend_id;
+        counts[m]   = membrane->num_objects;
+        
+        if (membrane->qat_config) {
+            ggml_p9ml_save_qat_config(gctx, m, membrane->qat_config);
+        }
+        
+        for (int i = 0; i < membrane->num_objects; i++, k++) {
+            const struct ggml_tensor * object = membrane->objects[i];
+            if (!object->data || !ggml_is_contiguous(object)) {
+                GGML_LOG_WARN("%s: object '%s' of membrane '%s' is not a contiguous allocated tensor\n", __func__, object->name, membrane->name);
+                result = -1;
+                break;
+            }
+            object_names[k] = object->name;
+            errors[k] = membrane->object_errors[i];
+            
+            // Store the objects in the type chosen by the mixed-precision search
+            enum ggml_type type = membrane->object_types[i];
+            const void * data = object->data;
+            const float * imatrix = ggml_p9ml_object_imatrix(membrane, i);
+            if (type != object->type && ggml_p9ml_can_fake_quantize(type) && ggml_p9ml_object_is_quantizable(object, type) &&
+                (imatrix || !ggml_quantize_requires_imatrix(type))) {
+                const int64_t ncols = object->ne[0];
+                const int64_t nrows = ggml_nrows(object);
+                float * src = malloc(ggml_nelements(object)*sizeof(float));
+                owned[k] = malloc(ggml_row_size(type, ncols)*nrows);
+                if (!src || !owned[k]) {
+                    free(src);
+                    result = -1;
+                    break;
+                }
+                ggml_p9ml_tile_to_float(object, 0, nrows, 0, ncols, src);
+                ggml_quantize_chunk(type, src, owned[k], 0, nrows, ncols, imatrix);
+                free(src);
+                data = owned[k];
+            } else {
+                type = object->type;
+                if (!ggml_p9ml_object_is_host(object)) {
+                    if (!(owned[k] = malloc(ggml_nbytes(object)))) {
+                        result = -1;
+                        break;
+                    }
+                    ggml_backend_tensor_get(object, owned[k], 0, ggml_nbytes(object));
+                    data = owned[k];
+                }
+            }
+            
+            struct ggml_tensor * stored = ggml_new_tensor(meta, type, GGML_MAX_DIMS, object->ne);
+            ggml_format_name(stored, P9ML_TENSOR_NAME, m, i);
+            gguf_add_tensor(gctx, stored);
+            gguf_set_tensor_data(gctx, stored->name, data);
+        }
+    }
+    
+    if (result == 0) {
+        gguf_set_val_u32 (gctx, P9ML_KEY_VERSION, P9ML_FORMAT_VERSION);
+        gguf_set_val_str (gctx, P9ML_KEY_NAME, ns->name);
+        gguf_set_val_u64 (gctx, P9ML_KEY_SEED, ns->seed);
+        gguf_set_val_f32 (gctx, P9ML_KEY_NOISE_SCALE, ns->noise_scale);
+        gguf_set_val_i32 (gctx, P9ML_KEY_TARGET_BITS, ns->target_bits);
+        gguf_set_val_bool(gctx, P9ML_KEY_MIXED_PRECISION, ns->mixed_precision);
+        gguf_set_val_u64 (gctx, P9ML_KEY_TOTAL_PARAMS, ns->total_params);
+        gguf_set_val_u64 (gctx, P9ML_KEY_QUANTIZED_PARAMS, ns->quantized_params);
+        gguf_set_val_f32 (gctx, P9ML_KEY_COMPRESSION, ns->compression_ratio);
+        
+        gguf_set_arr_str (gctx, P9ML_KEY_MEMBRANE_NAMES, membrane_names, n_membranes);
+        gguf_set_arr_data(gctx, P9ML_KEY_MEMBRANE_LEVELS, GGUF_TYPE_INT32, levels, n_membranes);
+        gguf_set_arr_data(gctx, P9ML_KEY_MEMBRANE_PARENTS, GGUF_TYPE_INT32, parents, n_membranes);
+        gguf_set_arr_data(gctx, P9ML_KEY_MEMBRANE_BACKEND, GGUF_TYPE_INT32, backends, n_membranes);
+        gguf_set_arr_data(gctx, P9ML_KEY_MEMBRANE_OBJECTS, GGUF_TYPE_INT32, counts, n_membranes);
+        gguf_set_arr_str (gctx, P9ML_KEY_OBJECT_NAMES, object_names, n_objects);
+        gguf_set_arr_data(gctx, P9ML_KEY_OBJECT_ERRORS, GGUF_TYPE_FLOAT32, errors, n_objects);
+        
+        if (!gguf_write_to_file(gctx, fname, false)) {
+            GGML_LOG_WARN("%s: failed to write '%s'\n", __func__, fname);
+            result = -1;
+        }
+    }
+    
+    for (int i = 0; owned && i < n_objects; i++) {
+        free(owned[i]);
+    }
+    free(owned);
+    free(errors);
+    free(object_names);
+    free(counts);
+    free(backends);
+    free(parents);
+    free(levels);
+    free(membrane_names);
+    if (gctx) {
+        gguf_free(gctx);
+    }
+    ggml_free(meta);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+// Membranes and objects of a saved namespace, the objects point into the mapping
+static int ggml_p9ml_namespace_load_tree(
+    struct ggml_p9ml_namespace * ns,
+    const struct gguf_context * gctx,
+    struct ggml_p9ml_mapping * mapping) {
+    
+    const int64_t names_id = ggml_p9ml_find_key(gctx, P9ML_KEY_MEMBRANE_NAMES, GGUF_TYPE_ARRAY);
+    if (names_id < 0 || gguf_get_arr_type(gctx, names_id) != GGUF_TYPE_STRING || gguf_get_arr_n(gctx, names_id) == 0) {
+        return -1;
+    }
+    const int n_membranes = (int) gguf_get_arr_n(gctx, names_id);
+    
+    const int64_t levels_id   = ggml_p9ml_find_arr(gctx, P9ML_KEY_MEMBRANE_LEVELS,  GGUF_TYPE_INT32, n_membranes);
+    const int64_t parents_id  = ggml_p9ml_find_arr(gctx, P9ML_KEY_MEMBRANE_PARENTS, GGUF_TYPE_INT32, n_membranes);
+    const int64_t backends_id = ggml_p9ml_find_arr(gctx, P9ML_KEY_MEMBRANE_BACKEND, GGUF_TYPE_INT32, n_membranes);
+    const int64_t counts_id   = ggml_p9ml_find_arr(gctx, P9ML_KEY_MEMBRANE_OBJECTS, GGUF_TYPE_INT32, n_membranes);
+    if (levels_id < 0 || parents_id < 0 || backends_id < 0 || counts_id < 0) {
+        return -1;
+    }
+    const int32_t * levels   = gguf_get_arr_data(gctx, levels_id);
+    const int32_t * parents  = gguf_get_arr_data(gctx, parents_id);
+    const int32_t * backends = gguf_get_arr_data(gctx, backends_id);
+    const int32_t * counts   = gguf_get_arr_data(gctx, counts_id);
+    
+    int n_objects = 0;
+    for (int m = 0; m < n_membranes; m++) {
+        // breadth-first: the parent comes first
+        if (counts[m] < 0 || (m == 0 ? parents[m] != -1 : parents[m] < 0 || parents[m] >= m)) {
+            return -1;
+        }
+        n_objects += counts[m];
+    }
+    
+    const int64_t object_names_id = ggml_p9ml_find_arr(gctx, P9ML_KEY_OBJECT_NAMES, GGUF_TYPE_STRING, n_objects);
+    const int64_t errors_id       = ggml_p9ml_find_arr(gctx, P9ML_KEY_OBJECT_ERRORS, GGUF_TYPE_FLOAT32, n_objects);
+    if (object_names_id < 0 || errors_id < 0) {
+        return -1;
+    }
+    const float * errors = n_objects > 0 ? gguf_get_arr_data(gctx, errors_id) : NULL;
+    
+    struct ggml_p9ml_membrane ** membranes = malloc(n_membranes * sizeof(struct ggml_p9ml_membrane *));
+    if (!membranes) {
+        return -1;
+    }
+    
+    const size_t data_offset = gguf_get_data_offset(gctx);
+    
+    int result = 0;
+    int k = 0;
+    for (int m = 0; m < n_membranes && result == 0; m++) {
+        struct ggml_p9ml_membrane * membrane = ggml_p9ml_namespace_membrane_new(ns, gguf_get_arr_str(gctx, names_id, m), levels[m], mapping->ctx);
+        if (!membrane || (m > 0 && ggml_p9ml_membrane_add_child(membranes[parents[m]], membrane) != 0)) {
+            result = -1;
+            break;
+        }
+        membranes[m] = membrane;
+        membrane->backend_id = backends[m];
+        
+        struct ggml_p9ml_qat_config config;
+        const int has_config = ggml_p9ml_load_qat_config(gctx, m, &config);
+        if (has_config < 0 || (has_config == 0 && !(membrane->qat_config = ggml_p9ml_membrane_alloc(membrane, sizeof(config))))) {
+            result = -1;
+            break;
+        }
+        if (has_config == 0) {
+            *membrane->qat_config = config;
+        }
+        
+        for (int i = 0; i < counts[m]; i++, k++) {
+            char name[GGML_MAX_NAME];
+            snprintf(name, sizeof(name), P9ML_TENSOR_NAME, m, i);
+            struct ggml_tensor * object = ggml_get_tensor(mapping->ctx, name);
+            const int64_t tensor_id = gguf_find_tensor(gctx, name);
+            if (!object || tensor_id < 0) {
+                result = -1;
+                break;
+            }
+            
+            const size_t offset = data_offset + gguf_get_tensor_offset(gctx, tensor_id);
+            if (offset + ggml_nbytes(object) > mapping->size ||
+                ggml_backend_tensor_alloc(mapping->buffer, object, (char *) mapping->addr + offset) != GGML_STATUS_SUCCESS ||
+                ggml_p9ml_membrane_add_object(membrane, object) != 0) {
+                result = -1;
+                break;
+            }
+            ggml_set_name(object, gguf_get_arr_str(gctx, object_names_id, k));
+            membrane->object_errors[i] = errors[k];
+        }
+    }
+    
+    if (result == 0) {
+        result = ggml_p9ml_namespace_set_root(ns, membranes[0]);
+    }
+    
+    free(membranes);
+    
+    return result;
+}
+
+struct ggml_p9ml_namespace * ggml_p9ml_namespace_load(
+    const char * fname,
+    struct ggml_backend * backend) {
+    
+    if (!fname) {
+        return NULL;
+    }
+    
+    struct ggml_context * meta = NULL;
+    struct gguf_init_params params = {
+        /*.no_alloc =*/ true,
+        /*.ctx      =*/ &meta,
+    };
+    struct gguf_context * gctx = gguf_init_from_file(fname, params);
+    if (!gctx) {
+        GGML_LOG_WARN("%s: failed to read '%s'\n", __func__, fname);
+        return NULL;
+    }
+    
+    const int64_t version_id = ggml_p9ml_find_key(gctx, P9ML_KEY_VERSION, GGUF_TYPE_UINT32);
+    const int64_t name_id    = ggml_p9ml_find_key(gctx, P9ML_KEY_NAME, GGUF_TYPE_STRING);
+    if (version_id < 0 || gguf_get_val_u32(gctx, version_id) != P9ML_FORMAT_VERSION || name_id < 0) {
+        GGML_LOG_WARN("%s: '%s' is not a P9-ML namespace\n", __func__, fname);
+        gguf_free(gctx);
+        ggml_free(meta);
+        return NULL;
+    }
+    
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new(gguf_get_val_str(gctx, name_id), backend);
+    struct ggml_p9ml_mapping * mapping = ns ? ggml_p9ml_mapping_new(fname) : NULL;
+    if (!mapping) {
+        ggml_p9ml_namespace_free(ns);
+        gguf_free(gctx);
+        ggml_free(meta);
+        return NULL;
+    }
+    mapping->ctx = meta;
+    ns->mapping = mapping;
+    
+    int64_t id;
+    if ((id = ggml_p9ml_find_key(gctx, P9ML_KEY_SEED, GGUF_TYPE_UINT64)) >= 0)               ns->seed = gguf_get_val_u64(gctx, id);
+    if ((id = ggml_p9ml_find_key(gctx, P9ML_KEY_NOISE_SCALE, GGUF_TYPE_FLOAT32)) >= 0)       ns->noise_scale = gguf_get_val_f32(gctx, id);
+    if ((id = ggml_p9ml_find_key(gctx, P9ML_KEY_TARGET_BITS, GGUF_TYPE_INT32)) >= 0)         ns->target_bits = gguf_get_val_i32(gctx, id);
+    if ((id = ggml_p9ml_find_key(gctx, P9ML_KEY_MIXED_PRECISION, GGUF_TYPE_BOOL)) >= 0)      ns->mixed_precision = gguf_get_val_bool(gctx, id);
+    if ((id = ggml_p9ml_find_key(gctx, P9ML_KEY_TOTAL_PARAMS, GGUF_TYPE_UINT64)) >= 0)       ns->total_params = gguf_get_val_u64(gctx, id);
+    if ((id = ggml_p9ml_find_key(gctx, P9ML_KEY_QUANTIZED_PARAMS, GGUF_TYPE_UINT64)) >= 0)   ns->quantized_params = gguf_get_val_u64(gctx, id);
+    if ((id = ggml_p9ml_find_key(gctx, P9ML_KEY_COMPRESSION, GGUF_TYPE_FLOAT32)) >= 0)       ns->compression_ratio = gguf_get_val_f32(gctx, id);
+    
+    mapping->buffer = ggml_backend_cpu_buffer_from_ptr(mapping->addr, mapping->size);
+    if (!mapping->buffer || ggml_p9ml_namespace_load_tree(ns, gctx, mapping) != 0) {
+        GGML_LOG_WARN("%s: invalid namespace in '%s'\n", __func__, fname);
+        ggml_p9ml_namespace_free(ns);
+        gguf_free(gctx);
+        return NULL;
+    }
+    
+    gguf_free(gctx);
+    
+    return ns;
+}
+
+//
+// Memory budget
+//
+// Evicted membranes are written to one GGUF file each, then the whole pages of their objects are handed back
+// to the OS (the tensors keep their addresses, the contents are undefined until reloaded). Reloading maps the
+// spill file and copies the objects back in place, so the graphs and the shards that refer to them stay valid.
+//
+
+#define P9ML_SPILL_TENSOR_NAME "p9ml.spill.%d"
+
+// <spill_prefix>.<spill_id>.gguf (to be freed)
+static char * ggml_p9ml_spill_fname(const struct ggml_p9ml_namespace * ns, uint64_t spill_id) {
+    const size_t size = strlen(ns->spill_prefix) + 32;
+    char * fname = malloc(size);
+    if (fname) {
+        snprintf(fname, size, "%s.%llu.gguf", ns->spill_prefix, (unsigned long long) spill_id);
+    }
+    return fname;
+}
+
+// Release the whole pages of [data, data + size), their contents are undefined afterwards
+static void ggml_p9ml_release_pages(void * data, size_t size) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const uintptr_t page = info.dwPageSize;
+#else
+    const uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+#endif
+    const uintptr_t begin = ((uintptr_t) data + page - 1) & ~(page - 1);
+    const uintptr_t end   = ((uintptr_t) data + size) & ~(page - 1);
+    if (end <= begin) {
+        return;
+    }
+    
+    // best effort: memory that cannot be released (e.g. locked) just stays resident
+#if defined(_WIN32)
+    VirtualAlloc((void *) begin, end - begin, MEM_RESET, PAGE_READWRITE);
+#else
+    madvise((void *) begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+static bool ggml_p9ml_membrane_is_evictable(const struct ggml_p9ml_membrane * membrane) {
+    if (membrane->spill_id != 0 || membrane->nbytes == 0 || !membrane->ns || !membrane->ns->spill_prefix) {
+        return false;
+    }
+    
+    // objects (or views of them) held by other slots of the tree are still used by those
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_membrane_tree_namespace(membrane);
+    if (ns && !ns->index && !(ns->index = ggml_p9ml_index_build(ns))) {
+        return false;
+    }
+    
+    for (int i = 0; i < membrane->num_objects; i++) {
+        const struct ggml_tensor * object = membrane->objects[i];
+        const int * refs = membrane->object_states[i].refs;
+        if (!ggml_p9ml_object_is_host(object) || object->view_src || !ggml_is_contiguous(object) || (refs && *refs > 1) ||
+            membrane->object_states[i].cow) {
+            return false;
+        }
+        if (ns && ggml_p9ml_index_storage_lookup(ns->index, object)->n_slots > 1) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Delete the spill file of an evicted membrane (the objects are lost)
+static void ggml_p9ml_membrane_drop_spill(struct ggml_p9ml_membrane * membrane) {
+    if (membrane->spill_id == 0 || !membrane->ns || !membrane->ns->spill_prefix) {
+        return;
+    }
+    
+    char * fname = ggml_p9ml_spill_fname(membrane->ns, membrane->spill_id);
+    if (fname) {
+        remove(fname);
+        free(fname);
+    }
+    membrane->spill_id = 0;
+}
+
+int ggml_p9ml_namespace_set_memory_budget(
+    struct ggml_p9ml_namespace * ns,
+    size_t budget,
+    const char * spill_prefix) {
+    
+    if (!ns || (budget > 0 && !spill_prefix && !ns->spill_prefix)) {
+        return -1;
+    }
+    
+    if (spill_prefix && (!ns->spill_prefix || strcmp(spill_prefix, ns->spill_prefix) != 0)) {
+        // the evicted membranes are found through the old prefix
+        struct ggml_p9ml_work_list list;
+        if (ns->root) {
+            if (ggml_p9ml_work_list_build_resident(ns->root, &list) != 0) {
+                return -1;
+            }
+            ggml_p9ml_work_list_free(&list);
+        }
+        
+        const size_t size = strlen(spill_prefix) + 1;
+        char * prefix = malloc(size);
+        if (!prefix) {
+            return -1;
+        }
+        memcpy(prefix, spill_prefix, size);
+        free(ns->spill_prefix);
+        ns->spill_prefix = prefix;
+    }
+    
+    ns->memory_budget = budget;
+    
+    return 0;
+}
+
+size_t ggml_p9ml_namespace_memory_used(struct ggml_p9ml_namespace * ns) {
+    if (!ns || !ns->root) {
+        return 0;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build(ns->root, &list) != 0) {
+        return 0;
+    }
+    
+    size_t used = 0;
+    for (int i = 0; i < list.n_membranes; i++) {
+        used += list.membranes[i]->spill_id == 0 ? list.membranes[i]->nbytes : 0;
+    }
+    
+    ggml_p9ml_work_list_free(&list);
+    
+    return used;
+}
+
+int ggml_p9ml_membrane_evict(struct ggml_p9ml_membrane * membrane) {
+    if (!membrane) {
+        return -1;
+    }
+    
+    if (membrane->spill_id != 0 || membrane->nbytes == 0) {
+        return 0;
+    }
+    if (!ggml_p9ml_membrane_is_evictable(membrane)) {
+        return -1;
+    }
+    
+    struct ggml_p9ml_namespace * ns = membrane->ns;
+    const uint64_t spill_id = ns->n_spills + 1;
+    
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ membrane->num_objects*ggml_tensor_overhead(),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    struct ggml_context * meta = ggml_init(params);
+    struct gguf_context * gctx = gguf_init_empty();
+    char * fname = ggml_p9ml_spill_fname(ns, spill_id);
+    
+    int result = meta && gctx && fname ? 0 : -1;
+    
+    // the objects may share names, the spill file uses their slots
+    for (int i = 0; i < membrane->num_objects && result == 0; i++) {
+        char name[GGML_MAX_NAME];
+        snprintf(name, sizeof(name), P9ML_SPILL_TENSOR_NAME, i);
+        struct ggml_tensor * spill = ggml_dup_tensor(meta, membrane->objects[i]);
+        ggml_set_name(spill, name);
+        spill->data = membrane->objects[i]->data;
+        gguf_add_tensor(gctx, spill);
+    }
+    
+    if (result == 0 && !gguf_write_to_file(gctx, fname, false)) {
+        GGML_LOG_WARN("%s: cannot write the objects of membrane '%s' to %s\n", __func__, membrane->name, fname);
+        remove(fname);
+        result = -1;
+    }
+    
+    if (result == 0) {
+        for (int i = 0; i < membrane->num_objects; i++) {
+            ggml_p9ml_release_pages(membrane->objects[i]->data, ggml_nbytes(membrane->objects[i]));
+        }
+        membrane->spill_id = spill_id;
+        ns->n_spills = spill_id;
+    }
+    
+    free(fname);
+    gguf_free(gctx);
+    ggml_free(meta);
+    
+    return result;
+}
+
+int ggml_p9ml_membrane_reload(struct ggml_p9ml_membrane * membrane) {
+    if (!membrane) {
+        return -1;
+    }
+    
+    if (membrane->spill_id == 0) {
+        return 0;
+    }
+    
+    struct gguf_init_params params = {
+        /*.no_alloc =*/ true,
+        /*.ctx      =*/ NULL,
+    };
+    char * fname = ggml_p9ml_spill_fname(membrane->ns, membrane->spill_id);
+    struct gguf_context * gctx = fname ? gguf_init_from_file(fname, params) : NULL;
+    struct ggml_p9ml_mapping * mapping = gctx ? ggml_p9ml_mapping_new(fname) : NULL;
+    
+    int result = mapping ? 0 : -1;
+    
+    for (int i = 0; i < membrane->num_objects && result == 0; i++) {
+        struct ggml_tensor * object = membrane->objects[i];
+        
+        char name[GGML_MAX_NAME];
+        snprintf(name, sizeof(name), P9ML_SPILL_TENSOR_NAME, i);
+        const int64_t tensor_id = gguf_find_tensor(gctx, name);
+        const size_t offset = tensor_id >= 0 ? gguf_get_data_offset(gctx) + gguf_get_tensor_offset(gctx, tensor_id) : 0;
+        if (tensor_id < 0 || gguf_get_tensor_size(gctx, tensor_id) != ggml_nbytes(object) || offset + ggml_nbytes(object) > mapping->size) {
+            result = -1;
+            break;
+        }
+        memcpy(object->data, (const char *) mapping->addr + offset, ggml_nbytes(object));
+    }
+    
+    ggml_p9ml_mapping_free(mapping);
+    gguf_free(gctx);
+    free(fname);
+    
+    if (result != 0) {
+        GGML_LOG_WARN("%s: cannot reload the objects of membrane '%s'\n", __func__, membrane->name);
+        return -1;
+    }
+    
+    ggml_p9ml_membrane_drop_spill(membrane);
+    
+    return 0;
+}
+
+// Evict the least recently used membranes of the namespace tree, except those used since keep, until the
+// resident objects fit the budget
+static int ggml_p9ml_namespace_enforce_budget(struct ggml_p9ml_namespace * ns, uint64_t keep) {
+    if (ns->memory_budget == 0 || !ns->spill_prefix || !ns->root) {
+        return 0;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build(ns->root, &list) != 0) {
+        return -1;
+    }
+    
+    size_t used = 0;
+    for (int i = 0; i < list.n_membranes; i++) {
+        used += list.membranes[i]->spill_id == 0 ? list.membranes[i]->nbytes : 0;
+    }
+    
+    int result = 0;
+    
+    while (used > ns->memory_budget && result == 0) {
+        struct ggml_p9ml_membrane * victim = NULL;
+        for (int i = 0; i < list.n_membranes; i++) {
+            struct ggml_p9ml_membrane * membrane = list.membranes[i];
+            if (membrane->last_use < keep && ggml_p9ml_membrane_is_evictable(membrane) &&
+                (!victim || membrane->last_use < victim->last_use)) {
+                victim = membrane;
+            }
+        }
+        if (!victim) {
+            GGML_LOG_DEBUG("%s: namespace '%s' holds %zu bytes, over its budget of %zu\n", __func__, ns->name, used, ns->memory_budget);
+            break;
+        }
+        
+        result = ggml_p9ml_membrane_evict(victim);
+        used -= victim->nbytes;
+    }
+    
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+int ggml_p9ml_namespace_evict(struct ggml_p9ml_namespace * ns) {
+    if (!ns) {
+        return -1;
+    }
+    
+    return ggml_p9ml_namespace_enforce_budget(ns, ns->clock + 1);
+}
+
+// Reload the evicted membranes whose objects the graph uses, and mark them used at now
+static int ggml_p9ml_namespace_reload_graph(struct ggml_p9ml_namespace * ns, struct ggml_cgraph * graph, uint64_t now) {
+    if (!ns->spill_prefix || !ns->root) {
+        return 0;
+    }
+    
+    struct ggml_p9ml_work_list list;
+    if (ggml_p9ml_work_list_build(ns->root, &list) != 0) {
+        return -1;
+    }
+    
+    struct ggml_hash_set in_graph = ggml_hash_set_new(2*(graph->n_nodes + graph->n_leafs) + 1);
+    if (!in_graph.keys || !in_graph.used) {
+        ggml_hash_set_free(&in_graph);
+        ggml_p9ml_work_list_free(&list);
+        return -1;
+    }
+    
+    for (int i = 0; i < graph->n_leafs; i++) {
+        ggml_hash_insert(&in_graph, graph->leafs[i]);
+    }
+    for (int i = 0; i < graph->n_nodes; i++) {
+        ggml_hash_insert(&in_graph, graph->nodes[i]);
+    }
+    
+    int result = 0;
+    
+    for (int i = 0; i < list.n_membranes && result == 0; i++) {
+        struct ggml_p9ml_membrane * membrane = list.membranes[i];
+        for (int j = 0; j < membrane->num_objects; j++) {
+            if (ggml_hash_contains(&in_graph, membrane->objects[j])) {
+                membrane->last_use = now;
+                result = ggml_p9ml_membrane_reload(membrane);
+                break;
+            }
+        }
+    }
+    
+    ggml_hash_set_free(&in_graph);
+    ggml_p9ml_work_list_free(&list);
+    
+    return result;
+}
+
+//
+// Utility functions
+//
+
+void ggml_p9ml_print_membrane_stats(struct ggml_p9ml_membrane * membrane) {
+    if (!membrane) {
+        return;
+    }
+    
+    printf("Membrane '%s' (Level %d):\n", membrane->name, membrane->level);
+    printf("  Objects: %d/%d\n", membrane->num_objects, membrane->max_objects);
+    printf("  Children: %d/%d\n", membrane->num_children, membrane->max_children);
+    printf("  Rules: %d/%d\n", membrane->num_rules, membrane->max_rules);
+    
+    if (membrane->qat_config) {
+        printf("  QAT: enabled (noise=%.3f, bits=%s)\n", 
+               (double)membrane->qat_config->noise_scale,
+               ggml_type_name(membrane->qat_config->target_type));
+        
+        for (int i = 0; i < membrane->num_objects; i++) {
+            if (membrane->object_errors[i] >= 0.0f) {
+                printf("    %-32s rmse=%.6f\n", membrane->objects[i]->name, (double)membrane->object_errors[i]);
+            }
+        }
+    }
+    
+    for (int i = 0; i < membrane->num_objects; i++) {
+        const struct ggml_p9ml_tile_map * map = &membrane->tile_maps[i];
+        if (map->n_x > 0) {
+            float max_rmse = 0.0f;
+            for (int64_t t = 0; t < map->n_x*map->n_y; t++) {
+                max_rmse = MAX(max_rmse, map->rmse[t]);
+            }
+            printf("    %-32s tiles=%lldx%lld (%lldx%lld) max_rmse=%.6f\n", membrane->objects[i]->name,
+                   (long long)map->n_y, (long long)map->n_x, (long long)map->tile_rows, (long long)map->tile_cols,
+                   (double)max_rmse);
+        }
+    }
+    
+    for (int i = 0; i < membrane->num_objects; i++) {
+        if (membrane->object_types[i] != membrane->objects[i]->type) {
+            printf("    %-32s %s -> %s\n", membrane->objects[i]->name,
+                   ggml_type_name(membrane->objects[i]->type), ggml_type_name(membrane->object_types[i]));
+        }
+    }
+    
+    printf("\n");
+}
+
+void ggml_p9ml_print_namespace_stats(struct ggml_p9ml_namespace * ns) {
+    if (!ns) {
+        return;
+    }
+    
+    printf("Namespace '%s':\n", ns->name);
+    printf("  Total params: %zu\n", ns->total_params);
+    printf("  Quantized params: %zu\n", ns->quantized_params);
+    printf("  Compression ratio: %.2fx\n", (double)ns->compression_ratio);
+    printf("  Target bits: %d\n", ns->target_bits);
+    printf("  Mixed precision: %s\n", ns->mixed_precision ? "enabled" : "disabled");
+    for (int i = 0; i < ns->n_backends; i++) {
+        printf("  Backend %d: %s\n", i, ggml_backend_name(ns->backends[i]));
+    }
+    if (ns->mapping) {
+        printf("  Mapped: %.2f MiB\n", (double)ns->mapping->size/(1024.0*1024.0));
+    }
+    if (ns->memory_budget > 0) {
+        printf("  Memory: %.2f / %.2f MiB\n", (double)ggml_p9ml_namespace_memory_used(ns)/(1024.0*1024.0), (double)ns->memory_budget/(1024.0*1024.0));
+    }
+    for (int p = 0; p < GGML_P9ML_PASS_COUNT && ns->stats; p++) {
+        int n_runs = 0;
+        int64_t time_us = 0;
+        for (int i = 0; i < ns->stats->n_records; i++) {
+            const struct ggml_p9ml_stats_record * record = &ns->stats->records[i];
+            if (record->total && record->pass == (enum ggml_p9ml_pass) p) {
+                n_runs++;
+                time_us += record->t_end_us - record->t_start_us;
+            }
+        }
+        if (n_runs > 0) {
+            printf("  %-16s runs=%d time=%.3f ms\n", ggml_p9ml_pass_name((enum ggml_p9ml_pass) p), n_runs, (double)time_us/1000.0);
+        }
+    }
+    printf("\n");
+}
+
+//
+// Helper functions
+//
+
+static struct ggml_p9ml_membrane * ggml_p9ml_membrane_init(
+    struct ggml_p9ml_arena * arena,
+    const char * name,
+    int level,
+    struct ggml_context * ctx) {
+    
+    struct ggml_p9ml_membrane * membrane = arena ?
+        ggml_p9ml_arena_alloc(arena, sizeof(struct ggml_p9ml_membrane)) :
+        malloc(sizeof(struct ggml_p9ml_membrane));
+    if (!membrane) {
+        return NULL;
+    }
+    
+    // Initialize basic properties
+    strncpy(membrane->name, name ? name : "unnamed", P9ML_MEMBRANE_NAME_MAX - 1);
+    membrane->name[P9ML_MEMBRANE_NAME_MAX - 1] = '\0';
+    membrane->level = level;
+    membrane->ctx = ctx;
+    membrane->ns = NULL;
+    membrane->arena = arena;
+    membrane->parent = NULL;
+    membrane->backend_id = -1;
+    membrane->numa_node = -1;
+    
+    // Initialize counters
+    membrane->num_children = 0;
+    membrane->max_children = P9ML_INITIAL_MAX_CHILDREN;
+    membrane->num_objects = 0;
+    membrane->max_objects = P9ML_INITIAL_MAX_OBJECTS;
+    membrane->num_rules = 0;
+    membrane->max_rules = P9ML_INITIAL_MAX_RULES;
+    
+    // Initialize QAT config
+    membrane->qat_config = NULL;
+    membrane->dirty = 0;
+    membrane->qat_key = 0;
+    
+    membrane->nbytes = 0;
+    membrane->last_use = 0;
+    membrane->spill_id = 0;
+    
+    // Allocate arrays
+    membrane->children = ggml_p9ml_membrane_alloc(membrane, membrane->max_children * sizeof(struct ggml_p9ml_membrane *));
+    membrane->objects = ggml_p9ml_membrane_alloc(membrane, membrane->max_objects * sizeof(struct ggml_tensor *));
+    membrane->object_errors = ggml_p9ml_membrane_alloc(membrane, membrane->max_objects * sizeof(float));
+    membrane->object_types = ggml_p9ml_membrane_alloc(membrane, membrane->max_objects * sizeof(enum ggml_type));
+    membrane->tile_maps = ggml_p9ml_membrane_alloc(membrane, membrane->max_objects * sizeof(struct ggml_p9ml_tile_map));
+    membrane->object_states = ggml_p9ml_membrane_alloc(membrane, membrane->max_objects * sizeof(struct ggml_p9ml_object_state));
+    membrane->calibrations = ggml_p9ml_membrane_alloc(membrane, membrane->max_objects * sizeof(struct ggml_p9ml_calibration));
+    membrane->rules = ggml_p9ml_membrane_alloc(membrane, membrane->max_rules * sizeof(struct ggml_p9ml_rule));
+    
+    if (!membrane->children || !membrane->objects || !membrane->object_errors || !membrane->object_types || !membrane->tile_maps || !membrane->object_states || !membrane->calibrations || !membrane->rules) {
+        ggml_p9ml_membrane_destroy(membrane);
+        return NULL;
+    }
+    
+    return membrane;
+}
+
+// The dirty bits of a membrane cover its subtree: an ancestor has every bit of its descendants
+static void ggml_p9ml_membrane_mark_dirty(struct ggml_p9ml_membrane * membrane, uint32_t passes) {
+    for (struct ggml_p9ml_membrane * cur = membrane; cur && (cur->dirty & passes) != passes; cur = cur->parent) {
+        cur->dirty |= passes;
+    }
+}
+
+static void * ggml_p9ml_membrane_alloc(struct ggml_p9ml_membrane * membrane, size_t size) {
+    return membrane->arena ? ggml_p9ml_arena_alloc(membrane->arena, size) : malloc(size);
+}
+
+// Move the first n entries of *table to a new table of the given capacity
+static int ggml_p9ml_membrane_grow(struct ggml_p9ml_membrane * membrane, void ** table, int n, int capacity, size_t elem_size) {
+    void * data = ggml_p9ml_membrane_alloc(membrane, capacity * elem_size);
+    if (!data) {
+        return -1;
+    }
+    
+    memcpy(data, *table, n * elem_size);
+    if (!membrane->arena) {
+        free(*table);
+    }
+    *table = data;
+    
+    return 0;
+}
+
+static void ggml_p9ml_membrane_destroy(struct ggml_p9ml_membrane * membrane) {
+    ggml_p9ml_membrane_drop_spill(membrane);
+    for (int i = 0; i < membrane->num_objects; i++) {
+        ggml_p9ml_object_release(membrane, i);
+    }
+    
+    // Arena membranes are released with their namespace
+    if (membrane->arena) {
+        return;
     }
     
-    if (!tensor) {
+    // Free QAT config if exists
+    if (membrane->qat_config) {
+        ggml_p9ml_qat_config_free(membrane->qat_config);
+    }
+    
+    // Free arrays
+    free(membrane->children);
+    free(membrane->objects);
+    free(membrane->object_errors);
+    free(membrane->object_types);
+    for (int i = 0; i < membrane->num_objects; i++) {
+        free(membrane->tile_maps[i].rmse);
+    }
+    free(membrane->tile_maps);
+    free(membrane->object_states);
+    for (int i = 0; i < membrane->num_objects; i++) {
+        free(membrane->calibrations[i].imatrix);
+        free(membrane->calibrations[i].scales);
+    }
+    free(membrane->calibrations);
+    free(membrane->rules);
+    
+    // Free the membrane itself
+    free(membrane);
+}
+
+static struct ggml_p9ml_qat_pass * ggml_p9ml_qat_pass_new(
+    enum ggml_p9ml_pass kind,
+    const struct ggml_p9ml_membrane * membrane,
+    uint64_t seed,
+    float noise_scale,
+    bool write_back) {
+    
+    struct ggml_p9ml_qat_pass * pass = calloc(1, sizeof(struct ggml_p9ml_qat_pass));
+    if (!pass) {
         return NULL;
     }
     
-    // Fill with synthetic data (Gaussian noise)
-    float * data = (float *)tensor->data;
-    if (data) {
-        size_t n_elements = ggml_nelements(tensor);
-        for (size_t i = 0; i < n_elements; i++) {
-            data[i] = ggml_p9ml_generate_noise(noise_scale);
-        }
+    pass->kind = kind;
+    pass->membrane = membrane;
+    pass->seed = seed;
+    pass->noise_scale = noise_scale;
+    pass->write_back = write_back;
+    
+    return pass;
+}
+
+static void ggml_p9ml_qat_pass_free(struct ggml_p9ml_qat_pass * pass) {
+    if (!pass) {
+        return;
     }
     
-    return tensor;
+    for (int t = 0; t < GGML_MAX_N_THREADS; t++) {
+        free(pass->scratch[t]);
+    }
+    free(pass->chunks);
+    free(pass->jobs);
+    free(pass->groups);
+    free(pass);
 }
 
-int ggml_p9ml_forward_tiled_qat(
+// Split an object into tiles for the given type, returns the group index or -1
+// Without a tile map, the tiles are chunks of full rows and no per-tile error is reported.
+// Objects held by a namespace backend are added as a single job instead.
+static int ggml_p9ml_qat_pass_add(
+    struct ggml_p9ml_qat_pass * pass,
     struct ggml_p9ml_membrane * membrane,
-    struct ggml_p9ml_qat_config * config,
-    struct ggml_tensor * reference) {
+    int slot,
+    enum ggml_type type,
+    const struct ggml_p9ml_tile_map * map) {
     
-    if (!membrane || !config) {
-        return -1;
+    const struct ggml_tensor * tensor = membrane->objects[slot];
+    const uint64_t id = ggml_p9ml_object_id(membrane, slot);
+    
+    const int64_t n_per_row = tensor->ne[0];
+    const int64_t nr        = ggml_nrows(tensor);
+    const int64_t nc        = map ? map->tile_cols : n_per_row;
+    const int64_t nb        = map ? map->tile_rows : MAX(1, P9ML_QAT_CHUNK_ELEMENTS/n_per_row);
+    
+    if (pass->n_groups == pass->max_groups) {
+        const int max_groups = pass->max_groups ? 2*pass->max_groups : 16;
+        struct ggml_p9ml_qat_group * groups = realloc(pass->groups, max_groups*sizeof(struct ggml_p9ml_qat_group));
+        if (!groups) {
+            return -1;
+        }
+        pass->groups = groups;
+        pass->max_groups = max_groups;
     }
     
-    // Implementation of forward tiled QAT
-    // This would process tensors in tiles of specified size
-    int tile_size = config->tile_size;
+    const int group = pass->n_groups++;
+    pass->groups[group].membrane = membrane;
+    pass->groups[group].slot = slot;
     
-    for (int i = 0; i < membrane->num_objects; i++) {
-        struct ggml_tensor * tensor = membrane->objects[i];
-        if (!tensor) continue;
+    const int backend_id = ggml_p9ml_object_backend(membrane, tensor);
+    if (backend_id >= 0) {
+        if (pass->n_jobs == pass->max_jobs) {
+            const int max_jobs = pass->max_jobs ? 2*pass->max_jobs : 16;
+            struct ggml_p9ml_qat_job * jobs = realloc(pass->jobs, max_jobs*sizeof(struct ggml_p9ml_qat_job));
+            if (!jobs) {
+                return -1;
+            }
+            pass->jobs = jobs;
+            pass->max_jobs = max_jobs;
+        }
         
-        // Process tensor in tiles
-        // This is a simplified implementation
-        size_t n_elements = ggml_nelements(tensor);
-        size_t n_tiles = (n_elements + tile_size - 1) / tile_size;
+        struct ggml_p9ml_qat_job * job = &pass->jobs[pass->n_jobs++];
+        job->membrane   = membrane;
+        job->slot       = slot;
+        job->group      = group;
+        job->type       = type;
+        job->id         = id;
+        job->backend_id = backend_id;
+        job->map        = map;
+        job->out_err    = NULL;
+        job->out_src    = NULL;
+        job->sq_err     = -1.0;
+        job->sq_src     = 0.0;
         
-        for (size_t tile = 0; tile < n_tiles; tile++) {
-            size_t start = tile * tile_size;
-            size_t end = (start + tile_size < n_elements) ? start + tile_size : n_elements;
+        return group;
+    }
+    
+    pass->scratch_elements = MAX(pass->scratch_elements, MIN(nb, nr)*nc);
+    pass->scratch_size     = MAX(pass->scratch_size, MIN(nb, nr)*ggml_row_size(type, nc));
+    
+    for (int64_t ir = 0; ir < nr; ir += nb) {
+        for (int64_t ic = 0; ic < n_per_row; ic += nc) {
+            if (pass->n_chunks == pass->max_chunks) {
+                const int max_chunks = pass->max_chunks ? 2*pass->max_chunks : 64;
+                struct ggml_p9ml_qat_chunk * chunks = realloc(pass->chunks, max_chunks*sizeof(struct ggml_p9ml_qat_chunk));
+                if (!chunks) {
+                    return -1;
+                }
+                pass->chunks = chunks;
+                pass->max_chunks = max_chunks;
+            }
             
-            // Process tile (simplified)
-            // In a real implementation, this would apply quantization
-            // and compare with reference if available
-            (void)start; (void)end; (void)reference; // Avoid unused variable warnings
+            struct ggml_p9ml_qat_chunk * chunk = &pass->chunks[pass->n_chunks++];
+            chunk->membrane = membrane;
+            chunk->slot     = slot;
+            chunk->group    = group;
+            chunk->type     = type;
+            chunk->id       = id;
+            chunk->ir0      = ir;
+            chunk->ir1      = MIN(ir + nb, nr);
+            chunk->ic0      = ic;
+            chunk->ic1      = MIN(ic + nc, n_per_row);
+            chunk->rmse     = map ? &map->rmse[(ir/nb)*map->n_x + ic/nc] : NULL;
+            chunk->sq_err   = 0.0;
+            chunk->sq_src   = 0.0;
         }
     }
     
-    return 0;
+    return group;
 }
 
-int ggml_p9ml_mixed_precision_quantize(
-    struct ggml_p9ml_membrane * membrane,
-    float quality_threshold) {
+//
+// Jobs: fake-quantization of the objects held by namespace backends
+//
+
+// Input of a job graph, set once the graph is allocated
+struct ggml_p9ml_qat_input {
+    struct ggml_tensor * tensor;
+    const void * data;                      // host data (NULL: copied from src)
+    void * owned;                           // host data allocated for the graph
+    struct ggml_tensor * src;               // device object of a staged graph
+};
+
+// Graph of the jobs of one backend
+struct ggml_p9ml_qat_graph {
+    ggml_backend_t backend;                 // backend computing the graph
+    struct ggml_context * ctx;
+    struct ggml_cgraph * graph;
+    ggml_gallocr_t galloc;
+    struct ggml_p9ml_qat_input * inputs;
+    int n_inputs;
+    struct ggml_tensor ** staged;           // host copies of the objects written back by a staged graph
+    struct ggml_tensor ** targets;          // and the device objects they are copied to
+    int n_staged;
+    bool started;
+};
+
+static void ggml_p9ml_qat_graph_free(struct ggml_p9ml_qat_graph * qg) {
+    for (int i = 0; i < qg->n_inputs; i++) {
+        free(qg->inputs[i].owned);
+    }
+    free(qg->inputs);
+    free(qg->staged);
+    free(qg->targets);
+    ggml_gallocr_free(qg->galloc);
+    ggml_free(qg->ctx);
+    memset(qg, 0, sizeof(*qg));
+}
+
+static struct ggml_tensor * ggml_p9ml_qat_graph_input(struct ggml_p9ml_qat_graph * qg, struct ggml_tensor * tensor, const void * data, void * owned, struct ggml_tensor * src) {
+    ggml_set_input(tensor);
+    struct ggml_p9ml_qat_input * input = &qg->inputs[qg->n_inputs++];
+    input->tensor = tensor;
+    input->data = data;
+    input->owned = owned;
+    input->src = src;
+    return tensor;
+}
+
+// Graph of the jobs held by a backend: x = object (+ noise), fq = fake_quant(x), and the sums of (ref - fq)^2,
+// per tile with a tile map, and of ref^2, with ref = x or the pass reference. The objects are overwritten with fq
+// when the pass writes back. A staged graph runs on the CPU backend on host copies of the objects.
+// Returns 1 if the backend cannot run one of the ops.
+static int ggml_p9ml_qat_graph_build(struct ggml_p9ml_qat_pass * pass, struct ggml_p9ml_qat_graph * qg, int backend_id, ggml_backend_t backend, bool staged) {
+    int n_jobs = 0;
+    for (int j = 0; j < pass->n_jobs; j++) {
+        n_jobs += pass->jobs[j].backend_id == backend_id ? 1 : 0;
+    }
     
-    if (!membrane) {
+    // at most 5 inputs and 24 tensors per job
+    const size_t n_tensors = 24*(size_t) n_jobs + 16;
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ n_tensors*ggml_tensor_overhead() + ggml_graph_overhead_custom(n_tensors, false),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    
+    qg->backend = backend;
+    qg->ctx     = ggml_init(params);
+    qg->inputs  = malloc((5*n_jobs + 1) * sizeof(struct ggml_p9ml_qat_input));
+    qg->staged  = malloc((n_jobs + 1) * sizeof(struct ggml_tensor *));
+    qg->targets = malloc((n_jobs + 1) * sizeof(struct ggml_tensor *));
+    if (!qg->ctx || !qg->inputs || !qg->staged || !qg->targets) {
         return -1;
     }
     
-    // Implementation of mixed-precision quantization
-    // This would analyze each tensor and determine optimal bit-width
+    struct ggml_context * ctx = qg->ctx;
+    qg->graph = ggml_new_graph_custom(ctx, n_tensors, false);
     
-    for (int i = 0; i < membrane->num_objects; i++) {
-        struct ggml_tensor * tensor = membrane->objects[i];
-        if (!tensor) continue;
+    const struct ggml_p9ml_qat_job * prev = NULL;
+    struct ggml_tensor * w   = NULL;
+    struct ggml_tensor * x   = NULL;
+    struct ggml_tensor * ref = NULL;
+    struct ggml_tensor * sum_src = NULL;
+    
+    for (int j = 0; j < pass->n_jobs; j++) {
+        struct ggml_p9ml_qat_job * job = &pass->jobs[j];
+        if (job->backend_id != backend_id) {
+            continue;
+        }
+        
+        struct ggml_tensor * object = job->membrane->objects[job->slot];
+        const int64_t ne0 = object->ne[0];
+        const int64_t nr  = ggml_nrows(object);
         
-        // Analyze tensor characteristics and determine optimal quantization
-        // This is a simplified heuristic
-        size_t n_elements = ggml_nelements(tensor);
+        // the candidate types of an object (mixed precision) follow each other and share its source values
+        if (!prev || prev->membrane != job->membrane || prev->slot != job->slot) {
+            w = object;
+            if (staged) {
+                w = ggml_p9ml_qat_graph_input(qg, ggml_dup_tensor(ctx, object), NULL, NULL, object);
+            }
+            
+            x = ggml_reshape_2d(ctx, w, ne0, nr);
+            if (x->type != GGML_TYPE_F32) {
+                x = ggml_cast(ctx, x, GGML_TYPE_F32);
+            }
+            
+            // same stream as the host tasks, generated on the host
+            if (pass->noise_scale > 0.0f) {
+                float * noise = malloc(ne0*nr*sizeof(float));
+                if (!noise) {
+                    return -1;
+                }
+                ggml_p9ml_noise_fill(noise, ne0*nr, 0, pass->seed, job->id, GGML_P9ML_NOISE_GAUSSIAN, pass->noise_scale);
+                x = ggml_add(ctx, x, ggml_p9ml_qat_graph_input(qg, ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, nr), noise, noise, NULL));
+            }
+            
+            ref = x;
+            if (pass->reference) {
+                ref = ggml_p9ml_qat_graph_input(qg, ggml_new_tensor_2d(ctx, pass->reference->type, ne0, nr), pass->reference->data, NULL, NULL);
+                if (ref->type != GGML_TYPE_F32) {
+                    ref = ggml_cast(ctx, ref, GGML_TYPE_F32);
+                }
+            }
+            
+            sum_src = ggml_sum(ctx, ggml_sqr(ctx, ref));
+            ggml_set_output(sum_src);
+            ggml_build_forward_expand(qg->graph, sum_src);
+        }
+        prev = job;
+        
+        int64_t n_row_scales = 0;
+        const float * cal_scales = ggml_p9ml_object_scales(job->membrane, job->slot, job->type, &n_row_scales);
+        const float * imatrix = ggml_p9ml_object_imatrix(job->membrane, job->slot);
+        
+        struct ggml_tensor * scales = NULL;
+        if (cal_scales) {
+            scales = ggml_p9ml_qat_graph_input(qg, ggml_new_tensor_2d(ctx, GGML_TYPE_F32, n_row_scales, nr), cal_scales, NULL, NULL);
+        }
+        struct ggml_tensor * im = NULL;
+        if (imatrix) {
+            im = ggml_p9ml_qat_graph_input(qg, ggml_new_tensor_1d(ctx, GGML_TYPE_F32, ne0), imatrix, NULL, NULL);
+        }
+        
+        struct ggml_tensor * fq  = ggml_fake_quant_ext(ctx, x, scales, im, job->type);
+        struct ggml_tensor * err = ggml_sqr(ctx, ggml_sub(ctx, ref, fq));
         
-        if (n_elements > 1000000) {
-            // Large tensors get more aggressive quantization
-            // In practice, this would use more sophisticated analysis
+        if (job->map) {
+            // [tile_cols, n_x, tile_rows, n_y] -> [tile_cols*tile_rows, n_x*n_y], the partial tiles are padded with zeros
+            const struct ggml_p9ml_tile_map * map = job->map;
+            err = ggml_pad(ctx, err, (int) (map->n_x*map->tile_cols - ne0), (int) (map->n_y*map->tile_rows - nr), 0, 0);
+            err = ggml_reshape_4d(ctx, err, map->tile_cols, map->n_x, map->tile_rows, map->n_y);
+            err = ggml_cont(ctx, ggml_permute(ctx, err, 0, 2, 1, 3));
+            err = ggml_sum_rows(ctx, ggml_reshape_2d(ctx, err, map->tile_cols*map->tile_rows, map->n_x*map->n_y));
         } else {
-            // Smaller tensors get higher precision
+            err = ggml_sum(ctx, err);
         }
+        ggml_set_output(err);
+        ggml_build_forward_expand(qg->graph, err);
         
-        // Use quality_threshold in analysis
-        (void)quality_threshold; // Avoid unused variable warning for now
+        job->out_err = err;
+        job->out_src = sum_src;
+        
+        // after the sums, x may be a view of the object
+        if (pass->write_back) {
+            ggml_build_forward_expand(qg->graph, ggml_cpy(ctx, fq, w));
+            if (staged) {
+                qg->staged[qg->n_staged] = w;
+                qg->targets[qg->n_staged] = object;
+                qg->n_staged++;
+            }
+        }
+    }
+    
+    for (int i = 0; i < ggml_graph_n_nodes(qg->graph) && !staged; i++) {
+        if (!ggml_backend_supports_op(backend, ggml_graph_node(qg->graph, i))) {
+            return 1;
+        }
     }
     
     return 0;
 }
 
-//
-// Membrane evolution (P-Systems computation)
-//
-
-int ggml_p9ml_membrane_evolve(struct ggml_p9ml_membrane * membrane) {
-    if (!membrane) {
-        return -1;
+// Build, allocate and start the graphs of the jobs, one per backend
+static int ggml_p9ml_qat_pass_launch(struct ggml_p9ml_qat_pass * pass, struct ggml_p9ml_namespace * ns, struct ggml_p9ml_qat_graph * graphs) {
+    for (int b = 0; b < ns->n_backends; b++) {
+        bool used = false;
+        for (int j = 0; j < pass->n_jobs && !used; j++) {
+            used = pass->jobs[j].backend_id == b;
+        }
+        if (!used) {
+            continue;
+        }
+        
+        struct ggml_p9ml_qat_graph * qg = &graphs[b];
+        int result = ggml_p9ml_qat_graph_build(pass, qg, b, ns->backends[b], false);
+        if (result > 0) {
+            // the objects go through a CPU backend of the namespace instead
+            ggml_backend_t cpu = NULL;
+            for (int c = 0; c < ns->n_backends && !cpu; c++) {
+                ggml_backend_dev_t dev = ggml_backend_get_device(ns->backends[c]);
+                cpu = dev && ggml_backend_dev_type(dev) == GGML_BACKEND_DEVICE_TYPE_CPU ? ns->backends[c] : NULL;
+            }
+            ggml_p9ml_qat_graph_free(qg);
+            result = cpu ? ggml_p9ml_qat_graph_build(pass, qg, b, cpu, true) : -1;
+        }
+        if (result != 0) {
+            GGML_LOG_WARN("%s: cannot fake-quantize the objects of backend %s\n", __func__, ggml_backend_name(ns->backends[b]));
+            return -1;
+        }
+        
+        qg->galloc = ggml_gallocr_new(ggml_backend_get_default_buffer_type(qg->backend));
+        if (!qg->galloc || !ggml_gallocr_alloc_graph(qg->galloc, qg->graph)) {
+            return -1;
+        }
+        
+        for (int i = 0; i < qg->n_inputs; i++) {
+            const struct ggml_p9ml_qat_input * input = &qg->inputs[i];
+            if (input->data) {
+                ggml_backend_tensor_set(input->tensor, input->data, 0, ggml_nbytes(input->tensor));
+            } else {
+                ggml_backend_tensor_copy(input->src, input->tensor);
+            }
+        }
+        
+        if (ggml_backend_graph_compute_async(qg->backend, qg->graph) != GGML_STATUS_SUCCESS) {
+            return -1;
+        }
+        qg->started = true;
     }
     
-    // P-Systems evolution step
-    // Apply rules to objects within the membrane
+    return 0;
+}
+
+// Wait for the graphs of the jobs and read their errors
+static int ggml_p9ml_qat_pass_finish(struct ggml_p9ml_qat_pass * pass, struct ggml_p9ml_namespace * ns, struct ggml_p9ml_qat_graph * graphs) {
+    int result = 0;
     
-    // For now, this is a placeholder that could implement:
-    // 1. Object transformation rules
-    // 2. Communication rules between membranes
-    // 3. Membrane division/creation rules
-    // 4. Object transport rules
+    for (int b = 0; b < ns->n_backends; b++) {
+        struct ggml_p9ml_qat_graph * qg = &graphs[b];
+        if (!qg->started) {
+            continue;
+        }
+        ggml_backend_synchronize(qg->backend);
+        for (int i = 0; i < qg->n_staged; i++) {
+            ggml_backend_tensor_copy(qg->staged[i], qg->targets[i]);
+        }
+    }
     
-    // Apply evolution to child membranes
-    for (int i = 0; i < membrane->num_children; i++) {
-        ggml_p9ml_membrane_evolve(membrane->children[i]);
+    for (int j = 0; j < pass->n_jobs && result == 0; j++) {
+        struct ggml_p9ml_qat_job * job = &pass->jobs[j];
+        if (!graphs[job->backend_id].started) {
+            result = -1;
+            break;
+        }
+        
+        float sum_src = 0.0f;
+        ggml_backend_tensor_get(job->out_src, &sum_src, 0, sizeof(float));
+        job->sq_src = sum_src;
+        
+        if (!job->map) {
+            float sum_err = 0.0f;
+            ggml_backend_tensor_get(job->out_err, &sum_err, 0, sizeof(float));
+            job->sq_err = sum_err;
+            continue;
+        }
+        
+        const struct ggml_p9ml_tile_map * map = job->map;
+        const struct ggml_tensor * object = job->membrane->objects[job->slot];
+        const int64_t n_tiles = map->n_x*map->n_y;
+        
+        float * sums = malloc(n_tiles*sizeof(float));
+        if (!sums) {
+            result = -1;
+            break;
+        }
+        ggml_backend_tensor_get(job->out_err, sums, 0, n_tiles*sizeof(float));
+        
+        job->sq_err = 0.0;
+        for (int64_t t = 0; t < n_tiles; t++) {
+            const int64_t nc = MIN(map->tile_cols, object->ne[0] - (t % map->n_x)*map->tile_cols);
+            const int64_t nr = MIN(map->tile_rows, ggml_nrows(object) - (t / map->n_x)*map->tile_rows);
+            map->rmse[t] = sqrtf(sums[t] / (float) (nc*nr));
+            job->sq_err += (double) sums[t];
+        }
+        free(sums);
     }
     
-    return 0;
+    return result;
 }
 
-//
-// Distributed computation
-//
-
-int ggml_p9ml_namespace_compute(
-    struct ggml_p9ml_namespace * ns,
-    struct ggml_cgraph * graph) {
+// Process all the chunks and reduce their errors per group (sq_err and sq_src may be NULL)
+static int ggml_p9ml_qat_pass_run(struct ggml_p9ml_qat_pass * pass, struct ggml_p9ml_namespace * ns, double * sq_err, double * sq_src) {
+    pass->run = ggml_p9ml_stats_begin(ns);
+    const int64_t t_start = pass->run ? ggml_time_us() : 0;
     
-    if (!ns || !graph) {
-        return -1;
+    // the backends process their objects while the host tasks run
+    struct ggml_p9ml_qat_graph * graphs = NULL;
+    int result = 0;
+    if (pass->n_jobs > 0) {
+        graphs = ns ? calloc(ns->n_backends, sizeof(struct ggml_p9ml_qat_graph)) : NULL;
+        result = graphs ? ggml_p9ml_qat_pass_launch(pass, ns, graphs) : -1;
     }
     
-    // Distributed computation across the namespace
-    // This would coordinate computation across all membranes
+    if (pass->n_chunks > 0 && result == 0) {
+        // the kernels of ggml-base are built for the baseline instruction set
+        void * proc = ggml_p9ml_cpu_proc_address(ns, "ggml_backend_cpu_vec_sq_err_f32");
+        memcpy(&pass->sq_err_f32, &proc, sizeof(proc));
+        
+        // src + deq (+ ref) floats, followed by the quantized rows
+        const size_t scratch_size = pass->scratch_size;
+        pass->scratch_size += (pass->reference ? 3 : 2)*pass->scratch_elements*sizeof(float);
+        
+        const int offsets[2] = { 0, pass->n_chunks };
+        int * nodes = ggml_p9ml_qat_pass_numa_nodes(pass, ns);
+        result = ggml_p9ml_run_tasks(ns, offsets, 1, nodes, ggml_p9ml_fake_quant_task, pass);
+        free(nodes);
+        
+        pass->scratch_size = scratch_size;
+    }
     
-    if (ns->backend) {
-        // Use the namespace's backend for computation
-        if (ggml_backend_graph_compute(ns->backend, graph) != GGML_STATUS_SUCCESS) {
+    if (graphs) {
+        if (ggml_p9ml_qat_pass_finish(pass, ns, graphs) != 0) {
+            result = -1;
+        }
+        for (int b = 0; b < ns->n_backends; b++) {
+            ggml_p9ml_qat_graph_free(&graphs[b]);
+        }
+        free(graphs);
+    }
+    if (result != 0) {
+        return result;
+    }
+    
+    if (pass->run) {
+        ggml_p9ml_stats_add_pass(ns, pass, t_start, ggml_time_us());
+    }
+    
+    for (int g = 0; g < pass->n_groups; g++) {
+        if (sq_err) {
+            sq_err[g] = 0.0;
+        }
+        if (sq_src) {
+            sq_src[g] = 0.0;
+        }
+    }
+    
+    for (int c = 0; c < pass->n_chunks; c++) {
+        const struct ggml_p9ml_qat_chunk * chunk = &pass->chunks[c];
+        if (chunk->sq_err < 0.0) {
             return -1;
         }
+        if (sq_err) {
+            sq_err[chunk->group] += chunk->sq_err;
+        }
+        if (sq_src) {
+            sq_src[chunk->group] += chunk->sq_src;
+        }
+    }
+    
+    for (int j = 0; j < pass->n_jobs; j++) {
+        const struct ggml_p9ml_qat_job * job = &pass->jobs[j];
+        if (sq_err) {
+            sq_err[job->group] += job->sq_err;
+        }
+        if (sq_src) {
+            sq_src[job->group] += job->sq_src;
+        }
     }
     
     return 0;
 }
 
-//
-// Utility functions
-//
+static struct ggml_p9ml_arena * ggml_p9ml_arena_new(void) {
+    struct ggml_p9ml_arena * arena = malloc(sizeof(struct ggml_p9ml_arena));
+    if (!arena) {
+        return NULL;
+    }
+    
+    arena->head = NULL;
+    arena->next_block_size = P9ML_ARENA_MIN_BLOCK_SIZE;
+    arena->total_size = 0;
+    
+    return arena;
+}
 
-void ggml_p9ml_print_membrane_stats(struct ggml_p9ml_membrane * membrane) {
-    if (!membrane) {
+static void ggml_p9ml_arena_free(struct ggml_p9ml_arena * arena) {
+    if (!arena) {
         return;
     }
     
-    printf("Membrane '%s' (Level %d):\n", membrane->name, membrane->level);
-    printf("  Objects: %d/%d\n", membrane->num_objects, membrane->max_objects);
-    printf("  Children: %d/%d\n", membrane->num_children, membrane->max_children);
-    printf("  Rules: %d/%d\n", membrane->num_rules, membrane->max_rules);
+    struct ggml_p9ml_arena_block * block = arena->head;
+    while (block) {
+        struct ggml_p9ml_arena_block * next = block->next;
+        free(block);
+        block = next;
+    }
     
-    if (membrane->qat_config) {
-        printf("  QAT: enabled (noise=%.3f, bits=%s)\n", 
-               (double)membrane->qat_config->noise_scale,
-               ggml_type_name(membrane->qat_config->target_type));
+    free(arena);
+}
+
+static void * ggml_p9ml_arena_alloc(struct ggml_p9ml_arena * arena, size_t size) {
+    const size_t header = GGML_PAD(sizeof(struct ggml_p9ml_arena_block), GGML_MEM_ALIGN);
+    
+    size = GGML_PAD(size, GGML_MEM_ALIGN);
+    
+    struct ggml_p9ml_arena_block * block = arena->head;
+    if (!block || block->used + size > block->size) {
+        const size_t block_size = MAX(arena->next_block_size, size);
+        
+        block = malloc(header + block_size);
+        if (!block) {
+            return NULL;
+        }
+        block->next = arena->head;
+        block->size = block_size;
+        block->used = 0;
+        
+        arena->head = block;
+        arena->total_size += block_size;
+        arena->next_block_size = MIN(2*arena->next_block_size, (size_t) P9ML_ARENA_MAX_BLOCK_SIZE);
     }
     
-    printf("\n");
+    void * ptr = (char *) block + header + block->used;
+    block->used += size;
+    
+    return ptr;
 }
 
-void ggml_p9ml_print_namespace_stats(struct ggml_p9ml_namespace * ns) {
-    if (!ns) {
-        return;
+static int ggml_p9ml_work_list_build(struct ggml_p9ml_membrane * root, struct ggml_p9ml_work_list * list) {
+    int max_membranes = 16;
+    int max_waves = 8;
+    
+    list->membranes    = malloc(max_membranes * sizeof(struct ggml_p9ml_membrane *));
+    list->wave_offsets = malloc((max_waves + 1) * sizeof(int));
+    list->n_membranes  = 0;
+    list->n_waves      = 0;
+    
+    if (!list->membranes || !list->wave_offsets) {
+        ggml_p9ml_work_list_free(list);
+        return -1;
     }
     
-    printf("Namespace '%s':\n", ns->name);
-    printf("  Total params: %zu\n", ns->total_params);
-    printf("  Quantized params: %zu\n", ns->quantized_params);
-    printf("  Compression ratio: %.2fx\n", (double)ns->compression_ratio);
-    printf("  Target bits: %d\n", ns->target_bits);
-    printf("  Mixed precision: %s\n", ns->mixed_precision ? "enabled" : "disabled");
-    printf("\n");
+    list->membranes[list->n_membranes++] = root;
+    list->wave_offsets[0] = 0;
+    
+    // Breadth-first: the list doubles as the queue, each wave is appended after the previous one
+    int begin = 0;
+    int end   = 1;
+    while (begin < end) {
+        for (int i = begin; i < end; i++) {
+            struct ggml_p9ml_membrane * membrane = list->membranes[i];
+            for (int c = 0; c < membrane->num_children; c++) {
+                if (!membrane->children[c]) {
+                    continue;
+                }
+                if (list->n_membranes == max_membranes) {
+                    max_membranes *= 2;
+                    struct ggml_p9ml_membrane ** membranes = realloc(list->membranes, max_membranes * sizeof(struct ggml_p9ml_membrane *));
+                    if (!membranes) {
+                        ggml_p9ml_work_list_free(list);
+                        return -1;
+                    }
+                    list->membranes = membranes;
+                }
+                list->membranes[list->n_membranes++] = membrane->children[c];
+            }
+        }
+        
+        if (list->n_waves == max_waves) {
+            max_waves *= 2;
+            int * wave_offsets = realloc(list->wave_offsets, (max_waves + 1) * sizeof(int));
+            if (!wave_offsets) {
+                ggml_p9ml_work_list_free(list);
+                return -1;
+            }
+            list->wave_offsets = wave_offsets;
+        }
+        list->wave_offsets[++list->n_waves] = end;
+        
+        begin = end;
+        end   = list->n_membranes;
+    }
+    
+    return 0;
 }
 
-//
-// Helper functions
-//
+static void ggml_p9ml_work_list_free(struct ggml_p9ml_work_list * list) {
+    free(list->membranes);
+    free(list->wave_offsets);
+    list->membranes    = NULL;
+    list->wave_offsets = NULL;
+    list->n_membranes  = 0;
+    list->n_waves      = 0;
+}
 
-static void ggml_p9ml_membrane_init_arrays(struct ggml_p9ml_membrane * membrane) {
-    membrane->children = malloc(membrane->max_children * sizeof(struct ggml_p9ml_membrane *));
-    membrane->objects = malloc(membrane->max_objects * sizeof(struct ggml_tensor *));
-    membrane->rules = malloc(membrane->max_rules * sizeof(void *));
+// Reload the evicted membranes of a work list, a pass is about to read their objects
+static int ggml_p9ml_work_list_reload(struct ggml_p9ml_work_list * list) {
+    struct ggml_p9ml_namespace * ns = list->n_membranes > 0 ? list->membranes[0]->ns : NULL;
+    if (!ns || !ns->spill_prefix) {
+        return 0;
+    }
     
-    // Initialize arrays to NULL
-    if (membrane->children) {
-        memset(membrane->children, 0, membrane->max_children * sizeof(struct ggml_p9ml_membrane *));
+    const uint64_t now = ++ns->clock;
+    for (int i = 0; i < list->n_membranes; i++) {
+        list->membranes[i]->last_use = now;
+        if (ggml_p9ml_membrane_reload(list->membranes[i]) != 0) {
+            return -1;
+        }
     }
-    if (membrane->objects) {
-        memset(membrane->objects, 0, membrane->max_objects * sizeof(struct ggml_tensor *));
+    
+    return 0;
+}
+
+static int ggml_p9ml_work_list_build_resident(struct ggml_p9ml_membrane * root, struct ggml_p9ml_work_list * list) {
+    if (ggml_p9ml_work_list_build(root, list) != 0) {
+        return -1;
     }
-    if (membrane->rules) {
-        memset(membrane->rules, 0, membrane->max_rules * sizeof(void *));
+    if (ggml_p9ml_work_list_reload(list) != 0) {
+        ggml_p9ml_work_list_free(list);
+        return -1;
     }
+    return 0;
 }
 
-static void ggml_p9ml_membrane_free_arrays(struct ggml_p9ml_membrane * membrane) {
-    if (membrane->children) {
-        free(membrane->children);
+// Function of the first CPU backend of the namespace (NULL if none): ggml-base cannot link against it
+static void * ggml_p9ml_cpu_proc_address(const struct ggml_p9ml_namespace * ns, const char * name) {
+    for (int b = 0; ns && b < ns->n_backends; b++) {
+        ggml_backend_dev_t dev = ggml_backend_get_device(ns->backends[b]);
+        if (dev && ggml_backend_dev_type(dev) == GGML_BACKEND_DEVICE_TYPE_CPU) {
+            return ggml_backend_reg_get_proc_address(ggml_backend_dev_backend_reg(dev), name);
+        }
     }
-    if (membrane->objects) {
-        free(membrane->objects);
+    return NULL;
+}
+
+static ggml_backend_t ggml_p9ml_cpu_backend(const struct ggml_p9ml_namespace * ns) {
+    if (!ns || !ns->backend) {
+        return NULL;
     }
-    if (membrane->rules) {
-        free(membrane->rules);
+    
+    // membrane passes operate on host memory, only the CPU backend can run them
+    ggml_backend_dev_t dev = ggml_backend_get_device(ns->backend);
+    if (!dev || ggml_backend_dev_type(dev) != GGML_BACKEND_DEVICE_TYPE_CPU) {
+        return NULL;
     }
+    
+    return ns->backend;
 }
 
-static float ggml_p9ml_generate_noise(float scale) {
-    // Simple pseudo-random noise generation
-    // In practice, this should use a proper random number generator
-    static unsigned int seed = 12345;
-    seed = seed * 1103515245 + 12345;
-    float normalized = (float)(seed & 0x7FFFFFFF) / (float)0x7FFFFFFF;
-    return (normalized - 0.5f) * 2.0f * scale;
+struct ggml_p9ml_task_queue {
+    int end;                                // one past the last entry of the queue
+    atomic_int next;                        // next entry to be picked up
+};
+
+struct ggml_p9ml_task_phase {
+    ggml_p9ml_task_t fun;
+    void * userdata;
+    const int * order;                      // task of each queue entry (NULL: the entries are the tasks)
+    ggml_p9ml_numa_thread_node_t thread_node; // node of a thread (NULL: one queue)
+    int n_nodes;
+    struct ggml_p9ml_task_queue queues[GGML_P9ML_NUMA_MAX_NODES + 1]; // one per node, then the unplaced tasks
+    atomic_int nth;                         // threads running the phase
+};
+
+// GGML_OP_CUSTOM kernel: every thread pulls tasks of the phase until none are left, from the queue of its node
+// first, then from the unplaced tasks and the queues of the other nodes
+static void ggml_p9ml_task_op(struct ggml_tensor * dst, int ith, int nth, void * userdata) {
+    struct ggml_p9ml_task_phase * phase = (struct ggml_p9ml_task_phase *) userdata;
+    
+    if (ith == 0) {
+        atomic_store(&phase->nth, nth);
+    }
+    
+    const int n_nodes = phase->n_nodes;
+    const int node = phase->thread_node ? phase->thread_node(ith) : -1;
+    const int own = node >= 0 && node < n_nodes ? node : n_nodes;
+    
+    int visit[GGML_P9ML_NUMA_MAX_NODES + 1];
+    int n_visit = 0;
+    visit[n_visit++] = own;
+    if (own != n_nodes) {
+        visit[n_visit++] = n_nodes;
+    }
+    for (int i = 0; i < n_nodes; i++) {
+        const int q = own == n_nodes ? i : (own + 1 + i) % n_nodes;
+        if (q != own) {
+            visit[n_visit++] = q;
+        }
+    }
+    
+    for (int v = 0; v < n_visit; v++) {
+        struct ggml_p9ml_task_queue * queue = &phase->queues[visit[v]];
+        for (int i = atomic_fetch_add(&queue->next, 1); i < queue->end; i = atomic_fetch_add(&queue->next, 1)) {
+            phase->fun(phase->order ? phase->order[i] : i, ith, phase->userdata);
+        }
+    }
+    
+    GGML_UNUSED(dst);
 }
 
-static void ggml_p9ml_propagate_namespace(struct ggml_p9ml_membrane * membrane, struct ggml_p9ml_namespace * ns) {
-    if (!membrane || !ns) {
-        return;
+// Run the tasks [phase_offsets[p], phase_offsets[p + 1]) of each phase on the namespace CPU backend
+// Each phase is a GGML_OP_CUSTOM node that depends on the previous one, so phases run in order
+// while the tasks of a phase are load-balanced over all the threads (and threadpool) of the backend
+// With task_nodes (NUMA node of each task, -1: unplaced), the threads bound to a node take its tasks first
+// Without a CPU backend, the tasks are run in order on the current thread
+static int ggml_p9ml_run_tasks(
+    struct ggml_p9ml_namespace * ns,
+    const int * phase_offsets,
+    int n_phases,
+    const int * task_nodes,
+    ggml_p9ml_task_t fun,
+    void * userdata) {
+    
+    ggml_backend_t backend = ggml_p9ml_cpu_backend(ns);
+    
+    if (!backend) {
+        for (int task = phase_offsets[0]; task < phase_offsets[n_phases]; task++) {
+            fun(task, 0, userdata);
+        }
+        if (ns && ns->stats) {
+            ns->stats->n_threads = 1;
+        }
+        return 0;
+    }
+    
+    ggml_p9ml_numa_thread_node_t thread_node = NULL;
+    const int n_nodes = task_nodes ? ggml_p9ml_numa_topology(ns, &thread_node) : 0;
+    
+    struct ggml_p9ml_task_phase * phases = malloc(n_phases * sizeof(struct ggml_p9ml_task_phase));
+    int * order = n_nodes > 0 ? malloc(MAX(phase_offsets[n_phases], 1) * sizeof(int)) : NULL;
+    if (!phases || (n_nodes > 0 && !order)) {
+        free(phases);
+        free(order);
+        return -1;
     }
     
-    membrane->ns = ns;
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ ggml_tensor_overhead()*n_phases + ggml_graph_overhead_custom(n_phases, false),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ true,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    if (!ctx) {
+        free(phases);
+        free(order);
+        return -1;
+    }
     
-    // Propagate to all children
-    for (int i = 0; i < membrane->num_children; i++) {
-        if (membrane->children[i]) {
-            ggml_p9ml_propagate_namespace(membrane->children[i], ns);
+    struct ggml_cgraph * gf = ggml_new_graph_custom(ctx, n_phases, false);
+    struct ggml_tensor * prev = NULL;
+    for (int p = 0; p < n_phases; p++) {
+        struct ggml_p9ml_task_phase * phase = &phases[p];
+        phase->fun         = fun;
+        phase->userdata    = userdata;
+        phase->order       = order;
+        phase->thread_node = order ? thread_node : NULL;
+        phase->n_nodes     = order ? n_nodes : 0;
+        atomic_store(&phase->nth, 0);
+        
+        if (order) {
+            // counting sort of the tasks of the phase by node, the unplaced ones last
+            int count[GGML_P9ML_NUMA_MAX_NODES + 1] = { 0 };
+            for (int task = phase_offsets[p]; task < phase_offsets[p + 1]; task++) {
+                const int q = task_nodes[task] >= 0 && task_nodes[task] < n_nodes ? task_nodes[task] : n_nodes;
+                count[q]++;
+            }
+            int begin = phase_offsets[p];
+            for (int q = 0; q <= n_nodes; q++) {
+                atomic_store(&phase->queues[q].next, begin);
+                begin += count[q];
+                phase->queues[q].end = atomic_load(&phase->queues[q].next);
+            }
+            for (int task = phase_offsets[p]; task < phase_offsets[p + 1]; task++) {
+                const int q = task_nodes[task] >= 0 && task_nodes[task] < n_nodes ? task_nodes[task] : n_nodes;
+                order[phase->queues[q].end++] = task;
+            }
+        } else {
+            phase->queues[0].end = phase_offsets[p + 1];
+            atomic_store(&phase->queues[0].next, phase_offsets[p]);
         }
+        
+        prev = ggml_custom_4d(ctx, GGML_TYPE_F32, 1, 1, 1, 1, &prev, prev ? 1 : 0, ggml_p9ml_task_op, GGML_N_TASKS_MAX, phase);
+        ggml_build_forward_expand(gf, prev);
+    }
+    
+    const enum ggml_status status = ggml_backend_graph_compute(backend, gf);
+    if (ns->stats) {
+        ns->stats->n_threads = atomic_load(&phases[0].nth);
     }
-}
\ No newline at end of file
+    
+    ggml_free(ctx);
+    free(phases);
+    free(order);
+    
+    return status == GGML_STATUS_SUCCESS ? 0 : -1;
+}
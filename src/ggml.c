@@ -984,9 +984,10 @@ static const char * GGML_OP_NAME[GGML_OP_COUNT] = {
     "CROSS_ENTROPY_LOSS",
     "CROSS_ENTROPY_LOSS_BACK",
     "OPT_STEP_ADAMW",
+    "FAKE_QUANT",
 };
 
-static_assert(GGML_OP_COUNT == 83, "GGML_OP_COUNT != 83");
+static_assert(GGML_OP_COUNT == 84, "GGML_OP_COUNT != 84");
 
 static const char * GGML_OP_SYMBOL[GGML_OP_COUNT] = {
     "none",
@@ -1080,9 +1081,10 @@ static const char * GGML_OP_SYMBOL[GGML_OP_COUNT] = {
     "cross_entropy_loss(x,y)",
     "cross_entropy_loss_back(x,y)",
     "adamw(x)",
+    "fake_quant(x)",
 };
 
-static_assert(GGML_OP_COUNT == 83, "GGML_OP_COUNT != 83");
+static_assert(GGML_OP_COUNT == 84, "GGML_OP_COUNT != 84");
 
 static_assert(GGML_OP_POOL_COUNT == 2, "GGML_OP_POOL_COUNT != 2");
 
@@ -5215,6 +5217,48 @@ struct ggml_tensor * ggml_opt_step_adamw(
     return result;
 }
 
+// ggml_fake_quant
+
+struct ggml_tensor * ggml_fake_quant(
+        struct ggml_context * ctx,
+        struct ggml_tensor  * a,
+        enum ggml_type        type) {
+    return ggml_fake_quant_ext(ctx, a, NULL, NULL, type);
+}
+
+struct ggml_tensor * ggml_fake_quant_ext(
+        struct ggml_context * ctx,
+        struct ggml_tensor  * a,
+        struct ggml_tensor  * scales,
+        struct ggml_tensor  * imatrix,
+        enum ggml_type        type) {
+    GGML_ASSERT(a->type == GGML_TYPE_F32);
+    GGML_ASSERT(type != GGML_TYPE_F32 && ggml_get_type_traits(type)->to_float != NULL);
+    GGML_ASSERT(a->ne[0] % ggml_blck_size(type) == 0);
+    GGML_ASSERT(imatrix || !ggml_quantize_requires_imatrix(type));
+
+    if (scales) {
+        GGML_ASSERT(scales->type == GGML_TYPE_F32);
+        GGML_ASSERT(ggml_is_contiguous(scales));
+        GGML_ASSERT(ggml_nelements(scales) == a->ne[1] || ggml_nelements(scales) == a->ne[1]*(a->ne[0]/ggml_blck_size(type)));
+    }
+    if (imatrix) {
+        GGML_ASSERT(imatrix->type == GGML_TYPE_F32);
+        GGML_ASSERT(ggml_is_contiguous(imatrix) && ggml_nelements(imatrix) == a->ne[0]);
+    }
+
+    struct ggml_tensor * result = ggml_dup_tensor(ctx, a);
+
+    ggml_set_op_params_i32(result, 0, (int32_t) type);
+
+    result->op     = GGML_OP_FAKE_QUANT;
+    result->src[0] = a;
+    result->src[1] = scales;
+    result->src[2] = imatrix;
+
+    return result;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 struct ggml_hash_set ggml_hash_set_new(size_t size) {
@@ -5800,6 +5844,12 @@ static void ggml_compute_backward(
             }
             GGML_ASSERT(!src1_needs_grads && "backward pass for labels not implemented");
         } break;
+        case GGML_OP_FAKE_QUANT: {
+            // straight-through estimator
+            if (src0_needs_grads) {
+                ggml_add_or_set(ctx, cgraph, isrc0, grad);
+            }
+        } break;
         case GGML_OP_NONE: {
             // noop
         } break;
@@ -5933,6 +5983,12 @@ void ggml_build_backward_expand(
                 ignore_src[1] = true;
                 break;
 
+            // gradients in node->src[1] and node->src[2] for one reason or another have no effect on output gradients
+            case GGML_OP_FAKE_QUANT:    // scales and importance matrix are constants
+                ignore_src[1] = true;
+                ignore_src[2] = true;
+                break;
+
             default:
                 break;
         }
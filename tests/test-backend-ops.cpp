@@ -3520,6 +3520,89 @@ struct test_opt_step_adamw : public test_case {
     }
 };
 
+// GGML_OP_FAKE_QUANT
+struct test_fake_quant : public test_case {
+    const ggml_type type;
+    const std::array<int64_t, 4> ne;
+    const bool scales;
+    const bool imatrix;
+
+    std::string vars() override {
+        return VARS_TO_STR4(type, ne, scales, imatrix);
+    }
+
+    test_fake_quant(ggml_type type = GGML_TYPE_Q4_0,
+            std::array<int64_t, 4> ne = {256, 16, 2, 1},
+            bool scales = false,
+            bool imatrix = false)
+        : type(type), ne(ne), scales(scales), imatrix(imatrix) {}
+
+    ggml_tensor * build_graph(ggml_context * ctx) override {
+        ggml_tensor * a = ggml_new_tensor_4d(ctx, GGML_TYPE_F32, ne[0], ne[1], ne[2], ne[3]);
+        ggml_set_name(a, "a");
+
+        if (grid_exact()) {
+            ggml_set_param(a);
+        }
+
+        ggml_tensor * s = nullptr;
+        if (scales) {
+            s = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, ne[1]);
+            ggml_set_name(s, "scales");
+        }
+
+        ggml_tensor * im = nullptr;
+        if (imatrix) {
+            im = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, ne[0]);
+            ggml_set_name(im, "imatrix");
+        }
+
+        ggml_tensor * out = ggml_fake_quant_ext(ctx, a, s, im, type);
+        ggml_set_name(out, "out");
+
+        return out;
+    }
+
+    // the gradient is checked where q(x) is x: values on the grid of a block scale that is a power of two, with
+    // steps of eps that stay on it (the numerical gradient of the other values is discarded by grad_expect)
+    bool grid_exact() {
+        return (type == GGML_TYPE_Q8_0 || type == GGML_TYPE_F16) && !imatrix;
+    }
+
+    void initialize_tensors(ggml_context * ctx) override {
+        for (ggml_tensor * t = ggml_get_first_tensor(ctx); t != NULL; t = ggml_get_next_tensor(ctx, t)) {
+            if (mode == MODE_GRAD && strcmp(t->name, "a") == 0) {
+                // multiples of 1/128, |x| <= 108/128 around a block absmax of 127/128: the Q8_0 scale is 1/128
+                std::vector<float> data(ggml_nelements(t));
+                for (size_t i = 0; i < data.size(); i++) {
+                    data[i] = i % 32 == 0 ? 127.0f/128 : (float) ((int) (i*37 % 201) - 100)/128;
+                }
+                ggml_backend_tensor_set(t, data.data(), 0, ggml_nbytes(t));
+            } else if (mode == MODE_GRAD) {
+                std::vector<float> data(ggml_nelements(t), 0.5f); // keeps the scaled values on the grid
+                ggml_backend_tensor_set(t, data.data(), 0, ggml_nbytes(t));
+            } else if (strcmp(t->name, "a") == 0) {
+                init_tensor_uniform(t, -1.0f, 1.0f);
+            } else {
+                init_tensor_uniform(t, 0.5f, 1.0f); // positive scales and importance
+            }
+        }
+    }
+
+    double max_nmse_err() override {
+        // backends may round ties differently
+        return 1e-4;
+    }
+
+    float grad_eps() override {
+        return 8.0f/128;
+    }
+
+    std::vector<float> grad_expect() override {
+        return {1.0f};
+    }
+};
+
 enum llm_norm_type {
     LLM_NORM,
     LLM_NORM_RMS,
@@ -4582,6 +4665,14 @@ static std::vector<std::unique_ptr<test_case>> make_test_cases_eval() {
 
     test_cases.emplace_back(new test_opt_step_adamw(GGML_TYPE_F32, {10, 5, 4, 3}));
 
+    for (ggml_type type : {GGML_TYPE_Q4_0, GGML_TYPE_Q8_0, GGML_TYPE_Q4_K, GGML_TYPE_Q6_K, GGML_TYPE_IQ4_NL, GGML_TYPE_F16}) {
+        for (bool scales : {false, true}) {
+            test_cases.emplace_back(new test_fake_quant(type, {256, 16, 2, 1}, scales, false));
+        }
+    }
+    test_cases.emplace_back(new test_fake_quant(GGML_TYPE_Q4_K,    {256, 16, 1, 1}, true,  true));
+    test_cases.emplace_back(new test_fake_quant(GGML_TYPE_IQ2_XXS, {256, 16, 1, 1}, false, true));
+
     // these tests are disabled to save execution time, but they can be handy for debugging
 #if 0
     test_cases.emplace_back(new test_llama(1));
@@ -0,0 +1,191 @@
+#include "ggml.h"
+#include "ggml-alloc.h"
+#include "ggml-backend.h"
+#include "ggml-cpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_EMBD    64
+#define N_HEAD    4
+#define N_VOCAB   16
+#define N_TOKENS  4
+#define N_THREADS 4
+#define N_REPS    20
+#define N_INPUTS  6
+
+// a small decoder-like block: independent projections followed by chains of cheap element-wise ops,
+// with in-place ops and copies into views of a shared tensor to exercise the dependency checks
+static struct ggml_tensor * build_graph(struct ggml_context * ctx, struct ggml_cgraph * gf, struct ggml_tensor ** inputs) {
+    struct ggml_tensor * tok = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, N_EMBD, N_VOCAB);
+    struct ggml_tensor * wq  = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, N_EMBD, N_EMBD);
+    struct ggml_tensor * wk  = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, N_EMBD, N_EMBD);
+    struct ggml_tensor * wv  = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, N_EMBD, N_EMBD);
+    struct ggml_tensor * ids = ggml_new_tensor_1d(ctx, GGML_TYPE_I32, N_TOKENS);
+    struct ggml_tensor * pos = ggml_new_tensor_1d(ctx, GGML_TYPE_I32, N_TOKENS);
+    ggml_set_input(ids);
+    ggml_set_input(pos);
+
+    inputs[0] = tok;
+    inputs[1] = wq;
+    inputs[2] = wk;
+    inputs[3] = wv;
+    inputs[4] = ids;
+    inputs[5] = pos;
+
+    struct ggml_tensor * x   = ggml_get_rows(ctx, tok, ids);
+    struct ggml_tensor * cur = ggml_rms_norm(ctx, x, 1e-6f);
+
+    struct ggml_tensor * q = ggml_mul_mat(ctx, wq, cur);
+    q = ggml_rope(ctx, ggml_reshape_3d(ctx, q, N_EMBD/N_HEAD, N_HEAD, N_TOKENS), pos, N_EMBD/N_HEAD, 0);
+    q = ggml_reshape_2d(ctx, q, N_EMBD, N_TOKENS);
+    struct ggml_tensor * k = ggml_mul_mat(ctx, wk, cur);
+    struct ggml_tensor * v = ggml_mul_mat(ctx, wv, cur);
+
+    struct ggml_tensor * qs = ggml_scale(ctx, q, 0.125f);
+    struct ggml_tensor * ks = ggml_silu(ctx, k);
+    struct ggml_tensor * vs = ggml_sqr(ctx, v);
+
+    struct ggml_tensor * qk = ggml_mul(ctx, qs, ks);
+    qk = ggml_add_inplace(ctx, qk, vs);
+    qk = ggml_soft_max(ctx, qk);
+
+    struct ggml_tensor * out = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, N_EMBD, 3*N_TOKENS);
+    ggml_set_output(out);
+
+    struct ggml_tensor * o0 = ggml_view_2d(ctx, out, N_EMBD, N_TOKENS, out->nb[1], 0);
+    struct ggml_tensor * o1 = ggml_view_2d(ctx, out, N_EMBD, N_TOKENS, out->nb[1], 1*N_TOKENS*out->nb[1]);
+    struct ggml_tensor * o2 = ggml_view_2d(ctx, out, N_EMBD, N_TOKENS, out->nb[1], 2*N_TOKENS*out->nb[1]);
+
+    ggml_build_forward_expand(gf, ggml_cpy(ctx, qk, o0));
+    ggml_build_forward_expand(gf, ggml_cpy(ctx, ggml_norm(ctx, ks, 1e-5f), o1));
+    ggml_build_forward_expand(gf, ggml_cpy(ctx, ggml_tanh(ctx, ggml_add(ctx, qs, vs)), o2));
+
+    // reads the whole output after the copies into it
+    ggml_build_forward_expand(gf, ggml_scale_inplace(ctx, out, 2.0f));
+
+    return out;
+}
+
+static void set_inputs(struct ggml_tensor ** inputs) {
+    for (int i = 0; i < N_INPUTS; i++) {
+        const int64_t n = ggml_nelements(inputs[i]);
+        void * data = malloc(ggml_nbytes(inputs[i]));
+        for (int64_t j = 0; j < n; j++) {
+            if (inputs[i]->type == GGML_TYPE_I32) {
+                ((int32_t *) data)[j] = (int32_t) ((j*7 + i) % N_VOCAB);
+            } else {
+                ((float *) data)[j] = (float) ((j*37 + i*11) % 101)/101.0f - 0.5f;
+            }
+        }
+        if (inputs[i]->buffer) {
+            ggml_backend_tensor_set(inputs[i], data, 0, ggml_nbytes(inputs[i]));
+        } else {
+            memcpy(inputs[i]->data, data, ggml_nbytes(inputs[i]));
+        }
+        free(data);
+    }
+}
+
+static void compute_ctx(float * result, int n_threads, bool use_dag) {
+    struct ggml_init_params params = {
+        .mem_size   = 16*1024*1024,
+        .mem_buffer = NULL,
+        .no_alloc   = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    struct ggml_cgraph  * gf  = ggml_new_graph(ctx);
+
+    struct ggml_tensor * inputs[N_INPUTS];
+    struct ggml_tensor * out = build_graph(ctx, gf, inputs);
+
+    set_inputs(inputs);
+    memset(out->data, 0, ggml_nbytes(out));
+
+    struct ggml_cplan cplan = ggml_graph_plan(gf, n_threads, NULL);
+    GGML_ASSERT(cplan.use_dag);
+    cplan.use_dag   = use_dag;
+    cplan.work_data = (uint8_t *) malloc(cplan.work_size);
+
+    GGML_ASSERT(ggml_graph_compute(gf, &cplan) == GGML_STATUS_SUCCESS);
+
+    memcpy(result, out->data, ggml_nbytes(out));
+
+    free(cplan.work_data);
+    ggml_free(ctx);
+}
+
+// same graph through the CPU backend: the graph allocator reuses memory between nodes
+static void compute_backend(float * result) {
+    struct ggml_init_params params = {
+        .mem_size   = ggml_tensor_overhead()*GGML_DEFAULT_GRAPH_SIZE + ggml_graph_overhead(),
+        .mem_buffer = NULL,
+        .no_alloc   = true,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    struct ggml_cgraph  * gf  = ggml_new_graph(ctx);
+
+    struct ggml_tensor * inputs[N_INPUTS];
+    struct ggml_tensor * out = build_graph(ctx, gf, inputs);
+
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    ggml_backend_cpu_set_n_threads(backend, N_THREADS);
+
+    ggml_gallocr_t galloc = ggml_gallocr_new(ggml_backend_get_default_buffer_type(backend));
+    GGML_ASSERT(ggml_gallocr_alloc_graph(galloc, gf));
+
+    set_inputs(inputs);
+    ggml_backend_tensor_memset(out, 0, 0, ggml_nbytes(out));
+
+    GGML_ASSERT(ggml_backend_graph_compute(backend, gf) == GGML_STATUS_SUCCESS);
+
+    ggml_backend_tensor_get(out, result, 0, ggml_nbytes(out));
+
+    ggml_gallocr_free(galloc);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+}
+
+static bool check(const char * name, const float * ref, const float * res, int n) {
+    for (int i = 0; i < n; i++) {
+        if (ref[i] != res[i]) {
+            printf("%s: mismatch at %d: %.9g != %.9g\n", name, i, ref[i], res[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    const int n = N_EMBD*3*N_TOKENS;
+
+    float * ref = (float *) malloc(n*sizeof(float));
+    float * res = (float *) malloc(n*sizeof(float));
+
+    // single thread: no barriers and no chunks to share
+    compute_ctx(ref, 1, false);
+
+    bool ok = true;
+    for (int rep = 0; rep < N_REPS && ok; rep++) {
+        compute_ctx(res, N_THREADS, false);
+        ok = check("chunks", ref, res, n);
+
+        if (ok) {
+            compute_ctx(res, N_THREADS, true);
+            ok = check("graph", ref, res, n);
+        }
+
+        if (ok) {
+            compute_backend(res);
+            ok = check("backend", ref, res, n);
+        }
+    }
+
+    free(ref);
+    free(res);
+
+    printf("%s: %s\n", __func__, ok ? "ok" : "FAILED");
+
+    return ok ? 0 : 1;
+}
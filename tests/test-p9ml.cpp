@@ -5,11 +5,18 @@
 #include "ggml.h"
 #include "ggml-cpu.h"
 
+#ifdef GGML_USE_RPC
+#include "ggml-rpc.h"
+#include <chrono>
+#include <thread>
+#endif
+
 #undef NDEBUG
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 // Test utilities
 static void test_membrane_creation(void);
@@ -17,6 +24,27 @@ static void test_namespace_management(void);
 static void test_data_free_qat(void);
 static void test_synthetic_data_generation(void);
 static void test_membrane_hierarchy(void);
+static void test_fake_quantization(void);
+static void test_membrane_traversal(void);
+static void test_noise_generation(void);
+static void test_namespace_arena(void);
+static void test_mixed_precision(void);
+static void test_forward_tiled_qat(void);
+static void test_evolution_rules(void);
+static void test_namespace_placement(void);
+static void test_namespace_shard(void);
+static void test_namespace_save_load(void);
+static void test_dirty_tracking(void);
+static void test_calibration(void);
+static void test_qat_train(void);
+static void test_fake_quant_op(void);
+static void test_memory_budget(void);
+static void test_namespace_find(void);
+static void test_zero_copy_rules(void);
+static void test_cow_division(void);
+static void test_stats(void);
+static void test_batched_executor(void);
+static void test_numa_placement(void);
 
 int main(void) {
     printf("Testing P9-ML Membrane Computing System\n");
@@ -38,6 +66,27 @@ int main(void) {
     test_data_free_qat();
     test_synthetic_data_generation();
     test_membrane_hierarchy();
+    test_fake_quantization();
+    test_membrane_traversal();
+    test_noise_generation();
+    test_namespace_arena();
+    test_mixed_precision();
+    test_forward_tiled_qat();
+    test_evolution_rules();
+    test_namespace_placement();
+    test_namespace_shard();
+    test_namespace_save_load();
+    test_dirty_tracking();
+    test_calibration();
+    test_qat_train();
+    test_fake_quant_op();
+    test_memory_budget();
+    test_namespace_find();
+    test_zero_copy_rules();
+    test_cow_division();
+    test_stats();
+    test_batched_executor();
+    test_numa_placement(); // initializes NUMA for the rest of the process
     
     // Cleanup
     ggml_free(ctx);
@@ -191,6 +240,10 @@ static void test_data_free_qat(void) {
         // In a real implementation, we'd use a proper PRNG
     }
     
+    // Every quantizable object should report its quantization error
+    assert(membrane->object_errors[0] > 0.0f && membrane->object_errors[0] < 0.1f);
+    assert(membrane->object_errors[1] > 0.0f && membrane->object_errors[1] < 0.1f);
+    
     printf("  QAT config: type=%s, noise=%.3f, per_channel=%s\n",
            ggml_type_name(config->target_type), 
            config->noise_scale,
@@ -204,6 +257,32 @@ static void test_data_free_qat(void) {
     result = ggml_p9ml_mixed_precision_quantize(membrane, 0.95f);
     assert(result == 0);
     
+    // The noise of an object does not depend on the membrane the pass starts from, nor on the membranes before it
+    config->noise_scale = 0.05f;
+    struct ggml_tensor * w[2];
+    struct ggml_p9ml_membrane * roots[2];
+    for (int k = 0; k < 2; k++) {
+        roots[k] = ggml_p9ml_membrane_new("model", 0, ctx);
+        if (k == 0) {
+            struct ggml_p9ml_membrane * other = ggml_p9ml_membrane_new("other", 1, ctx);
+            ggml_p9ml_membrane_add_child(roots[k], other);
+            ggml_p9ml_membrane_add_object(other, ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 64, 4));
+            memset(other->objects[0]->data, 0, ggml_nbytes(other->objects[0]));
+        }
+        struct ggml_p9ml_membrane * blk = ggml_p9ml_membrane_new("blk", 1, ctx);
+        ggml_p9ml_membrane_add_child(roots[k], blk);
+        w[k] = ggml_set_name(ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 64, 8), "w");
+        for (int64_t i = 0; i < ggml_nelements(w[k]); i++) {
+            ((float *) w[k]->data)[i] = 0.01f*(float) (i % 37);
+        }
+        ggml_p9ml_membrane_add_object(blk, w[k]);
+    }
+    assert(ggml_p9ml_apply_data_free_qat(roots[0], config) == 0);
+    assert(ggml_p9ml_apply_data_free_qat(roots[1]->children[0], config) == 0);
+    assert(memcmp(w[0]->data, w[1]->data, ggml_nbytes(w[0])) == 0);
+    ggml_p9ml_membrane_free(roots[0]);
+    ggml_p9ml_membrane_free(roots[1]);
+    
     // Cleanup
     ggml_p9ml_qat_config_free(config); // Free the original config
     ggml_p9ml_membrane_free(membrane); // This will free the copied config
@@ -256,6 +335,16 @@ static void test_synthetic_data_generation(void) {
     printf("  Generated 2D tensor: shape=[%ld,%ld], elements=%zu\n", 
            (long)tensor2d->ne[0], (long)tensor2d->ne[1], ggml_nelements(tensor2d));
     
+    // The data only depends on the contents of the context
+    struct ggml_context * ctx2 = ggml_init(params);
+    assert(ctx2 != NULL);
+    struct ggml_tensor * again1d = ggml_p9ml_generate_synthetic_data(ctx2, shape1d, 1, 1.0f);
+    struct ggml_tensor * again2d = ggml_p9ml_generate_synthetic_data(ctx2, shape2d, 2, 0.5f);
+    assert(memcmp(again1d->data, tensor1d->data, ggml_nbytes(tensor1d)) == 0);
+    assert(memcmp(again2d->data, tensor2d->data, ggml_nbytes(tensor2d)) == 0);
+    assert(memcmp(tensor2d->data, tensor1d->data, ggml_nbytes(tensor1d)) != 0);
+    ggml_free(ctx2);
+    
     // Cleanup
     ggml_free(ctx);
     
@@ -316,4 +405,2098 @@ static void test_membrane_hierarchy(void) {
     ggml_free(ctx);
     
     printf("✓ Membrane hierarchy test passed\n\n");
-}
\ No newline at end of file
+}
+
+static void test_fake_quantization(void) {
+    printf("Testing fake quantization...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 4 * 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    const int64_t ne0 = 256;
+    const int64_t ne1 = 64;
+    
+    // Same weights, quantized serially (no namespace) and on a multi-threaded CPU backend
+    struct ggml_tensor * w_serial   = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, ne1);
+    struct ggml_tensor * w_threaded = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, ne1);
+    struct ggml_tensor * w_f16      = ggml_new_tensor_2d(ctx, GGML_TYPE_F16, ne0, ne1);
+    struct ggml_tensor * w_odd      = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 100);
+    // the same name in membranes of the same name: the same noise stream
+    ggml_set_name(w_serial, "w");
+    ggml_set_name(w_threaded, "w");
+    ggml_set_name(w_f16, "w_f16");
+    
+    float * d_serial   = (float *)w_serial->data;
+    float * d_threaded = (float *)w_threaded->data;
+    ggml_fp16_t * d_f16 = (ggml_fp16_t *)w_f16->data;
+    for (int64_t i = 0; i < ne0*ne1; i++) {
+        const float v = sinf(0.01f*(float)i) * (1.0f + (float)(i % 7));
+        d_serial[i] = v;
+        d_threaded[i] = v;
+        d_f16[i] = ggml_fp32_to_fp16(v);
+    }
+    
+    // With noise: the counter-based generator must give the same result on any number of threads
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_K, 0.05f);
+    
+    struct ggml_p9ml_membrane * serial = ggml_p9ml_membrane_new("fake_quant", 0, ctx);
+    ggml_p9ml_membrane_add_object(serial, w_serial);
+    ggml_p9ml_membrane_add_object(serial, w_odd); // row size not a multiple of QK_K
+    assert(ggml_p9ml_apply_data_free_qat(serial, config) == 0);
+    assert(serial->object_errors[0] > 0.0f);
+    assert(serial->object_errors[1] < 0.0f); // skipped
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    assert(backend != NULL);
+    struct ggml_threadpool_params tpp = ggml_threadpool_params_default(4);
+    struct ggml_threadpool * threadpool = ggml_threadpool_new(&tpp);
+    assert(threadpool != NULL);
+    
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("fake_quant", backend);
+    assert(ggml_p9ml_namespace_set_threadpool(ns, threadpool) == 0);
+    
+    struct ggml_p9ml_membrane * threaded = ggml_p9ml_membrane_new("fake_quant", 0, ctx);
+    ggml_p9ml_membrane_add_object(threaded, w_threaded);
+    ggml_p9ml_membrane_add_object(threaded, w_f16);
+    ggml_p9ml_namespace_set_root(ns, threaded);
+    assert(ggml_p9ml_apply_data_free_qat(threaded, config) == 0);
+    
+    // Row chunking must not change the result
+    for (int64_t i = 0; i < ne0*ne1; i++) {
+        assert(d_serial[i] == d_threaded[i]);
+    }
+    assert(fabsf(serial->object_errors[0] - threaded->object_errors[0]) < 1e-6f);
+    assert(threaded->object_errors[1] > 0.0f && threaded->object_errors[1] < 0.5f);
+    
+    // Q4_K values should be (nearly) a fixed point of a second round-trip
+    const float first_rmse = threaded->object_errors[0];
+    const float first_rmse_f16 = threaded->object_errors[1];
+    config->noise_scale = 0.0f;
+    assert(ggml_p9ml_apply_data_free_qat(threaded, config) == 0);
+    assert(threaded->object_errors[0] < first_rmse);
+    
+    printf("  Q4_K rmse: f32=%.6f f16=%.6f\n",
+           (double)first_rmse, (double)first_rmse_f16);
+    
+    // Types that need an importance matrix are rejected
+    struct ggml_p9ml_qat_config * iq_config = ggml_p9ml_qat_config_new(GGML_TYPE_IQ2_XXS, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(serial, iq_config) != 0);
+    
+    // Cleanup
+    ggml_p9ml_qat_config_free(iq_config);
+    ggml_p9ml_qat_config_free(config);
+    ggml_p9ml_membrane_free(serial);
+    ggml_p9ml_membrane_free(threaded);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_threadpool_free(threadpool);
+    ggml_free(ctx);
+    
+    printf("✓ Fake quantization test passed\n\n");
+}
+
+static void test_membrane_traversal(void) {
+    printf("Testing membrane traversal...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 8 * 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    assert(backend != NULL);
+    ggml_backend_cpu_set_n_threads(backend, 4);
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("traversal", backend);
+    
+    // Deep chain: would overflow the stack with a recursive traversal
+    const int depth = 20000;
+    struct ggml_p9ml_membrane * root = ggml_p9ml_membrane_new("layer", 0, ctx);
+    struct ggml_p9ml_membrane * tail = root;
+    for (int i = 1; i < depth; i++) {
+        struct ggml_p9ml_membrane * next = ggml_p9ml_membrane_new("layer", i, ctx);
+        assert(ggml_p9ml_membrane_add_child(tail, next) == 0);
+        tail = next;
+    }
+    
+    // Wide level of siblings with one object each under the last layer
+    const int width = 12;
+    struct ggml_tensor * weights[12];
+    for (int i = 0; i < width; i++) {
+        struct ggml_p9ml_membrane * sibling = ggml_p9ml_membrane_new("sibling", depth, ctx);
+        weights[i] = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 64, 32);
+        float * data = (float *)weights[i]->data;
+        for (int64_t j = 0; j < ggml_nelements(weights[i]); j++) {
+            data[j] = cosf(0.1f*(float)(i*j));
+        }
+        ggml_p9ml_membrane_add_object(sibling, weights[i]);
+        assert(ggml_p9ml_membrane_add_child(tail, sibling) == 0);
+    }
+    
+    assert(ggml_p9ml_namespace_set_root(ns, root) == 0);
+    assert(tail->ns == ns);
+    assert(tail->children[width - 1]->ns == ns);
+    
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q8_0, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(root, config) == 0);
+    for (int i = 0; i < width; i++) {
+        const float rmse = tail->children[i]->object_errors[0];
+        assert(rmse >= 0.0f && rmse < 0.01f);
+        assert(tail->children[i]->qat_config != NULL);
+    }
+    
+    printf("  Traversed %d membranes (depth %d, width %d)\n", depth + width, depth, width);
+    
+    // Cleanup
+    ggml_p9ml_qat_config_free(config);
+    ggml_p9ml_membrane_free(root);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Membrane traversal test passed\n\n");
+}
+
+static void test_noise_generation(void) {
+    printf("Testing noise generation...\n");
+    
+    const int64_t n = 10007;
+    float * full    = (float *)malloc(n * sizeof(float));
+    float * chunked = (float *)malloc(n * sizeof(float));
+    float * other   = (float *)malloc(n * sizeof(float));
+    
+    // Gaussian: statistics and independence from the chunking
+    ggml_p9ml_noise_fill(full, n, 3, 1234, 5, GGML_P9ML_NOISE_GAUSSIAN, 2.0f);
+    for (int64_t i = 0; i < n; ) {
+        const int64_t count = i + 37 < n ? 37 : n - i;
+        ggml_p9ml_noise_fill(chunked + i, count, 3 + i, 1234, 5, GGML_P9ML_NOISE_GAUSSIAN, 2.0f);
+        i += count;
+    }
+    assert(memcmp(full, chunked, n * sizeof(float)) == 0);
+    
+    double mean = 0.0;
+    double var  = 0.0;
+    for (int64_t i = 0; i < n; i++) {
+        mean += full[i];
+        var  += (double)full[i] * full[i];
+    }
+    mean /= n;
+    var = var / n - mean * mean;
+    assert(fabs(mean) < 0.1);
+    assert(fabs(sqrt(var) - 2.0) < 0.1);
+    
+    // Different streams are different
+    ggml_p9ml_noise_fill(other, n, 3, 1234, 6, GGML_P9ML_NOISE_GAUSSIAN, 2.0f);
+    assert(memcmp(full, other, n * sizeof(float)) != 0);
+    
+    // Uniform: bounds
+    ggml_p9ml_noise_fill(full, n, 0, 1234, 5, GGML_P9ML_NOISE_UNIFORM, 0.5f);
+    float vmin = full[0];
+    float vmax = full[0];
+    for (int64_t i = 0; i < n; i++) {
+        vmin = full[i] < vmin ? full[i] : vmin;
+        vmax = full[i] > vmax ? full[i] : vmax;
+    }
+    assert(vmin >= -0.5f && vmin < -0.45f);
+    assert(vmax <   0.5f && vmax >  0.45f);
+    
+    printf("  Gaussian: mean=%.4f std=%.4f, uniform: [%.4f, %.4f]\n", mean, sqrt(var), (double)vmin, (double)vmax);
+    
+    free(full);
+    free(chunked);
+    free(other);
+    
+    printf("✓ Noise generation test passed\n\n");
+}
+
+static void test_namespace_arena(void) {
+    printf("Testing namespace arena...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024 + 1000 * ggml_tensor_overhead(),
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("arena", backend);
+    
+    // Tens of thousands of membranes, no per-membrane malloc
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    assert(root != NULL);
+    assert(root->ns == ns);
+    assert(root->arena == ns->arena);
+    
+    const int n_layers = 500;
+    const int n_heads  = 64;
+    for (int l = 0; l < n_layers; l++) {
+        struct ggml_p9ml_membrane * layer = ggml_p9ml_namespace_membrane_new(ns, "layer", 1, ctx);
+        assert(ggml_p9ml_membrane_add_child(root, layer) == 0);
+        for (int h = 0; h < n_heads; h++) {
+            struct ggml_p9ml_membrane * head = ggml_p9ml_namespace_membrane_new(ns, "head", 2, ctx);
+            assert(ggml_p9ml_membrane_add_child(layer, head) == 0);
+        }
+        assert(layer->num_children == n_heads);
+    }
+    assert(root->num_children == n_layers);
+    assert(root->children[n_layers - 1]->children[n_heads - 1]->parent == root->children[n_layers - 1]);
+    
+    // Object tables grow past the former fixed capacity
+    const int n_objects = 1000;
+    struct ggml_p9ml_membrane * big = root->children[0];
+    for (int i = 0; i < n_objects; i++) {
+        struct ggml_tensor * t = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 32);
+        ggml_set_f32(t, (float)i);
+        assert(ggml_p9ml_membrane_add_object(big, t) == 0);
+    }
+    assert(big->num_objects == n_objects);
+    assert(big->max_objects >= n_objects);
+    assert(ggml_get_f32_1d(big->objects[n_objects - 1], 0) == (float)(n_objects - 1));
+    
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q8_0, 0.0f);
+    assert(ggml_p9ml_namespace_set_root(ns, root) == 0);
+    assert(ggml_p9ml_apply_data_free_qat(root, config) == 0);
+    assert(big->object_errors[n_objects - 1] >= 0.0f);
+    
+    // Heap-allocated membranes grow the same way
+    struct ggml_p9ml_membrane * heap = ggml_p9ml_membrane_new("heap", 0, ctx);
+    for (int i = 0; i < n_objects; i++) {
+        assert(ggml_p9ml_membrane_add_object(heap, big->objects[i]) == 0);
+    }
+    for (int i = 0; i < 100; i++) {
+        assert(ggml_p9ml_membrane_add_child(heap, ggml_p9ml_membrane_new("child", 1, ctx)) == 0);
+    }
+    assert(heap->objects[n_objects - 1] == big->objects[n_objects - 1]);
+    ggml_p9ml_membrane_free(heap);
+    
+    printf("  Created %d arena membranes\n", 1 + n_layers * (1 + n_heads));
+    
+    // Cleanup: arena membranes are released with the namespace
+    ggml_p9ml_qat_config_free(config);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Namespace arena test passed\n\n");
+}
+
+// Relative error of the mixed-precision assignment, recomputed from the per-object RMSE
+static double mixed_precision_error(struct ggml_p9ml_membrane * membrane) {
+    double sq_err = 0.0;
+    double sq_src = 0.0;
+    for (int i = 0; i < membrane->num_objects; i++) {
+        const struct ggml_tensor * t = membrane->objects[i];
+        const float * x = (const float *) t->data;
+        for (int64_t j = 0; j < ggml_nelements(t); j++) {
+            sq_src += (double) x[j] * x[j];
+        }
+        if (membrane->object_errors[i] >= 0.0f) {
+            sq_err += (double) membrane->object_errors[i] * membrane->object_errors[i] * ggml_nelements(t);
+        }
+    }
+    return sq_err / sq_src;
+}
+
+static void test_mixed_precision(void) {
+    printf("Testing mixed-precision search...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 4 * 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("mixed", backend);
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    
+    // Objects with different sensitivities to quantization
+    struct ggml_tensor * gauss = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 256, 64);
+    struct ggml_tensor * unif  = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 256, 32);
+    struct ggml_tensor * spiky = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 512, 16);
+    struct ggml_tensor * odd   = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 100);
+    ggml_p9ml_noise_fill((float *) gauss->data, ggml_nelements(gauss), 0, 1, 0, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    ggml_p9ml_noise_fill((float *) unif->data,  ggml_nelements(unif),  0, 1, 1, GGML_P9ML_NOISE_UNIFORM,  1.0f);
+    ggml_p9ml_noise_fill((float *) spiky->data, ggml_nelements(spiky), 0, 1, 2, GGML_P9ML_NOISE_GAUSSIAN, 0.1f);
+    ggml_p9ml_noise_fill((float *) odd->data,   ggml_nelements(odd),   0, 1, 3, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    for (int64_t j = 0; j < ggml_nelements(spiky); j += 97) {
+        ((float *) spiky->data)[j] = 25.0f;
+    }
+    assert(ggml_p9ml_membrane_add_object(root, gauss) == 0);
+    assert(ggml_p9ml_membrane_add_object(root, unif) == 0);
+    assert(ggml_p9ml_membrane_add_object(root, spiky) == 0);
+    assert(ggml_p9ml_membrane_add_object(root, odd) == 0);
+    assert(ggml_p9ml_namespace_set_root(ns, root) == 0);
+    
+    const float first = ggml_get_f32_1d(gauss, 0);
+    
+    // No error allowed: everything stays F32
+    assert(ggml_p9ml_mixed_precision_quantize(root, 0.0f) == 0);
+    for (int i = 0; i < root->num_objects; i++) {
+        assert(root->object_types[i] == GGML_TYPE_F32);
+    }
+    assert(ns->quantized_params == 0);
+    assert(fabsf(ns->compression_ratio - 1.0f) < 1e-6f);
+    
+    // Tighter thresholds never give a smaller model and always respect the error budget
+    const float thresholds[] = { 1e-5f, 1e-4f, 1e-3f, 1e-2f, 1e-1f };
+    float prev_ratio = 1.0f;
+    for (size_t t = 0; t < sizeof(thresholds)/sizeof(thresholds[0]); t++) {
+        assert(ggml_p9ml_mixed_precision_quantize(root, thresholds[t]) == 0);
+        const double err = mixed_precision_error(root);
+        printf("  threshold=%g: error=%.3g ratio=%.2f types=%s/%s/%s/%s\n",
+               (double) thresholds[t], err, (double) ns->compression_ratio,
+               ggml_type_name(root->object_types[0]), ggml_type_name(root->object_types[1]),
+               ggml_type_name(root->object_types[2]), ggml_type_name(root->object_types[3]));
+        assert(err <= thresholds[t]);
+        assert(ns->compression_ratio >= prev_ratio);
+        prev_ratio = ns->compression_ratio;
+    }
+    assert(ns->mixed_precision);
+    assert(ns->total_params == (size_t) (ggml_nelements(gauss) + ggml_nelements(unif) + ggml_nelements(spiky) + ggml_nelements(odd)));
+    assert(ns->quantized_params > 0);
+    assert(prev_ratio > 4.0f);
+    
+    // 100 columns only fit F16 among the candidates
+    assert(root->object_types[3] == GGML_TYPE_F32 || root->object_types[3] == GGML_TYPE_F16);
+    
+    // The search does not modify the tensors
+    assert(ggml_get_f32_1d(gauss, 0) == first);
+    
+    ggml_p9ml_print_membrane_stats(root);
+    
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Mixed-precision search test passed\n\n");
+}
+
+// RMSE of a tile of w round-tripped through type, against ref
+static float tile_rmse(const struct ggml_tensor * w, const float * ref, enum ggml_type type, int64_t ir0, int64_t ir1, int64_t ic0, int64_t ic1) {
+    const int64_t ne0 = w->ne[0];
+    float * deq = (float *) malloc(ne0 * sizeof(float));
+    void  * q   = malloc(ggml_row_size(type, ne0));
+    double sum = 0.0;
+    for (int64_t ir = ir0; ir < ir1; ir++) {
+        const float * row = (const float *) w->data + ir*ne0;
+        ggml_quantize_chunk(type, row, q, 0, 1, ne0, NULL);
+        ggml_get_type_traits(type)->to_float(q, deq, ne0);
+        for (int64_t ic = ic0; ic < ic1; ic++) {
+            const double d = (double) ref[ir*ne0 + ic] - deq[ic];
+            sum += d*d;
+        }
+    }
+    free(q);
+    free(deq);
+    return (float) sqrt(sum / (double) ((ir1 - ir0)*(ic1 - ic0)));
+}
+
+static void test_forward_tiled_qat(void) {
+    printf("Testing forward tiled QAT...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 4 * 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    const int64_t ne0 = 1024;
+    const int64_t ne1 = 48;
+    
+    struct ggml_tensor * w   = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, ne1);
+    struct ggml_tensor * ref = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, ne1);
+    ggml_set_name(w, "w");
+    ggml_p9ml_noise_fill((float *) w->data, ne0*ne1, 0, 7, 0, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    float * wd = (float *) w->data;
+    float * rd = (float *) ref->data;
+    for (int64_t i = 0; i < ne0*ne1; i++) {
+        rd[i] = wd[i] * (1.0f + 0.01f*(float)(i % 5));
+    }
+    const float first = wd[123];
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    ggml_backend_cpu_set_n_threads(backend, 4);
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("tiled", backend);
+    struct ggml_p9ml_membrane * membrane = ggml_p9ml_namespace_membrane_new(ns, "tiled", 0, ctx);
+    ggml_p9ml_membrane_add_object(membrane, w);
+    ggml_p9ml_namespace_set_root(ns, membrane);
+    
+    // Default cache-sized tiles: full rows
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_0, 0.0f);
+    assert(ggml_p9ml_forward_tiled_qat(membrane, config, NULL) == 0);
+    const struct ggml_p9ml_tile_map * map = &membrane->tile_maps[0];
+    assert(map->tile_cols == ne0);
+    assert(map->n_x == 1 && map->n_y * map->tile_rows >= ne1);
+    for (int64_t y = 0; y < map->n_y; y++) {
+        const int64_t ir1 = y*map->tile_rows + map->tile_rows < ne1 ? y*map->tile_rows + map->tile_rows : ne1;
+        const float expected = tile_rmse(w, wd, GGML_TYPE_Q4_0, y*map->tile_rows, ir1, 0, ne0);
+        assert(fabsf(map->rmse[y] - expected) <= 1e-4f*expected);
+    }
+    
+    // Small tiles split the rows on Q4_K block boundaries
+    config->target_type = GGML_TYPE_Q4_K;
+    config->tile_size = 300;
+    assert(ggml_p9ml_forward_tiled_qat(membrane, config, NULL) == 0);
+    assert(map->tile_cols == 256 && map->tile_rows == 1);
+    assert(map->n_x == 4 && map->n_y == ne1);
+    double sum = 0.0;
+    for (int64_t t = 0; t < map->n_x*map->n_y; t++) {
+        const int64_t y = t / map->n_x;
+        const int64_t x = t % map->n_x;
+        const float expected = tile_rmse(w, wd, GGML_TYPE_Q4_K, y, y + 1, x*256, x*256 + 256);
+        assert(fabsf(map->rmse[t] - expected) <= 1e-4f*expected);
+        sum += (double) map->rmse[t] * map->rmse[t];
+    }
+    assert(fabs(membrane->object_errors[0] - sqrt(sum / (double) (map->n_x*map->n_y))) < 1e-5);
+    
+    // Against an FP reference
+    assert(ggml_p9ml_forward_tiled_qat(membrane, config, ref) == 0);
+    assert(fabsf(map->rmse[5] - tile_rmse(w, rd, GGML_TYPE_Q4_K, 1, 2, 256, 512)) <= 1e-4f*map->rmse[5]);
+    
+    ggml_p9ml_print_membrane_stats(membrane);
+    
+    // The objects are not modified, a reference of another shape is rejected
+    assert(wd[123] == first);
+    struct ggml_tensor * bad = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, ne1 - 1);
+    assert(ggml_p9ml_forward_tiled_qat(membrane, config, bad) != 0);
+    
+    // Objects of another shape than the reference are skipped
+    struct ggml_tensor * other = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 256, 4);
+    ggml_set_name(other, "other");
+    ggml_p9ml_noise_fill((float *) other->data, ggml_nelements(other), 0, 7, 1, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    struct ggml_p9ml_membrane * child = ggml_p9ml_namespace_membrane_new(ns, "child", 1, ctx);
+    ggml_p9ml_membrane_add_object(child, other);
+    ggml_p9ml_membrane_add_child(membrane, child);
+    assert(ggml_p9ml_forward_tiled_qat(membrane, config, ref) == 0);
+    assert(fabsf(map->rmse[5] - tile_rmse(w, rd, GGML_TYPE_Q4_K, 1, 2, 256, 512)) <= 1e-4f*map->rmse[5]);
+    assert(child->object_errors[0] < 0.0f && child->tile_maps[0].n_x == 0);
+    assert(ggml_p9ml_forward_tiled_qat(membrane, config, NULL) == 0);
+    assert(child->object_errors[0] > 0.0f && child->tile_maps[0].n_x == 1);
+    
+    ggml_p9ml_qat_config_free(config);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Forward tiled QAT test passed\n\n");
+}
+
+static struct ggml_tensor * rule_double(struct ggml_context * ctx, struct ggml_p9ml_membrane * membrane, struct ggml_tensor * object, void * userdata) {
+    (void) membrane;
+    (void) userdata;
+    return ggml_scale(ctx, object, 2.0f);
+}
+
+// object + membrane->objects[0]
+static struct ggml_tensor * rule_add_first(struct ggml_context * ctx, struct ggml_p9ml_membrane * membrane, struct ggml_tensor * object, void * userdata) {
+    (void) userdata;
+    return ggml_add(ctx, object, membrane->objects[0]);
+}
+
+static struct ggml_tensor * new_filled_rows(struct ggml_context * ctx, int64_t ne0, int64_t nrows, float base, float step) {
+    struct ggml_tensor * t = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, nrows);
+    for (int64_t i = 0; i < ne0*nrows; i++) {
+        ((float *) t->data)[i] = base + step*(float)i;
+    }
+    return t;
+}
+
+static struct ggml_tensor * new_filled(struct ggml_context * ctx, int64_t n, float base, float step) {
+    return new_filled_rows(ctx, n/4, 4, base, step);
+}
+
+static void test_evolution_rules(void) {
+    printf("Testing evolution rules...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    ggml_backend_cpu_set_n_threads(backend, 4);
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("rules", backend);
+    
+    const int64_t n = 32;
+    
+    // Transform and communicate: every rule reads the state at the start of the step
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    struct ggml_p9ml_membrane * a    = ggml_p9ml_namespace_membrane_new(ns, "a", 1, ctx);
+    struct ggml_p9ml_membrane * b    = ggml_p9ml_namespace_membrane_new(ns, "b", 1, ctx);
+    ggml_p9ml_membrane_add_child(root, a);
+    ggml_p9ml_membrane_add_child(root, b);
+    
+    struct ggml_tensor * r0 = new_filled(ctx, n, 1.0f, 0.0f);
+    struct ggml_tensor * a0 = new_filled(ctx, n, 0.0f, 1.0f);
+    struct ggml_tensor * a1 = new_filled(ctx, n, 0.0f, 0.0f);
+    struct ggml_tensor * b0 = new_filled(ctx, n, 0.0f, 0.0f);
+    ggml_p9ml_membrane_add_object(root, r0);
+    ggml_p9ml_membrane_add_object(a, a0);
+    ggml_p9ml_membrane_add_object(a, a1);
+    ggml_p9ml_membrane_add_object(b, b0);
+    
+    assert(ggml_p9ml_membrane_add_rule(a, ggml_p9ml_rule_transform(0, rule_double, NULL)) == 0);
+    assert(ggml_p9ml_membrane_add_rule(a, ggml_p9ml_rule_transform(1, rule_add_first, NULL)) == 0);
+    assert(ggml_p9ml_membrane_add_rule(a, ggml_p9ml_rule_communicate(0, -1, 0)) == 0);   // out to the parent
+    assert(ggml_p9ml_membrane_add_rule(root, ggml_p9ml_rule_communicate(0, 1, 0)) == 0); // in to b
+    assert(ggml_p9ml_membrane_add_rule(a, ggml_p9ml_rule_transform(0, NULL, NULL)) != 0);
+    assert(a->num_rules == 3);
+    
+    // Rules need a namespace backend to run on
+    struct ggml_p9ml_membrane * lone = ggml_p9ml_membrane_new("lone", 0, ctx);
+    ggml_p9ml_membrane_add_object(lone, a1);
+    ggml_p9ml_membrane_add_rule(lone, ggml_p9ml_rule_transform(0, rule_double, NULL));
+    assert(ggml_p9ml_membrane_evolve(lone) != 0);
+    ggml_p9ml_membrane_free(lone);
+    
+    ggml_p9ml_namespace_set_root(ns, root);
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    for (int64_t i = 0; i < n; i++) {
+        assert(ggml_get_f32_1d(a0, i) == 2.0f*(float)i);
+        assert(ggml_get_f32_1d(a1, i) == (float)i);
+        assert(ggml_get_f32_1d(r0, i) == (float)i);
+        assert(ggml_get_f32_1d(b0, i) == 1.0f);
+    }
+    
+    // Divide and dissolve
+    struct ggml_p9ml_membrane * c = ggml_p9ml_namespace_membrane_new(ns, "c", 1, ctx);
+    struct ggml_p9ml_membrane * d = ggml_p9ml_namespace_membrane_new(ns, "d", 2, ctx);
+    ggml_p9ml_membrane_add_child(root, c);
+    ggml_p9ml_membrane_add_child(c, d);
+    struct ggml_tensor * c0 = new_filled(ctx, n, 5.0f, 0.0f);
+    ggml_p9ml_membrane_add_object(c, c0);
+    
+    assert(ggml_p9ml_membrane_add_rule(b, ggml_p9ml_rule_transform(0, rule_double, NULL)) == 0);
+    assert(ggml_p9ml_membrane_add_rule(b, ggml_p9ml_rule_divide()) == 0);
+    assert(ggml_p9ml_membrane_add_rule(c, ggml_p9ml_rule_dissolve()) == 0);
+    
+    // b0 receives r0 = i and doubles it, the copy of b gets the value at the start of the step
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    assert(root->num_children == 4);
+    assert(root->children[0] == a && root->children[1] == b && root->children[3] == d);
+    assert(d->parent == root);
+    
+    struct ggml_p9ml_membrane * b_copy = root->children[2];
+    assert(strcmp(b_copy->name, "b") == 0);
+    assert(b_copy->parent == root && b_copy->ns == ns);
+    assert(b_copy->num_objects == 1 && b_copy->objects[0] != b0);
+    assert(b->num_rules == 1 && b_copy->num_rules == 1);
+    assert(root->num_objects == 2 && root->objects[1] == c0);
+    for (int64_t i = 0; i < n; i++) {
+        assert(ggml_get_f32_1d(b0, i) == 2.0f);
+        assert(ggml_get_f32_1d(b_copy->objects[0], i) == 1.0f);
+    }
+    
+    // The copy evolves with the rules of the original
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    assert(root->num_children == 4);
+    for (int64_t i = 0; i < n; i++) {
+        assert(ggml_get_f32_1d(b_copy->objects[0], i) == 2.0f);
+    }
+    
+    ggml_p9ml_print_membrane_stats(root);
+    
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Evolution rules test passed\n\n");
+}
+
+static void test_namespace_placement(void) {
+    printf("Testing namespace placement...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    // Two CPU backends standing in for two devices / NUMA nodes
+    ggml_backend_t cpu0 = ggml_backend_cpu_init();
+    ggml_backend_t cpu1 = ggml_backend_cpu_init();
+    ggml_backend_cpu_set_n_threads(cpu0, 2);
+    ggml_backend_cpu_set_n_threads(cpu1, 2);
+    
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("placement", cpu0);
+    assert(ns->n_backends == 1);
+    assert(ggml_p9ml_namespace_add_backend(ns, cpu1) == 1);
+    
+    struct ggml_p9ml_membrane * root  = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    struct ggml_p9ml_membrane * left  = ggml_p9ml_namespace_membrane_new(ns, "left", 1, ctx);
+    struct ggml_p9ml_membrane * right = ggml_p9ml_namespace_membrane_new(ns, "right", 1, ctx);
+    struct ggml_p9ml_membrane * inner = ggml_p9ml_namespace_membrane_new(ns, "inner", 2, ctx);
+    ggml_p9ml_membrane_add_child(root, left);
+    ggml_p9ml_membrane_add_child(root, right);
+    ggml_p9ml_membrane_add_child(right, inner);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    assert(ggml_p9ml_membrane_set_backend(left, 0) == 0);
+    assert(ggml_p9ml_membrane_set_backend(right, 1) == 0);
+    assert(ggml_p9ml_membrane_set_backend(right, 2) != 0);
+    
+    const int64_t n = 64;
+    struct ggml_tensor * x = new_filled(ctx, n, 1.0f, 1.0f);
+    struct ggml_tensor * y = new_filled(ctx, n, 0.5f, 0.0f);
+    struct ggml_tensor * z = new_filled(ctx, n, 3.0f, 0.0f);
+    ggml_p9ml_membrane_add_object(left, x);
+    ggml_p9ml_membrane_add_object(right, y);
+    ggml_p9ml_membrane_add_object(inner, z); // inherits the placement of right
+    
+    struct ggml_init_params graph_params = {
+        .mem_size = 64 * ggml_tensor_overhead() + ggml_graph_overhead(),
+        .mem_buffer = NULL,
+        .no_alloc = true,
+    };
+    struct ggml_context * gctx = ggml_init(graph_params);
+    struct ggml_tensor * lx  = ggml_scale(gctx, x, 2.0f);
+    struct ggml_tensor * ry  = ggml_mul(gctx, y, z);
+    struct ggml_tensor * out = ggml_add(gctx, lx, ry);
+    struct ggml_cgraph * graph = ggml_new_graph(gctx);
+    ggml_build_forward_expand(graph, out);
+    
+    assert(ggml_p9ml_namespace_compute(ns, graph) == 0);
+    
+    assert(ggml_backend_sched_get_tensor_backend(ns->sched, x)  == cpu0);
+    assert(ggml_backend_sched_get_tensor_backend(ns->sched, lx) == cpu0);
+    assert(ggml_backend_sched_get_tensor_backend(ns->sched, z)  == cpu1);
+    assert(ggml_backend_sched_get_tensor_backend(ns->sched, ry) == cpu1);
+    assert(ggml_backend_sched_get_n_splits(ns->sched) >= 2);
+    
+    for (int64_t i = 0; i < n; i++) {
+        const float expected = 2.0f*(1.0f + (float)i) + 1.5f;
+        assert(fabsf(((float *) out->data)[i] - expected) < 1e-6f);
+    }
+    
+    printf("  %d splits over %d backends\n", ggml_backend_sched_get_n_splits(ns->sched), ns->n_backends);
+    ggml_p9ml_print_namespace_stats(ns);
+    
+    ggml_free(gctx);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(cpu1);
+    ggml_backend_free(cpu0);
+    ggml_free(ctx);
+    
+    printf("✓ Namespace placement test passed\n\n");
+}
+
+static void test_namespace_shard(void) {
+    printf("Testing namespace sharding...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t cpu0 = ggml_backend_cpu_init();
+    ggml_backend_t cpu1 = ggml_backend_cpu_init();
+    
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("shard", cpu0);
+    assert(ggml_p9ml_namespace_add_backend(ns, cpu1) == 1);
+    
+    // Subtrees of 96, 64, 48 and 32 elements
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    struct ggml_p9ml_membrane * parts[4];
+    const int64_t sizes[4] = { 48, 96, 32, 64 };
+    for (int i = 0; i < 4; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "part%d", i);
+        parts[i] = ggml_p9ml_namespace_membrane_new(ns, name, 1, ctx);
+        ggml_p9ml_membrane_add_object(parts[i], new_filled(ctx, sizes[i], (float) i, 1.0f));
+        ggml_p9ml_membrane_add_child(root, parts[i]);
+    }
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    const int ids[2] = { 0, 1 };
+    assert(ggml_p9ml_namespace_shard(ns, ids, 0) != 0);
+    assert(ggml_p9ml_namespace_shard(ns, ids, 2) == 0);
+    
+    // 96 -> 0, 64 -> 1, 48 -> 1, 32 -> 0: 128 elements each
+    assert(parts[1]->backend_id == 0);
+    assert(parts[3]->backend_id == 1);
+    assert(parts[0]->backend_id == 1);
+    assert(parts[2]->backend_id == 0);
+    
+    // Host backends use the objects in place
+    assert(ns->n_shards == 0);
+    
+    ggml_p9ml_namespace_free(ns);
+    
+#ifdef GGML_USE_RPC
+    {
+        const char * endpoint = "127.0.0.1:50152";
+        ggml_backend_t server = ggml_backend_cpu_init();
+        std::thread([server, endpoint]() {
+            ggml_backend_rpc_start_server(server, endpoint, NULL, 1 << 30, 1 << 30);
+        }).detach();
+        
+        ggml_backend_t remote = NULL;
+        for (int attempt = 0; attempt < 50 && !remote; attempt++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            remote = ggml_backend_rpc_init(endpoint);
+        }
+        assert(remote != NULL);
+        
+        // The remote backend first, the CPU backend last
+        struct ggml_p9ml_namespace * rns = ggml_p9ml_namespace_new("rpc", remote);
+        assert(ggml_p9ml_namespace_add_backend(rns, cpu1) == 1);
+        
+        struct ggml_p9ml_membrane * rroot  = ggml_p9ml_namespace_membrane_new(rns, "root", 0, ctx);
+        struct ggml_p9ml_membrane * far    = ggml_p9ml_namespace_membrane_new(rns, "far", 1, ctx);
+        struct ggml_p9ml_membrane * near   = ggml_p9ml_namespace_membrane_new(rns, "near", 1, ctx);
+        ggml_p9ml_membrane_add_child(rroot, far);
+        ggml_p9ml_membrane_add_child(rroot, near);
+        ggml_p9ml_namespace_set_root(rns, rroot);
+        
+        const int64_t n = 64;
+        struct ggml_tensor * x = new_filled_rows(ctx, 32, 2, 1.0f, 1.0f);
+        struct ggml_tensor * y = new_filled_rows(ctx, 32, 2, 0.5f, 0.0f);
+        ggml_p9ml_membrane_add_object(far, x);
+        ggml_p9ml_membrane_add_object(near, y);
+        ggml_p9ml_membrane_set_backend(far, 0);
+        ggml_p9ml_membrane_set_backend(near, 1);
+        
+        assert(ggml_p9ml_namespace_upload(rns) == 0);
+        assert(rns->n_shards == 1);
+        struct ggml_tensor * rx = far->objects[0];
+        assert(rx != x && rx->buffer && !ggml_backend_buffer_is_host(rx->buffer));
+        assert(near->objects[0] == y);
+        
+        // Remote objects are fake-quantized on their backend, like the same data on the host
+        struct ggml_p9ml_membrane * local = ggml_p9ml_membrane_new("local", 1, ctx);
+        struct ggml_tensor * hx = new_filled_rows(ctx, 32, 2, 1.0f, 1.0f);
+        ggml_p9ml_membrane_add_object(local, hx);
+        
+        struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_0, 0.0f);
+        config->tile_size = 32;
+        assert(ggml_p9ml_apply_data_free_qat(far, config) == 0);
+        assert(ggml_p9ml_apply_data_free_qat(local, config) == 0);
+        
+        float fq[64];
+        ggml_backend_tensor_get(rx, fq, 0, sizeof(fq));
+        for (int64_t i = 0; i < n; i++) {
+            assert(fq[i] == ((float *) hx->data)[i]);
+        }
+        assert(far->object_errors[0] > 0.0f);
+        assert(fabsf(far->object_errors[0] - local->object_errors[0]) < 1e-4f*local->object_errors[0]);
+        
+        // Per-tile errors against the original values
+        struct ggml_tensor * ref = new_filled_rows(ctx, 32, 2, 1.0f, 1.0f);
+        config->target_type = GGML_TYPE_Q8_0;
+        config->use_reference = true;
+        assert(ggml_p9ml_forward_tiled_qat(far, config, ref) == 0);
+        assert(ggml_p9ml_forward_tiled_qat(local, config, ref) == 0);
+        assert(far->tile_maps[0].n_x == 1 && far->tile_maps[0].n_y == 2);
+        for (int t = 0; t < 2; t++) {
+            assert(far->tile_maps[0].rmse[t] > 0.0f);
+            assert(fabsf(far->tile_maps[0].rmse[t] - local->tile_maps[0].rmse[t]) < 1e-4f*local->tile_maps[0].rmse[t]);
+        }
+        ggml_p9ml_qat_config_free(config);
+        
+        assert(ggml_p9ml_mixed_precision_quantize(far, 0.01f) == 0);
+        assert(ggml_p9ml_mixed_precision_quantize(local, 0.01f) == 0);
+        assert(far->object_types[0] == local->object_types[0]);
+        assert(far->object_types[0] != GGML_TYPE_F32);
+        ggml_p9ml_membrane_free(local);
+        
+        struct ggml_init_params graph_params = {
+            .mem_size = 16 * ggml_tensor_overhead() + ggml_graph_overhead(),
+            .mem_buffer = NULL,
+            .no_alloc = true,
+        };
+        struct ggml_context * gctx = ggml_init(graph_params);
+        struct ggml_tensor * out = ggml_add(gctx, ggml_scale(gctx, rx, 2.0f), y);
+        struct ggml_cgraph * graph = ggml_new_graph(gctx);
+        ggml_build_forward_expand(graph, out);
+        
+        assert(ggml_p9ml_namespace_compute(rns, graph) == 0);
+        
+        float result[64];
+        ggml_backend_tensor_get(out, result, 0, sizeof(result));
+        for (int64_t i = 0; i < n; i++) {
+            assert(fabsf(result[i] - (2.0f*fq[i] + 0.5f)) < 1e-6f);
+        }
+        printf("  %d splits over the RPC and CPU backends\n", ggml_backend_sched_get_n_splits(rns->sched));
+        
+        ggml_free(gctx);
+        ggml_p9ml_namespace_free(rns);
+        ggml_backend_free(remote);
+    }
+#endif
+    
+    ggml_backend_free(cpu1);
+    ggml_backend_free(cpu0);
+    ggml_free(ctx);
+    
+    printf("✓ Namespace sharding test passed\n\n");
+}
+
+static void test_namespace_save_load(void) {
+    printf("Testing namespace save/load...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("saved", backend);
+    ns->seed = 1234;
+    ns->target_bits = 4;
+    
+    struct ggml_p9ml_membrane * root  = ggml_p9ml_namespace_membrane_new(ns, "model", 0, ctx);
+    struct ggml_p9ml_membrane * attn  = ggml_p9ml_namespace_membrane_new(ns, "attn", 1, ctx);
+    struct ggml_p9ml_membrane * ffn   = ggml_p9ml_namespace_membrane_new(ns, "ffn", 1, ctx);
+    struct ggml_p9ml_membrane * inner = ggml_p9ml_namespace_membrane_new(ns, "inner", 2, ctx);
+    ggml_p9ml_membrane_add_child(root, attn);
+    ggml_p9ml_membrane_add_child(root, ffn);
+    ggml_p9ml_membrane_add_child(ffn, inner);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    struct ggml_tensor * wq = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 64, 8);
+    struct ggml_tensor * w1 = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 32, 4);
+    struct ggml_tensor * b1 = ggml_new_tensor_1d(ctx, GGML_TYPE_F16, 32);
+    ggml_set_name(wq, "attn.wq");
+    ggml_set_name(w1, "ffn.w1");
+    ggml_set_name(b1, "ffn.b1");
+    for (int64_t i = 0; i < ggml_nelements(wq); i++) {
+        ((float *) wq->data)[i] = sinf(0.1f*(float) i);
+    }
+    for (int64_t i = 0; i < ggml_nelements(w1); i++) {
+        ((float *) w1->data)[i] = 0.01f*(float) i;
+    }
+    for (int64_t i = 0; i < ggml_nelements(b1); i++) {
+        ((ggml_fp16_t *) b1->data)[i] = ggml_fp32_to_fp16((float) i);
+    }
+    ggml_p9ml_membrane_add_object(attn, wq);
+    ggml_p9ml_membrane_add_object(ffn, w1);
+    ggml_p9ml_membrane_add_object(inner, b1);
+    ggml_p9ml_membrane_set_backend(ffn, 0);
+    
+    // wq is stored quantized
+    attn->object_types[0] = GGML_TYPE_Q8_0;
+    attn->object_errors[0] = 0.5f;
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_K, 0.25f);
+    config->tile_size = 512;
+    ffn->qat_config = config; // arena membranes do not own it
+    
+    const char * fname = "test-p9ml-namespace.gguf";
+    assert(ggml_p9ml_namespace_save(ns, fname) == 0);
+    assert(ggml_p9ml_namespace_load("missing-p9ml-namespace.gguf", backend) == NULL);
+    
+    struct ggml_p9ml_namespace * loaded = ggml_p9ml_namespace_load(fname, backend);
+    assert(loaded != NULL);
+    assert(strcmp(loaded->name, "saved") == 0);
+    assert(loaded->seed == 1234);
+    assert(loaded->target_bits == 4);
+    
+    struct ggml_p9ml_membrane * lroot = loaded->root;
+    assert(strcmp(lroot->name, "model") == 0 && lroot->num_children == 2);
+    struct ggml_p9ml_membrane * lattn = lroot->children[0];
+    struct ggml_p9ml_membrane * lffn  = lroot->children[1];
+    assert(strcmp(lattn->name, "attn") == 0 && lattn->level == 1 && lattn->parent == lroot);
+    assert(strcmp(lffn->name, "ffn") == 0 && lffn->backend_id == 0 && lffn->num_children == 1);
+    struct ggml_p9ml_membrane * linner = lffn->children[0];
+    assert(strcmp(linner->name, "inner") == 0 && linner->level == 2 && linner->backend_id == -1);
+    
+    assert(lattn->qat_config == NULL);
+    assert(lffn->qat_config != NULL);
+    assert(lffn->qat_config->target_type == GGML_TYPE_Q4_K);
+    assert(lffn->qat_config->noise_scale == 0.25f);
+    assert(lffn->qat_config->tile_size == 512);
+    
+    // Objects are mapped from the file, in the chosen type
+    struct ggml_tensor * lwq = lattn->objects[0];
+    struct ggml_tensor * lw1 = lffn->objects[0];
+    struct ggml_tensor * lb1 = linner->objects[0];
+    assert(strcmp(lwq->name, "attn.wq") == 0 && lwq->type == GGML_TYPE_Q8_0);
+    assert(lwq->ne[0] == 64 && lwq->ne[1] == 8);
+    assert(lattn->object_types[0] == GGML_TYPE_Q8_0 && lattn->object_errors[0] == 0.5f);
+    assert(lwq->buffer && ggml_backend_buffer_is_host(lwq->buffer));
+    assert(lw1->type == GGML_TYPE_F32 && memcmp(lw1->data, w1->data, ggml_nbytes(w1)) == 0);
+    assert(lb1->type == GGML_TYPE_F16 && memcmp(lb1->data, b1->data, ggml_nbytes(b1)) == 0);
+    
+    float deq[64*8];
+    ggml_get_type_traits(GGML_TYPE_Q8_0)->to_float(lwq->data, deq, ggml_nelements(lwq));
+    for (int64_t i = 0; i < ggml_nelements(wq); i++) {
+        assert(fabsf(deq[i] - ((float *) wq->data)[i]) < 1e-2f);
+    }
+    
+    // The mapping is copy-on-write
+    ((float *) lw1->data)[0] = 42.0f;
+    struct ggml_p9ml_namespace * reloaded = ggml_p9ml_namespace_load(fname, backend);
+    assert(((float *) reloaded->root->children[1]->objects[0]->data)[0] == 0.0f);
+    ggml_p9ml_namespace_free(reloaded);
+    
+    // Mapped objects can be used in graphs
+    struct ggml_init_params graph_params = {
+        .mem_size = 16 * ggml_tensor_overhead() + ggml_graph_overhead(),
+        .mem_buffer = NULL,
+        .no_alloc = true,
+    };
+    struct ggml_context * gctx = ggml_init(graph_params);
+    struct ggml_tensor * out = ggml_scale(gctx, lw1, 2.0f);
+    struct ggml_cgraph * graph = ggml_new_graph(gctx);
+    ggml_build_forward_expand(graph, out);
+    ggml_gallocr_t galloc = ggml_gallocr_new(ggml_backend_get_default_buffer_type(backend));
+    assert(ggml_gallocr_alloc_graph(galloc, graph));
+    assert(ggml_p9ml_namespace_compute(loaded, graph) == 0);
+    assert(((float *) out->data)[0] == 84.0f);
+    assert(((float *) out->data)[1] == 0.02f);
+    
+    ggml_p9ml_print_namespace_stats(loaded);
+    
+    ggml_gallocr_free(galloc);
+    ggml_free(gctx);
+    ggml_p9ml_namespace_free(loaded);
+    ggml_p9ml_namespace_free(ns);
+    ggml_p9ml_qat_config_free(config);
+    remove(fname);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Namespace save/load test passed\n\n");
+}
+
+static void test_dirty_tracking(void) {
+    printf("Testing dirty tracking...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("dirty", backend);
+    
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    struct ggml_p9ml_membrane * a    = ggml_p9ml_namespace_membrane_new(ns, "a", 1, ctx);
+    struct ggml_p9ml_membrane * b    = ggml_p9ml_namespace_membrane_new(ns, "b", 1, ctx);
+    ggml_p9ml_namespace_set_root(ns, root);
+    ggml_p9ml_membrane_add_child(root, a);
+    ggml_p9ml_membrane_add_child(root, b);
+    
+    struct ggml_tensor * wa = new_filled(ctx, 1024, 0.1f, 0.013f);
+    struct ggml_tensor * wb = new_filled(ctx, 1024, -0.7f, 0.021f);
+    ggml_p9ml_membrane_add_object(a, wa);
+    ggml_p9ml_membrane_add_object(b, wb);
+    
+    // New objects are dirty, up to the root
+    assert(a->dirty == GGML_P9ML_DIRTY_ALL && root->dirty == GGML_P9ML_DIRTY_ALL);
+    
+    struct ggml_p9ml_qat_config * q8 = ggml_p9ml_qat_config_new(GGML_TYPE_Q8_0, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(root, q8) == 0);
+    assert(a->object_errors[0] >= 0.0f && b->object_errors[0] >= 0.0f);
+    assert((root->dirty & GGML_P9ML_DIRTY_QAT) == 0 && (b->dirty & GGML_P9ML_DIRTY_QAT) == 0);
+    assert(a->object_states[0].version == 2); // written back
+    
+    // Unmodified objects are skipped
+    a->object_errors[0] = -5.0f;
+    b->object_errors[0] = -5.0f;
+    ((float *) wb->data)[0] = 0.123456f;
+    assert(ggml_p9ml_apply_data_free_qat(root, q8) == 0);
+    assert(a->object_errors[0] == -5.0f && b->object_errors[0] == -5.0f);
+    assert(((float *) wb->data)[0] == 0.123456f);
+    
+    // Only the touched object is processed again
+    assert(ggml_p9ml_membrane_touch(b, 0) == 0);
+    assert(ggml_p9ml_membrane_touch(b, 1) != 0);
+    assert((b->dirty & GGML_P9ML_DIRTY_QAT) && (root->dirty & GGML_P9ML_DIRTY_QAT) && !(a->dirty & GGML_P9ML_DIRTY_QAT));
+    assert(ggml_p9ml_apply_data_free_qat(root, q8) == 0);
+    assert(a->object_errors[0] == -5.0f && b->object_errors[0] >= 0.0f);
+    assert(((float *) wb->data)[0] != 0.123456f);
+    
+    // Other settings process everything
+    struct ggml_p9ml_qat_config * q4 = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_0, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(root, q4) == 0);
+    assert(a->object_errors[0] >= 0.0f);
+    
+    // Mixed precision reuses the errors measured on unmodified objects
+    assert(ggml_p9ml_mixed_precision_quantize(root, 0.01f) == 0);
+    assert(a->object_states[0].mp_version == a->object_states[0].version);
+    assert((root->dirty & GGML_P9ML_DIRTY_MIXED) == 0);
+    const double cached = a->object_states[0].mp_sq_src;
+    const float error_a = a->object_errors[0];
+    for (int64_t i = 0; i < ggml_nelements(wa); i++) {
+        ((float *) wa->data)[i] *= 2.0f;
+    }
+    assert(ggml_p9ml_mixed_precision_quantize(root, 0.01f) == 0);
+    assert(a->object_states[0].mp_sq_src == cached && a->object_errors[0] == error_a);
+    ggml_p9ml_membrane_touch(a, -1);
+    assert(ggml_p9ml_mixed_precision_quantize(root, 0.01f) == 0);
+    assert(fabs(a->object_states[0].mp_sq_src - 4.0*cached) < 1e-3*cached);
+    
+    // Objects written by evolution rules are modified
+    const uint64_t version = a->object_states[0].version;
+    ggml_p9ml_membrane_add_rule(a, ggml_p9ml_rule_transform(0, rule_double, NULL));
+    assert(ggml_p9ml_apply_data_free_qat(root, q4) == 0);
+    assert(!(root->dirty & GGML_P9ML_DIRTY_QAT) && a->dirty == GGML_P9ML_DIRTY_MIXED);
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    assert(a->object_states[0].version > version + 1);
+    assert(a->dirty == GGML_P9ML_DIRTY_ALL && root->dirty == GGML_P9ML_DIRTY_ALL && b->dirty == 0);
+    
+    ggml_p9ml_qat_config_free(q4);
+    ggml_p9ml_qat_config_free(q8);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Dirty tracking test passed\n\n");
+}
+
+static void test_calibration(void) {
+    printf("Testing calibration...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("calibration", backend);
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    // Two chained layers: 256 -> 64 -> 32
+    struct ggml_tensor * w1 = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 256, 64);
+    struct ggml_tensor * w2 = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 64, 32);
+    ggml_p9ml_noise_fill((float *) w1->data, ggml_nelements(w1), 0, 7, 1, GGML_P9ML_NOISE_GAUSSIAN, 0.05f);
+    ggml_p9ml_noise_fill((float *) w2->data, ggml_nelements(w2), 0, 7, 2, GGML_P9ML_NOISE_GAUSSIAN, 0.05f);
+    ggml_p9ml_membrane_add_object(root, w1);
+    ggml_p9ml_membrane_add_object(root, w2);
+    
+    float * orig = (float *) malloc(ggml_nbytes(w1));
+    memcpy(orig, w1->data, ggml_nbytes(w1));
+    
+    // Types that need an importance matrix fail on uncalibrated objects
+    struct ggml_p9ml_qat_config * iq2 = ggml_p9ml_qat_config_new(GGML_TYPE_IQ2_XXS, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(root, iq2) != 0);
+    
+    struct ggml_p9ml_qat_config * q4 = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_K, 0.0f);
+    q4->per_channel = true;
+    q4->scale_steps = 8;
+    q4->scale_range = 0.16f;
+    assert(ggml_p9ml_calibrate(root, q4) == 0);
+    
+    for (int i = 0; i < 2; i++) {
+        const struct ggml_p9ml_calibration * cal = &root->calibrations[i];
+        assert(cal->imatrix != NULL && cal->n_cols == root->objects[i]->ne[0]);
+        for (int64_t j = 0; j < cal->n_cols; j++) {
+            assert(cal->imatrix[j] > 0.0f && isfinite(cal->imatrix[j]));
+        }
+    }
+    // w1 sees unit Gaussian inputs
+    assert(fabsf(root->calibrations[0].imatrix[0] - 1.0f) < 0.5f);
+    
+    // Scales only for the layer Q4_K can quantize, one per 256-element block (one per row), on both sides of 1
+    assert(root->calibrations[0].n_rows == 64 && root->calibrations[1].n_rows == 0);
+    assert(root->calibrations[0].n_row_scales == 1);
+    bool below = false;
+    bool above = false;
+    for (int64_t r = 0; r < 64; r++) {
+        const float scale = root->calibrations[0].scales[r];
+        assert(scale >= 0.84f - 1e-6f && scale <= 1.16f + 1e-6f);
+        below = below || scale < 1.0f;
+        above = above || scale > 1.0f;
+    }
+    assert(below && above);
+    
+    // Calibrated objects become quantizable to IQ2_XXS
+    assert(ggml_p9ml_apply_data_free_qat(root, iq2) == 0);
+    assert(root->object_errors[0] >= 0.0f && isfinite(root->object_errors[0]));
+    
+    // The same seed gives the same calibration
+    float imatrix[256];
+    memcpy(imatrix, root->calibrations[0].imatrix, sizeof(imatrix));
+    memcpy(w1->data, orig, ggml_nbytes(w1));
+    ggml_p9ml_membrane_touch(root, 0);
+    assert(ggml_p9ml_calibrate(root, q4) == 0);
+    assert(memcmp(imatrix, root->calibrations[0].imatrix, sizeof(imatrix)) == 0);
+    free(orig);
+    
+    // Q4_0 blocks get one scale each, which the QAT passes apply
+    struct ggml_p9ml_qat_config * q40 = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_0, 0.0f);
+    assert(ggml_p9ml_calibrate(root, q40) == 0);
+    const struct ggml_p9ml_calibration * cal = &root->calibrations[0];
+    assert(cal->n_rows == 64 && cal->n_row_scales == 256/32);
+    assert(root->calibrations[1].n_rows == 32 && root->calibrations[1].n_row_scales == 64/32);
+    assert(ggml_p9ml_forward_tiled_qat(root, q40, NULL) == 0);
+    
+    float src[256];
+    float deq[256];
+    char  q[256*sizeof(float)];
+    double sum = 0.0;
+    for (int64_t r = 0; r < 64; r++) {
+        const float * row = (const float *) w1->data + r*256;
+        for (int64_t j = 0; j < 256; j++) {
+            src[j] = cal->scales[r*8 + j/32]*row[j];
+        }
+        ggml_quantize_chunk(GGML_TYPE_Q4_0, src, q, 0, 1, 256, cal->imatrix);
+        ggml_get_type_traits(GGML_TYPE_Q4_0)->to_float(q, deq, 256);
+        for (int64_t j = 0; j < 256; j++) {
+            const double d = (double) row[j] - deq[j]/cal->scales[r*8 + j/32];
+            sum += d*d;
+        }
+    }
+    const float expected = (float) sqrt(sum / (64.0*256.0));
+    assert(fabsf(root->object_errors[0] - expected) <= 1e-4f*expected);
+    
+    ggml_p9ml_qat_config_free(q40);
+    ggml_p9ml_qat_config_free(q4);
+    ggml_p9ml_qat_config_free(iq2);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Calibration test passed\n\n");
+}
+
+static void test_qat_train(void) {
+    printf("Testing STE QAT training...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("ste", backend);
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "root", 0, ctx);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    // Two chained layers, the second one sees correlated inputs
+    struct ggml_tensor * w1 = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 256, 256);
+    struct ggml_tensor * w2 = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, 256, 64);
+    ggml_p9ml_noise_fill((float *) w1->data, ggml_nelements(w1), 0, 11, 1, GGML_P9ML_NOISE_GAUSSIAN, 0.05f);
+    ggml_p9ml_noise_fill((float *) w2->data, ggml_nelements(w2), 0, 11, 2, GGML_P9ML_NOISE_GAUSSIAN, 0.05f);
+    ggml_p9ml_membrane_add_object(root, w1);
+    ggml_p9ml_membrane_add_object(root, w2);
+    
+    const int64_t n2 = ggml_nelements(w2);
+    float * ref = (float *) malloc(n2*sizeof(float));
+    float * rtn = (float *) malloc(n2*sizeof(float));
+    float * w1_orig = (float *) malloc(ggml_nbytes(w1));
+    memcpy(ref, w2->data, n2*sizeof(float));
+    memcpy(w1_orig, w1->data, ggml_nbytes(w1));
+    
+    // Inputs of the second layer: rms_norm(w1 * x)
+    const int n_samples = 64;
+    float * x  = (float *) malloc(256*n_samples*sizeof(float));
+    float * h  = (float *) malloc(256*n_samples*sizeof(float));
+    ggml_p9ml_noise_fill(x, 256*n_samples, 0, 99, 0, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    for (int s = 0; s < n_samples; s++) {
+        double ms = 0.0;
+        for (int r = 0; r < 256; r++) {
+            float sum = 0.0f;
+            for (int c = 0; c < 256; c++) {
+                sum += ((float *) w1->data)[r*256 + c]*x[s*256 + c];
+            }
+            h[s*256 + r] = sum;
+            ms += (double) sum*sum/256.0;
+        }
+        for (int r = 0; r < 256; r++) {
+            h[s*256 + r] /= (float) sqrt(ms + 1e-6);
+        }
+    }
+    
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q3_K, 0.0f);
+    
+    // Fake-quantized directly
+    assert(ggml_p9ml_apply_data_free_qat(root, config) == 0);
+    memcpy(rtn, w2->data, n2*sizeof(float));
+    memcpy(w2->data, ref, n2*sizeof(float));
+    memcpy(w1->data, w1_orig, ggml_nbytes(w1));
+    ggml_p9ml_membrane_touch(root, -1);
+    
+    // Distilled with the straight-through estimator
+    config->num_steps = 200;
+    config->learning_rate = 1e-5f;
+    assert(ggml_p9ml_qat_train(root, config) == 0);
+    assert(root->object_errors[1] >= 0.0f);
+    
+    // Output error of the second layer
+    double err_rtn = 0.0;
+    double err_ste = 0.0;
+    for (int s = 0; s < n_samples; s++) {
+        for (int r = 0; r < 64; r++) {
+            float d_rtn = 0.0f;
+            float d_ste = 0.0f;
+            for (int c = 0; c < 256; c++) {
+                d_rtn += (rtn[r*256 + c] - ref[r*256 + c])*h[s*256 + c];
+                d_ste += (((float *) w2->data)[r*256 + c] - ref[r*256 + c])*h[s*256 + c];
+            }
+            err_rtn += (double) d_rtn*d_rtn;
+            err_ste += (double) d_ste*d_ste;
+        }
+    }
+    assert(err_ste < err_rtn);
+    
+    free(w1_orig);
+    free(h);
+    free(x);
+    free(rtn);
+    free(ref);
+    ggml_p9ml_qat_config_free(config);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ STE QAT training test passed\n\n");
+}
+
+static void test_fake_quant_op(void) {
+    printf("Testing fake quantization op...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 16 * 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    const int64_t ncols = 256;
+    const int64_t nrows = 8;
+    
+    struct ggml_tensor * a = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ncols, nrows);
+    struct ggml_tensor * s = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, nrows);
+    ggml_p9ml_noise_fill((float *) a->data, ncols*nrows, 0, 5, 0, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    for (int64_t r = 0; r < nrows; r++) {
+        ((float *) s->data)[r] = 1.0f - 0.05f*(float) r;
+    }
+    
+    // Fused (Q8_0, Q4_0) and generic kernels match quantize + dequantize, without scales, with one scale per row
+    // and with one scale per block
+    const enum ggml_type types[] = { GGML_TYPE_Q8_0, GGML_TYPE_Q4_0, GGML_TYPE_Q4_K, GGML_TYPE_IQ4_NL };
+    float * sc  = (float *) malloc(ncols*sizeof(float));
+    float * src = (float *) malloc(ncols*sizeof(float));
+    float * ref = (float *) malloc(ncols*sizeof(float));
+    void  * q   = malloc(ncols*sizeof(float));
+    for (enum ggml_type type : types) {
+        const int64_t blck = ggml_blck_size(type);
+        struct ggml_tensor * sb = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ncols/blck, nrows);
+        for (int64_t i = 0; i < ggml_nelements(sb); i++) {
+            ((float *) sb->data)[i] = 0.9f + 0.03f*(float) (i % 7);
+        }
+        for (int with_scales = 0; with_scales < 3; with_scales++) {
+            struct ggml_tensor * scales = with_scales == 1 ? s : with_scales == 2 ? sb : NULL;
+            struct ggml_tensor * out = ggml_fake_quant_ext(ctx, a, scales, NULL, type);
+            struct ggml_cgraph * gf = ggml_new_graph(ctx);
+            ggml_build_forward_expand(gf, out);
+            assert(ggml_graph_compute_with_ctx(ctx, gf, 4) == GGML_STATUS_SUCCESS);
+            
+            for (int64_t r = 0; r < nrows; r++) {
+                for (int64_t j = 0; j < ncols; j++) {
+                    sc[j]  = with_scales == 1 ? ((float *) s->data)[r] :
+                             with_scales == 2 ? ((float *) sb->data)[r*(ncols/blck) + j/blck] : 1.0f;
+                    src[j] = sc[j]*((float *) a->data)[r*ncols + j];
+                }
+                ggml_quantize_chunk(type, src, q, 0, 1, ncols, NULL);
+                ggml_get_type_traits(type)->to_float(q, ref, ncols);
+                for (int64_t j = 0; j < ncols; j++) {
+                    const float y = ((float *) out->data)[r*ncols + j];
+                    assert(fabsf(y - ref[j]/sc[j]) <= 1e-5f*(1.0f + fabsf(ref[j])));
+                }
+            }
+        }
+    }
+    free(q);
+    free(ref);
+    free(src);
+    free(sc);
+    
+    // The gradient passes through unchanged
+    struct ggml_tensor * w = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ncols, nrows);
+    struct ggml_tensor * c = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ncols, nrows);
+    memcpy(w->data, a->data, ggml_nbytes(a));
+    ggml_p9ml_noise_fill((float *) c->data, ncols*nrows, 0, 5, 1, GGML_P9ML_NOISE_UNIFORM, 1.0f);
+    ggml_set_param(w);
+    
+    struct ggml_tensor * loss = ggml_sum(ctx, ggml_mul(ctx, ggml_fake_quant_ext(ctx, w, s, NULL, GGML_TYPE_Q4_0), c));
+    ggml_set_loss(loss);
+    
+    struct ggml_cgraph * gb = ggml_new_graph_custom(ctx, GGML_DEFAULT_GRAPH_SIZE, true);
+    ggml_build_forward_expand(gb, loss);
+    ggml_build_backward_expand(ctx, gb, NULL);
+    ggml_graph_reset(gb);
+    assert(ggml_graph_compute_with_ctx(ctx, gb, 4) == GGML_STATUS_SUCCESS);
+    
+    const struct ggml_tensor * grad = ggml_graph_get_grad(gb, w);
+    assert(grad != NULL);
+    assert(memcmp(grad->data, c->data, ggml_nbytes(c)) == 0);
+    
+    ggml_free(ctx);
+    
+    printf("✓ Fake quantization op test passed\n\n");
+}
+
+static bool file_exists(const char * fname) {
+    FILE * f = fopen(fname, "rb");
+    if (f) {
+        fclose(f);
+    }
+    return f != NULL;
+}
+
+static void test_memory_budget(void) {
+    printf("Testing memory budget...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 4 * 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("budget", backend);
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "model", 0, ctx);
+    struct ggml_p9ml_membrane * a    = ggml_p9ml_namespace_membrane_new(ns, "a", 1, ctx);
+    struct ggml_p9ml_membrane * b    = ggml_p9ml_namespace_membrane_new(ns, "b", 1, ctx);
+    ggml_p9ml_membrane_add_child(root, a);
+    ggml_p9ml_membrane_add_child(root, b);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    const int64_t n = 256;
+    struct ggml_tensor * wa = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, n, n);
+    struct ggml_tensor * wb = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, n, n);
+    ggml_p9ml_noise_fill((float *) wa->data, n*n, 0, 7, 0, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    ggml_p9ml_noise_fill((float *) wb->data, n*n, 0, 7, 1, GGML_P9ML_NOISE_GAUSSIAN, 1.0f);
+    ggml_p9ml_membrane_add_object(a, wa);
+    ggml_p9ml_membrane_add_object(b, wb);
+    
+    float * ref_a = (float *) malloc(ggml_nbytes(wa));
+    float * ref_b = (float *) malloc(ggml_nbytes(wb));
+    memcpy(ref_a, wa->data, ggml_nbytes(wa));
+    memcpy(ref_b, wb->data, ggml_nbytes(wb));
+    
+    // Accounting
+    assert(a->nbytes == ggml_nbytes(wa) && b->nbytes == ggml_nbytes(wb) && root->nbytes == 0);
+    assert(ggml_p9ml_namespace_memory_used(ns) == ggml_nbytes(wa) + ggml_nbytes(wb));
+    assert(ggml_p9ml_namespace_set_memory_budget(ns, ggml_nbytes(wa), NULL) != 0);
+    assert(ggml_p9ml_namespace_set_memory_budget(ns, ggml_nbytes(wa) + 1024, "test-p9ml-spill") == 0);
+    
+    struct ggml_init_params graph_params = {
+        .mem_size = 16 * ggml_tensor_overhead() + 2 * ggml_graph_overhead(),
+        .mem_buffer = NULL,
+        .no_alloc = true,
+    };
+    struct ggml_context * gctx = ggml_init(graph_params);
+    struct ggml_tensor * sum_a = ggml_sum(gctx, wa);
+    struct ggml_tensor * sum_b = ggml_sum(gctx, wb);
+    struct ggml_cgraph * graph_a = ggml_new_graph(gctx);
+    struct ggml_cgraph * graph_b = ggml_new_graph(gctx);
+    ggml_build_forward_expand(graph_a, sum_a);
+    ggml_build_forward_expand(graph_b, sum_b);
+    
+    double expected_a = 0.0;
+    double expected_b = 0.0;
+    for (int64_t i = 0; i < n*n; i++) {
+        expected_a += ref_a[i];
+        expected_b += ref_b[i];
+    }
+    
+    // The membrane the graph does not use is evicted
+    assert(ggml_p9ml_namespace_compute(ns, graph_a) == 0);
+    assert(fabs(((float *) sum_a->data)[0] - expected_a) < 1e-2*(1.0 + fabs(expected_a)));
+    assert(a->spill_id == 0 && b->spill_id != 0);
+    assert(ggml_p9ml_namespace_memory_used(ns) == ggml_nbytes(wa));
+    assert(file_exists("test-p9ml-spill.1.gguf"));
+    
+    // and reloaded when a graph uses it, the other one goes
+    assert(ggml_p9ml_namespace_compute(ns, graph_b) == 0);
+    assert(fabs(((float *) sum_b->data)[0] - expected_b) < 1e-2*(1.0 + fabs(expected_b)));
+    assert(b->spill_id == 0 && a->spill_id != 0);
+    assert(!file_exists("test-p9ml-spill.1.gguf"));
+    assert(memcmp(wb->data, ref_b, ggml_nbytes(wb)) == 0);
+    
+    // Passes reload what they read
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q8_0, 0.0f);
+    assert(ggml_p9ml_forward_tiled_qat(root, config, NULL) == 0);
+    assert(a->spill_id == 0 && memcmp(wa->data, ref_a, ggml_nbytes(wa)) == 0);
+    assert(ggml_p9ml_namespace_memory_used(ns) == ggml_nbytes(wa) + ggml_nbytes(wb));
+    
+    // Explicit eviction, the spill files are removed with the namespace
+    assert(ggml_p9ml_namespace_evict(ns) == 0);
+    assert(ggml_p9ml_namespace_memory_used(ns) <= ns->memory_budget);
+    assert(ggml_p9ml_membrane_evict(a) == 0 && ggml_p9ml_membrane_evict(b) == 0);
+    assert(ggml_p9ml_namespace_memory_used(ns) == 0);
+    char spill[64];
+    snprintf(spill, sizeof(spill), "test-p9ml-spill.%llu.gguf", (unsigned long long) a->spill_id);
+    assert(file_exists(spill));
+    assert(ggml_p9ml_membrane_reload(a) == 0 && memcmp(wa->data, ref_a, ggml_nbytes(wa)) == 0);
+    snprintf(spill, sizeof(spill), "test-p9ml-spill.%llu.gguf", (unsigned long long) b->spill_id);
+    
+    // Objects viewed by another membrane stay resident
+    assert(ggml_p9ml_membrane_reload(b) == 0 && !file_exists(spill));
+    struct ggml_p9ml_membrane * c = ggml_p9ml_namespace_membrane_new(ns, "c", 1, ctx);
+    ggml_p9ml_membrane_add_object(c, ggml_view_1d(ctx, wb, n, 0));
+    ggml_p9ml_membrane_add_child(root, c);
+    assert(ggml_p9ml_membrane_evict(b) != 0 && b->spill_id == 0);
+    
+    // A failed eviction does not fail the compute
+    assert(ggml_p9ml_namespace_set_memory_budget(ns, 1, "missing-p9ml-dir/spill") == 0);
+    assert(ggml_p9ml_namespace_compute(ns, graph_b) == 0);
+    assert(ns->evict_status != 0 && a->spill_id == 0);
+    
+    // and neither are objects held by two membranes
+    struct ggml_p9ml_membrane * d = ggml_p9ml_namespace_membrane_new(ns, "d", 1, ctx);
+    ggml_p9ml_membrane_add_object(d, wa);
+    ggml_p9ml_membrane_add_child(root, d);
+    assert(ggml_p9ml_namespace_compute(ns, graph_b) == 0);
+    assert(ns->evict_status == 0 && a->spill_id == 0 && d->spill_id == 0);
+    
+    ggml_p9ml_print_namespace_stats(ns);
+    
+    ggml_p9ml_qat_config_free(config);
+    ggml_free(gctx);
+    ggml_p9ml_namespace_free(ns);
+    assert(!file_exists(spill));
+    free(ref_a);
+    free(ref_b);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Memory budget test passed\n\n");
+}
+
+static void test_namespace_find(void) {
+    printf("Testing namespace object lookup...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("lookup", NULL);
+    struct ggml_p9ml_membrane * root  = ggml_p9ml_namespace_membrane_new(ns, "model", 0, ctx);
+    struct ggml_p9ml_membrane * attn  = ggml_p9ml_namespace_membrane_new(ns, "attn", 1, ctx);
+    struct ggml_p9ml_membrane * ffn   = ggml_p9ml_namespace_membrane_new(ns, "ffn", 1, ctx);
+    struct ggml_p9ml_membrane * inner = ggml_p9ml_namespace_membrane_new(ns, "inner", 2, ctx);
+    ggml_p9ml_membrane_add_child(root, attn);
+    ggml_p9ml_membrane_add_child(root, ffn);
+    ggml_p9ml_membrane_add_child(ffn, inner);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    struct ggml_tensor * q  = ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16), "q");
+    struct ggml_tensor * k  = ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16), "attn.k_proj");
+    struct ggml_tensor * iq = ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16), "q");
+    ggml_p9ml_membrane_add_object(inner, iq);
+    ggml_p9ml_membrane_add_object(attn, q);
+    ggml_p9ml_membrane_add_object(attn, k);
+    
+    // Names resolve to the first object in breadth-first order, paths to their membrane
+    struct ggml_p9ml_membrane * membrane = NULL;
+    int slot = -1;
+    assert(ggml_p9ml_namespace_find(ns, "q", &membrane, &slot) == q && membrane == attn && slot == 0);
+    assert(ggml_p9ml_namespace_find(ns, "attn.k_proj", &membrane, &slot) == k && membrane == attn && slot == 1);
+    assert(ggml_p9ml_namespace_find(ns, "model/attn/q", NULL, NULL) == q);
+    assert(ggml_p9ml_namespace_find(ns, "model/ffn/inner/q", &membrane, &slot) == iq && membrane == inner && slot == 0);
+    assert(ggml_p9ml_namespace_find(ns, "model/ffn/q", NULL, NULL) == NULL);
+    assert(ggml_p9ml_namespace_find(ns, "missing", NULL, NULL) == NULL);
+    
+    // Objects added later are indexed as they are added
+    struct ggml_tensor * w = ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16), "ffn.w");
+    ggml_p9ml_membrane_add_object(ffn, w);
+    assert(ns->index != NULL);
+    assert(ggml_p9ml_namespace_find(ns, "ffn.w", NULL, NULL) == w);
+    assert(ggml_p9ml_namespace_find(ns, "model/ffn/ffn.w", NULL, NULL) == w);
+    
+    // An object shadowing a deeper one with the same name rebuilds the index
+    struct ggml_tensor * rq = ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16), "q");
+    ggml_p9ml_membrane_add_object(root, rq);
+    assert(ggml_p9ml_namespace_find(ns, "q", &membrane, NULL) == rq && membrane == root);
+    assert(ggml_p9ml_namespace_find(ns, "model/q", NULL, NULL) == rq);
+    
+    // and so do structural changes
+    struct ggml_p9ml_membrane * extra = ggml_p9ml_namespace_membrane_new(ns, "extra", 2, ctx);
+    struct ggml_tensor * e = ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16), "extra.e");
+    ggml_p9ml_membrane_add_object(extra, e);
+    assert(ggml_p9ml_namespace_find(ns, "extra.e", NULL, NULL) == NULL);
+    ggml_p9ml_membrane_add_child(attn, extra);
+    assert(ggml_p9ml_namespace_find(ns, "model/attn/extra/extra.e", &membrane, &slot) == e && membrane == extra && slot == 0);
+    
+    // including freeing a subtree still in the tree
+    ggml_p9ml_membrane_free(extra);
+    assert(attn->num_children == 0);
+    assert(ggml_p9ml_namespace_find(ns, "extra.e", NULL, NULL) == NULL);
+    assert(ggml_p9ml_namespace_find(ns, "model/attn/q", NULL, NULL) == q);
+    
+    // Many objects
+    char name[GGML_MAX_NAME];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "blk.%d.weight", i);
+        ggml_p9ml_membrane_add_object(inner, ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 1), name));
+    }
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "model/ffn/inner/blk.%d.weight", i);
+        assert(ggml_p9ml_namespace_find(ns, name, &membrane, &slot) == inner->objects[i + 1] && slot == i + 1);
+    }
+    
+    ggml_p9ml_namespace_free(ns);
+    ggml_free(ctx);
+    
+    printf("✓ Namespace object lookup test passed\n\n");
+}
+
+static void test_zero_copy_rules(void) {
+    printf("Testing zero-copy move and share rules...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("transfer", backend);
+    
+    const int64_t n = 1024;
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "model", 0, ctx);
+    struct ggml_p9ml_membrane * blk  = ggml_p9ml_namespace_membrane_new(ns, "blk", 1, ctx);
+    ggml_p9ml_membrane_add_child(root, blk);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    struct ggml_tensor * r = ggml_set_name(new_filled(ctx, n, 1.0f, 0.5f), "r");
+    struct ggml_tensor * w = ggml_set_name(new_filled(ctx, n, 2.0f, 0.0f), "w");
+    struct ggml_tensor * b = ggml_set_name(new_filled(ctx, n, 1.0f, 0.0f), "b");
+    ggml_p9ml_membrane_add_object(root, r);
+    ggml_p9ml_membrane_add_object(blk, w);
+    ggml_p9ml_membrane_add_object(blk, b);
+    blk->object_errors[0] = 0.25f;
+    const void * w_data = w->data;
+    
+    // w moves up, the transform of b follows its slot, r is shared down
+    assert(ggml_p9ml_membrane_add_rule(blk, ggml_p9ml_rule_move(0, -1)) == 0);
+    assert(ggml_p9ml_membrane_add_rule(blk, ggml_p9ml_rule_transform(1, rule_double, NULL)) == 0);
+    assert(ggml_p9ml_membrane_add_rule(root, ggml_p9ml_rule_share(0, 0)) == 0);
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    
+    assert(root->num_objects == 2 && root->objects[1] == w && w->data == w_data);
+    assert(root->object_errors[1] == 0.25f);
+    assert(blk->num_objects == 2 && blk->objects[0] == b);
+    assert(((float *) b->data)[0] == 2.0f);
+    struct ggml_tensor * alias = blk->objects[1];
+    assert(alias->view_src == r && alias->data == r->data && strcmp(alias->name, "r") == 0);
+    assert(blk->object_states[1].alias && blk->object_states[1].refs == root->object_states[0].refs);
+    assert(*root->object_states[0].refs == 2);
+    assert(root->nbytes == ggml_nbytes(r) + ggml_nbytes(w) && blk->nbytes == ggml_nbytes(b));
+    assert(ggml_p9ml_namespace_find(ns, "model/w", NULL, NULL) == w);
+    assert(ggml_p9ml_namespace_find(ns, "model/blk/r", NULL, NULL) == alias);
+    
+    // Transfer rules fire once, the others keep running on the renumbered slots
+    assert(root->num_rules == 0 && blk->num_rules == 1 && blk->rules[0].object == 0);
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    assert(((float *) b->data)[0] == 4.0f && ((float *) w->data)[0] == 2.0f);
+    
+    // An object moved twice fails the step before anything is computed or moved
+    assert(ggml_p9ml_membrane_add_rule(blk, ggml_p9ml_rule_move(0, -1)) == 0);
+    assert(ggml_p9ml_membrane_add_rule(blk, ggml_p9ml_rule_move(0, -1)) == 0);
+    assert(ggml_p9ml_membrane_evolve(root) != 0);
+    assert(root->num_objects == 2 && blk->num_objects == 2 && blk->objects[0] == b);
+    assert(((float *) b->data)[0] == 4.0f);
+    blk->num_rules = 1;
+    
+    // Shared data is quantized once, through its owner
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q8_0, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(root, config) == 0);
+    assert(root->object_errors[0] >= 0.0f && blk->object_errors[1] < 0.0f);
+    ggml_p9ml_qat_config_free(config);
+    
+    // The sharing counts follow the objects of dissolved membranes, ggml_p9ml_membrane_free removes its slots
+    struct ggml_p9ml_membrane * parent = ggml_p9ml_membrane_new("parent", 0, ctx);
+    struct ggml_p9ml_membrane * child  = ggml_p9ml_membrane_new("child", 1, ctx);
+    ggml_p9ml_membrane_add_child(parent, child);
+    ggml_p9ml_membrane_add_object(parent, new_filled(ctx, n, 0.0f, 1.0f));
+    assert(ggml_p9ml_membrane_add_rule(parent, ggml_p9ml_rule_share(0, 0)) == 0);
+    assert(ggml_p9ml_membrane_add_rule(parent, ggml_p9ml_rule_share(0, 5)) == 0);
+    assert(ggml_p9ml_membrane_evolve(parent) != 0); // needs a namespace, and child 5 does not exist
+    parent->num_rules = 1;
+    parent->ns = ns;
+    assert(ggml_p9ml_membrane_evolve(parent) == 0);
+    assert(child->num_objects == 1 && *child->object_states[0].refs == 2);
+    assert(ggml_p9ml_membrane_add_rule(child, ggml_p9ml_rule_dissolve()) == 0);
+    assert(ggml_p9ml_membrane_evolve(parent) == 0);
+    assert(parent->num_children == 0 && parent->num_objects == 2);
+    assert(parent->object_states[1].refs == parent->object_states[0].refs && *parent->object_states[0].refs == 2);
+    ggml_p9ml_membrane_free(parent);
+    
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Zero-copy move and share rules test passed\n\n");
+}
+
+static void test_cow_division(void) {
+    printf("Testing copy-on-write membrane division...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("ensemble", backend);
+    
+    const int64_t n = 1024;
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "model", 0, ctx);
+    struct ggml_p9ml_membrane * blk  = ggml_p9ml_namespace_membrane_new(ns, "blk", 1, ctx);
+    struct ggml_p9ml_membrane * sub  = ggml_p9ml_namespace_membrane_new(ns, "sub", 2, ctx);
+    ggml_p9ml_membrane_add_child(root, blk);
+    ggml_p9ml_membrane_add_child(blk, sub);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    struct ggml_tensor * w = ggml_set_name(new_filled(ctx, n, -3.0f, 0.0061f), "w");
+    struct ggml_tensor * b = ggml_set_name(ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 100), "b"); // not quantizable
+    struct ggml_tensor * s = ggml_set_name(new_filled(ctx, n, 1.0f, -0.0023f), "s");
+    for (int64_t i = 0; i < ggml_nelements(b); i++) {
+        ((float *) b->data)[i] = 1.0f;
+    }
+    ggml_p9ml_membrane_add_object(blk, w);
+    ggml_p9ml_membrane_add_object(blk, b);
+    ggml_p9ml_membrane_add_object(sub, s);
+    
+    float * w_values = (float *) malloc(ggml_nbytes(w));
+    memcpy(w_values, w->data, ggml_nbytes(w));
+    const void * w_data = w->data;
+    const size_t used = ggml_p9ml_namespace_memory_used(ns);
+    
+    // The clone of the subtree reads the data of the originals
+    assert(ggml_p9ml_membrane_divide(root) == NULL);
+    struct ggml_p9ml_membrane * clone = ggml_p9ml_membrane_divide(blk);
+    assert(clone != NULL && root->num_children == 2 && root->children[1] == clone);
+    assert(strcmp(clone->name, "blk") == 0 && clone->ns == ns);
+    assert(clone->num_objects == 2 && clone->num_children == 1);
+    assert(clone->objects[0] != w && clone->objects[0]->data == w->data);
+    assert(clone->objects[1] != b && clone->objects[1]->data == b->data);
+    assert(clone->children[0] != sub && clone->children[0]->objects[0]->data == s->data);
+    assert(clone->nbytes == 0 && ggml_p9ml_namespace_memory_used(ns) == used);
+    
+    // QAT of the clone copies the objects it writes, the originals do not change
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q8_0, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(clone, config) == 0);
+    assert(clone->objects[0]->data != w->data && clone->objects[1]->data == b->data);
+    assert(clone->children[0]->objects[0]->data != s->data);
+    assert(memcmp(w->data, w_values, ggml_nbytes(w)) == 0);
+    assert(memcmp(clone->objects[0]->data, w_values, ggml_nbytes(w)) != 0);
+    assert(clone->nbytes == ggml_nbytes(w));
+    assert(ggml_p9ml_namespace_memory_used(ns) == used + ggml_nbytes(w) + ggml_nbytes(s));
+    
+    // The original is quantized in place to the same values
+    assert(ggml_p9ml_apply_data_free_qat(blk, config) == 0);
+    assert(w->data == w_data && memcmp(w->data, clone->objects[0]->data, ggml_nbytes(w)) == 0);
+    
+    // A write to the original hands the clone a copy of the data
+    assert(ggml_p9ml_membrane_add_rule(blk, ggml_p9ml_rule_transform(1, rule_double, NULL)) == 0);
+    assert(ggml_p9ml_membrane_evolve(root) == 0);
+    assert(((float *) b->data)[0] == 2.0f && ((float *) clone->objects[1]->data)[0] == 1.0f);
+    assert(clone->objects[1]->data != b->data);
+    
+    // Objects cloned after the pass are not quantized again
+    struct ggml_p9ml_membrane * clone2 = ggml_p9ml_membrane_divide(blk);
+    assert(clone2 != NULL && root->num_children == 3);
+    assert(clone2->object_states[0].qat_version == clone2->object_states[0].version);
+    assert(ggml_p9ml_apply_data_free_qat(clone2, config) == 0);
+    assert(clone2->objects[0]->data == w->data && clone2->nbytes == 0);
+    assert(ggml_p9ml_membrane_unshare(clone2, -1) == 0);
+    assert(clone2->objects[0]->data != w->data && clone2->nbytes == ggml_nbytes(w) + ggml_nbytes(b));
+    assert(memcmp(clone2->objects[0]->data, w->data, ggml_nbytes(w)) == 0);
+    
+    ggml_p9ml_qat_config_free(config);
+    free(w_values);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Copy-on-write membrane division test passed\n\n");
+}
+
+static const struct ggml_p9ml_stats_record * find_record(
+        const struct ggml_p9ml_namespace * ns, enum ggml_p9ml_pass pass, const char * membrane, bool total) {
+    for (int i = 0; i < ggml_p9ml_namespace_stats_n_records(ns); i++) {
+        const struct ggml_p9ml_stats_record * record = ggml_p9ml_namespace_stats_get(ns, i);
+        if (record->pass == pass && record->total == total && strcmp(record->membrane, membrane) == 0) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+static bool file_contains(const char * fname, const char * text) {
+    FILE * f = fopen(fname, "rb");
+    if (!f) {
+        return false;
+    }
+    char * buf = (char *) calloc(1, 1 << 16);
+    fread(buf, 1, (1 << 16) - 1, f);
+    fclose(f);
+    const bool found = strstr(buf, text) != NULL;
+    free(buf);
+    return found;
+}
+
+static void test_stats(void) {
+    printf("Testing instrumentation...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    ggml_backend_cpu_set_n_threads(backend, 2);
+    struct ggml_p9ml_namespace * ns = ggml_p9ml_namespace_new("stats", backend);
+    
+    const int64_t n = 4096;
+    struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(ns, "model", 0, ctx);
+    struct ggml_p9ml_membrane * blk  = ggml_p9ml_namespace_membrane_new(ns, "blk", 1, ctx);
+    struct ggml_p9ml_membrane * sub  = ggml_p9ml_namespace_membrane_new(ns, "sub", 2, ctx);
+    ggml_p9ml_membrane_add_child(root, blk);
+    ggml_p9ml_membrane_add_child(blk, sub);
+    ggml_p9ml_namespace_set_root(ns, root);
+    
+    struct ggml_tensor * w = ggml_set_name(new_filled(ctx, n, -3.0f, 0.0013f), "w");
+    struct ggml_tensor * s = ggml_set_name(new_filled(ctx, n, 1.0f, -0.0007f), "s");
+    ggml_p9ml_membrane_add_object(blk, w);
+    ggml_p9ml_membrane_add_object(sub, s);
+    
+    // Nothing is recorded until the stats are enabled
+    struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_0, 0.0f);
+    assert(ggml_p9ml_apply_data_free_qat(root, config) == 0);
+    assert(ggml_p9ml_namespace_stats_n_records(ns) == 0);
+    assert(ggml_p9ml_namespace_set_stats(ns, GGML_P9ML_STATS_PASSES | GGML_P9ML_STATS_NODES) == 0);
+    
+    // A QAT pass records each membrane it quantized and its total
+    config->target_type = GGML_TYPE_Q8_0;
+    assert(ggml_p9ml_apply_data_free_qat(root, config) == 0);
+    const struct ggml_p9ml_stats_record * total = find_record(ns, GGML_P9ML_PASS_QAT, "model", true);
+    const struct ggml_p9ml_stats_record * rblk  = find_record(ns, GGML_P9ML_PASS_QAT, "model/blk", false);
+    const struct ggml_p9ml_stats_record * rsub  = find_record(ns, GGML_P9ML_PASS_QAT, "model/blk/sub", false);
+    assert(total != NULL && rblk != NULL && rsub != NULL);
+    assert(total->run == 1 && rblk->run == 1 && rsub->run == 1);
+    assert(rblk->n_quantized == (uint64_t) n && rsub->n_quantized == (uint64_t) n);
+    assert(total->n_quantized == 2*(uint64_t) n);
+    assert(total->bytes_read == ggml_nbytes(w) + ggml_nbytes(s) && total->bytes_written == total->bytes_read);
+    assert(total->n_threads == 2);
+    assert(total->t_start_us <= rblk->t_start_us && rsub->t_end_us <= total->t_end_us);
+    assert(total->sq_err > 0.0 && total->sq_err < 1e-3*total->sq_src);
+    assert(fabs(total->sq_err - rblk->sq_err - rsub->sq_err) < 1e-6*total->sq_err);
+    
+    // Node timing charges each node to the membrane of the objects it reads
+    struct ggml_init_params graph_params = {
+        .mem_size = 16 * ggml_tensor_overhead() + ggml_graph_overhead(),
+        .mem_buffer = NULL,
+        .no_alloc = true,
+    };
+    struct ggml_context * gctx = ggml_init(graph_params);
+    struct ggml_tensor * sw  = ggml_scale(gctx, w, 2.0f);
+    struct ggml_tensor * ss  = ggml_mul(gctx, s, s);
+    struct ggml_tensor * out = ggml_add(gctx, sw, ss);
+    struct ggml_cgraph * graph = ggml_new_graph(gctx);
+    ggml_build_forward_expand(graph, out);
+    assert(ggml_p9ml_namespace_compute(ns, graph) == 0);
+    
+    const struct ggml_p9ml_stats_record * cblk = find_record(ns, GGML_P9ML_PASS_COMPUTE, "model/blk", false);
+    const struct ggml_p9ml_stats_record * csub = find_record(ns, GGML_P9ML_PASS_COMPUTE, "model/blk/sub", false);
+    const struct ggml_p9ml_stats_record * ctot = find_record(ns, GGML_P9ML_PASS_COMPUTE, "model", true);
+    assert(cblk != NULL && csub != NULL && ctot != NULL && ctot->run == 2);
+    assert(cblk->bytes_written == 2*ggml_nbytes(w) && cblk->bytes_read == 3*ggml_nbytes(w));
+    assert(csub->bytes_written == ggml_nbytes(s) && csub->bytes_read == 2*ggml_nbytes(s));
+    assert(ctot->bytes_written == cblk->bytes_written + csub->bytes_written);
+    
+    assert(ggml_p9ml_namespace_stats_write_json(ns, "test-p9ml-stats.json") == 0);
+    assert(ggml_p9ml_namespace_stats_write_trace(ns, "test-p9ml-trace.json") == 0);
+    assert(file_contains("test-p9ml-stats.json", "\"model/blk/sub\""));
+    assert(file_contains("test-p9ml-stats.json", "\"rmse\""));
+    assert(file_contains("test-p9ml-trace.json", "\"traceEvents\""));
+    assert(file_contains("test-p9ml-trace.json", "\"thread_name\""));
+    remove("test-p9ml-stats.json");
+    remove("test-p9ml-trace.json");
+    ggml_p9ml_print_namespace_stats(ns);
+    
+    // Reset keeps recording from run 1, disabling drops the records
+    ggml_p9ml_namespace_stats_reset(ns);
+    assert(ggml_p9ml_namespace_stats_n_records(ns) == 0);
+    assert(ggml_p9ml_namespace_compute(ns, graph) == 0);
+    assert(ggml_p9ml_namespace_stats_n_records(ns) > 0 && ggml_p9ml_namespace_stats_get(ns, 0)->run == 1);
+    assert(ggml_p9ml_namespace_set_stats(ns, 0) == 0);
+    assert(ggml_p9ml_namespace_stats_n_records(ns) == 0 && ns->stats == NULL);
+    
+    ggml_free(gctx);
+    ggml_p9ml_qat_config_free(config);
+    ggml_p9ml_namespace_free(ns);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ Instrumentation test passed\n\n");
+}
+
+static void test_numa_placement(void) {
+    printf("Testing NUMA placement...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    ggml_backend_cpu_set_n_threads(backend, 3);
+    struct ggml_p9ml_namespace * ns  = ggml_p9ml_namespace_new("numa", backend);
+    struct ggml_p9ml_namespace * ref = ggml_p9ml_namespace_new("flat", backend);
+    
+    const int64_t n = 8192;
+    struct ggml_p9ml_membrane * membranes[2][3];
+    struct ggml_p9ml_namespace * namespaces[2] = { ns, ref };
+    for (int k = 0; k < 2; k++) {
+        membranes[k][0] = ggml_p9ml_namespace_membrane_new(namespaces[k], "model", 0, ctx);
+        membranes[k][1] = ggml_p9ml_namespace_membrane_new(namespaces[k], "a", 1, ctx);
+        membranes[k][2] = ggml_p9ml_namespace_membrane_new(namespaces[k], "b", 2, ctx);
+        ggml_p9ml_membrane_add_child(membranes[k][0], membranes[k][1]);
+        ggml_p9ml_membrane_add_child(membranes[k][1], membranes[k][2]);
+        ggml_p9ml_namespace_set_root(namespaces[k], membranes[k][0]);
+        for (int m = 0; m < 3; m++) {
+            ggml_p9ml_membrane_add_object(membranes[k][m], new_filled(ctx, n, -2.0f + m, 0.0005f));
+            ggml_p9ml_membrane_add_object(membranes[k][m], new_filled(ctx, n/2, 1.0f, -0.0003f*(m + 1)));
+        }
+    }
+    struct ggml_p9ml_membrane * root = membranes[0][0];
+    struct ggml_p9ml_membrane * a    = membranes[0][1];
+    struct ggml_p9ml_membrane * b    = membranes[0][2];
+    
+    // No topology before ggml_numa_init
+    assert(ggml_numa_n_nodes() == 0 && ggml_numa_thread_node(0) == -1);
+    assert(ggml_p9ml_membrane_set_numa_node(a, 0) != 0);
+    
+    ggml_numa_init(GGML_NUMA_STRATEGY_DISTRIBUTE);
+    const int n_nodes = ggml_numa_n_nodes();
+    if (n_nodes == 0) {
+        printf("  no NUMA topology, skipped\n");
+    } else {
+        for (int ith = 0; ith < 8; ith++) {
+            assert(ggml_numa_thread_node(ith) == ith % n_nodes);
+        }
+        assert(ggml_p9ml_membrane_set_numa_node(a, n_nodes) != 0);
+        assert(ggml_p9ml_membrane_set_numa_node(a, -2) != 0);
+        assert(ggml_p9ml_membrane_set_numa_node(root, 0) == 0);
+        assert(ggml_p9ml_membrane_set_numa_node(root, -1) == 0);
+        assert(ggml_p9ml_membrane_set_numa_node(a, n_nodes - 1) == 0);
+        assert(b->numa_node == -1);
+        
+        // The tasks of a and b are queued for their node, those of the root are unplaced: same results as no placement
+        struct ggml_p9ml_qat_config * config = ggml_p9ml_qat_config_new(GGML_TYPE_Q4_0, 0.01f);
+        assert(ggml_p9ml_apply_data_free_qat(root, config) == 0);
+        assert(ggml_p9ml_apply_data_free_qat(membranes[1][0], config) == 0);
+        for (int m = 0; m < 3; m++) {
+            for (int i = 0; i < 2; i++) {
+                const struct ggml_tensor * t0 = membranes[0][m]->objects[i];
+                const struct ggml_tensor * t1 = membranes[1][m]->objects[i];
+                assert(memcmp(t0->data, t1->data, ggml_nbytes(t0)) == 0);
+                assert(membranes[0][m]->object_errors[i] == membranes[1][m]->object_errors[i]);
+            }
+        }
+        
+        // Clones keep the placement
+        struct ggml_p9ml_membrane * clone = ggml_p9ml_membrane_divide(a);
+        assert(clone != NULL && clone->numa_node == a->numa_node && clone->children[0]->numa_node == -1);
+        
+#if defined(__linux__)
+        assert(ggml_p9ml_namespace_numa_bind(ns) == 0);
+#endif
+        
+        // The other fake-quantization passes
+        assert(ggml_p9ml_mixed_precision_quantize(root, 0.01f) == 0);
+        assert(ggml_p9ml_forward_tiled_qat(root, config, NULL) == 0);
+        
+        ggml_p9ml_qat_config_free(config);
+    }
+    
+    ggml_p9ml_namespace_free(ns);
+    ggml_p9ml_namespace_free(ref);
+    ggml_backend_free(backend);
+    ggml_free(ctx);
+    
+    printf("✓ NUMA placement test passed\n\n");
+}
+
+static void test_batched_executor(void) {
+    printf("Testing batched executor...\n");
+    
+    struct ggml_init_params params = {
+        .mem_size = 1024 * 1024,
+        .mem_buffer = NULL,
+        .no_alloc = false,
+    };
+    struct ggml_context * ctx = ggml_init(params);
+    assert(ctx != NULL);
+    
+    ggml_backend_t backend = ggml_backend_cpu_init();
+    ggml_backend_t cpu1 = ggml_backend_cpu_init();
+    struct ggml_threadpool_params tpp = ggml_threadpool_params_default(2);
+    struct ggml_threadpool * threadpool = ggml_threadpool_new(&tpp);
+    assert(threadpool != NULL);
+    
+    // Three single-backend tenants and one split over two backends
+    const int n_tenants = 4;
+    const int64_t n = 256;
+    struct ggml_p9ml_namespace * tenants[4];
+    struct ggml_tensor * objects[4];
+    for (int t = 0; t < n_tenants; t++) {
+        char name[16];
+        snprintf(name, sizeof(name), "tenant.%d", t);
+        tenants[t] = ggml_p9ml_namespace_new(name, backend);
+        struct ggml_p9ml_membrane * root = ggml_p9ml_namespace_membrane_new(tenants[t], "model", 0, ctx);
+        ggml_p9ml_namespace_set_root(tenants[t], root);
+        objects[t] = new_filled(ctx, n, (float) t, 0.25f);
+        ggml_p9ml_membrane_add_object(root, objects[t]);
+    }
+    assert(ggml_p9ml_namespace_add_backend(tenants[2], cpu1) == 1);
+    
+    // An evicted tenant is reloaded by the run
+    assert(ggml_p9ml_namespace_set_memory_budget(tenants[1], 1 << 20, "test-p9ml-exec-spill") == 0);
+    assert(ggml_p9ml_membrane_evict(tenants[1]->root) == 0 && tenants[1]->root->spill_id != 0);
+    assert(ggml_p9ml_namespace_set_stats(tenants[0], GGML_P9ML_STATS_PASSES) == 0);
+    
+    struct ggml_init_params graph_params = {
+        .mem_size = 64 * ggml_tensor_overhead() + 12 * ggml_graph_overhead(),
+        .mem_buffer = NULL,
+        .no_alloc = true,
+    };
+    struct ggml_context * gctx = ggml_init(graph_params);
+    struct ggml_cgraph * graphs[5];
+    struct ggml_tensor * outs[5];
+    for (int t = 0; t < n_tenants; t++) {
+        outs[t] = ggml_add(gctx, ggml_scale(gctx, objects[t], 2.0f), objects[t]);
+        graphs[t] = ggml_new_graph(gctx);
+        ggml_build_forward_expand(graphs[t], outs[t]);
+    }
+    // a second graph of tenant 0 reads the result of its first one
+    outs[4] = ggml_sum(gctx, outs[0]);
+    graphs[4] = ggml_new_graph(gctx);
+    ggml_build_forward_expand(graphs[4], outs[4]);
+    
+    assert(ggml_p9ml_executor_new(NULL, NULL, 0) == NULL);
+    struct ggml_p9ml_executor * exec = ggml_p9ml_executor_new(backend, threadpool, 0);
+    assert(exec != NULL && exec->max_nodes == GGML_DEFAULT_GRAPH_SIZE);
+    
+    // [0, 1] are batched, 2 is computed by its namespace, [3, 0] are batched
+    const int order[5] = { 0, 1, 2, 3, 4 };
+    for (int i = 0; i < 5; i++) {
+        assert(ggml_p9ml_executor_add(exec, tenants[i < 4 ? i : 0], graphs[order[i]]) == i);
+    }
+    assert(ggml_p9ml_executor_run(exec) == 0);
+    assert(exec->n_batches == 2 && exec->n_single == 1 && exec->n_entries == 0);
+    
+    for (int t = 0; t < n_tenants; t++) {
+        for (int64_t i = 0; i < n; i++) {
+            assert(((float *) outs[t]->data)[i] == 3.0f*((float) t + 0.25f*(float) i));
+        }
+    }
+    const float sum0 = ((float *) outs[4]->data)[0];
+    assert(fabsf(sum0 - 3.0f*0.25f*(float)(n*(n - 1)/2)) < 1e-3f*fabsf(sum0));
+    assert(tenants[1]->root->spill_id == 0);
+    assert(ggml_p9ml_namespace_stats_n_records(tenants[0]) == 2);
+    assert(ggml_p9ml_namespace_stats_get(tenants[0], 0)->pass == GGML_P9ML_PASS_COMPUTE);
+    
+    // Graphs larger than the batch are computed alone (the graphs of a run are new ones)
+    ggml_p9ml_executor_free(exec);
+    exec = ggml_p9ml_executor_new(backend, threadpool, 1);
+    assert(exec != NULL);
+    for (int t = 0; t < 2; t++) {
+        outs[t] = ggml_scale(gctx, objects[3*t], 2.0f);
+        graphs[t] = ggml_new_graph(gctx);
+        ggml_build_forward_expand(graphs[t], outs[t]);
+        assert(ggml_p9ml_executor_add(exec, tenants[3*t], graphs[t]) == t);
+    }
+    assert(ggml_p9ml_executor_run(exec) == 0);
+    assert(exec->n_batches == 2 && exec->n_single == 0);
+    assert(((float *) outs[0]->data)[1] == 0.5f && ((float *) outs[1]->data)[1] == 6.5f);
+    
+    // An intermediate shared with a graph of an earlier batch keeps its result and is not computed again
+    // (mul_mat is not computed in place, sqr would reuse the memory of its source otherwise)
+    struct ggml_tensor * w = new_filled_rows(ctx, 16, 8, 0.0f, 0.125f);
+    struct ggml_tensor * x = new_filled_rows(ctx, 16, 4, 1.0f, -0.25f);
+    struct ggml_tensor * mm = ggml_mul_mat(gctx, w, x);
+    outs[0] = ggml_sqr(gctx, mm);
+    outs[1] = ggml_scale(gctx, mm, 3.0f);
+    for (int t = 0; t < 2; t++) {
+        graphs[t] = ggml_new_graph(gctx);
+        ggml_build_forward_expand(graphs[t], outs[t]);
+        assert(ggml_p9ml_executor_add(exec, tenants[0], graphs[t]) == t);
+    }
+    assert(ggml_p9ml_executor_run(exec) == 0);
+    assert(exec->n_batches == 2);
+    for (int64_t j = 0; j < 4; j++) {
+        for (int64_t i = 0; i < 8; i++) {
+            float dot = 0.0f;
+            for (int64_t k = 0; k < 16; k++) {
+                dot += ((float *) w->data)[i*16 + k]*((float *) x->data)[j*16 + k];
+            }
+            assert(fabsf(((float *) outs[0]->data)[j*8 + i] - dot*dot) <= 1e-4f*(1.0f + dot*dot));
+            assert(fabsf(((float *) outs[1]->data)[j*8 + i] - 3.0f*dot) <= 1e-4f*(1.0f + fabsf(dot)));
+        }
+    }
+    
+    ggml_p9ml_executor_free(exec);
+    ggml_free(gctx);
+    for (int t = 0; t < n_tenants; t++) {
+        ggml_p9ml_namespace_free(tenants[t]);
+    }
+    ggml_backend_free(backend);
+    ggml_backend_free(cpu1);
+    ggml_threadpool_free(threadpool);
+    ggml_free(ctx);
+    
+    printf("✓ Batched executor test passed\n\n");
+}
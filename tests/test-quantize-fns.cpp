@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <vector>
 
@@ -98,6 +99,66 @@ static float dot_product_error(const ggml_type_traits * qfns, const ggml_type_tr
     return fabsf(result - dot_ref) / test_size;
 }
 
+// Largest difference between ggml_fake_quant_ext computed on the CPU backend and ggml_quantize_chunk followed by
+// to_float, with the optional per-row scales applied as by the op: q(s*x)/s
+static float fake_quant_error(ggml_type type, int64_t n_per_row, int64_t nrows, const float * test_data, bool scales) {
+    const size_t n = n_per_row*nrows;
+
+    ggml_init_params params = {
+        /* .mem_size   = */ 4*n*sizeof(float) + 1024*1024,
+        /* .mem_buffer = */ NULL,
+        /* .no_alloc   = */ false,
+    };
+    ggml_context * ctx = ggml_init(params);
+
+    ggml_tensor * a = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, n_per_row, nrows);
+    memcpy(a->data, test_data, n*sizeof(float));
+
+    ggml_tensor * s = nullptr;
+    if (scales) {
+        s = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, nrows);
+        for (int64_t i = 0; i < nrows; i++) {
+            ((float *) s->data)[i] = 0.75f + 0.03125f*i;
+        }
+    }
+
+    ggml_tensor * im = nullptr;
+    if (ggml_quantize_requires_imatrix(type)) {
+        im = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, n_per_row);
+        for (int64_t j = 0; j < n_per_row; j++) {
+            ((float *) im->data)[j] = 1.0f + 0.25f*(j % 7);
+        }
+    }
+
+    ggml_tensor * out = ggml_fake_quant_ext(ctx, a, s, im, type);
+    ggml_cgraph * gf = ggml_new_graph(ctx);
+    ggml_build_forward_expand(gf, out);
+    ggml_graph_compute_with_ctx(ctx, gf, 4);
+
+    std::vector<float> tmp(n_per_row);
+    std::vector<float> ref(n_per_row);
+    std::vector<uint8_t> q(ggml_row_size(type, n_per_row));
+
+    float max_err = 0.0f;
+    for (int64_t i = 0; i < nrows; i++) {
+        const float scale = s ? ((const float *) s->data)[i] : 1.0f;
+        for (int64_t j = 0; j < n_per_row; j++) {
+            tmp[j] = test_data[i*n_per_row + j]*scale;
+        }
+        ggml_quantize_chunk(type, tmp.data(), q.data(), 0, 1, n_per_row, im ? (const float *) im->data : nullptr);
+        ggml_get_type_traits(type)->to_float(q.data(), ref.data(), n_per_row);
+
+        const float * res = (const float *) out->data + i*n_per_row;
+        for (int64_t j = 0; j < n_per_row; j++) {
+            max_err = fmaxf(max_err, fabsf(res[j] - ref[j]*(1.0f/scale)));
+        }
+    }
+
+    ggml_free(ctx);
+
+    return max_err;
+}
+
 int main(int argc, char * argv[]) {
     bool verbose = false;
     const size_t test_size = 32 * 128;
@@ -120,6 +181,13 @@ int main(int argc, char * argv[]) {
     generate_data(0.0, test_data.size(), test_data.data());
     generate_data(1.0, test_data2.size(), test_data2.data());
 
+    // fake quantization data: a block with an absmax of 127 (Q8_0 scale of 1) and values halfway between two steps
+    std::vector<float> test_data_fq(test_data);
+    for (int j = 0; j < 31; j++) {
+        test_data_fq[j] = j - 15.5f;
+    }
+    test_data_fq[31] = 127.0f;
+
     ggml_cpu_init();
 
     int num_failed = 0;
@@ -176,6 +244,18 @@ int main(int argc, char * argv[]) {
                 printf("%5s dot product error:              %s (%f)\n", ggml_type_name(type), RESULT_STR[failed], vec_dot_error);
             }
         }
+
+        if (qfns->to_float && type != GGML_TYPE_F32) {
+            for (bool scales : {false, true}) {
+                // same quantization as ggml_quantize_chunk, including the fused kernels of Q8_0 and Q4_0
+                const float fake_quant_err = fake_quant_error(type, 256, test_size/256, test_data_fq.data(), scales);
+                failed = !(fake_quant_err == 0.0f);
+                num_failed += failed;
+                if (failed || verbose) {
+                    printf("%5s fake quantization error%s:   %s (%f)\n", ggml_type_name(type), scales ? " (scales)" : "         ", RESULT_STR[failed], fake_quant_err);
+                }
+            }
+        }
     }
 
     if (num_failed || verbose) {